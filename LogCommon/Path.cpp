@@ -10,6 +10,11 @@
 #include "Win32Exception.hpp"
 #include "Path.hpp"
 
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define INSTALOG_PATH_SSE2
+#endif
+
 namespace Instalog { namespace Path {
 
     std::wstring Append( std::wstring path, std::wstring const& more )
@@ -360,7 +365,10 @@ namespace Instalog { namespace Path {
     /*
      * Converts a memory buffer to upper case.
      *
-     * @remarks Right now this is Win32 specific.
+     * @remarks Right now this is Win32 specific. Paths are nearly always ASCII, whose upper case
+     *          does not depend on the locale, so runs of ASCII are converted here (eight
+     *          characters at a time where SSE2 is available) and only the rest is handed to
+     *          LCMapStringW.
      */
     void path::uppercase_range(path::size_type length, path::const_pointer start, path::pointer target)
     {
@@ -374,11 +382,55 @@ namespace Instalog { namespace Path {
             std::terminate();
         }
 
-        int asInt = static_cast<int>(length);
-        auto result = ::LCMapStringW(LOCALE_INVARIANT, LCMAP_UPPERCASE, start, asInt, target, asInt);
-        if (!result)
-        {
-            SystemFacades::Win32Exception::ThrowFromLastError();
+#if defined(INSTALOG_PATH_SSE2)
+        __m128i const nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+        __m128i const zero = _mm_setzero_si128();
+        __m128i const beforeLowerA = _mm_set1_epi16(L'a' - 1);
+        __m128i const afterLowerZ = _mm_set1_epi16(L'z' + 1);
+        __m128i const caseBit = _mm_set1_epi16(L'a' - L'A');
+#endif
+        path::size_type index = 0;
+        while (index < length)
+        {
+#if defined(INSTALOG_PATH_SSE2)
+            for (; index + 8 <= length; index += 8)
+            {
+                auto block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(start + index));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(block, nonAscii), zero)) != 0xFFFF)
+                {
+                    break;
+                }
+
+                // Every character is below 0x80, so the signed comparisons are safe.
+                auto lower = _mm_and_si128(_mm_cmpgt_epi16(block, beforeLowerA), _mm_cmplt_epi16(block, afterLowerZ));
+                block = _mm_sub_epi16(block, _mm_and_si128(lower, caseBit));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target + index), block);
+            }
+#endif
+            for (; index < length && start[index] < 0x80; ++index)
+            {
+                auto character = start[index];
+                target[index] = character >= L'a' && character <= L'z' ? static_cast<wchar_t>(character - (L'a' - L'A')) : character;
+            }
+
+            // ASCII is never part of a surrogate pair, so the rest can be split around it.
+            auto runEnd = index;
+            while (runEnd < length && start[runEnd] >= 0x80)
+            {
+                ++runEnd;
+            }
+
+            if (runEnd != index)
+            {
+                int asInt = static_cast<int>(runEnd - index);
+                auto result = ::LCMapStringW(LOCALE_INVARIANT, LCMAP_UPPERCASE, start + index, asInt, target + index, asInt);
+                if (!result)
+                {
+                    SystemFacades::Win32Exception::ThrowFromLastError();
+                }
+
+                index = runEnd;
+            }
         }
     }
 
@@ -393,6 +445,14 @@ namespace Instalog { namespace Path {
         , size_(other.size())
         , base_(new wchar_t[capacity_to_memory_capacity(this->capacity_)])
     {
+        if (other.base_ == nullptr)
+        {
+            // other was default constructed or moved from, and holds no buffer.
+            this->base_[0] = L'\0';
+            this->upperBase()[0] = L'\0';
+            return;
+        }
+
         auto uppercaseBegin = other.upperBase();
         // +1 for null terminator
         std::copy(other.base_, other.base_ + other.size_ + 1, this->base_);
@@ -644,6 +704,12 @@ namespace Instalog { namespace Path {
             std::copy(upperBegin, upperBegin + this->size() + 1, buffer + count + 1);
             delete [] this->base_;
         }
+        else
+        {
+            // Inserts copy the terminators along, so a new buffer needs them too.
+            buffer[0] = L'\0';
+            buffer[count + 1] = L'\0';
+        }
 
         this->base_ = buffer;
         this->capacity_ = count;
@@ -28,6 +28,10 @@
 #include "../pevLib/dosdev.h"
 #include "../pevLib/linkResolve.h"
 #include "../pevLib/wait.hpp"
+#include "../pevLib/hashListCompiler.h"
+#include "../pevLib/dupes.h"
+#include "../pevLib/verify.h"
+#include "../pevLib/strings.h"
 
 int __cdecl wmain(int argc, wchar_t* argv[])
 {
@@ -76,6 +80,14 @@ int __cdecl wmain(int argc, wchar_t* argv[])
         return rexport::main(argc, argv);
     else if (iequals(firstArgument, L"WAIT"))
         return wait::main(argc, argv);
+    else if (iequals(firstArgument, L"HASHLIST"))
+        return hashListCompiler::main(argc, argv);
+    else if (iequals(firstArgument, L"DUPES"))
+        return dupes::main(argc, argv);
+    else if (iequals(firstArgument, L"VERIFY"))
+        return verify::main(argc, argv);
+    else if (iequals(firstArgument, L"STRINGS"))
+        return strings::main(argc, argv);
     return vFind::main();
     }
     catch (std::exception& except)
@@ -8,6 +8,12 @@
 #include "filter.h"
 #include "fileData.h"
 #include "utility.h"
+#include "hashListFile.h"
+#include "peImports.h"
+#include "entropy.h"
+#include "contentSearch.h"
+#include "compiledCriteria.h"
+#include "directoryFilter.h"
 
 std::wstring sizeFilter::debugTreeInternal(const std::wstring& type) const
 {
@@ -28,6 +34,11 @@ BOOL gtSizeFilter::include(FileData &file) const
 {
     return file.getSize() > size;
 }
+bool gtSizeFilter::lower(flatProgram& program) const
+{
+    program.size(flatProgram::GREATER, size);
+    return true;
+}
 std::wstring gtSizeFilter::debugTree() const
 {
     return debugTreeInternal(L"GREATERTHAN");
@@ -38,6 +49,11 @@ BOOL ltSizeFilter::include(FileData &file) const
 {
     return file.getSize() < size;
 }
+bool ltSizeFilter::lower(flatProgram& program) const
+{
+    program.size(flatProgram::LESS, size);
+    return true;
+}
 std::wstring ltSizeFilter::debugTree() const
 {
     return debugTreeInternal(L"LESSTHAN");
@@ -48,6 +64,11 @@ BOOL notSizeFilter::include(FileData &file) const
 {
     return file.getSize() != size;
 }
+bool notSizeFilter::lower(flatProgram& program) const
+{
+    program.size(flatProgram::NOT_EQUAL, size);
+    return true;
+}
 std::wstring notSizeFilter::debugTree() const
 {
     return debugTreeInternal(L"ISNOT");
@@ -58,6 +79,11 @@ BOOL isSizeFilter::include(FileData &file) const
 {
     return file.getSize() == size;
 }
+bool isSizeFilter::lower(flatProgram& program) const
+{
+    program.size(flatProgram::EQUAL, size);
+    return true;
+}
 std::wstring isSizeFilter::debugTree() const
 {
     return debugTreeInternal(L"EQUALS");
@@ -68,66 +94,110 @@ unsigned __int32 dateFilter::getPriorityClass() const
 }
 dateFilter::dateFilter(const FILETIME &inDate) : date(inDate)
 {}
+std::wstring dateFilter::debugTreeInternal(const std::wstring& type) const
+{
+    std::wstring result(type + L" " + getDateAsString(date));
+    //Show fractions of a second too, so that distinct bounds never print the
+    //same; the simplifier tells criteria apart by their debug text.
+    unsigned long ticks = static_cast<unsigned long>(((static_cast<unsigned __int64>(date.dwHighDateTime) << 32) | date.dwLowDateTime) % 10000000);
+    if (ticks)
+    {
+        wchar_t fraction[9];
+        int fractionLength = swprintf_s(fraction, L".%07lu", ticks);
+        result.append(fraction, std::max(fractionLength, 0));
+    }
+    return result;
+}
 accessLDate::accessLDate(const FILETIME &inDate) : dateFilter(inDate)
 {}
 std::wstring accessLDate::debugTree() const
 {
-    return L"ACCESS DATEFILTER LESSTHAN " + getDateAsString(date);
+    return debugTreeInternal(L"ACCESS DATEFILTER LESSTHAN");
 }
 BOOL accessLDate::include(FileData &file) const
 {
     return file.getLastAccessTime() < date;
 }
+bool accessLDate::lower(flatProgram& program) const
+{
+    program.time(flatProgram::ACCESS_TIME, flatProgram::LESS, date);
+    return true;
+}
 accessGDate::accessGDate(const FILETIME &inDate) : dateFilter(inDate)
 {}
 std::wstring accessGDate::debugTree() const
 {
-    return L"ACCESS DATEFILTER GREATERTHAN " + getDateAsString(date);
+    return debugTreeInternal(L"ACCESS DATEFILTER GREATERTHAN");
 }
 BOOL accessGDate::include(FileData &file) const
 {
     return date < file.getLastAccessTime();
 }
+bool accessGDate::lower(flatProgram& program) const
+{
+    program.time(flatProgram::ACCESS_TIME, flatProgram::GREATER, date);
+    return true;
+}
 modifiedLDate::modifiedLDate(const FILETIME &inDate) : dateFilter(inDate)
 {}
 std::wstring modifiedLDate::debugTree() const
 {
-    return L"MOD DATEFILTER LESSTHAN " + getDateAsString(date);
+    return debugTreeInternal(L"MOD DATEFILTER LESSTHAN");
 }
 BOOL modifiedLDate::include(FileData &file) const
 {
     return file.getLastModTime() < date;
 }
+bool modifiedLDate::lower(flatProgram& program) const
+{
+    program.time(flatProgram::MODIFIED_TIME, flatProgram::LESS, date);
+    return true;
+}
 modifiedGDate::modifiedGDate(const FILETIME &inDate) : dateFilter(inDate)
 {}
 std::wstring modifiedGDate::debugTree() const
 {
-    return L"MOD DATEFILTER GREATERTHAN " + getDateAsString(date);
+    return debugTreeInternal(L"MOD DATEFILTER GREATERTHAN");
 }
 BOOL modifiedGDate::include(FileData &file) const
 {
     return date < file.getLastModTime();
 }
+bool modifiedGDate::lower(flatProgram& program) const
+{
+    program.time(flatProgram::MODIFIED_TIME, flatProgram::GREATER, date);
+    return true;
+}
 createdLDate::createdLDate(const FILETIME &inDate) : dateFilter(inDate)
 {}
 std::wstring createdLDate::debugTree() const
 {
-    return L"CREATED DATEFILTER LESSTHAN " + getDateAsString(date);
+    return debugTreeInternal(L"CREATED DATEFILTER LESSTHAN");
 }
 BOOL createdLDate::include(FileData &file) const
 {
     return file.getCreationTime() < date;
 }
+bool createdLDate::lower(flatProgram& program) const
+{
+    program.time(flatProgram::CREATION_TIME, flatProgram::LESS, date);
+    return true;
+}
 createdGDate::createdGDate(const FILETIME &inDate) : dateFilter(inDate)
 {}
 std::wstring createdGDate::debugTree() const
 {
-    return L"CREATED DATEFILTER GREATERTHAN " + getDateAsString(date);
+    return debugTreeInternal(L"CREATED DATEFILTER GREATERTHAN");
 }
 BOOL createdGDate::include(FileData &file) const
 {
     return date < file.getCreationTime();
 }
+bool createdGDate::lower(flatProgram& program) const
+{
+    program.time(flatProgram::CREATION_TIME, flatProgram::GREATER, date);
+    return true;
+}
 unsigned __int32 fastFilter::getPriorityClass() const
 {
     return PRIORITY_FAST_FILTER;
@@ -136,6 +206,11 @@ BOOL isArchive::include(FileData &file) const
 {
     return file.isArchive();
 }
+bool isArchive::lower(flatProgram& program) const
+{
+    program.attributes(FileData::ARCHIVE);
+    return true;
+}
 std::wstring isArchive::debugTree() const
 {
     return std::wstring(L"+ ISARCHIVE");
@@ -144,6 +219,11 @@ BOOL isCompressed::include(FileData &file) const
 {
     return file.isCompressed();
 }
+bool isCompressed::lower(flatProgram& program) const
+{
+    program.attributes(FileData::COMPRESSED);
+    return true;
+}
 std::wstring isCompressed::debugTree() const
 {
     return std::wstring(L"+ ISCOMPRESSED");
@@ -152,6 +232,11 @@ BOOL isDirectory::include(FileData &file) const
 {
     return file.isDirectory();
 }
+bool isDirectory::lower(flatProgram& program) const
+{
+    program.attributes(FileData::DIRECTORY);
+    return true;
+}
 std::wstring isDirectory::debugTree() const
 {
     return std::wstring(L"+ ISDIRECTORY");
@@ -160,6 +245,11 @@ BOOL isFile::include(FileData &file) const
 {
     return file.isFile();
 }
+bool isFile::lower(flatProgram& program) const
+{
+    program.attributes(FileData::FILE);
+    return true;
+}
 std::wstring isFile::debugTree() const
 {
     return std::wstring(L"+ ISFILE");
@@ -168,6 +258,11 @@ BOOL isReparsePoint::include(FileData &file) const
 {
     return file.isReparsePoint();
 }
+bool isReparsePoint::lower(flatProgram& program) const
+{
+    program.attributes(FileData::REPARSE);
+    return true;
+}
 std::wstring isReparsePoint::debugTree() const
 {
     return std::wstring(L"+ ISREPARSEPOINT");
@@ -184,6 +279,11 @@ BOOL isHidden::include(FileData &file) const
 {
     return file.isHidden();
 }
+bool isHidden::lower(flatProgram& program) const
+{
+    program.attributes(FileData::HIDDEN);
+    return true;
+}
 std::wstring isHidden::debugTree() const
 {
     return std::wstring(L"+ ISHIDDEN");
@@ -192,6 +292,11 @@ BOOL isReadOnly::include(FileData &file) const
 {
     return file.isReadOnly();
 }
+bool isReadOnly::lower(flatProgram& program) const
+{
+    program.attributes(FileData::READONLY);
+    return true;
+}
 std::wstring isReadOnly::debugTree() const
 {
     return std::wstring(L"+ ISREADONLY");
@@ -200,6 +305,11 @@ BOOL isSystem::include(FileData &file) const
 {
     return file.isSystem();
 }
+bool isSystem::lower(flatProgram& program) const
+{
+    program.attributes(FileData::SYSTEM);
+    return true;
+}
 std::wstring isSystem::debugTree() const
 {
     return std::wstring(L"+ ISSYSTEM"); 
@@ -208,6 +318,11 @@ BOOL isVolumeLabel::include(FileData &file) const
 {
     return file.isVolumeLabel();
 }
+bool isVolumeLabel::lower(flatProgram& program) const
+{
+    program.attributes(FileData::VOLLABEL);
+    return true;
+}
 std::wstring isVolumeLabel::debugTree() const
 {
     return std::wstring(L"+ ISVOLLABEL");
@@ -216,6 +331,11 @@ BOOL isWritable::include(FileData &file) const
 {
     return file.isWritable();
 }
+bool isWritable::lower(flatProgram& program) const
+{
+    program.attributes(FileData::WRITABLE);
+    return true;
+}
 std::wstring isWritable::debugTree() const
 {
     return std::wstring(L"+ ISWRITABLE");
@@ -224,6 +344,11 @@ BOOL isTemp::include(FileData &file) const
 {
     return file.isTemporary();
 }
+bool isTemp::lower(flatProgram& program) const
+{
+    program.attributes(FileData::TEMPORARY);
+    return true;
+}
 std::wstring isTemp::debugTree() const
 {
     return std::wstring(L"+ ISTEMP");
@@ -284,6 +409,167 @@ std::wstring isDLLFile::debugTree() const
 {
     return std::wstring(L"+ ISDLL");
 }
+unsigned __int32 importsFilter::getPriorityClass() const
+{
+    return PRIORITY_PE_DIRECTORIES;
+}
+BOOL importsFilter::include(FileData &file) const
+{
+    //Decoding the directories maps the file, so only do so for PE images.
+    if (!file.isPE())
+        return false;
+    const peImports* imports = file.getImports();
+    if (!imports)
+        return false;
+    std::vector<peImports::importedFunction> const& functions = imports->getImports();
+    for (std::vector<peImports::importedFunction>::const_iterator it = functions.begin(); it != functions.end(); ++it)
+    {
+        for (std::vector<std::pair<std::string, std::string> >::const_iterator entry = wanted.begin(); entry != wanted.end(); ++entry)
+        {
+            if (peImports::matchesImport(*it, entry->first, entry->second))
+                return true;
+        }
+    }
+    return false;
+}
+std::wstring importsFilter::debugTree() const
+{
+    return L"+ IMPORTS " + importList;
+}
+importsFilter::importsFilter(const std::wstring& importList_) : importList(importList_)
+{
+    std::string const list(convertUnicode(importList));
+    std::size_t begin = 0;
+    while (begin <= list.size())
+    {
+        std::size_t end = list.find(',', begin);
+        if (end == std::string::npos)
+            end = list.size();
+        std::string const entry(list.substr(begin, end - begin));
+        begin = end + 1;
+        if (entry.empty())
+            continue;
+        std::size_t const bang = entry.find('!');
+        std::string const key(bang == std::string::npos
+            ? peImports::makeImportKey(std::string(), entry)
+            : peImports::makeImportKey(entry.substr(0, bang), entry.substr(bang + 1)));
+        std::size_t const keyBang = key.find('!');
+        wanted.push_back(std::make_pair(key.substr(0, keyBang), key.substr(keyBang + 1)));
+    }
+    if (wanted.empty())
+        throw std::runtime_error("-imports needs at least one module!function or function.");
+}
+BOOL magicFilter::include(FileData &file) const
+{
+    return static_cast<BOOL>((wanted >> file.getContentType()) & 1);
+}
+std::wstring magicFilter::debugTree() const
+{
+    return L"+ MAGIC " + typeList;
+}
+magicFilter::magicFilter(const std::wstring& typeList_) : wanted(0), typeList(typeList_)
+{
+    std::string const list(convertUnicode(typeList));
+    std::size_t begin = 0;
+    while (begin <= list.size())
+    {
+        std::size_t end = list.find(',', begin);
+        if (end == std::string::npos)
+            end = list.size();
+        std::string const entry(list.substr(begin, end - begin));
+        begin = end + 1;
+        if (entry.empty())
+            continue;
+        fileMagic::type fileType;
+        if (!fileMagic::fromName(entry, fileType))
+            throw std::runtime_error("Unknown -magic type " + entry + ".");
+        wanted |= 1ull << fileType;
+    }
+    if (!wanted)
+        throw std::runtime_error("-magic needs at least one type.");
+}
+std::wstring entropyFilter::debugTreeInternal(const std::wstring& type) const
+{
+    wchar_t thresholdTemp[16];
+    int result = swprintf_s(thresholdTemp, L"%.3f", threshold);
+    return L"+ " + type + (above ? L" GREATERTHAN " : L" LESSTHAN ") + std::wstring(thresholdTemp, std::max(result, 0));
+}
+std::wstring entropyFilter::identity() const
+{
+    wchar_t thresholdTemp[32];
+    int result = swprintf_s(thresholdTemp, L" %.17g", threshold);
+    return debugTree() + std::wstring(thresholdTemp, std::max(result, 0));
+}
+unsigned __int32 entropyFilter::getPriorityClass() const
+{
+    //Entropy needs the whole file read, like a hash.
+    return PRIORITY_HASH_CHECK;
+}
+entropyFilter::entropyFilter(double threshold_, bool above_) : threshold(threshold_), above(above_)
+{}
+fileEntropyFilter::fileEntropyFilter(double threshold_, bool above_) : entropyFilter(threshold_, above_)
+{}
+BOOL fileEntropyFilter::include(FileData &file) const
+{
+    const peEntropy* entropy = file.getEntropy();
+    if (!entropy)
+        return false;
+    return above ? entropy->getFileEntropy() > threshold : entropy->getFileEntropy() < threshold;
+}
+std::wstring fileEntropyFilter::debugTree() const
+{
+    return debugTreeInternal(L"ENTROPY");
+}
+sectionEntropyFilter::sectionEntropyFilter(double threshold_, bool above_) : entropyFilter(threshold_, above_)
+{}
+BOOL sectionEntropyFilter::include(FileData &file) const
+{
+    //Only PE images have sections; check before reading the file.
+    if (!file.isPE())
+        return false;
+    const peEntropy* entropy = file.getEntropy();
+    if (!entropy || entropy->getSections().empty())
+        return false;
+    double highest = 0.0;
+    std::vector<peEntropy::section> const& sections = entropy->getSections();
+    for (std::vector<peEntropy::section>::const_iterator it = sections.begin(); it != sections.end(); ++it)
+        highest = std::max(highest, it->entropy);
+    return above ? highest > threshold : highest < threshold;
+}
+std::wstring sectionEntropyFilter::debugTree() const
+{
+    return debugTreeInternal(L"SECTIONENTROPY");
+}
+unsigned __int32 isPacked::getPriorityClass() const
+{
+    return PRIORITY_HASH_CHECK;
+}
+BOOL isPacked::include(FileData &file) const
+{
+    if (!file.isPE())
+        return false;
+    const peEntropy* entropy = file.getEntropy();
+    if (!entropy)
+        return false;
+    //Compiled code rarely exceeds 6.5 bits per byte; compressed or encrypted
+    //data is close to 8. Tiny sections are too short to tell.
+    double const packedEntropy = 7.0;
+    std::uint32_t const minimumSize = 512;
+    std::uint32_t const executable = 0x20000000; //IMAGE_SCN_MEM_EXECUTE
+    std::vector<peEntropy::section> const& sections = entropy->getSections();
+    for (std::size_t idx = 0; idx < sections.size(); ++idx)
+    {
+        if (sections[idx].size < minimumSize || sections[idx].entropy <= packedEntropy)
+            continue;
+        if ((sections[idx].characteristics & executable) || idx == entropy->getEntryPointSection())
+            return true;
+    }
+    return false;
+}
+std::wstring isPacked::debugTree() const
+{
+    return std::wstring(L"+ ISPACKED");
+}
 unsigned __int32 hash::getPriorityClass() const
 {
     return PRIORITY_HASH_CHECK;
@@ -315,64 +601,134 @@ sha1Match::sha1Match(std::wstring sha1Value): sha1Val(sha1Value)
 std::wstring hashList::listValues() const
 {
     std::wstring retVal;
-    for( std::vector<std::wstring>::const_iterator it = values.begin(); it != values.end(); it++)
-        retVal.append(L"  ").append(*it).append(L"\r\n");
-    retVal.erase(retVal.end() - 2, retVal.end());
+    for (std::size_t idx = 0; idx < values->size(); idx++)
+        retVal.append(L"  ").append(hashSet::formatHexDigest(values->keyAt(idx), values->digestLength())).append(L"\r\n");
+    if (!retVal.empty())
+        retVal.erase(retVal.end() - 2, retVal.end());
     return retVal;
 }
-hashList::hashList(std::vector<std::wstring> hashes) : values(hashes)
+std::wstring hashList::identityInternal(const std::wstring& type) const
 {
-    std::sort(values.begin(),values.end());
-    for(std::vector<std::wstring>::iterator it = hashes.begin(); it != hashes.end(); it++)
-    {
-        boost::algorithm::to_upper(*it);
-    }
+    wchar_t pointerTemp[24];
+    int result = swprintf_s(pointerTemp, L" %p", static_cast<const void *>(values.get()));
+    return type + std::wstring(pointerTemp, std::max(result, 0));
 }
+hashList::hashList(const std::wstring& listFile, std::size_t digestLength)
+    : values(loadHashList(listFile, digestLength))
+{}
+hashList::hashList(const std::shared_ptr<hashSet>& values_)
+    : values(values_)
+{}
 BOOL md5List::include(FileData &file) const
 {
-    return std::binary_search(values.begin(),values.end(),file.MD5());
+    return values->matchFile(file.getSize(), false, [&file](unsigned char* digest) { return file.MD5Digest(digest) == ERROR_SUCCESS; });
 }
 std::wstring md5List::debugTree() const
 {
     return L"+ MD5 LIST:\r\n" + listValues();
 }
-md5List::md5List(std::vector<std::wstring> md5s): hashList(md5s)
+std::wstring md5List::identity() const
+{
+    return identityInternal(L"+ MD5 LIST");
+}
+md5List::md5List(const std::wstring& listFile): hashList(listFile, CryptoPP::Weak::MD5::DIGESTSIZE)
+{}
+md5List::md5List(const std::shared_ptr<hashSet>& values_): hashList(values_)
 {}
 BOOL sha1List::include(FileData &file) const
 {
-    return std::binary_search(values.begin(),values.end(),file.SHA1());
+    return values->matchFile(file.getSize(), false, [&file](unsigned char* digest) { return file.SHA1Digest(digest) == ERROR_SUCCESS; });
 }
 std::wstring sha1List::debugTree() const
 {
     return L"+ SHA-1 LIST:\r\n" + listValues();
 }
-sha1List::sha1List(std::vector<std::wstring> sha1s): hashList(sha1s)
+std::wstring sha1List::identity() const
+{
+    return identityInternal(L"+ SHA-1 LIST");
+}
+sha1List::sha1List(const std::wstring& listFile): hashList(listFile, CryptoPP::SHA1::DIGESTSIZE)
+{}
+sha1List::sha1List(const std::shared_ptr<hashSet>& values_): hashList(values_)
 {}
 BOOL md5EList::include(FileData &file) const
 {
-    std::wstring calcHash = file.MD5();
-    if (calcHash[0] == L'!')
-        return true;
-    return std::binary_search(values.begin(),values.end(),calcHash);
+    return values->matchFile(file.getSize(), true, [&file](unsigned char* digest) { return file.MD5Digest(digest) == ERROR_SUCCESS; });
 }
 std::wstring md5EList::debugTree() const
 {
     return L"+ MD5 OR ERROR LIST:\r\n" + listValues();
 }
-md5EList::md5EList(std::vector<std::wstring> md5s): hashList(md5s)
+std::wstring md5EList::identity() const
+{
+    return identityInternal(L"+ MD5 OR ERROR LIST");
+}
+md5EList::md5EList(const std::wstring& listFile): hashList(listFile, CryptoPP::Weak::MD5::DIGESTSIZE)
 {}
 BOOL sha1EList::include(FileData &file) const
 {
-    std::wstring calcHash = file.SHA1();
-    if (calcHash[0] == L'!')
-        return true;
-    return std::binary_search(values.begin(),values.end(),calcHash);
+    return values->matchFile(file.getSize(), true, [&file](unsigned char* digest) { return file.SHA1Digest(digest) == ERROR_SUCCESS; });
 }
 std::wstring sha1EList::debugTree() const
 {
     return L"+ SHA-1 OR ERROR LIST:\r\n" + listValues();
 }
-sha1EList::sha1EList(std::vector<std::wstring> sha1s): hashList(sha1s)
+std::wstring sha1EList::identity() const
+{
+    return identityInternal(L"+ SHA-1 OR ERROR LIST");
+}
+sha1EList::sha1EList(const std::wstring& listFile): hashList(listFile, CryptoPP::SHA1::DIGESTSIZE)
+{}
+unsigned __int32 sampleMatch::getPriorityClass() const
+{
+    return PRIORITY_SAMPLE_HASH;
+}
+BOOL sampleMatch::include(FileData &file) const
+{
+    return file.SampleHash() == sampleVal;
+}
+std::wstring sampleMatch::debugTree() const
+{
+    return std::wstring(L"+ SAMPLE MATCHES ").append(sampleVal);
+}
+sampleMatch::sampleMatch(std::wstring sampleValue): sampleVal(sampleValue)
+{
+    boost::algorithm::to_upper(sampleVal);
+}
+unsigned __int32 sampleList::getPriorityClass() const
+{
+    return PRIORITY_SAMPLE_HASH;
+}
+BOOL sampleList::include(FileData &file) const
+{
+    return values->matchFile(file.getSize(), false, [&file](unsigned char* digest) { return file.SampleDigest(digest) == ERROR_SUCCESS; });
+}
+std::wstring sampleList::debugTree() const
+{
+    return L"+ SAMPLE LIST:\r\n" + listValues();
+}
+std::wstring sampleList::identity() const
+{
+    return identityInternal(L"+ SAMPLE LIST");
+}
+sampleList::sampleList(const std::wstring& listFile): hashList(listFile, CryptoPP::SHA1::DIGESTSIZE)
+{}
+unsigned __int32 contentMatch::getPriorityClass() const
+{
+    return PRIORITY_HEX_SEARCH;
+}
+BOOL contentMatch::include(FileData &file) const
+{
+    return file.containsPattern(*patterns, search);
+}
+std::wstring contentMatch::debugTree() const
+{
+    return L"+ CONTAINS " + description;
+}
+contentMatch::contentMatch(const std::shared_ptr<contentPatterns>& patterns_, std::size_t search_, const std::wstring& description_)
+    : patterns(patterns_)
+    , search(search_)
+    , description(description_)
 {}
 unsigned __int32 skipper::getPriorityClass() const 
 { 
@@ -386,15 +742,16 @@ std::wstring skipper::debugTree() const
 { 
     return L"SKIP " + _toSkip;
 }
-unsigned int skipper::directoryCheck(const std::wstring& directory)
+unsigned int skipper::directoryCheck(const std::wstring& directory) const
 {
-    wchar_t relPath[MAX_PATH];
-    if (!PathRelativePathTo(relPath, _toSkip.c_str(), FILE_ATTRIBUTE_DIRECTORY, directory.c_str(), FILE_ATTRIBUTE_DIRECTORY))
-        return DIRECTORY_DONTCARE;
-    if (relPath[0] == L'.' && relPath[1] == NULL)
+    if (directoryFilter::samePath(_toSkip, directory))
         return DIRECTORY_EXCLUDE;
     return DIRECTORY_DONTCARE;
 }
+void skipper::directoryPaths(std::vector<std::wstring>& paths) const
+{
+    paths.push_back(_toSkip);
+}
 skipper::skipper(const std::wstring& toSkip) : _toSkip(toSkip)
 {}
 
@@ -445,7 +802,7 @@ unsigned __int32 headerLDate::getPriorityClass() const
 
 std::wstring headerLDate::debugTree() const
 {
-    return L"HEADER DATEFILTER LESSTHAN " + getDateAsString(date);
+    return debugTreeInternal(L"HEADER DATEFILTER LESSTHAN");
 }
 
 BOOL headerLDate::include(FileData &file) const
@@ -462,7 +819,7 @@ unsigned __int32 headerGDate::getPriorityClass() const
 
 std::wstring headerGDate::debugTree() const
 {
-    return L"HEADER DATEFILTER GREATERTHAN " + getDateAsString(date);
+    return debugTreeInternal(L"HEADER DATEFILTER GREATERTHAN");
 }
 
 BOOL headerGDate::include(FileData &file) const
@@ -8,7 +8,11 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <memory>
 #include "criterion.h"
+#include "hashSet.h"
+
+class contentPatterns;
 
 class sizeFilter : public criterion
 {
@@ -18,6 +22,7 @@ protected:
 public:
     unsigned __int32 getPriorityClass() const;
     sizeFilter(unsigned __int64 createdSize);
+    unsigned __int64 getSize() const { return size; }
 };
 
 struct gtSizeFilter : sizeFilter
@@ -25,6 +30,7 @@ struct gtSizeFilter : sizeFilter
     gtSizeFilter(unsigned __int64 createdSize);
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
 };
 
 struct ltSizeFilter : sizeFilter
@@ -32,6 +38,7 @@ struct ltSizeFilter : sizeFilter
     ltSizeFilter(unsigned __int64 createdSize);
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
 };
 
 struct notSizeFilter : sizeFilter
@@ -39,6 +46,7 @@ struct notSizeFilter : sizeFilter
     notSizeFilter(unsigned __int64 createdSize);
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
 };
 
 struct isSizeFilter : sizeFilter
@@ -46,16 +54,18 @@ struct isSizeFilter : sizeFilter
     isSizeFilter(unsigned __int64 createdSize);
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
 };
 
 class dateFilter : public criterion
 {
 protected:
     FILETIME date;
+    std::wstring debugTreeInternal(const std::wstring& type) const;
 public:
     virtual unsigned __int32 getPriorityClass() const;
     dateFilter(const FILETIME &inDate);
-    
+    const FILETIME& getDate() const { return date; }
 };
 
 struct headerLDate : dateFilter
@@ -80,6 +90,7 @@ public:
     accessLDate(const FILETIME &inDate);
     std::wstring debugTree() const;
     BOOL include(FileData &file) const;
+    bool lower(flatProgram& program) const;
 };
 
 class accessGDate : public dateFilter
@@ -88,6 +99,7 @@ public:
     accessGDate(const FILETIME &inDate);
     std::wstring debugTree() const;
     BOOL include(FileData &file) const;
+    bool lower(flatProgram& program) const;
 };
 
 class modifiedLDate : public dateFilter
@@ -96,6 +108,7 @@ public:
     modifiedLDate(const FILETIME &inDate);
     std::wstring debugTree() const;
     BOOL include(FileData &file) const;
+    bool lower(flatProgram& program) const;
 };
 
 class modifiedGDate : public dateFilter
@@ -104,6 +117,7 @@ public:
     modifiedGDate(const FILETIME &inDate);
     std::wstring debugTree() const;
     BOOL include(FileData &file) const;
+    bool lower(flatProgram& program) const;
 };
 
 class createdLDate : public dateFilter
@@ -112,6 +126,7 @@ public:
     createdLDate(const FILETIME &inDate);
     std::wstring debugTree() const;
     BOOL include(FileData &file) const;
+    bool lower(flatProgram& program) const;
 };
 
 class createdGDate : public dateFilter
@@ -120,6 +135,7 @@ public:
     createdGDate(const FILETIME &inDate);
     std::wstring debugTree() const;
     BOOL include(FileData &file) const;
+    bool lower(flatProgram& program) const;
 };
 
 struct fastFilter : public criterion
@@ -131,26 +147,31 @@ struct isArchive : public fastFilter
 {
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
 };
 struct isCompressed : public fastFilter
 {
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
 };
 struct isDirectory : public fastFilter
 {
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
 };
 struct isFile : public fastFilter
 {
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
 };
 struct isReparsePoint : public fastFilter
 {
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
 };
 struct isSFCProtected : public fastFilter
 {
@@ -161,31 +182,37 @@ struct isHidden : public fastFilter
 {
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
 };
 struct isReadOnly : public fastFilter
 {
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
 };
 struct isSystem : public fastFilter
 {
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
 };
 struct isVolumeLabel : public fastFilter
 {
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
 };
 struct isWritable : public fastFilter
 {
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
 };
 struct isTemp : public fastFilter
 {
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
 };
 struct sigIsValid : public criterion
 {
@@ -247,6 +274,62 @@ struct isDLLFile : public peFilter
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
 };
+class importsFilter : public peFilter
+{
+    //Normalized module and function names, as peImports::matchesImport
+    //takes them. The module is empty for functions which match whatever
+    //module imports them.
+    std::vector<std::pair<std::string, std::string> > wanted;
+    std::wstring importList;
+public:
+    unsigned __int32 getPriorityClass() const;
+    BOOL include(FileData &file) const;
+    std::wstring debugTree() const;
+    importsFilter(const std::wstring& importList);
+};
+class magicFilter : public peFilter
+{
+    //One bit per fileMagic::type
+    unsigned __int64 wanted;
+    std::wstring typeList;
+public:
+    BOOL include(FileData &file) const;
+    std::wstring debugTree() const;
+    magicFilter(const std::wstring& typeList);
+};
+class entropyFilter : public criterion
+{
+protected:
+    double threshold;
+    bool above;
+    std::wstring debugTreeInternal(const std::wstring& type) const;
+public:
+    unsigned __int32 getPriorityClass() const;
+    entropyFilter(double threshold_, bool above_);
+    //The debug text rounds the threshold; this has all of it
+    std::wstring identity() const;
+};
+struct fileEntropyFilter : public entropyFilter
+{
+    fileEntropyFilter(double threshold_, bool above_);
+    BOOL include(FileData &file) const;
+    std::wstring debugTree() const;
+};
+//Compares the highest entropy of any section of a PE image
+struct sectionEntropyFilter : public entropyFilter
+{
+    sectionEntropyFilter(double threshold_, bool above_);
+    BOOL include(FileData &file) const;
+    std::wstring debugTree() const;
+};
+//PE images whose entry point section, or any executable section, looks
+//compressed or encrypted
+struct isPacked : public criterion
+{
+    unsigned __int32 getPriorityClass() const;
+    BOOL include(FileData &file) const;
+    std::wstring debugTree() const;
+};
 
 struct hash : public criterion
 {
@@ -260,6 +343,7 @@ public:
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
     md5Match(std::wstring md5Value);
+    const std::wstring& getValue() const { return md5Val; }
 };
 class sha1Match : public hash
 {
@@ -268,38 +352,80 @@ public:
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
     sha1Match(std::wstring sha1Value);
+    const std::wstring& getValue() const { return sha1Val; }
 };
 class hashList : public hash
 {
 protected:
-    std::vector<std::wstring> values;
+    std::shared_ptr<hashSet> values;
     std::wstring listValues() const;
+    //type and which hashSet is tested; printing every value for each
+    //comparison the simplifier makes would be far too slow
+    std::wstring identityInternal(const std::wstring& type) const;
 public:
-    hashList(std::vector<std::wstring> hashes);
+    hashList(const std::wstring& listFile, std::size_t digestLength);
+    hashList(const std::shared_ptr<hashSet>& values_);
+    const std::shared_ptr<hashSet>& getValues() const { return values; }
 };
 struct md5List : public hashList
 {
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
-    md5List(std::vector<std::wstring> md5s);
+    std::wstring identity() const;
+    md5List(const std::wstring& listFile);
+    md5List(const std::shared_ptr<hashSet>& values_);
 };
 struct sha1List : public hashList
 {
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
-    sha1List(std::vector<std::wstring> sha1s);
+    std::wstring identity() const;
+    sha1List(const std::wstring& listFile);
+    sha1List(const std::shared_ptr<hashSet>& values_);
 };
 struct md5EList : public hashList
 {
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
-    md5EList(std::vector<std::wstring> md5s);
+    std::wstring identity() const;
+    md5EList(const std::wstring& listFile);
 };
 struct sha1EList : public hashList
 {
     BOOL include(FileData &file) const;
     std::wstring debugTree() const;
-    sha1EList(std::vector<std::wstring> sha1s);
+    std::wstring identity() const;
+    sha1EList(const std::wstring& listFile);
+};
+class sampleMatch : public hash
+{
+    std::wstring sampleVal;
+public:
+    unsigned __int32 getPriorityClass() const;
+    BOOL include(FileData &file) const;
+    std::wstring debugTree() const;
+    sampleMatch(std::wstring sampleValue);
+};
+struct sampleList : public hashList
+{
+    unsigned __int32 getPriorityClass() const;
+    BOOL include(FileData &file) const;
+    std::wstring debugTree() const;
+    std::wstring identity() const;
+    sampleList(const std::wstring& listFile);
+};
+//Matches files containing a -hex or -string pattern. Every content search of
+//a command line shares one automaton.
+class contentMatch : public criterion
+{
+    std::shared_ptr<contentPatterns> patterns;
+    std::size_t search;
+    std::wstring description;
+public:
+    unsigned __int32 getPriorityClass() const;
+    BOOL include(FileData &file) const;
+    std::wstring debugTree() const;
+    contentMatch(const std::shared_ptr<contentPatterns>& patterns_, std::size_t search_, const std::wstring& description_);
 };
 class skipper : public criterion
 {
@@ -308,6 +434,7 @@ public:
     unsigned __int32 getPriorityClass() const;
     BOOL include(FileData & /*file*/) const;
     std::wstring debugTree() const;
-    virtual unsigned int directoryCheck(const std::wstring& directory);
+    virtual unsigned int directoryCheck(const std::wstring& directory) const;
+    void directoryPaths(std::vector<std::wstring>& paths) const;
     skipper(const std::wstring& toSkip);
 };
@@ -9,6 +9,7 @@
 #define _OPSTRUCT_H_INCLUDED
 #include <vector>
 #include "criterion.h"
+#include "adaptiveOrder.h"
 
 class operation : public criterion
 {
@@ -16,28 +17,55 @@ protected:
     std::shared_ptr<criterion> operandA;
     std::shared_ptr<criterion> operandB;
     std::wstring debugTreeInternal(const std::wstring& curOp) const;
+    std::wstring identityInternal(const std::wstring& curOp) const;
+    std::wstring describeInternal(const std::wstring& curOp, describer describe) const;
+    std::wstring explainTreeInternal(const std::wstring& curOp, const adaptiveOrder& ordering) const;
 public:
     virtual void reorderTree();
     unsigned __int32 getPriorityClass() const;
     operation(std::shared_ptr<criterion> a, std::shared_ptr<criterion> b);
+    void directoryPaths(std::vector<std::wstring>& paths) const;
     void makeNonRecursive();
+    void compileTree();
 };
 
 class andAndClass : public operation
 {
+    //Operands are evaluated in the order measured to be cheapest
+    mutable adaptiveOrder ordering;
 public:
+    virtual void reorderTree();
     BOOL include(FileData &file) const;
     virtual unsigned int directoryCheck(const std::wstring& directory) const;
     andAndClass(std::shared_ptr<criterion> a, std::shared_ptr<criterion> b);
     std::wstring debugTree() const;
+    std::wstring identity() const;
+    std::wstring explainTree() const;
+    bool lower(flatProgram& program) const;
+    void filterBlock(entryBlock& block, entryBlock::selection& rows) const;
+    bool simplify(std::shared_ptr<criterion>& replacement);
+    //Collects the operands of this and any directly nested AND nodes
+    void gatherOperands(std::vector<const criterion *>& operands) const;
+    void gatherOperands(std::vector<std::shared_ptr<criterion> >& operands) const;
 };
 class orAndClass : public operation
 {
+    //Operands are evaluated in the order measured to be cheapest
+    mutable adaptiveOrder ordering;
 public:
+    virtual void reorderTree();
     BOOL include(FileData &file) const;
     virtual unsigned int directoryCheck(const std::wstring& directory) const;
     orAndClass(std::shared_ptr<criterion> a, std::shared_ptr<criterion> b);
     std::wstring debugTree() const;
+    std::wstring identity() const;
+    std::wstring explainTree() const;
+    bool lower(flatProgram& program) const;
+    void filterBlock(entryBlock& block, entryBlock::selection& rows) const;
+    bool simplify(std::shared_ptr<criterion>& replacement);
+    //Collects the operands of this and any directly nested OR nodes
+    void gatherOperands(std::vector<const criterion *>& operands) const;
+    void gatherOperands(std::vector<std::shared_ptr<criterion> >& operands) const;
 };
 class xorAndClass : public operation
 {
@@ -46,30 +74,55 @@ public:
     virtual unsigned int directoryCheck(const std::wstring& directory) const;
     xorAndClass(std::shared_ptr<criterion> a, std::shared_ptr<criterion> b);
     std::wstring debugTree() const;
+    std::wstring identity() const;
+    std::wstring explainTree() const;
+    bool lower(flatProgram& program) const;
+    void filterBlock(entryBlock& block, entryBlock::selection& rows) const;
+    bool simplify(std::shared_ptr<criterion>& replacement);
 };
 class notAndClass : public criterion
 {
     std::shared_ptr<criterion> operand;
+    std::wstring describeInternal(describer describe) const;
 public:
     virtual void reorderTree();
     unsigned __int32 getPriorityClass() const;
     BOOL include(FileData &file) const;
     virtual unsigned int directoryCheck(const std::wstring& directory) const;
     notAndClass(std::shared_ptr<criterion> a);
+    void directoryPaths(std::vector<std::wstring>& paths) const;
     std::wstring debugTree() const;
+    std::wstring identity() const;
+    std::wstring explainTree() const;
     void makeNonRecursive();
+    bool lower(flatProgram& program) const;
+    void filterBlock(entryBlock& block, entryBlock::selection& rows) const;
+    void compileTree();
+    bool simplify(std::shared_ptr<criterion>& replacement);
+    const std::shared_ptr<criterion>& getOperand() const { return operand; }
 };
 class bracketClass : public criterion
 {
     std::vector<std::shared_ptr<criterion> > expr;
+    std::vector<criterion *> operands; //expr without the reference counting, for ordering
+    mutable adaptiveOrder ordering;
+    std::wstring describeInternal(describer describe) const;
 public:
     virtual void reorderTree();
     unsigned __int32 getPriorityClass() const;
     BOOL include(FileData &file) const;
-    virtual unsigned int directoryCheck(const std::wstring& directory);
+    virtual unsigned int directoryCheck(const std::wstring& directory) const;
+    void directoryPaths(std::vector<std::wstring>& paths) const;
     bracketClass(std::vector<std::shared_ptr<criterion> > exprA);
     std::wstring debugTree() const;
+    std::wstring identity() const;
+    std::wstring explainTree() const;
     void makeNonRecursive();
+    bool lower(flatProgram& program) const;
+    void filterBlock(entryBlock& block, entryBlock::selection& rows) const;
+    void compileTree();
+    bool simplify(std::shared_ptr<criterion>& replacement);
+    const std::vector<std::shared_ptr<criterion> >& getExpression() const { return expr; }
 };
 
 class ifClass : public criterion
@@ -77,14 +130,36 @@ class ifClass : public criterion
     std::shared_ptr<criterion> condVal;
     std::shared_ptr<criterion> tVal;
     std::shared_ptr<criterion> fVal;
+    std::wstring describeInternal(describer describe) const;
 public:
     virtual void reorderTree();
     unsigned __int32 getPriorityClass() const;
     BOOL include(FileData &file) const;
     virtual unsigned int directoryCheck(const std::wstring& directory) const;
     ifClass(std::shared_ptr<criterion> condition,std::shared_ptr<criterion> valueIfTrue,std::shared_ptr<criterion> valueIfFalse = std::shared_ptr<criterion>((criterion *)NULL));
+    void directoryPaths(std::vector<std::wstring>& paths) const;
     std::wstring debugTree() const;
+    std::wstring identity() const;
+    std::wstring explainTree() const;
     void makeNonRecursive();
+    bool lower(flatProgram& program) const;
+    void filterBlock(entryBlock& block, entryBlock::selection& rows) const;
+    void compileTree();
+    bool simplify(std::shared_ptr<criterion>& replacement);
+};
+
+//TRUE or FALSE; left behind where the simplifier folds a subtree away.
+class constantClass : public criterion
+{
+    bool value;
+public:
+    unsigned __int32 getPriorityClass() const;
+    BOOL include(FileData &file) const;
+    constantClass(bool value_);
+    bool getValue() const { return value; }
+    std::wstring debugTree() const;
+    bool lower(flatProgram& program) const;
+    void filterBlock(entryBlock& block, entryBlock::selection& rows) const;
 };
 
 #endif
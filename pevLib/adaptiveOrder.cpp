@@ -0,0 +1,225 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// adaptiveOrder.cpp -- Implements cost based operand ordering.
+
+#include "pch.hpp"
+#include <algorithm>
+#include <cstdio>
+#include "adaptiveOrder.h"
+
+namespace {
+
+    //Only every timingInterval'th evaluation is timed, so that reading the
+    //clock costs little next to cheap criteria. Must be a power of two.
+    const unsigned __int64 timingInterval = 8;
+    //The first reorder happens after this many evaluations; the interval
+    //then doubles up to maximumReorderInterval.
+    const unsigned __int64 firstReorder = 64;
+    const unsigned __int64 maximumReorderInterval = 65536;
+    //Measurements needed before they replace the estimates below
+    const unsigned __int64 minimumSamples = 4;
+
+    //Rough microseconds per evaluation for each priority class, used until
+    //an operand has been measured.
+    double estimatedCost(unsigned __int32 priorityClass)
+    {
+        static const double costs[] = { 0.1, 0.1, 1.0, 2.0, 100.0, 300.0, 10000.0, 20000.0, 30000.0 };
+        if (priorityClass >= sizeof(costs) / sizeof(costs[0]))
+            return costs[sizeof(costs) / sizeof(costs[0]) - 1];
+        return costs[priorityClass];
+    }
+
+    unsigned __int64 readTicks()
+    {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        return static_cast<unsigned __int64>(now.QuadPart);
+    }
+
+    double ticksPerMicrosecond()
+    {
+        static double result = 0.0;
+        if (result == 0.0)
+        {
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+            result = static_cast<double>(frequency.QuadPart) / 1000000.0;
+        }
+        return result;
+    }
+
+    struct byRank
+    {
+        std::vector<double> const& ranks;
+        explicit byRank(std::vector<double> const& ranks_) : ranks(ranks_) {}
+        bool operator()(std::size_t lhs, std::size_t rhs) const
+        {
+            return ranks[lhs] < ranks[rhs];
+        }
+    private:
+        byRank& operator=(const byRank&);
+    };
+
+}
+
+adaptiveOrder::adaptiveOrder(bool stopValue_)
+    : evaluations(0)
+    , nextReorder(firstReorder)
+    , reorders(0)
+    , stopValue(stopValue_)
+{}
+
+void adaptiveOrder::reset(std::size_t operandCount)
+{
+    statistics empty = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    measured.assign(operandCount, empty);
+    order.resize(operandCount);
+    for (std::size_t idx = 0; idx < operandCount; ++idx)
+        order[idx] = idx;
+    evaluations = 0;
+    nextReorder = firstReorder;
+    reorders = 0;
+}
+
+BOOL adaptiveOrder::evaluate(criterion* const* operands, FileData& file)
+{
+    bool const timed = (evaluations & (timingInterval - 1)) == 0;
+    ++evaluations;
+    bool result = !stopValue;
+    for (std::vector<std::size_t>::const_iterator it = order.begin(); it != order.end(); ++it)
+    {
+        statistics& current = measured[*it];
+        bool passed;
+        if (timed)
+        {
+            unsigned __int64 const start = readTicks();
+            passed = operands[*it]->include(file) != FALSE;
+            unsigned __int64 const elapsed = readTicks() - start;
+            current.ticks += elapsed;
+            current.totalTicks += elapsed;
+            ++current.timedEvaluations;
+            ++current.totalTimed;
+        }
+        else
+        {
+            passed = operands[*it]->include(file) != FALSE;
+        }
+        ++current.evaluations;
+        ++current.totalEvaluations;
+        if (passed)
+        {
+            ++current.passes;
+            ++current.totalPasses;
+        }
+        if (passed == stopValue)
+        {
+            result = stopValue;
+            break;
+        }
+    }
+    if (evaluations >= nextReorder)
+        reorder(operands);
+    return result;
+}
+
+void adaptiveOrder::filterBlock(criterion* const* operands, entryBlock& block, entryBlock::selection& rows)
+{
+    std::size_t const rowCount = rows.size();
+    if (rowCount == 0)
+        return;
+    //Rows which returned the stop value; only needed for OR
+    entryBlock::selection decided;
+    entryBlock::selection passed;
+    for (std::vector<std::size_t>::const_iterator it = order.begin(); it != order.end() && !rows.empty(); ++it)
+    {
+        statistics& current = measured[*it];
+        passed = rows;
+        //Timing a whole block is cheap, so every block is timed
+        unsigned __int64 const start = readTicks();
+        operands[*it]->filterBlock(block, passed);
+        unsigned __int64 const elapsed = readTicks() - start;
+        current.evaluations += rows.size();
+        current.totalEvaluations += rows.size();
+        current.timedEvaluations += rows.size();
+        current.totalTimed += rows.size();
+        current.ticks += elapsed;
+        current.totalTicks += elapsed;
+        current.passes += passed.size();
+        current.totalPasses += passed.size();
+        if (stopValue)
+        {
+            entryBlock::unite(decided, passed);
+            entryBlock::subtract(rows, passed);
+        }
+        else
+        {
+            rows.swap(passed);
+        }
+    }
+    if (stopValue)
+        rows.swap(decided);
+    evaluations += rowCount;
+    if (evaluations >= nextReorder)
+        reorder(operands);
+}
+
+double adaptiveOrder::passRate(std::size_t operand) const
+{
+    statistics const& current = measured[operand];
+    if (current.evaluations < minimumSamples)
+        return 0.5;
+    return static_cast<double>(current.passes) / static_cast<double>(current.evaluations);
+}
+
+double adaptiveOrder::averageCost(std::size_t operand, const criterion* op) const
+{
+    statistics const& current = measured[operand];
+    if (current.timedEvaluations < minimumSamples)
+        return estimatedCost(op->getPriorityClass());
+    return static_cast<double>(current.ticks) / static_cast<double>(current.timedEvaluations) / ticksPerMicrosecond();
+}
+
+void adaptiveOrder::reorder(criterion* const* operands)
+{
+    ++reorders;
+    nextReorder = evaluations + std::min(evaluations, maximumReorderInterval);
+    //Evaluating an operand costs its cost, and ends the evaluation with the
+    //probability it returns the stop value. Sorting by cost divided by that
+    //probability minimizes the expected total.
+    std::vector<double> ranks(measured.size());
+    for (std::size_t idx = 0; idx < measured.size(); ++idx)
+    {
+        double const pass = passRate(idx);
+        double const stops = stopValue ? pass : 1.0 - pass;
+        ranks[idx] = averageCost(idx, operands[idx]) / std::max(stops, 0.000001);
+    }
+    std::stable_sort(order.begin(), order.end(), byRank(ranks));
+    //Halve the counts, so that recent files count for more than old ones
+    //when the mix of files changes during a search.
+    for (std::vector<statistics>::iterator it = measured.begin(); it != measured.end(); ++it)
+    {
+        if (it->timedEvaluations < minimumSamples * 2 || it->evaluations < minimumSamples * 2)
+            continue;
+        it->evaluations /= 2;
+        it->passes /= 2;
+        it->timedEvaluations /= 2;
+        it->ticks /= 2;
+    }
+}
+
+std::wstring adaptiveOrder::describe(std::size_t operand) const
+{
+    statistics const& current = measured[operand];
+    if (current.totalEvaluations == 0)
+        return L"[never evaluated] ";
+    wchar_t temp[96];
+    double const cost = current.totalTimed
+        ? static_cast<double>(current.totalTicks) / static_cast<double>(current.totalTimed) / ticksPerMicrosecond()
+        : 0.0;
+    int result = swprintf_s(temp, L"[%I64u evaluated, %.1f%% passed, %.2fus each] ",
+        current.totalEvaluations, 100.0 * current.totalPasses / current.totalEvaluations, cost);
+    return std::wstring(temp, std::max(result, 0));
+}
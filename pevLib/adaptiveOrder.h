@@ -0,0 +1,61 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// adaptiveOrder.h -- Evaluates the operands of an AND or OR node in the
+// order which is cheapest for the files actually being searched. The
+// PRIORITY_* classes give the starting order; as files are evaluated, the
+// cost and pass rate of each operand are measured, and the operands are
+// periodically sorted by expected cost per short circuit.
+#pragma once
+#include <vector>
+#include <string>
+#include "criterion.h"
+#include "entryBlock.h"
+
+class adaptiveOrder
+{
+    struct statistics
+    {
+        //Totals for the whole search, for --explain
+        unsigned __int64 totalEvaluations;
+        unsigned __int64 totalPasses;
+        unsigned __int64 totalTimed;
+        unsigned __int64 totalTicks;
+        //Recent measurements, which are halved at each reorder
+        unsigned __int64 evaluations;
+        unsigned __int64 passes;
+        unsigned __int64 timedEvaluations;
+        unsigned __int64 ticks;
+    };
+    std::vector<statistics> measured; //Indexed by operand
+    std::vector<std::size_t> order;
+    unsigned __int64 evaluations;
+    unsigned __int64 nextReorder;
+    unsigned int reorders;
+    //The result which ends evaluation early: false for AND, true for OR
+    bool stopValue;
+
+    double passRate(std::size_t operand) const;
+    //Microseconds per evaluation, or an estimate from the priority class
+    //if there are too few measurements
+    double averageCost(std::size_t operand, const criterion* op) const;
+    void reorder(criterion* const* operands);
+public:
+    explicit adaptiveOrder(bool stopValue_);
+    //Forgets all measurements and starts over with the given number of
+    //operands, evaluated in index order.
+    void reset(std::size_t operandCount);
+    //Evaluates operands[order[0]], operands[order[1]] ... until one returns
+    //the stop value, and returns that, or the opposite if none did.
+    BOOL evaluate(criterion* const* operands, FileData& file);
+    //The same for a block: narrows rows to those evaluate would include,
+    //passing each operand only the rows still undecided.
+    void filterBlock(criterion* const* operands, entryBlock& block, entryBlock::selection& rows);
+    //Operand indexes in the order they are currently evaluated
+    std::vector<std::size_t> const& getOrder() const { return order; }
+    unsigned int getReorderCount() const { return reorders; }
+    //Measured numbers for --explain, such as "[1024 evaluated, 3.1% passed, 12.5us each] "
+    std::wstring describe(std::size_t operand) const;
+};
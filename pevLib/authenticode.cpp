@@ -0,0 +1,281 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// authenticode.cpp -- Implements the embedded signature decoder.
+
+#include "pch.hpp"
+#include <cstring>
+#include "authenticode.h"
+#include "der.h"
+
+namespace {
+
+    std::uint32_t read32(unsigned char const* data)
+    {
+        return static_cast<std::uint32_t>(data[0])
+            | (static_cast<std::uint32_t>(data[1]) << 8)
+            | (static_cast<std::uint32_t>(data[2]) << 16)
+            | (static_cast<std::uint32_t>(data[3]) << 24);
+    }
+
+    // WIN_CERTIFICATE, from the PE/COFF specification
+    const std::size_t certificateHeaderSize = 8;
+    const std::uint16_t certificateTypePkcsSignedData = 2;
+
+    // Object identifiers, as encoded
+    const unsigned char oidSpcIndirectData[] = { 0x2B, 0x06, 0x01, 0x04, 0x01, 0x82, 0x37, 0x02, 0x01, 0x04 };
+    const unsigned char oidMd5[] = { 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x02, 0x05 };
+    const unsigned char oidSha1[] = { 0x2B, 0x0E, 0x03, 0x02, 0x1A };
+    const unsigned char oidSha256[] = { 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01 };
+    const unsigned char oidSha384[] = { 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x02 };
+    const unsigned char oidSha512[] = { 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x03 };
+    const unsigned char oidCommonName[] = { 0x55, 0x04, 0x03 };
+
+    void appendUtf8(std::wstring& result, unsigned char const* data, std::size_t length)
+    {
+        for (std::size_t idx = 0; idx < length;)
+        {
+            std::uint32_t codePoint = data[idx];
+            std::size_t extra = 0;
+            if (codePoint >= 0xF0)
+            {
+                codePoint &= 0x07;
+                extra = 3;
+            }
+            else if (codePoint >= 0xE0)
+            {
+                codePoint &= 0x0F;
+                extra = 2;
+            }
+            else if (codePoint >= 0xC0)
+            {
+                codePoint &= 0x1F;
+                extra = 1;
+            }
+            ++idx;
+            for (; extra && idx < length; --extra, ++idx)
+                codePoint = (codePoint << 6) | (data[idx] & 0x3F);
+            if (codePoint >= 0x10000 && sizeof(wchar_t) == 2)
+            {
+                codePoint -= 0x10000;
+                result.push_back(static_cast<wchar_t>(0xD800 + (codePoint >> 10)));
+                result.push_back(static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF)));
+            }
+            else
+                result.push_back(static_cast<wchar_t>(codePoint));
+        }
+    }
+
+    bool decodeDirectoryString(const derElement& value, std::wstring& result)
+    {
+        result.clear();
+        switch (value.tag)
+        {
+        case DER_UTF8_STRING:
+            appendUtf8(result, value.contents, value.length);
+            return true;
+        case DER_PRINTABLE_STRING:
+        case DER_T61_STRING:
+        case DER_IA5_STRING:
+            result.assign(value.contents, value.contents + value.length);
+            return true;
+        case DER_BMP_STRING:
+            for (std::size_t idx = 0; idx + 1 < value.length; idx += 2)
+                result.push_back(static_cast<wchar_t>((value.contents[idx] << 8) | value.contents[idx + 1]));
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Finds the common name in an X.501 Name (a sequence of sets of
+    // attribute type and value pairs). The last one wins, as the most
+    // specific element of the name comes last.
+    void findCommonName(const derElement& name, std::wstring& result)
+    {
+        derReader names(name);
+        derElement relativeName;
+        while (names.next(relativeName, DER_SET))
+        {
+            derReader attributes(relativeName);
+            derElement attribute;
+            while (attributes.next(attribute, DER_SEQUENCE))
+            {
+                derReader pair(attribute);
+                derElement type, value;
+                std::wstring decoded;
+                if (pair.next(type) && type.isOid(oidCommonName) && pair.next(value) && decodeDirectoryString(value, decoded))
+                    result = decoded;
+            }
+        }
+    }
+
+    authenticodeSignature::digestAlgorithm decodeAlgorithm(const derElement& algorithmIdentifier)
+    {
+        derReader reader(algorithmIdentifier);
+        derElement oid;
+        if (!reader.next(oid, DER_OID))
+            return authenticodeSignature::DIGEST_UNKNOWN;
+        if (oid.isOid(oidSha1))
+            return authenticodeSignature::DIGEST_SHA1;
+        if (oid.isOid(oidSha256))
+            return authenticodeSignature::DIGEST_SHA256;
+        if (oid.isOid(oidSha384))
+            return authenticodeSignature::DIGEST_SHA384;
+        if (oid.isOid(oidSha512))
+            return authenticodeSignature::DIGEST_SHA512;
+        if (oid.isOid(oidMd5))
+            return authenticodeSignature::DIGEST_MD5;
+        return authenticodeSignature::DIGEST_UNKNOWN;
+    }
+
+}
+
+authenticodeSignature::authenticodeSignature()
+    : algorithm(DIGEST_UNKNOWN)
+{}
+
+bool authenticodeSignature::parseCertificateTable(unsigned char const* table, std::size_t length)
+{
+    // WIN_CERTIFICATE entries are 8 byte aligned
+    for (std::size_t offset = 0; offset + certificateHeaderSize <= length;)
+    {
+        std::uint32_t entryLength = read32(table + offset);
+        std::uint16_t const type = static_cast<std::uint16_t>(table[offset + 6] | (table[offset + 7] << 8));
+        if (entryLength < certificateHeaderSize || entryLength > length - offset)
+            return false;
+        if (type == certificateTypePkcsSignedData)
+            return parseSignedData(table + offset + certificateHeaderSize, entryLength - certificateHeaderSize);
+        offset += (entryLength + 7) & ~static_cast<std::uint32_t>(7);
+    }
+    return false;
+}
+
+bool authenticodeSignature::parseSignedData(unsigned char const* data, std::size_t length)
+{
+    *this = authenticodeSignature();
+
+    // The encapsulated content is SpcIndirectDataContent ::= SEQUENCE {
+    //     data SpcAttributeTypeAndOptionalValue, messageDigest DigestInfo }
+    derElement contentInfo, encapsulatedType, indirectData;
+    derReader signedDataReader;
+    if (!derOpenSignedData(data, length, contentInfo, encapsulatedType, indirectData, signedDataReader)
+        || !encapsulatedType.isOid(oidSpcIndirectData) || indirectData.tag != DER_SEQUENCE)
+        return false;
+    derReader indirectDataReader(indirectData);
+    derElement attributeValue, digestInfo;
+    if (!indirectDataReader.next(attributeValue, DER_SEQUENCE)
+        || !indirectDataReader.next(digestInfo, DER_SEQUENCE))
+        return false;
+    derReader digestInfoReader(digestInfo);
+    derElement digestAlgorithm, digestValue;
+    if (!digestInfoReader.next(digestAlgorithm, DER_SEQUENCE)
+        || !digestInfoReader.next(digestValue, DER_OCTET_STRING))
+        return false;
+    algorithm = decodeAlgorithm(digestAlgorithm);
+    digest.assign(digestValue.contents, digestValue.contents + digestValue.length);
+    signedData.assign(contentInfo.encoded, contentInfo.encoded + contentInfo.encodedLength);
+
+    // Certificates, CRLs, and then the signer infos.
+    derElement element = derElement();
+    derElement certificates = derElement();
+    while (signedDataReader.next(element) && element.tag != DER_SET)
+    {
+        if (element.tag == DER_CONTEXT_0)
+            certificates = element;
+    }
+    if (element.tag != DER_SET)
+        return true; // No signer; the digest is still useful
+
+    // SignerInfo ::= SEQUENCE { version, issuerAndSerialNumber, ... }
+    derReader signerInfos(element);
+    derElement signerInfo, signerVersion, issuerAndSerial;
+    if (!signerInfos.next(signerInfo, DER_SEQUENCE))
+        return true;
+    derReader signerInfoReader(signerInfo);
+    if (!signerInfoReader.next(signerVersion, DER_INTEGER)
+        || !signerInfoReader.next(issuerAndSerial, DER_SEQUENCE))
+        return true;
+    derReader issuerAndSerialReader(issuerAndSerial);
+    derElement issuer, serial;
+    if (!issuerAndSerialReader.next(issuer, DER_SEQUENCE)
+        || !issuerAndSerialReader.next(serial, DER_INTEGER))
+        return true;
+    serialNumber.assign(serial.contents, serial.contents + serial.length);
+    findCommonName(issuer, issuerName);
+
+    // Find the signing certificate to get the subject's name.
+    // Certificate ::= SEQUENCE { tbsCertificate, signatureAlgorithm, signature }
+    // TBSCertificate ::= SEQUENCE { [0] version OPTIONAL, serialNumber,
+    //     signature, issuer, validity, subject, ... }
+    if (certificates.tag != DER_CONTEXT_0)
+        return true;
+    derReader certificateReader(certificates);
+    derElement certificate;
+    while (certificateReader.next(certificate))
+    {
+        if (certificate.tag != DER_SEQUENCE)
+            continue;
+        derReader outerCertificate(certificate);
+        derElement tbs;
+        if (!outerCertificate.next(tbs, DER_SEQUENCE))
+            continue;
+        derReader tbsReader(tbs);
+        derElement field;
+        if (!tbsReader.next(field))
+            continue;
+        if (field.tag == DER_CONTEXT_0 && !tbsReader.next(field))
+            continue;
+        derElement signatureAlgorithm, certificateIssuer, validity, subject;
+        if (!field.sameEncoding(serial)
+            || !tbsReader.next(signatureAlgorithm, DER_SEQUENCE)
+            || !tbsReader.next(certificateIssuer, DER_SEQUENCE)
+            || !certificateIssuer.sameEncoding(issuer)
+            || !tbsReader.next(validity, DER_SEQUENCE)
+            || !tbsReader.next(subject, DER_SEQUENCE))
+            continue;
+        findCommonName(subject, signerName);
+        break;
+    }
+    return true;
+}
+
+std::size_t authenticodeSignature::getDigestLength(digestAlgorithm algorithm)
+{
+    switch (algorithm)
+    {
+    case DIGEST_MD5:
+        return 16;
+    case DIGEST_SHA1:
+        return 20;
+    case DIGEST_SHA256:
+        return 32;
+    case DIGEST_SHA384:
+        return 48;
+    case DIGEST_SHA512:
+        return 64;
+    default:
+        return 0;
+    }
+}
+
+wchar_t const* authenticodeSignature::getDigestName(digestAlgorithm algorithm)
+{
+    switch (algorithm)
+    {
+    case DIGEST_MD5:
+        return L"MD5";
+    case DIGEST_SHA1:
+        return L"SHA1";
+    case DIGEST_SHA256:
+        return L"SHA256";
+    case DIGEST_SHA384:
+        return L"SHA384";
+    case DIGEST_SHA512:
+        return L"SHA512";
+    default:
+        return L"UNKNOWN";
+    }
+}
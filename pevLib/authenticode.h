@@ -0,0 +1,122 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// authenticode.h -- Portable pieces of Authenticode: the PE image digest
+// (the hash of an image without its checksum field and certificate table)
+// and a decoder for the PKCS#7 SignedData blob embedded in the certificate
+// table. Together these answer "does the signature's digest match the
+// content" without WinVerifyTrust, and give a stable key for caching the
+// trust verdict of a signature.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "peHeaders.h"
+
+class authenticodeSignature
+{
+public:
+    enum digestAlgorithm
+    {
+        DIGEST_UNKNOWN = 0,
+        DIGEST_MD5,
+        DIGEST_SHA1,
+        DIGEST_SHA256,
+        DIGEST_SHA384,
+        DIGEST_SHA512
+    };
+private:
+    digestAlgorithm algorithm;
+    std::vector<unsigned char> digest;
+    std::vector<unsigned char> signedData;
+    std::wstring signerName;
+    std::wstring issuerName;
+    std::vector<unsigned char> serialNumber;
+public:
+    authenticodeSignature();
+
+    // Decodes the first PKCS#7 signature in a certificate table (the bytes
+    // the security directory points at). Returns false if there is no such
+    // signature or it is malformed.
+    bool parseCertificateTable(unsigned char const* table, std::size_t length);
+    // Decodes a DER encoded PKCS#7 ContentInfo holding Authenticode SignedData.
+    bool parseSignedData(unsigned char const* data, std::size_t length);
+
+    // The algorithm and value of the image digest the signature covers
+    digestAlgorithm getDigestAlgorithm() const { return algorithm; }
+    std::vector<unsigned char> const& getDigest() const { return digest; }
+    // The whole PKCS#7 blob
+    std::vector<unsigned char> const& getSignedData() const { return signedData; }
+    // Common names of the subject and issuer of the signing certificate. The
+    // signer name is empty if the blob does not carry the certificate.
+    std::wstring const& getSignerName() const { return signerName; }
+    std::wstring const& getIssuerName() const { return issuerName; }
+    // Big endian, as encoded
+    std::vector<unsigned char> const& getSerialNumber() const { return serialNumber; }
+
+    static std::size_t getDigestLength(digestAlgorithm algorithm);
+    static wchar_t const* getDigestName(digestAlgorithm algorithm);
+};
+
+// Feeds a hash the Authenticode digest of an image as the image's bytes are
+// passed to Update in order. The checksum field, the certificate table entry
+// of the data directory and the certificate table itself are skipped. Like
+// the CryptoPP hashes, it can be a sink of FileData's shared file read.
+template <typename hashType>
+class authenticodeHasher
+{
+    struct range
+    {
+        std::uint64_t begin;
+        std::uint64_t end;
+        bool operator<(const range& rhs) const { return begin < rhs.begin; }
+    };
+    hashType& hash;
+    std::uint64_t position;
+    range excluded[3];
+    authenticodeHasher& operator=(const authenticodeHasher&);
+public:
+    authenticodeHasher(hashType& target, const peHeaders& headers)
+        : hash(target)
+        , position(0)
+    {
+        excluded[0].begin = headers.getCheckSumOffset();
+        excluded[0].end = excluded[0].begin + 4;
+        excluded[1].begin = headers.getDataDirectoryEntryOffset(peHeaders::DIRECTORY_SECURITY);
+        excluded[1].end = excluded[1].begin + 8;
+        peHeaders::dataDirectory certificates = headers.getDataDirectory(peHeaders::DIRECTORY_SECURITY);
+        excluded[2].begin = certificates.virtualAddress;
+        excluded[2].end = static_cast<std::uint64_t>(certificates.virtualAddress) + certificates.size;
+        std::sort(excluded, excluded + 3);
+    }
+    void Update(unsigned char const* data, std::size_t length)
+    {
+        std::uint64_t const end = position + length;
+        for (std::size_t idx = 0; idx < 3 && position < end; ++idx)
+        {
+            if (excluded[idx].end <= position || excluded[idx].begin == excluded[idx].end)
+                continue;
+            if (excluded[idx].begin >= end)
+                break;
+            if (excluded[idx].begin > position)
+            {
+                std::size_t const included = static_cast<std::size_t>(excluded[idx].begin - position);
+                hash.Update(data, included);
+                data += included;
+                position += included;
+            }
+            std::size_t const skipped = static_cast<std::size_t>(std::min(excluded[idx].end, end) - position);
+            data += skipped;
+            position += skipped;
+        }
+        if (position < end)
+        {
+            hash.Update(data, static_cast<std::size_t>(end - position));
+            position = end;
+        }
+    }
+};
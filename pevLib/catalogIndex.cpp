@@ -0,0 +1,273 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// catalogIndex.cpp -- Implements the catalog decoder and index.
+
+#include "pch.hpp"
+#include <cstring>
+#include "catalogIndex.h"
+#include "der.h"
+
+namespace {
+
+    // Object identifiers, as encoded
+    const unsigned char oidCertificateTrustList[] = { 0x2B, 0x06, 0x01, 0x04, 0x01, 0x82, 0x37, 0x0A, 0x01 };
+    const unsigned char oidSpcIndirectData[] = { 0x2B, 0x06, 0x01, 0x04, 0x01, 0x82, 0x37, 0x02, 0x01, 0x04 };
+
+    const char indexMagic[8] = { 'P', 'E', 'V', 'C', 'A', 'T', 'I', 'X' };
+    const std::uint32_t indexVersion = 1;
+
+    // Members normally carry their digest in an SpcIndirectDataContent
+    // attribute, exactly as an embedded signature does:
+    //     Attribute ::= SEQUENCE { type OID, values SET OF ... }
+    //     SpcIndirectDataContent ::= SEQUENCE { data, messageDigest DigestInfo }
+    //     DigestInfo ::= SEQUENCE { digestAlgorithm, digest OCTET STRING }
+    bool findIndirectDataDigest(const derElement& attributes, std::string& digest)
+    {
+        derReader attributeReader(attributes);
+        derElement attribute;
+        while (attributeReader.next(attribute, DER_SEQUENCE))
+        {
+            derReader pair(attribute);
+            derElement type, values, indirectData;
+            if (!pair.next(type) || !type.isOid(oidSpcIndirectData) || !pair.next(values, DER_SET))
+                continue;
+            derReader valuesReader(values);
+            if (!valuesReader.next(indirectData, DER_SEQUENCE))
+                return false;
+            derReader indirectDataReader(indirectData);
+            derElement data, digestInfo, algorithm, value;
+            if (!indirectDataReader.next(data, DER_SEQUENCE) || !indirectDataReader.next(digestInfo, DER_SEQUENCE))
+                return false;
+            derReader digestInfoReader(digestInfo);
+            if (!digestInfoReader.next(algorithm, DER_SEQUENCE) || !digestInfoReader.next(value, DER_OCTET_STRING))
+                return false;
+            digest.assign(value.contents, value.contents + value.length);
+            return true;
+        }
+        return false;
+    }
+
+    // Otherwise the member's tag is the hex digest, in UTF-16.
+    bool decodeHexTag(const derElement& tag, std::string& digest)
+    {
+        std::size_t const characters = tag.length / 2;
+        if (tag.length % 2 || characters % 2 || characters < 32)
+            return false;
+        digest.resize(characters / 2);
+        for (std::size_t idx = 0; idx < characters; ++idx)
+        {
+            unsigned char const* unit = tag.contents + idx * 2;
+            if (unit[1] != 0)
+                return false;
+            unsigned char nibble;
+            if (unit[0] >= '0' && unit[0] <= '9')
+                nibble = static_cast<unsigned char>(unit[0] - '0');
+            else if (unit[0] >= 'A' && unit[0] <= 'F')
+                nibble = static_cast<unsigned char>(unit[0] - 'A' + 10);
+            else if (unit[0] >= 'a' && unit[0] <= 'f')
+                nibble = static_cast<unsigned char>(unit[0] - 'a' + 10);
+            else
+                return false;
+            if (idx % 2)
+                digest[idx / 2] = static_cast<char>(digest[idx / 2] | nibble);
+            else
+                digest[idx / 2] = static_cast<char>(nibble << 4);
+        }
+        return true;
+    }
+
+    void put32(std::vector<unsigned char>& target, std::uint32_t value)
+    {
+        for (int shift = 0; shift < 32; shift += 8)
+            target.push_back(static_cast<unsigned char>(value >> shift));
+    }
+    void put64(std::vector<unsigned char>& target, std::uint64_t value)
+    {
+        put32(target, static_cast<std::uint32_t>(value));
+        put32(target, static_cast<std::uint32_t>(value >> 32));
+    }
+
+    // Bounds checked reads from a serialized index
+    class indexReader
+    {
+        unsigned char const* cursor;
+        unsigned char const* end;
+    public:
+        indexReader(unsigned char const* data, std::size_t length)
+            : cursor(data)
+            , end(data + length)
+        {}
+        std::size_t remaining() const
+        {
+            return static_cast<std::size_t>(end - cursor);
+        }
+        bool skip(std::size_t length, unsigned char const*& result)
+        {
+            if (static_cast<std::size_t>(end - cursor) < length)
+                return false;
+            result = cursor;
+            cursor += length;
+            return true;
+        }
+        bool get32(std::uint32_t& result)
+        {
+            unsigned char const* data;
+            if (!skip(4, data))
+                return false;
+            result = static_cast<std::uint32_t>(data[0])
+                | (static_cast<std::uint32_t>(data[1]) << 8)
+                | (static_cast<std::uint32_t>(data[2]) << 16)
+                | (static_cast<std::uint32_t>(data[3]) << 24);
+            return true;
+        }
+        bool get64(std::uint64_t& result)
+        {
+            std::uint32_t low, high;
+            if (!get32(low) || !get32(high))
+                return false;
+            result = low | (static_cast<std::uint64_t>(high) << 32);
+            return true;
+        }
+    };
+
+}
+
+bool catalogIndex::parseCatalog(unsigned char const* data, std::size_t length, std::vector<std::string>& digests)
+{
+    // CertificateTrustList ::= SEQUENCE { subjectUsage, listIdentifier OPTIONAL,
+    //     sequenceNumber OPTIONAL, thisUpdate, nextUpdate OPTIONAL,
+    //     subjectAlgorithm, trustedSubjects OPTIONAL, extensions [0] OPTIONAL }
+    derElement contentInfo, contentType, trustList;
+    derReader signedDataReader;
+    if (!derOpenSignedData(data, length, contentInfo, contentType, trustList, signedDataReader)
+        || !contentType.isOid(oidCertificateTrustList) || trustList.tag != DER_SEQUENCE)
+        return false;
+    derReader trustListReader(trustList);
+    derElement element;
+    if (!trustListReader.next(element, DER_SEQUENCE))
+        return false;
+    // The optional fields and the times are all primitive; the next sequence
+    // is the subject algorithm.
+    do
+    {
+        if (!trustListReader.next(element))
+            return true;
+    } while (element.tag != DER_SEQUENCE);
+    if (!trustListReader.next(element, DER_SEQUENCE))
+        return true; // An empty catalog
+
+    // TrustedSubject ::= SEQUENCE { subjectIdentifier OCTET STRING,
+    //     subjectAttributes SET OF Attribute OPTIONAL }
+    derReader subjects(element);
+    derElement subject;
+    while (subjects.next(subject, DER_SEQUENCE))
+    {
+        derReader subjectReader(subject);
+        derElement identifier, attributes;
+        if (!subjectReader.next(identifier, DER_OCTET_STRING))
+            continue;
+        std::string digest;
+        if (!(subjectReader.next(attributes, DER_SET) && findIndirectDataDigest(attributes, digest))
+            && !decodeHexTag(identifier, digest))
+            continue;
+        digests.push_back(digest);
+    }
+    return true;
+}
+
+bool catalogIndex::addCatalog(const catalog& source, unsigned char const* data, std::size_t length)
+{
+    std::vector<std::string> digests;
+    bool const parsed = data != nullptr && parseCatalog(data, length, digests);
+    std::uint32_t const catalogNumber = static_cast<std::uint32_t>(catalogs.size());
+    catalogs.push_back(source);
+    for (std::vector<std::string>::const_iterator it = digests.begin(); it != digests.end(); ++it)
+        members.insert(std::make_pair(*it, catalogNumber)); // The first catalog wins
+    return parsed;
+}
+
+const catalogIndex::catalog* catalogIndex::find(unsigned char const* digest, std::size_t length) const
+{
+    std::unordered_map<std::string, std::uint32_t>::const_iterator it =
+        members.find(std::string(reinterpret_cast<const char*>(digest), length));
+    if (it == members.end())
+        return nullptr;
+    return &catalogs[it->second];
+}
+
+std::vector<unsigned char> catalogIndex::serialize() const
+{
+    std::vector<unsigned char> result(indexMagic, indexMagic + sizeof(indexMagic));
+    put32(result, indexVersion);
+    put32(result, static_cast<std::uint32_t>(catalogs.size()));
+    put32(result, static_cast<std::uint32_t>(members.size()));
+    for (std::vector<catalog>::const_iterator it = catalogs.begin(); it != catalogs.end(); ++it)
+    {
+        put64(result, it->lastWriteTime);
+        put64(result, it->size);
+        put32(result, static_cast<std::uint32_t>(it->path.size()));
+        for (std::wstring::const_iterator ch = it->path.begin(); ch != it->path.end(); ++ch)
+        {
+            result.push_back(static_cast<unsigned char>(*ch));
+            result.push_back(static_cast<unsigned char>(*ch >> 8));
+        }
+    }
+    for (std::unordered_map<std::string, std::uint32_t>::const_iterator it = members.begin(); it != members.end(); ++it)
+    {
+        result.push_back(static_cast<unsigned char>(it->first.size()));
+        result.insert(result.end(), it->first.begin(), it->first.end());
+        put32(result, it->second);
+    }
+    return result;
+}
+
+bool catalogIndex::deserialize(unsigned char const* data, std::size_t length)
+{
+    catalogs.clear();
+    members.clear();
+
+    indexReader reader(data, length);
+    unsigned char const* magic;
+    std::uint32_t version, catalogCount, memberCount;
+    if (!reader.skip(sizeof(indexMagic), magic) || std::memcmp(magic, indexMagic, sizeof(indexMagic)) != 0
+        || !reader.get32(version) || version != indexVersion
+        || !reader.get32(catalogCount) || !reader.get32(memberCount))
+        return false;
+    // Each catalog takes at least 20 bytes and each member 5; don't let a
+    // corrupt count allocate more than the file could describe.
+    if (static_cast<std::uint64_t>(catalogCount) * 20 + static_cast<std::uint64_t>(memberCount) * 5 > reader.remaining())
+        return false;
+
+    std::vector<catalog> newCatalogs(catalogCount);
+    for (std::vector<catalog>::iterator it = newCatalogs.begin(); it != newCatalogs.end(); ++it)
+    {
+        std::uint32_t pathLength;
+        unsigned char const* path;
+        if (!reader.get64(it->lastWriteTime) || !reader.get64(it->size)
+            || !reader.get32(pathLength) || !reader.skip(pathLength * 2, path))
+            return false;
+        it->path.resize(pathLength);
+        for (std::uint32_t idx = 0; idx < pathLength; ++idx)
+            it->path[idx] = static_cast<wchar_t>(path[idx * 2] | (path[idx * 2 + 1] << 8));
+    }
+
+    std::unordered_map<std::string, std::uint32_t> newMembers;
+    newMembers.reserve(memberCount);
+    for (std::uint32_t idx = 0; idx < memberCount; ++idx)
+    {
+        unsigned char const* digestLength;
+        unsigned char const* digest;
+        std::uint32_t catalogNumber;
+        if (!reader.skip(1, digestLength) || !reader.skip(*digestLength, digest)
+            || !reader.get32(catalogNumber) || catalogNumber >= catalogCount)
+            return false;
+        newMembers.insert(std::make_pair(std::string(reinterpret_cast<const char*>(digest), *digestLength), catalogNumber));
+    }
+
+    catalogs.swap(newCatalogs);
+    members.swap(newMembers);
+    return true;
+}
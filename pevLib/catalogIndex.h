@@ -0,0 +1,56 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// catalogIndex.h -- An index from member hash to catalog file, built by
+// decoding security catalogs (.cat files, which are PKCS#7 certificate trust
+// lists) directly. Looking a hash up here replaces a search through every
+// catalog on the system by CryptCATAdminEnumCatalogFromHash. The index can
+// be serialized so it need only be rebuilt when the catalogs change.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class catalogIndex
+{
+public:
+    // Identifies one catalog file, and the version of it that was indexed
+    struct catalog
+    {
+        std::wstring path;
+        std::uint64_t lastWriteTime;
+        std::uint64_t size;
+        bool operator==(const catalog& rhs) const
+        {
+            return path == rhs.path && lastWriteTime == rhs.lastWriteTime && size == rhs.size;
+        }
+    };
+private:
+    std::vector<catalog> catalogs;
+    // Member digest (raw bytes) to index into catalogs
+    std::unordered_map<std::string, std::uint32_t> members;
+public:
+    // Decodes the member digests of a catalog file. Returns false if data is
+    // not a catalog.
+    static bool parseCatalog(unsigned char const* data, std::size_t length, std::vector<std::string>& digests);
+
+    // Indexes the members of a catalog file. The file is recorded even if
+    // data is null or not a catalog (in which case this returns false), so
+    // getCatalogs() always lists every file the index was built from.
+    bool addCatalog(const catalog& source, unsigned char const* data, std::size_t length);
+    // Returns the catalog with a member with the given digest, or nullptr.
+    const catalog* find(unsigned char const* digest, std::size_t length) const;
+
+    std::vector<catalog> const& getCatalogs() const { return catalogs; }
+    std::size_t memberCount() const { return members.size(); }
+
+    // The serialized form is a small header, the catalog table and then the
+    // members; every integer is little endian.
+    std::vector<unsigned char> serialize() const;
+    // Returns false, leaving the index empty, if data is not a serialized index.
+    bool deserialize(unsigned char const* data, std::size_t length);
+};
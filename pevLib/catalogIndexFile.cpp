@@ -0,0 +1,127 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// catalogIndexFile.cpp -- Implements building and persisting the system
+// catalog index.
+
+#include "pch.hpp"
+#include <stdexcept>
+#include <algorithm>
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <boost/algorithm/string/predicate.hpp>
+#include "catalogIndexFile.h"
+#include "utility.h"
+#include "../LogCommon/Win32Glue.hpp"
+
+static bool catalogPathLess(const catalogIndex::catalog& lhs, const catalogIndex::catalog& rhs)
+{
+    return lhs.path < rhs.path;
+}
+
+static void enumerateCatalogs(const std::wstring& directory, std::vector<catalogIndex::catalog>& result)
+{
+    WIN32_FIND_DATAW findData;
+    HANDLE search = FindFirstFileW((directory + L"\\*").c_str(), &findData);
+    if (search == INVALID_HANDLE_VALUE)
+        return;
+    do
+    {
+        std::wstring name(findData.cFileName);
+        if (name == L"." || name == L"..")
+            continue;
+        std::wstring path(directory + L"\\" + name);
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            enumerateCatalogs(path, result);
+        else if (boost::algorithm::iends_with(name, L".cat"))
+        {
+            catalogIndex::catalog found;
+            found.path = path;
+            found.lastWriteTime = (static_cast<unsigned __int64>(findData.ftLastWriteTime.dwHighDateTime) << 32)
+                | findData.ftLastWriteTime.dwLowDateTime;
+            found.size = (static_cast<unsigned __int64>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+            result.push_back(found);
+        }
+    } while (FindNextFileW(search, &findData));
+    FindClose(search);
+}
+
+static bool loadSavedIndex(const std::wstring& indexFile, const std::vector<catalogIndex::catalog>& current, catalogIndex& index)
+{
+    try
+    {
+        std::size_t size = 0;
+        std::shared_ptr<const void> view(mapFile(indexFile, size));
+        if (!view || !index.deserialize(static_cast<const unsigned char*>(view.get()), size))
+            return false;
+    }
+    catch (std::runtime_error&)
+    {
+        return false;
+    }
+    return index.getCatalogs() == current;
+}
+
+static void saveIndex(const std::wstring& indexFile, const catalogIndex& index)
+{
+    //The saved index is only a cache; failing to write it is not an error.
+    std::vector<unsigned char> image(index.serialize());
+    Instalog::UniqueHandle file(CreateFileW(indexFile.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL));
+    if (!file.IsOpen())
+        return;
+    DWORD written = 0;
+    if (!WriteFile(file.Get(), &image[0], static_cast<DWORD>(image.size()), &written, NULL) || written != image.size())
+    {
+        file.Close();
+        DeleteFileW(indexFile.c_str());
+    }
+}
+
+std::shared_ptr<const catalogIndex> loadSystemCatalogIndex(const std::wstring& indexFile)
+{
+    //Parsing every catalog costs more than a run which checks a few
+    //signatures saves, so the index is only built to be kept.
+    if (indexFile.empty())
+        return std::shared_ptr<const catalogIndex>();
+    wchar_t systemDirectory[MAX_PATH];
+    UINT length = GetSystemDirectoryW(systemDirectory, MAX_PATH);
+    if (length == 0 || length >= MAX_PATH)
+        return std::shared_ptr<const catalogIndex>();
+
+    //Catalogs live in the native System32, so look past WOW64's redirection.
+    std::vector<catalogIndex::catalog> current;
+    {
+        scopedDisable64 redirection;
+        enumerateCatalogs(std::wstring(systemDirectory, length) + L"\\CatRoot", current);
+    }
+    if (current.empty())
+        return std::shared_ptr<const catalogIndex>();
+    std::sort(current.begin(), current.end(), catalogPathLess);
+
+    std::shared_ptr<catalogIndex> index(std::make_shared<catalogIndex>());
+    if (loadSavedIndex(indexFile, current, *index))
+        return index;
+
+    *index = catalogIndex();
+    {
+        scopedDisable64 redirection;
+        for (std::vector<catalogIndex::catalog>::const_iterator it = current.begin(); it != current.end(); ++it)
+        {
+            try
+            {
+                std::size_t size = 0;
+                std::shared_ptr<const void> view(mapFile(it->path, size));
+                index->addCatalog(*it, static_cast<const unsigned char*>(view.get()), size);
+            }
+            catch (std::runtime_error&)
+            {
+                //A catalog we cannot read is one WinVerifyTrust cannot use either.
+                index->addCatalog(*it, nullptr, 0);
+            }
+        }
+    }
+    saveIndex(indexFile, *index);
+    return index;
+}
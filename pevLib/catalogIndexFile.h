@@ -0,0 +1,17 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// catalogIndexFile.h -- Builds the index of the system's security catalogs
+// (everything under System32\CatRoot), and persists it between runs.
+#pragma once
+#include <string>
+#include <memory>
+#include "catalogIndex.h"
+
+// Returns an index of the system's catalogs, or null if indexFile is empty,
+// there are no catalogs or they cannot be read. An index saved in indexFile
+// is reused as long as no catalog has been added, removed or changed since;
+// otherwise the index is rebuilt and saved there.
+std::shared_ptr<const catalogIndex> loadSystemCatalogIndex(const std::wstring& indexFile);
@@ -0,0 +1,183 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// commandLexer.cpp -- Implements the single pass command line tokenizer.
+
+#include "pch.hpp"
+#include <algorithm>
+#include <cwctype>
+#include "commandLexer.h"
+
+namespace {
+
+    bool isSpace(wchar_t character)
+    {
+        return std::iswspace(character) != 0;
+    }
+
+    bool isAsciiAlphanumeric(wchar_t character)
+    {
+        return (character >= L'A' && character <= L'Z') || (character >= L'a' && character <= L'z') || (character >= L'0' && character <= L'9');
+    }
+
+    //Characters which may appear in the name of a modifier
+    bool isArgumentCharacter(wchar_t character)
+    {
+        return !isSpace(character) && character != L'"' && character != L'#' && character != L'{' && character != L'}';
+    }
+
+    //Reads a modifier's name: dashes, the last of which is kept, then at
+    //least one more argument character. A run of dashes alone keeps two.
+    bool readArgument(const std::wstring& text, std::size_t position, std::size_t& begin, std::size_t& end)
+    {
+        std::size_t dashes = position;
+        while (dashes < text.size() && text[dashes] == L'-')
+            ++dashes;
+        if (dashes == position)
+            return false;
+        end = dashes;
+        while (end < text.size() && isArgumentCharacter(text[end]))
+            ++end;
+        if (end != dashes)
+            begin = dashes - 1;
+        else if (end - position >= 2)
+            begin = end - 2;
+        else
+            return false;
+        return true;
+    }
+
+    //Lists where an option starting at position may end, longest first. In a
+    //#option# a # must be doubled or followed by a letter or digit; in a
+    //"option" a " must be doubled. The caller needs the delimiter next.
+    void optionEnds(const std::wstring& text, std::size_t position, wchar_t delimiter, std::vector<std::size_t>& ends)
+    {
+        ends.clear();
+        while (position < text.size())
+        {
+            if (text[position] != delimiter)
+                ++position;
+            else if (position + 1 < text.size() && (text[position + 1] == delimiter
+                || (delimiter == L'#' && isAsciiAlphanumeric(text[position + 1]))))
+                position += 2;
+            else
+                break;
+            ends.push_back(position);
+        }
+        std::reverse(ends.begin(), ends.end());
+    }
+
+    //Reads the #option# or "option" at position, if any, such that the text
+    //after it starts with close (or anything, if close is 0). Without an
+    //option, succeeds if the text at position starts with close.
+    bool readOption(const std::wstring& text, std::size_t position, wchar_t close, std::size_t& begin, std::size_t& end, std::size_t& after)
+    {
+        if (position < text.size() && (text[position] == L'#' || text[position] == L'"'))
+        {
+            wchar_t delimiter = text[position];
+            std::vector<std::size_t> ends;
+            optionEnds(text, position + 1, delimiter, ends);
+            for (std::vector<std::size_t>::const_iterator it = ends.begin(); it != ends.end(); ++it)
+            {
+                if (*it == text.size() || text[*it] != delimiter)
+                    continue;
+                if (close && (*it + 1 == text.size() || text[*it + 1] != close))
+                    continue;
+                begin = position + 1;
+                end = *it;
+                after = *it + 1;
+                return true;
+            }
+        }
+        begin = end = after = position;
+        return !close || (position < text.size() && text[position] == close);
+    }
+
+}
+
+void commandLexer::clear()
+{
+    streams.clear();
+}
+
+void commandLexer::push(const std::wstring& text)
+{
+    streams.push_back(tokenStream(std::make_shared<std::wstring>(text)));
+}
+
+bool commandLexer::next(std::wstring& argument, std::wstring& option)
+{
+    while (!streams.empty())
+    {
+        if (streams.back().next(argument, option))
+            return true;
+        streams.pop_back();
+    }
+    return false;
+}
+
+commandLexer::tokenStream::tokenStream(const std::shared_ptr<const std::wstring>& text_)
+    : text(text_)
+    , position(0)
+{}
+
+//Tokens are, in order of preference:
+//  { or }
+//  "-modifier" with an optional #option# or "option" inside the quotes
+//  "text", which may contain "" (kept as written)
+//  -modifier, with an optional #option# or "option"
+//  any other run of non-space characters
+bool commandLexer::tokenStream::next(std::wstring& argument, std::wstring& option)
+{
+    const std::wstring& line = *text;
+    while (position < line.size() && isSpace(line[position]))
+        ++position;
+    if (position == line.size())
+        return false;
+    std::size_t argumentBegin = position;
+    std::size_t argumentEnd = position + 1;
+    std::size_t optionBegin = position;
+    std::size_t optionEnd = position;
+    std::size_t after = position + 1;
+    wchar_t first = line[position];
+    bool found = first == L'{' || first == L'}';
+    if (!found && first == L'"')
+    {
+        found = readArgument(line, position + 1, argumentBegin, argumentEnd)
+            && readOption(line, argumentEnd, L'"', optionBegin, optionEnd, after);
+        if (found)
+            ++after;
+        else
+        {
+            std::vector<std::size_t> ends;
+            optionEnds(line, position + 1, L'"', ends);
+            for (std::vector<std::size_t>::const_iterator it = ends.begin(); !found && it != ends.end(); ++it)
+            {
+                if (*it < line.size() && line[*it] == L'"')
+                {
+                    found = true;
+                    argumentBegin = position + 1;
+                    argumentEnd = *it;
+                    optionBegin = optionEnd = *it;
+                    after = *it + 1;
+                }
+            }
+        }
+    }
+    if (!found && first == L'-')
+        found = readArgument(line, position, argumentBegin, argumentEnd)
+            && readOption(line, argumentEnd, 0, optionBegin, optionEnd, after);
+    if (!found)
+    {
+        argumentBegin = position;
+        for (argumentEnd = position; argumentEnd < line.size() && !isSpace(line[argumentEnd]); ++argumentEnd)
+            ;
+        optionBegin = optionEnd = after = argumentEnd;
+    }
+    argument.assign(line, argumentBegin, argumentEnd - argumentBegin);
+    option.assign(line, optionBegin, optionEnd - optionBegin);
+    position = after;
+    return true;
+}
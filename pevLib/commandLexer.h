@@ -0,0 +1,36 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// commandLexer.h -- Splits pevFind's command line, and the -loadline files
+// it names, into argument and option pairs for consoleParser.
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+
+class commandLexer
+{
+    //Reads the tokens of one command line or -loadline file in turn. Tokens
+    //are found by scanning the text in place; only the current one is copied
+    //out.
+    class tokenStream
+    {
+        std::shared_ptr<const std::wstring> text;
+        std::size_t position;
+    public:
+        explicit tokenStream(const std::shared_ptr<const std::wstring>& text_);
+        bool next(std::wstring& argument, std::wstring& option);
+    };
+
+    //A -loadline file's stream sits above the stream which loaded it, so its
+    //tokens are read in place of the -loadline token
+    std::vector<tokenStream> streams;
+public:
+    void clear();
+    //Reads text's tokens before the rest of the current stream
+    void push(const std::wstring& text);
+    //Reads the next token; false once every stream is read
+    bool next(std::wstring& argument, std::wstring& option);
+};
@@ -0,0 +1,531 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// compiledCriteria.cpp -- Implements lowering and running of flat programs.
+
+#include "pch.hpp"
+#include <algorithm>
+#include <boost/algorithm/string/replace.hpp>
+#include <boost/lexical_cast.hpp>
+#include "compiledCriteria.h"
+#include "fileData.h"
+
+namespace {
+
+    unsigned __int64 fileTimeValue(const FILETIME& time)
+    {
+        return (static_cast<unsigned __int64>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    }
+
+    bool isSingleBit(DWORD mask)
+    {
+        return (mask & (mask - 1)) == 0;
+    }
+
+    //The loops below are kept simple enough for the compiler to vectorize:
+    //each row's new result is computed unconditionally and then blended
+    //with the old one according to whether the row is live at pc.
+    template <typename compareType>
+    void compareColumn(const std::vector<unsigned __int64>& column, unsigned __int64 value, compareType compare,
+        const std::vector<std::size_t>& resumeAt, std::size_t pc, std::vector<unsigned char>& result)
+    {
+        for (std::size_t row = 0; row < result.size(); ++row)
+        {
+            unsigned char const computed = compare(column[row], value);
+            result[row] = resumeAt[row] <= pc ? computed : result[row];
+        }
+    }
+
+    struct lessThan
+    {
+        unsigned char operator()(unsigned __int64 lhs, unsigned __int64 rhs) const { return lhs < rhs; }
+    };
+    struct greaterThan
+    {
+        unsigned char operator()(unsigned __int64 lhs, unsigned __int64 rhs) const { return lhs > rhs; }
+    };
+    struct equalTo
+    {
+        unsigned char operator()(unsigned __int64 lhs, unsigned __int64 rhs) const { return lhs == rhs; }
+    };
+    struct notEqualTo
+    {
+        unsigned char operator()(unsigned __int64 lhs, unsigned __int64 rhs) const { return lhs != rhs; }
+    };
+
+    void gather(const std::vector<unsigned __int64>& column, const entryBlock::selection& rows, std::vector<unsigned __int64>& dense)
+    {
+        dense.resize(rows.size());
+        for (std::size_t idx = 0; idx < rows.size(); ++idx)
+            dense[idx] = column[rows[idx]];
+    }
+
+}
+
+flatProgram::flatProgram() : stackDepth(0)
+{}
+
+void flatProgram::emit(opcode op, std::size_t offset)
+{
+    instruction added;
+    added.op = op;
+    added.mask = 0;
+    added.flip = 0;
+    added.compare = EQUAL;
+    added.which = ACCESS_TIME;
+    added.value = 0;
+    added.offset = offset;
+    code.push_back(added);
+}
+
+//Jumps are relative, so programs can be pasted together as they are.
+void flatProgram::append(const flatProgram& other)
+{
+    code.insert(code.end(), other.code.begin(), other.code.end());
+    stackDepth = std::max(stackDepth, other.stackDepth);
+}
+
+//True if this program is one attribute test which can be merged into an
+//AND (any false) or OR (any true) of attribute tests.
+bool flatProgram::isAttributeTest(bool any) const
+{
+    if (code.size() != 1)
+        return false;
+    instruction const& test = code[0];
+    if (test.op == OP_ALL)
+        return !any || isSingleBit(test.mask);
+    if (test.op == OP_ANY)
+        return any || isSingleBit(test.mask);
+    return false;
+}
+
+void flatProgram::constant(bool value)
+{
+    emit(OP_CONSTANT);
+    code.back().value = value;
+}
+
+void flatProgram::attributes(DWORD mask)
+{
+    emit(OP_ALL);
+    code.back().mask = mask;
+}
+
+void flatProgram::size(comparison compare, unsigned __int64 value)
+{
+    emit(OP_SIZE);
+    code.back().compare = compare;
+    code.back().value = value;
+}
+
+void flatProgram::time(fileTime which, comparison compare, const FILETIME& value)
+{
+    emit(OP_TIME);
+    code.back().which = which;
+    code.back().compare = compare;
+    code.back().value = fileTimeValue(value);
+}
+
+bool flatProgram::lowerJunction(const std::vector<const criterion *>& operands, bool any)
+{
+    std::vector<flatProgram> parts(operands.size());
+    for (std::size_t idx = 0; idx < operands.size(); ++idx)
+        if (!operands[idx]->lower(parts[idx]))
+            return false;
+
+    //Fold every attribute test into one mask, which is tested first
+    DWORD mask = 0;
+    DWORD flip = 0;
+    bool folded = false;
+    for (std::vector<flatProgram>::const_iterator it = parts.begin(); it != parts.end(); ++it)
+    {
+        if (!it->isAttributeTest(any))
+            continue;
+        instruction const& test = it->code[0];
+        if ((flip ^ test.flip) & mask & test.mask)
+        {
+            //One operand wants a bit set and another wants it clear, so an
+            //AND is never true and an OR is always true.
+            constant(any);
+            return true;
+        }
+        mask |= test.mask;
+        flip |= test.flip;
+        folded = true;
+    }
+    std::vector<std::size_t> jumps;
+    if (folded)
+    {
+        emit(any ? OP_ANY : OP_ALL);
+        code.back().mask = mask;
+        code.back().flip = flip;
+    }
+    for (std::vector<flatProgram>::const_iterator it = parts.begin(); it != parts.end(); ++it)
+    {
+        if (it->isAttributeTest(any))
+            continue;
+        if (!code.empty())
+        {
+            jumps.push_back(code.size());
+            emit(any ? OP_JUMP_IF_TRUE : OP_JUMP_IF_FALSE);
+        }
+        append(*it);
+    }
+    for (std::vector<std::size_t>::const_iterator it = jumps.begin(); it != jumps.end(); ++it)
+        code[*it].offset = code.size() - *it - 1;
+    return true;
+}
+
+bool flatProgram::lowerAnd(const std::vector<const criterion *>& operands)
+{
+    return lowerJunction(operands, false);
+}
+
+bool flatProgram::lowerOr(const std::vector<const criterion *>& operands)
+{
+    return lowerJunction(operands, true);
+}
+
+bool flatProgram::lowerXor(const criterion& a, const criterion& b)
+{
+    flatProgram first;
+    flatProgram second;
+    if (!a.lower(first) || !b.lower(second))
+        return false;
+    if (second.stackDepth + 1 > maximumStackDepth)
+        return false;
+    append(first);
+    emit(OP_PUSH);
+    append(second);
+    emit(OP_XOR);
+    stackDepth = std::max(stackDepth, second.stackDepth + 1);
+    return true;
+}
+
+bool flatProgram::lowerNot(const criterion& operand)
+{
+    flatProgram inner;
+    if (!operand.lower(inner))
+        return false;
+    if (inner.code.size() == 1)
+    {
+        instruction& single = inner.code[0];
+        switch (single.op)
+        {
+        case OP_ALL:
+        case OP_ANY:
+            //Not all bits match exactly when any bit mismatches, and vice versa
+            single.op = single.op == OP_ALL ? OP_ANY : OP_ALL;
+            single.flip ^= single.mask;
+            append(inner);
+            return true;
+        case OP_CONSTANT:
+            single.value = !single.value;
+            append(inner);
+            return true;
+        }
+    }
+    append(inner);
+    emit(OP_NOT);
+    return true;
+}
+
+bool flatProgram::lowerIf(const criterion& condition, const criterion& valueIfTrue, const criterion* valueIfFalse)
+{
+    flatProgram conditionCode;
+    flatProgram trueCode;
+    flatProgram falseCode;
+    if (!condition.lower(conditionCode) || !valueIfTrue.lower(trueCode))
+        return false;
+    if (valueIfFalse)
+    {
+        if (!valueIfFalse->lower(falseCode))
+            return false;
+    }
+    else
+    {
+        //An IF without an ELSE is true when the condition is false
+        falseCode.constant(true);
+    }
+    append(conditionCode);
+    emit(OP_JUMP_IF_FALSE, trueCode.code.size() + 1);
+    append(trueCode);
+    emit(OP_JUMP, falseCode.code.size());
+    append(falseCode);
+    return true;
+}
+
+BOOL flatProgram::run(FileData& file) const
+{
+    DWORD attributeBits = 0;
+    bool haveAttributes = false;
+    WIN32_FILE_ATTRIBUTE_DATA attributeData;
+    bool haveAttributeData = false;
+    bool stack[maximumStackDepth];
+    unsigned int top = 0;
+    bool result = true;
+    for (std::size_t pc = 0; pc < code.size(); ++pc)
+    {
+        instruction const& current = code[pc];
+        switch (current.op)
+        {
+        case OP_CONSTANT:
+            result = current.value != 0;
+            break;
+        case OP_ALL:
+        case OP_ANY:
+            if (!haveAttributes)
+            {
+                attributeBits = file.getAttributeBits();
+                haveAttributes = true;
+            }
+            if (current.op == OP_ALL)
+                result = ((attributeBits ^ current.flip) & current.mask) == current.mask;
+            else
+                result = ((attributeBits ^ current.flip) & current.mask) != 0;
+            break;
+        case OP_SIZE:
+        case OP_TIME:
+            {
+                //One copy of the record's attribute data serves every size and date test
+                if (!haveAttributeData)
+                {
+                    attributeData = file.getAttributeData();
+                    haveAttributeData = true;
+                }
+                unsigned __int64 actual;
+                if (current.op == OP_SIZE)
+                {
+                    //Directories have no size, as in FileData::getSize
+                    if (attributeData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                        actual = 0;
+                    else
+                        actual = (static_cast<unsigned __int64>(attributeData.nFileSizeHigh) << 32) | attributeData.nFileSizeLow;
+                }
+                else if (current.which == ACCESS_TIME)
+                    actual = fileTimeValue(attributeData.ftLastAccessTime);
+                else if (current.which == MODIFIED_TIME)
+                    actual = fileTimeValue(attributeData.ftLastWriteTime);
+                else
+                    actual = fileTimeValue(attributeData.ftCreationTime);
+                switch (current.compare)
+                {
+                case LESS:
+                    result = actual < current.value;
+                    break;
+                case GREATER:
+                    result = actual > current.value;
+                    break;
+                case EQUAL:
+                    result = actual == current.value;
+                    break;
+                case NOT_EQUAL:
+                    result = actual != current.value;
+                    break;
+                }
+            }
+            break;
+        case OP_NOT:
+            result = !result;
+            break;
+        case OP_JUMP_IF_FALSE:
+            if (!result)
+                pc += current.offset;
+            break;
+        case OP_JUMP_IF_TRUE:
+            if (result)
+                pc += current.offset;
+            break;
+        case OP_JUMP:
+            pc += current.offset;
+            break;
+        case OP_PUSH:
+            stack[top++] = result;
+            break;
+        case OP_XOR:
+            result = stack[--top] != result;
+            break;
+        }
+    }
+    return result;
+}
+
+void flatProgram::runBlock(const entryBlock& block, entryBlock::selection& rows) const
+{
+    std::size_t const count = rows.size();
+    if (count == 0)
+        return;
+    //Copy the columns the program tests into dense arrays for the selection
+    std::vector<DWORD> attributeColumn;
+    std::vector<unsigned __int64> sizeColumn;
+    std::vector<unsigned __int64> timeColumns[3];
+    for (std::vector<instruction>::const_iterator it = code.begin(); it != code.end(); ++it)
+    {
+        if ((it->op == OP_ALL || it->op == OP_ANY) && attributeColumn.empty())
+        {
+            attributeColumn.resize(count);
+            for (std::size_t idx = 0; idx < count; ++idx)
+                attributeColumn[idx] = block.attributes[rows[idx]];
+        }
+        else if (it->op == OP_SIZE && sizeColumn.empty())
+            gather(block.sizes, rows, sizeColumn);
+        else if (it->op == OP_TIME && timeColumns[it->which].empty())
+        {
+            if (it->which == ACCESS_TIME)
+                gather(block.accessTimes, rows, timeColumns[it->which]);
+            else if (it->which == MODIFIED_TIME)
+                gather(block.modifiedTimes, rows, timeColumns[it->which]);
+            else
+                gather(block.creationTimes, rows, timeColumns[it->which]);
+        }
+    }
+
+    std::vector<unsigned char> result(count, 1);
+    //A row takes part in instruction pc only if resumeAt[row] <= pc; jumps
+    //move it forward. Jumps only go forward, so this follows each row's path.
+    std::vector<std::size_t> resumeAt(count, 0);
+    //Jumps never cross a PUSH without its XOR, so the stack height depends
+    //only on pc.
+    std::vector<unsigned char> stack(stackDepth * count);
+    std::size_t top = 0;
+    for (std::size_t pc = 0; pc < code.size(); ++pc)
+    {
+        instruction const& current = code[pc];
+        switch (current.op)
+        {
+        case OP_CONSTANT:
+            for (std::size_t row = 0; row < count; ++row)
+                result[row] = resumeAt[row] <= pc ? current.value != 0 : result[row];
+            break;
+        case OP_ALL:
+            for (std::size_t row = 0; row < count; ++row)
+            {
+                unsigned char const computed = ((attributeColumn[row] ^ current.flip) & current.mask) == current.mask;
+                result[row] = resumeAt[row] <= pc ? computed : result[row];
+            }
+            break;
+        case OP_ANY:
+            for (std::size_t row = 0; row < count; ++row)
+            {
+                unsigned char const computed = ((attributeColumn[row] ^ current.flip) & current.mask) != 0;
+                result[row] = resumeAt[row] <= pc ? computed : result[row];
+            }
+            break;
+        case OP_SIZE:
+        case OP_TIME:
+            {
+                std::vector<unsigned __int64> const& column = current.op == OP_SIZE ? sizeColumn : timeColumns[current.which];
+                switch (current.compare)
+                {
+                case LESS:
+                    compareColumn(column, current.value, lessThan(), resumeAt, pc, result);
+                    break;
+                case GREATER:
+                    compareColumn(column, current.value, greaterThan(), resumeAt, pc, result);
+                    break;
+                case EQUAL:
+                    compareColumn(column, current.value, equalTo(), resumeAt, pc, result);
+                    break;
+                case NOT_EQUAL:
+                    compareColumn(column, current.value, notEqualTo(), resumeAt, pc, result);
+                    break;
+                }
+            }
+            break;
+        case OP_NOT:
+            for (std::size_t row = 0; row < count; ++row)
+                result[row] = resumeAt[row] <= pc ? !result[row] : result[row];
+            break;
+        case OP_JUMP_IF_FALSE:
+            for (std::size_t row = 0; row < count; ++row)
+                if (resumeAt[row] <= pc && !result[row])
+                    resumeAt[row] = pc + current.offset + 1;
+            break;
+        case OP_JUMP_IF_TRUE:
+            for (std::size_t row = 0; row < count; ++row)
+                if (resumeAt[row] <= pc && result[row])
+                    resumeAt[row] = pc + current.offset + 1;
+            break;
+        case OP_JUMP:
+            for (std::size_t row = 0; row < count; ++row)
+                if (resumeAt[row] <= pc)
+                    resumeAt[row] = pc + current.offset + 1;
+            break;
+        case OP_PUSH:
+            std::copy(result.begin(), result.end(), stack.begin() + top * count);
+            ++top;
+            break;
+        case OP_XOR:
+            --top;
+            for (std::size_t row = 0; row < count; ++row)
+                result[row] = resumeAt[row] <= pc ? stack[top * count + row] != result[row] : result[row];
+            break;
+        }
+    }
+    std::size_t kept = 0;
+    for (std::size_t idx = 0; idx < count; ++idx)
+        if (result[idx])
+            rows[kept++] = rows[idx];
+    rows.resize(kept);
+}
+
+void flatProgram::compile(std::shared_ptr<criterion>& node)
+{
+    flatProgram program;
+    if (node->lower(program))
+        node = std::make_shared<compiledCriterion>(program, node);
+    else
+        node->compileTree();
+}
+
+compiledCriterion::compiledCriterion(const flatProgram& program_, std::shared_ptr<criterion> original_)
+    : program(program_)
+    , original(original_)
+{}
+
+unsigned __int32 compiledCriterion::getPriorityClass() const
+{
+    return original->getPriorityClass();
+}
+
+BOOL compiledCriterion::include(FileData &file) const
+{
+    return program.run(file);
+}
+
+void compiledCriterion::filterBlock(entryBlock& block, entryBlock::selection& rows) const
+{
+    program.runBlock(block, rows);
+}
+
+unsigned int compiledCriterion::directoryCheck(const std::wstring& directory) const
+{
+    return original->directoryCheck(directory);
+}
+
+void compiledCriterion::directoryPaths(std::vector<std::wstring>& paths) const
+{
+    original->directoryPaths(paths);
+}
+
+std::wstring compiledCriterion::debugTree() const
+{
+    std::wstring dbgMsg(L"- COMPILED (");
+    dbgMsg.append(boost::lexical_cast<std::wstring>(program.getInstructionCount()));
+    dbgMsg.append(L" instructions)\r\n");
+    dbgMsg.append(original->debugTree());
+    boost::algorithm::replace_all(dbgMsg, L"\r\n", L"\r\n   ");
+    return dbgMsg;
+}
+
+std::wstring compiledCriterion::identity() const
+{
+    return original->identity();
+}
+
+void compiledCriterion::makeNonRecursive()
+{
+    original->makeNonRecursive();
+}
@@ -0,0 +1,109 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// compiledCriteria.h -- Lowers subtrees of the criterion tree which only test
+// attributes, sizes and dates into flat programs. Attribute tests joined by
+// AND, OR and NOT fold into single masks over FileData's attribute bits, and
+// sizes and dates are compared inline against the record's attribute data,
+// so a compiled subtree costs one virtual call however large it is.
+#pragma once
+#include <vector>
+#include <memory>
+#include <string>
+#include "criterion.h"
+#include "entryBlock.h"
+
+class flatProgram
+{
+public:
+    enum comparison
+    {
+        LESS,
+        GREATER,
+        EQUAL,
+        NOT_EQUAL
+    };
+    enum fileTime
+    {
+        ACCESS_TIME,
+        MODIFIED_TIME,
+        CREATION_TIME
+    };
+private:
+    enum opcode
+    {
+        OP_CONSTANT,     //result = value != 0
+        OP_ALL,          //result = ((attributes ^ flip) & mask) == mask
+        OP_ANY,          //result = ((attributes ^ flip) & mask) != 0
+        OP_SIZE,         //result = size <compare> value
+        OP_TIME,         //result = time[which] <compare> value
+        OP_NOT,          //result = !result
+        OP_JUMP_IF_FALSE,//if (!result) skip offset instructions
+        OP_JUMP_IF_TRUE, //if (result) skip offset instructions
+        OP_JUMP,         //skip offset instructions
+        OP_PUSH,         //save result on the stack
+        OP_XOR           //result = pop() != result
+    };
+    struct instruction
+    {
+        opcode op;
+        DWORD mask;
+        DWORD flip;
+        comparison compare;
+        fileTime which;
+        unsigned __int64 value;
+        std::size_t offset;
+    };
+    std::vector<instruction> code;
+    unsigned int stackDepth;
+    //Nesting of XORs is limited so that run() needs no allocation
+    static const unsigned int maximumStackDepth = 16;
+
+    void emit(opcode op, std::size_t offset = 0);
+    void append(const flatProgram& other);
+    bool isAttributeTest(bool any) const;
+    bool lowerJunction(const std::vector<const criterion *>& operands, bool any);
+public:
+    flatProgram();
+    //The instructions emitted by the leaf criteria
+    void constant(bool value);
+    void attributes(DWORD mask);
+    void size(comparison compare, unsigned __int64 value);
+    void time(fileTime which, comparison compare, const FILETIME& value);
+    //Lowering for the operators; each returns false, leaving the program
+    //in an unspecified state, if any operand can't be lowered.
+    bool lowerAnd(const std::vector<const criterion *>& operands);
+    bool lowerOr(const std::vector<const criterion *>& operands);
+    bool lowerXor(const criterion& a, const criterion& b);
+    bool lowerNot(const criterion& operand);
+    bool lowerIf(const criterion& condition, const criterion& valueIfTrue, const criterion* valueIfFalse);
+
+    BOOL run(FileData& file) const;
+    //Runs the program over whole columns of a block, keeping the rows for
+    //which it is true. Each instruction is one loop over the selected rows;
+    //rows which jumped past it are left as they are.
+    void runBlock(const entryBlock& block, entryBlock::selection& rows) const;
+    std::size_t getInstructionCount() const { return code.size(); }
+    //Replaces node with a compiledCriterion if it lowers completely;
+    //otherwise asks it to compile its children.
+    static void compile(std::shared_ptr<criterion>& node);
+};
+
+class compiledCriterion : public criterion
+{
+    flatProgram program;
+    std::shared_ptr<criterion> original;
+public:
+    compiledCriterion(const flatProgram& program_, std::shared_ptr<criterion> original_);
+    unsigned __int32 getPriorityClass() const;
+    BOOL include(FileData &file) const;
+    void filterBlock(entryBlock& block, entryBlock::selection& rows) const;
+    unsigned int directoryCheck(const std::wstring& directory) const;
+    void directoryPaths(std::vector<std::wstring>& paths) const;
+    std::wstring debugTree() const;
+    //The same as the original's; the program computes the same result
+    std::wstring identity() const;
+    void makeNonRecursive();
+};
@@ -9,7 +9,7 @@
 
 #include "pch.hpp"
 #include <stdexcept>
-#include <boost/xpressive/xpressive_static.hpp>
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include "utility.h"
 #include "logger.h"
@@ -18,64 +18,40 @@
 #include "opstruct.h"
 #include "regex.h"
 #include "FILTER.h"
+#include "contentSearch.h"
 
 //Entry point into the parser system
-std::shared_ptr<criterion> consoleParser::parseCmdLine(const std::wstring& commandLine)
+std::shared_ptr<criterion> consoleParser::parseCmdLine(const std::wstring& commandLine, wchar_t const* subprogram)
 {
     tokenize(commandLine);
-    curToken++; //Skip past the program directory itself
-    if (boost::algorithm::iequals(curToken->argument, L"vfind"))
-        curToken++;
+    advance(); //Skip past the program directory itself
+    if (boost::algorithm::iequals(curToken.argument, subprogram))
+        advance();
     std::shared_ptr<criterion> result(andParse());
-    if (curToken->type != END)
+    if (curToken.type != END)
         throw std::runtime_error("Command line Syntax Error!!");
+    if (contentSearches)
+        contentSearches->compile();
     return result;
 }
 //Initial tokenizing function
 void consoleParser::tokenize(const std::wstring& commandLine)
 {
-    makeTokens(commandLine, tokens);
-    commandToken endCap;
-    endCap.type = END;
-    tokens.push_back(endCap);
-    curToken = tokens.begin();
+    lexer.clear();
+    lexer.push(commandLine);
+    advance();
 }
-//Inserts new tokens (--loadline) to the token stream
-void consoleParser::insertNewTokens(std::vector<commandToken>::iterator& position, const std::wstring& commandLine)
+//Moves curToken to the next token, or END once every stream is read
+void consoleParser::advance()
 {
-    std::vector<commandToken> newTokens;
-    makeTokens(commandLine, newTokens);
-    if (newTokens.size())
+    if (lexer.next(curToken.argument, curToken.option))
     {
-        size_t pos = position - tokens.begin(); //Remember the position offset
-        tokens.insert(position + 1, newTokens.begin(), newTokens.end()); //Invalidates iterators
-        position = tokens.begin() + pos; //Use the position offset to make this iterator valid again
-    }
-}
-void consoleParser::makeTokens(const std::wstring& commandLine, std::vector<commandToken>& resultVec)
-{
-    using namespace boost::xpressive;
-    mark_tag argument(2), option(3);
-    wsregex tokenRegex =    (argument= as_xpr(L"{")) | (argument= as_xpr("}")) | as_xpr(L'"') >> (*as_xpr(L'-') >> (argument= as_xpr(L'-') >> +(~set[_s | (set= L'"', L'#', L'{', L'}') ])) >>
-        !(as_xpr(L'#') >> (option= +(as_xpr(L'#') >> set[range(L'A', L'Z') | range(L'a', L'z') | range(L'0', L'9')
-        | L'#' ]| ~set[L'#'])) >> L'#' | as_xpr(L'"') >> (option= +(L"\"\"" | ~set[L'"'])) >> L'"')) >> L'"' |
-                            as_xpr(L'"') >> (argument= +(L"\"\"" |~set[L'"'])) >> L'"' |
-                            (*as_xpr(L'-') >> (argument= as_xpr(L'-') >> +(~set[_s | (set= L'"', L'#', L'{', L'}') ])) >>
-        !(as_xpr(L'#') >> (option= +(as_xpr(L'#') >> set[range(L'A', L'Z') | range(L'a', L'z') | range(L'0', L'9')
-        | L'#' ]| ~set[L'#'])) >> L'#' | as_xpr(L'"') >> (option= +(L"\"\"" | ~set[L'"'])) >> L'"')) |
-                            (argument= +~_s);
-    wsregex_iterator tokenizedIterator(commandLine.begin(), commandLine.end(), tokenRegex);
-    wsregex_iterator end;
-    for(; tokenizedIterator != end; tokenizedIterator++)
-    {
-        commandToken madeTok;
-        wsmatch const &curMatch = *tokenizedIterator;
-        madeTok.argument = curMatch[argument];
-        madeTok.option = curMatch[option];
-        madeTok.type = makeTypeFromToken(curMatch[argument]);
-        madeTok.fullMatch = curMatch[0];
-        resultVec.push_back(madeTok);
+        curToken.type = makeTypeFromToken(curToken.argument);
+        return;
     }
+    curToken.argument.clear();
+    curToken.option.clear();
+    curToken.type = END;
 }
 consoleParser::tokenType consoleParser::makeTypeFromToken(const std::wstring& argument)
 {
@@ -123,9 +99,9 @@ consoleParser::tokenType consoleParser::makeTypeFromToken(const std::wstring& ar
 std::shared_ptr<criterion> consoleParser::andParse()
 {
     std::shared_ptr<criterion> prev(orParse());
-    while (curToken->type == AND)
+    while (curToken.type == AND)
     {
-        curToken++;
+        advance();
         std::shared_ptr<criterion> cur(orParse());
         std::shared_ptr<criterion> newNode(new andAndClass(cur, prev));
         prev = newNode;
@@ -135,9 +111,9 @@ std::shared_ptr<criterion> consoleParser::andParse()
 std::shared_ptr<criterion> consoleParser::orParse()
 {
     std::shared_ptr<criterion> prev(xorParse());
-    while (curToken->type == OR)
+    while (curToken.type == OR)
     {
-        curToken++;
+        advance();
         std::shared_ptr<criterion> cur(xorParse());
         std::shared_ptr<criterion> newNode(new orAndClass(cur, prev));
         prev = newNode;
@@ -147,9 +123,9 @@ std::shared_ptr<criterion> consoleParser::orParse()
 std::shared_ptr<criterion> consoleParser::xorParse()
 {
     std::shared_ptr<criterion> prev(exprParse());
-    while (curToken->type == XOR)
+    while (curToken.type == XOR)
     {
-        curToken++;
+        advance();
         std::shared_ptr<criterion> cur(exprParse());
         std::shared_ptr<criterion> newNode(new xorAndClass(cur, prev));
         prev = newNode;
@@ -161,34 +137,34 @@ std::shared_ptr<criterion> consoleParser::exprParse()
     std::vector<std::shared_ptr<criterion> > results;
     while (isExpressionArgumentType())
     {
-        switch(curToken->type)
+        switch(curToken.type)
         {
         case NOT:
             {
-                curToken++;
+                advance();
                 std::shared_ptr<criterion> ptrVal(new notAndClass(exprParse()));
                 results.push_back(ptrVal);
             }
             break;
         case BRACKET:
             results.push_back(createBracket());
-            curToken++;
+            advance();
             break;
         case IFARG:
             results.push_back(createIf());
-            curToken++;
+            advance();
             break;
         case REGEX:
             {
-                std::shared_ptr<regexClass> ptrVal(new vFindRegex(curToken->argument));
+                std::shared_ptr<regexClass> ptrVal(new vFindRegex(curToken.argument));
                 results.push_back(ptrVal);
                 globalOptions::regularExpressions.push_back(ptrVal);
-                curToken++;
+                advance();
             }
             break;
         case MODIFIER:
             createModifier(results);
-            curToken++;
+            advance();
             break;
         default:
             throw std::runtime_error("Token unexpected. Check expression!");
@@ -206,21 +182,21 @@ std::shared_ptr<criterion> consoleParser::exprParse()
 }
 std::shared_ptr<criterion> consoleParser::createBracket()
 {
-    curToken++;
+    advance();
     std::shared_ptr<criterion> result = andParse();
-    if (curToken->type != ENDBRACKET)
+    if (curToken.type != ENDBRACKET)
         throw std::runtime_error("Unbalanced {}s in your expression.");
     return result;
 }
 std::shared_ptr<criterion> consoleParser::createIf()
 {
-    curToken++;
+    advance();
     std::shared_ptr<criterion> condition(exprParse());
     std::shared_ptr<criterion> then(exprParse());
     std::shared_ptr<criterion> els((criterion *)NULL);
-    if (curToken->type == ELSEARG)
+    if (curToken.type == ELSEARG)
     {
-        curToken++;
+        advance();
         els = exprParse();
     }
     std::shared_ptr<criterion> result(new ifClass(condition, then, els));
@@ -228,7 +204,7 @@ std::shared_ptr<criterion> consoleParser::createIf()
 }
 bool consoleParser::isExpressionArgumentType()
 {
-    switch(curToken->type)
+    switch(curToken.type)
     {
     case BRACKET:
     case IFARG:
@@ -242,7 +218,7 @@ bool consoleParser::isExpressionArgumentType()
 void consoleParser::createModifier(std::vector<std::shared_ptr<criterion> > &results)
 {
     using namespace boost::algorithm;
-    commandToken token = *curToken;
+    commandToken token = curToken;
     token.argument.erase(token.argument.begin(), token.argument.begin() + 1);
     do {
         if(      istarts_with(token.argument, L"custom"))
@@ -250,6 +226,12 @@ void consoleParser::createModifier(std::vector<std::shared_ptr<criterion> > &res
             globalOptions::displaySpecification = token.option;    
             return;
         }
+        else if (istarts_with(token.argument, L"catindex"))
+        {
+            removeArgument(8, token.argument);
+            globalOptions::catalogIndexFile = getEndOrOption(token);
+            return;
+        }
         else if (istarts_with(token.argument, L"c"))
         {
             globalOptions::displaySpecification = token.option;
@@ -307,6 +289,11 @@ void consoleParser::createModifier(std::vector<std::shared_ptr<criterion> > &res
             token.argument.erase(0, 4);
             globalOptions::encoding = globalOptions::ENCODING_TYPE_UTF16;
         }
+        else if (istarts_with(token.argument, L"explain"))
+        {
+            token.argument.erase(0, 7);
+            globalOptions::explain = true;
+        }
         else if (istarts_with(token.argument, L"expand"))
         {
             token.argument.erase(0, 6);
@@ -317,6 +304,8 @@ void consoleParser::createModifier(std::vector<std::shared_ptr<criterion> > &res
             token.argument.erase(0, 2);
             globalOptions::expandRegex = true;
         }
+        else if (istarts_with(token.argument, L"entropy"))
+            results.push_back(createEntropy<fileEntropyFilter>(token, 7));
         else if (istarts_with(token.argument, L"e"))
         {
             token.argument.erase(0, 1);
@@ -349,6 +338,14 @@ void consoleParser::createModifier(std::vector<std::shared_ptr<criterion> > &res
             token.argument.erase(0, 1);
             globalOptions::fullPath = true;
         }
+        else if (istarts_with(token.argument, L"hex"))
+            results.push_back(createContentSearch(token, true));
+        else if (istarts_with(token.argument, L"imports"))
+        {
+            removeArgument(7, token.argument);
+            results.push_back(std::shared_ptr<criterion>(new importsFilter(getEndOrOption(token))));
+            token.argument.clear();
+        }
         else if (istarts_with(token.argument, L"k"))
         {
             token.argument.erase(0, 1);
@@ -370,6 +367,12 @@ void consoleParser::createModifier(std::vector<std::shared_ptr<criterion> > &res
                 globalOptions::displaySpecification = L"#t #s #m  #8";
             globalOptions::summary = true;
         }
+        else if (istarts_with(token.argument, L"lreg"))
+        {
+            token.argument.clear();
+            boost::algorithm::replace_all(token.option, L"##", L"#");
+            results.push_back(std::shared_ptr<regexClass>(new linearRegex(token.option)));
+        }
         else if (istarts_with(token.argument, L"l"))
         {
             token.argument.erase(0, 1);
@@ -379,6 +382,12 @@ void consoleParser::createModifier(std::vector<std::shared_ptr<criterion> > &res
                 globalOptions::displaySpecification = L"#t #s #m  #8";
             globalOptions::summary = true;
         }
+        else if (istarts_with(token.argument, L"magic"))
+        {
+            removeArgument(5, token.argument);
+            results.push_back(std::shared_ptr<criterion>(new magicFilter(getEndOrOption(token))));
+            token.argument.clear();
+        }
         else if (istarts_with(token.argument, L"md5list"))
             results.push_back(createHashList<md5List>(token, 7));
         else if (istarts_with(token.argument, L"md5elist"))
@@ -417,6 +426,11 @@ void consoleParser::createModifier(std::vector<std::shared_ptr<criterion> > &res
             logger.update(getEndOrOption(token));
             token.argument.clear();
         }
+        else if (istarts_with(token.argument, L"packed"))
+        {
+            token.argument.erase(0, 6);
+            results.push_back(std::shared_ptr<criterion>(new isPacked()));
+        }
         else if (istarts_with(token.argument, L"peinfo"))
         {
             token.argument.erase(0, 6);
@@ -433,6 +447,17 @@ void consoleParser::createModifier(std::vector<std::shared_ptr<criterion> > &res
             token.argument.erase(0, 1);
             globalOptions::noSubDirectories = true;
         }
+        else if (istarts_with(token.argument, L"samplelist"))
+            results.push_back(createHashList<sampleList>(token, 10));
+        else if (istarts_with(token.argument, L"sampleblock"))
+        {
+            removeArgument(11, token.argument);
+            globalOptions::sampleBlockSize = processUL(token);
+            if (globalOptions::sampleBlockSize < 512 || globalOptions::sampleBlockSize > 128 * 1024)
+                throw std::runtime_error("The sample block size must be between 512 and 131072 bytes.");
+        }
+        else if (istarts_with(token.argument, L"sample"))
+            results.push_back(createHash<sampleMatch>(token, 6));
         else if (istarts_with(token.argument, L"sa"))
             ascendingSorts(token);
         else if (istarts_with(token.argument, L"sd"))
@@ -459,6 +484,17 @@ void consoleParser::createModifier(std::vector<std::shared_ptr<criterion> > &res
             results.push_back(std::shared_ptr<criterion>(new skipper(getEndOrOption(token))));
             token.argument.clear();
         }
+        else if (istarts_with(token.argument, L"strings"))
+        {
+            removeArgument(7, token.argument);
+            globalOptions::stringsMinimum = processUL(token);
+            if (!globalOptions::stringsMinimum)
+                globalOptions::stringsMinimum = 4;
+        }
+        else if (istarts_with(token.argument, L"string"))
+            results.push_back(createContentSearch(token, false));
+        else if (istarts_with(token.argument, L"sectionentropy"))
+            results.push_back(createEntropy<sectionEntropyFilter>(token, 14));
         else if (istarts_with(token.argument, L"s"))
             createSize(token,results);
         else if (istarts_with(token.argument, L"timeout"))
@@ -894,8 +930,7 @@ std::wstring& consoleParser::getEndOrOption(commandToken& token) const
 void consoleParser::processLoadlineArgument(commandToken& token)
 {
     removeArgument(8, token.argument);
-    std::wstring newCommands(loadFileAsString(getEndOrOption(token)));
-    insertNewTokens(curToken, newCommands);
+    lexer.push(loadFileAsString(getEndOrOption(token)));
     token.argument.clear();
 }
 
@@ -1005,6 +1040,67 @@ void consoleParser::parseNotTypeString(commandToken& token, std::vector<std::sha
     }
     
 }
+double consoleParser::processDouble(commandToken& token)
+{
+    wchar_t const * beginPoint = token.argument.c_str();
+    wchar_t * endPoint;
+    double result = wcstod(beginPoint, &endPoint);
+    if (endPoint == beginPoint)
+        throw std::runtime_error("Expected a number.");
+    token.argument.erase(0, endPoint - beginPoint);
+    return result;
+}
+std::shared_ptr<criterion> consoleParser::createContentSearch(commandToken& token, bool hex)
+{
+    token.argument.clear();
+    boost::algorithm::replace_all(token.option, L"##", L"#");
+    if (!contentSearches)
+        contentSearches = std::make_shared<contentPatterns>();
+    std::size_t const search = contentSearches->addSearch();
+    if (hex)
+    {
+        std::vector<unsigned char> bytes;
+        int high = -1;
+        for (std::wstring::const_iterator it = token.option.begin(); it != token.option.end(); ++it)
+        {
+            int digit;
+            if (*it == L' ')
+                continue;
+            else if (*it >= L'0' && *it <= L'9')
+                digit = *it - L'0';
+            else if (*it >= L'A' && *it <= L'F')
+                digit = *it - L'A' + 10;
+            else if (*it >= L'a' && *it <= L'f')
+                digit = *it - L'a' + 10;
+            else
+                throw std::runtime_error("-hex takes hexadecimal digits.");
+            if (high < 0)
+                high = digit;
+            else
+            {
+                bytes.push_back(static_cast<unsigned char>((high << 4) | digit));
+                high = -1;
+            }
+        }
+        if (high >= 0 || bytes.empty())
+            throw std::runtime_error("-hex takes whole bytes, two digits each.");
+        contentSearches->addPattern(search, &bytes[0], bytes.size());
+        return std::shared_ptr<criterion>(new contentMatch(contentSearches, search, L"HEX " + token.option));
+    }
+    if (token.option.empty())
+        throw std::runtime_error("-string needs some text to look for.");
+    //Look for the text both as the ANSI code page and as UTF-16 would store it.
+    std::string const narrow(convertUnicode(token.option));
+    contentSearches->addPattern(search, reinterpret_cast<const unsigned char*>(narrow.data()), narrow.size());
+    std::vector<unsigned char> wide;
+    for (std::wstring::const_iterator it = token.option.begin(); it != token.option.end(); ++it)
+    {
+        wide.push_back(static_cast<unsigned char>(*it));
+        wide.push_back(static_cast<unsigned char>(*it >> 8));
+    }
+    contentSearches->addPattern(search, &wide[0], wide.size());
+    return std::shared_ptr<criterion>(new contentMatch(contentSearches, search, L"STRING " + token.option));
+}
 void consoleParser::createSize(commandToken& token, std::vector<std::shared_ptr<criterion> > &results)
 {
     removeArgument(1, token.argument);
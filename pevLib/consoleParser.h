@@ -9,9 +9,13 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <memory>
+#include <stdexcept>
 #include <windows.h>
+#include "commandLexer.h"
 
 class criterion;
+class contentPatterns;
 
 class consoleParser 
 {
@@ -33,18 +37,18 @@ class consoleParser
     struct commandToken {
         std::wstring argument;
         std::wstring option;
-        std::wstring fullMatch;
         tokenType type;
-        std::wstring& operator()() { return fullMatch; };
     };
 
-    std::vector<commandToken> tokens;
-    std::vector<commandToken>::iterator curToken;
+    commandLexer lexer;
+    commandToken curToken;
+
+    //Every -hex and -string pattern, compiled together once parsing is done
+    std::shared_ptr<contentPatterns> contentSearches;
 
-    void insertNewTokens(std::vector<commandToken>::iterator& position, const std::wstring& commandLine);
     void tokenize(const std::wstring& commandLine);
-    void makeTokens(const std::wstring& commandLine, std::vector<commandToken>& resultVec);
-    tokenType makeTypeFromToken(const std::wstring& argument);
+    void advance();
+    static tokenType makeTypeFromToken(const std::wstring& argument);
 
     //Recursive-Descent Parser
     std::shared_ptr<criterion> andParse();
@@ -64,6 +68,7 @@ class consoleParser
     unsigned long processUL(std::wstring& numberString);
     long processLong(commandToken& token);
     long processLong(std::wstring& numberString);
+    double processDouble(commandToken& token);
     std::wstring& getEndOrOption(commandToken& token) const;
     template <typename hash_t> std::shared_ptr<criterion> createHashList(commandToken& token, std::size_t hashNameLen);
     template <typename hash_t> std::shared_ptr<criterion> createHash(commandToken& token, std::size_t hashNameLen);
@@ -72,6 +77,8 @@ class consoleParser
     void parseTypeString(commandToken& token, std::vector<std::shared_ptr<criterion> > &results);
     void parseNotTypeString(commandToken& token, std::vector<std::shared_ptr<criterion> > &results);
     void createSize(commandToken& token, std::vector<std::shared_ptr<criterion> > &results);
+    std::shared_ptr<criterion> createContentSearch(commandToken& token, bool hex);
+    template <typename entropy_t> std::shared_ptr<criterion> createEntropy(commandToken& token, std::size_t nameLen);
     void createDate(commandToken& token, std::vector<std::shared_ptr<criterion> > &results);
     void parseTypeString(TCHAR const *typeString, std::vector<criterion *>& results);
     
@@ -79,16 +86,16 @@ class consoleParser
     template <typename lowerClass, typename upperClass> 
         void subDateType(std::wstring& token, std::vector<std::shared_ptr<criterion> > &results);
     void processRelativeDate(std::wstring& token, FILETIME &result);
-    std::vector<std::wstring> stripCommandStruct(std::vector<commandToken>::iterator start, std::vector<commandToken>::iterator end);
 public:
-    std::shared_ptr<criterion> parseCmdLine(const std::wstring& commandLine);
+    //subprogram is the name which may follow the program path and is skipped
+    std::shared_ptr<criterion> parseCmdLine(const std::wstring& commandLine, wchar_t const* subprogram = L"vfind");
 };
 
 
 template <typename hash_t> std::shared_ptr<criterion> consoleParser::createHashList(commandToken& token, std::size_t hashNameLen)
 {
     removeArgument(hashNameLen, token.argument);
-    std::shared_ptr<criterion> crit(new hash_t(loadStringsFromFile(getEndOrOption(token))));
+    std::shared_ptr<criterion> crit(new hash_t(getEndOrOption(token)));
     token.argument.clear();
     return crit;
 }
@@ -101,6 +108,24 @@ template <typename hash_t> std::shared_ptr<criterion> consoleParser::createHash(
     return result;
 }
 
+template <typename entropy_t> std::shared_ptr<criterion> consoleParser::createEntropy(commandToken& token, std::size_t nameLen)
+{
+    removeArgument(nameLen, token.argument);
+    wchar_t typeChar = token.argument.empty() ? L'\0' : token.argument[0];
+    bool above;
+    if (typeChar == L'+' || typeChar == L'G' || typeChar == L'g')
+        above = true;
+    else if (typeChar == L'-' || typeChar == L'L' || typeChar == L'l')
+        above = false;
+    else
+        throw std::runtime_error("Entropy thresholds must start with + or -.");
+    removeArgument(1, token.argument);
+    double threshold = processDouble(token);
+    if (threshold < 0.0 || threshold > 8.0)
+        throw std::runtime_error("Entropy thresholds must be between 0 and 8.");
+    return std::shared_ptr<criterion>(new entropy_t(threshold, above));
+}
+
 template <typename lowerClass, typename upperClass> 
 void consoleParser::subDateType(std::wstring& token, std::vector<std::shared_ptr<criterion> > &results)
 {
@@ -0,0 +1,191 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// contentSearch.cpp -- Implements the multi-pattern content search.
+
+#include "pch.hpp"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include "contentSearch.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PEV_SEARCH_SSE2
+#endif
+
+namespace {
+
+    const std::uint32_t noTransition = 0xFFFFFFFF;
+
+    // Patterns rarely start with more than a few distinct bytes; up to this
+    // many are compared sixteen at a time.
+    const std::size_t maxVectorFirstBytes = 4;
+
+    // Returns the offset of the first byte in data which can start a match.
+    std::size_t skipToFirstByte(unsigned char const* data, std::size_t length,
+        const bool (&isFirstByte)[256], std::vector<unsigned char> const& firstBytes)
+    {
+        std::size_t idx = 0;
+#if defined(PEV_SEARCH_SSE2)
+        std::size_t const count = firstBytes.size();
+        // With no patterns at all nothing leaves the start state, and the
+        // scalar loop below runs to the end without reading any needle.
+        if (count != 0 && count <= maxVectorFirstBytes)
+        {
+            __m128i needles[maxVectorFirstBytes];
+            for (std::size_t needle = 0; needle < count; ++needle)
+                needles[needle] = _mm_set1_epi8(static_cast<char>(firstBytes[needle]));
+            for (; idx + 16 <= length; idx += 16)
+            {
+                __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + idx));
+                __m128i hits = _mm_cmpeq_epi8(block, needles[0]);
+                for (std::size_t needle = 1; needle < count; ++needle)
+                    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[needle]));
+                if (_mm_movemask_epi8(hits))
+                    break;
+            }
+        }
+#else
+        (void)firstBytes;
+#endif
+        while (idx < length && !isFirstByte[data[idx]])
+            ++idx;
+        return idx;
+    }
+
+}
+
+contentPatterns::contentPatterns()
+    : searches(0)
+{
+    std::memset(isFirstByte, 0, sizeof(isFirstByte));
+}
+
+std::size_t contentPatterns::addSearch()
+{
+    return searches++;
+}
+
+void contentPatterns::addPattern(std::size_t search, unsigned char const* bytes, std::size_t length)
+{
+    if (length == 0)
+        throw std::runtime_error("Content patterns must not be empty.");
+    pattern added;
+    added.bytes.assign(bytes, bytes + length);
+    added.search = search;
+    patterns.push_back(added);
+}
+
+void contentPatterns::compile()
+{
+    // Build the trie, with the searches each pattern satisfies at its end.
+    transitions.assign(256, noTransition);
+    std::vector<std::vector<std::uint32_t> > outputs(1);
+    for (std::vector<pattern>::const_iterator it = patterns.begin(); it != patterns.end(); ++it)
+    {
+        std::uint32_t current = 0;
+        for (std::vector<unsigned char>::const_iterator byte = it->bytes.begin(); byte != it->bytes.end(); ++byte)
+        {
+            std::uint32_t& next = transitions[current * 256 + *byte];
+            if (next == noTransition)
+            {
+                next = static_cast<std::uint32_t>(outputs.size());
+                outputs.push_back(std::vector<std::uint32_t>());
+                transitions.resize(transitions.size() + 256, noTransition);
+            }
+            current = transitions[current * 256 + *byte];
+        }
+        outputs[current].push_back(static_cast<std::uint32_t>(it->search));
+    }
+
+    // Breadth first, fill in failure transitions so that every state has all
+    // 256, and collect the outputs of each state's failure chain.
+    std::vector<std::uint32_t> failure(outputs.size(), 0);
+    std::deque<std::uint32_t> queue;
+    std::memset(isFirstByte, 0, sizeof(isFirstByte));
+    firstBytes.clear();
+    for (std::size_t byte = 0; byte < 256; ++byte)
+    {
+        std::uint32_t& next = transitions[byte];
+        if (next == noTransition)
+            next = 0;
+        else
+        {
+            isFirstByte[byte] = true;
+            firstBytes.push_back(static_cast<unsigned char>(byte));
+            queue.push_back(next);
+        }
+    }
+    while (!queue.empty())
+    {
+        std::uint32_t const current = queue.front();
+        queue.pop_front();
+        for (std::size_t byte = 0; byte < 256; ++byte)
+        {
+            std::uint32_t& next = transitions[current * 256 + byte];
+            std::uint32_t const fallback = transitions[failure[current] * 256 + byte];
+            if (next == noTransition)
+                next = fallback;
+            else
+            {
+                failure[next] = fallback;
+                outputs[next].insert(outputs[next].end(), outputs[fallback].begin(), outputs[fallback].end());
+                queue.push_back(next);
+            }
+        }
+    }
+
+    outputOffsets.assign(1, 0);
+    outputSearches.clear();
+    for (std::vector<std::vector<std::uint32_t> >::iterator it = outputs.begin(); it != outputs.end(); ++it)
+    {
+        std::sort(it->begin(), it->end());
+        it->erase(std::unique(it->begin(), it->end()), it->end());
+        outputSearches.insert(outputSearches.end(), it->begin(), it->end());
+        outputOffsets.push_back(static_cast<std::uint32_t>(outputSearches.size()));
+    }
+}
+
+contentScanner::contentScanner(const contentPatterns& patterns, std::size_t targetSearch)
+    : automaton(patterns)
+    , target(targetSearch)
+    , state(0)
+    , found(patterns.searchCount(), false)
+    , foundCount(0)
+    , done(patterns.searchCount() == 0)
+{}
+
+void contentScanner::Update(unsigned char const* data, std::size_t length)
+{
+    std::uint32_t const* const transitions = &automaton.transitions[0];
+    std::uint32_t const* const outputOffsets = &automaton.outputOffsets[0];
+    std::uint32_t current = state;
+    std::size_t idx = 0;
+    while (idx < length && !done)
+    {
+        if (current == 0)
+        {
+            idx += skipToFirstByte(data + idx, length - idx, automaton.isFirstByte, automaton.firstBytes);
+            if (idx == length)
+                break;
+        }
+        current = transitions[current * 256 + data[idx++]];
+        std::uint32_t const outputBegin = outputOffsets[current];
+        std::uint32_t const outputEnd = outputOffsets[current + 1];
+        for (std::uint32_t output = outputBegin; output < outputEnd; ++output)
+        {
+            std::uint32_t const search = automaton.outputSearches[output];
+            if (found[search])
+                continue;
+            found[search] = true;
+            ++foundCount;
+            if (search == target || foundCount == found.size())
+                done = true;
+        }
+    }
+    state = current;
+}
@@ -0,0 +1,65 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// contentSearch.h -- Searches file contents for many byte patterns at once.
+// Every pattern of a command line is compiled into one Aho-Corasick
+// automaton, so a file is read once no matter how many -hex and -string
+// criteria there are. Each criterion is a "search", which one or more
+// patterns satisfy (-string looks for both ASCII and UTF-16 forms).
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class contentPatterns
+{
+    friend class contentScanner;
+    struct pattern
+    {
+        std::vector<unsigned char> bytes;
+        std::size_t search;
+    };
+    std::vector<pattern> patterns;
+    std::size_t searches;
+
+    // The compiled automaton: 256 transitions per state, and for each state
+    // the searches satisfied on entering it.
+    std::vector<std::uint32_t> transitions;
+    std::vector<std::uint32_t> outputOffsets;
+    std::vector<std::uint32_t> outputSearches;
+    // Bytes which leave the start state, for skipping ahead
+    bool isFirstByte[256];
+    std::vector<unsigned char> firstBytes;
+public:
+    contentPatterns();
+    // Returns the id of a new search.
+    std::size_t addSearch();
+    // Adds a pattern (which must not be empty) which satisfies a search.
+    void addPattern(std::size_t search, unsigned char const* bytes, std::size_t length);
+    // Builds the automaton; call after the last addPattern and before scanning.
+    void compile();
+    std::size_t searchCount() const { return searches; }
+};
+
+// Runs the automaton over data passed to Update in order, so it can be a sink
+// of FileData's shared read. It stops once the target search is satisfied.
+class contentScanner
+{
+    const contentPatterns& automaton;
+    std::size_t target;
+    std::uint32_t state;
+    std::vector<bool> found;
+    std::size_t foundCount;
+    bool done;
+    contentScanner& operator=(const contentScanner&);
+public:
+    contentScanner(const contentPatterns& patterns, std::size_t targetSearch);
+    void Update(unsigned char const* data, std::size_t length);
+    // True once the target has been found (or everything has); the rest of
+    // the data need not be passed to Update.
+    bool isDone() const { return done; }
+    bool foundAll() const { return foundCount == found.size(); }
+    std::vector<bool> const& getFound() const { return found; }
+};
@@ -7,17 +7,22 @@
 #pragma once
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#include <vector>
 
 class FileData;
+class flatProgram;
+class entryBlock;
 
 #define PRIORITY_FAST_FILTER 1
 #define PRIORITY_SLOW_FILTER 2
 #define PRIORITY_VFIND_REGEX 3
 #define PRIORITY_PERL_REGEX 3
 #define PRIORITY_HASH_CHECK 6
+#define PRIORITY_SAMPLE_HASH 4
 #define PRIORITY_PE_DATA 4
+#define PRIORITY_PE_DIRECTORIES 5
 #define PRIORITY_SIGCHECK 7
-#define PRIORITY_HEX_SEARCH 5
+#define PRIORITY_HEX_SEARCH 8
 
 #define DIRECTORY_DONTCARE 2
 #define DIRECTORY_INCLUDE 1 
@@ -29,10 +34,36 @@ public:
     virtual unsigned __int32 getPriorityClass() const = 0;
     virtual BOOL include(FileData &file) const = 0;
     virtual void reorderTree() {};
-    virtual unsigned int directoryCheck(const std::wstring& /*directory*/) { return DIRECTORY_DONTCARE; };
+    //Simplifies this node's children, then returns true and sets replacement
+    //if this node is equivalent to a simpler one. See simplify.h.
+    virtual bool simplify(std::shared_ptr<criterion>& /*replacement*/) { return false; }
+    virtual unsigned int directoryCheck(const std::wstring& /*directory*/) const { return DIRECTORY_DONTCARE; };
+    //Adds the paths which directoryCheck compares directories against. The
+    //answer may only depend on how a directory is related to these paths;
+    //see directoryFilter.h.
+    virtual void directoryPaths(std::vector<std::wstring>& /*paths*/) const {};
     virtual std::wstring debugTree() const = 0;
+    //Like debugTree, but with what was measured during the search; used by --explain
+    virtual std::wstring explainTree() const { return debugTree(); }
+    //Text which two criteria share only if they always give the same result;
+    //the simplifier drops repeated operands by it. The default is the debug
+    //text, so criteria whose debug text leaves out a parameter which changes
+    //the result, or which is too long to build for every comparison, override
+    //it. Differing for equivalent criteria only costs a missed fold.
+    virtual std::wstring identity() const { return debugTree(); }
+    //debugTree or identity, for nodes which print their children either way
+    typedef std::wstring (criterion::*describer)() const;
     virtual ~criterion() {}; //Virtual destructor DO NOT REMOVE!
     virtual void makeNonRecursive() {};
+    //Appends instructions computing include() to program, or returns false if
+    //this can only be evaluated by calling include(). See compiledCriteria.h.
+    virtual bool lower(flatProgram& /*program*/) const { return false; }
+    //Compiles the children which lower completely; see flatProgram::compile.
+    virtual void compileTree() {};
+    //Removes the rows of block which are not included from rows, which is
+    //an entryBlock::selection. The default calls include() on each row's
+    //record; see entryBlock.cpp.
+    virtual void filterBlock(entryBlock& block, std::vector<unsigned __int16>& rows) const;
 };
 
 //Functor which converts pointers to criteria to priority classes
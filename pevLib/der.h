@@ -0,0 +1,136 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// der.h -- A minimal reader for the DER encoding used by PKCS#7 and X.509,
+// shared by the Authenticode and catalog decoders. Elements point into the
+// buffer being decoded; nothing is copied.
+#pragma once
+#include <cstddef>
+#include <cstring>
+
+enum derTag
+{
+    DER_INTEGER = 0x02,
+    DER_OCTET_STRING = 0x04,
+    DER_OID = 0x06,
+    DER_UTF8_STRING = 0x0C,
+    DER_PRINTABLE_STRING = 0x13,
+    DER_T61_STRING = 0x14,
+    DER_IA5_STRING = 0x16,
+    DER_BMP_STRING = 0x1E,
+    DER_SEQUENCE = 0x30,
+    DER_SET = 0x31,
+    DER_CONTEXT_0 = 0xA0
+};
+
+struct derElement
+{
+    unsigned char tag;
+    unsigned char const* contents;
+    std::size_t length;
+    unsigned char const* encoded; // Including the tag and length
+    std::size_t encodedLength;
+
+    template <std::size_t size>
+    bool isOid(const unsigned char (&oid)[size]) const
+    {
+        return tag == DER_OID && length == size && std::memcmp(contents, oid, size) == 0;
+    }
+    bool sameEncoding(const derElement& rhs) const
+    {
+        return encodedLength == rhs.encodedLength && std::memcmp(encoded, rhs.encoded, encodedLength) == 0;
+    }
+};
+
+// Reads the elements of a constructed value in order. Only definite lengths
+// are accepted, which is all DER allows.
+class derReader
+{
+    unsigned char const* cursor;
+    unsigned char const* end;
+public:
+    derReader()
+        : cursor(nullptr)
+        , end(nullptr)
+    {}
+    derReader(unsigned char const* data, std::size_t length)
+        : cursor(data)
+        , end(data + length)
+    {}
+    explicit derReader(const derElement& constructed)
+        : cursor(constructed.contents)
+        , end(constructed.contents + constructed.length)
+    {}
+    bool atEnd() const { return cursor == end; }
+    bool next(derElement& element)
+    {
+        std::size_t const remaining = end - cursor;
+        if (remaining < 2)
+            return false;
+        element.encoded = cursor;
+        element.tag = cursor[0];
+        if ((element.tag & 0x1F) == 0x1F)
+            return false; // High tag numbers are not used by anything we read
+        std::size_t length = cursor[1];
+        std::size_t header = 2;
+        if (length & 0x80)
+        {
+            std::size_t const lengthBytes = length & 0x7F;
+            if (lengthBytes == 0 || lengthBytes > 4 || remaining < 2 + lengthBytes)
+                return false;
+            length = 0;
+            for (std::size_t idx = 0; idx < lengthBytes; ++idx)
+                length = (length << 8) | cursor[2 + idx];
+            header += lengthBytes;
+        }
+        if (length > remaining - header)
+            return false;
+        element.contents = cursor + header;
+        element.length = length;
+        element.encodedLength = header + length;
+        cursor += element.encodedLength;
+        return true;
+    }
+    bool next(derElement& element, unsigned char expectedTag)
+    {
+        return next(element) && element.tag == expectedTag;
+    }
+};
+
+// Opens a PKCS#7 ContentInfo holding SignedData:
+//     ContentInfo ::= SEQUENCE { contentType, [0] EXPLICIT content }
+//     SignedData ::= SEQUENCE { version, digestAlgorithms, encapContentInfo,
+//         [0] certificates OPTIONAL, [1] crls OPTIONAL, signerInfos }
+// On success, contentType and content are the type and the (unwrapped) value
+// of the encapsulated content, and rest is positioned at the certificates.
+inline bool derOpenSignedData(unsigned char const* data, std::size_t length,
+    derElement& contentInfo, derElement& contentType, derElement& content, derReader& rest)
+{
+    static const unsigned char oidSignedData[] = { 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x02 };
+    derReader outer(data, length);
+    derElement outerType, outerExplicit, signedData;
+    if (!outer.next(contentInfo, DER_SEQUENCE))
+        return false;
+    derReader contentInfoReader(contentInfo);
+    if (!contentInfoReader.next(outerType) || !outerType.isOid(oidSignedData)
+        || !contentInfoReader.next(outerExplicit, DER_CONTEXT_0))
+        return false;
+    derReader outerExplicitReader(outerExplicit);
+    if (!outerExplicitReader.next(signedData, DER_SEQUENCE))
+        return false;
+
+    rest = derReader(signedData);
+    derElement version, digestAlgorithms, encapsulated, encapsulatedExplicit;
+    if (!rest.next(version, DER_INTEGER)
+        || !rest.next(digestAlgorithms, DER_SET)
+        || !rest.next(encapsulated, DER_SEQUENCE))
+        return false;
+    derReader encapsulatedReader(encapsulated);
+    if (!encapsulatedReader.next(contentType, DER_OID)
+        || !encapsulatedReader.next(encapsulatedExplicit, DER_CONTEXT_0))
+        return false;
+    derReader encapsulatedExplicitReader(encapsulatedExplicit);
+    return encapsulatedExplicitReader.next(content);
+}
@@ -0,0 +1,110 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// directoryFilter.cpp -- Implements the trie of directory criteria.
+
+#include "pch.hpp"
+#include <cwctype>
+#include "directoryFilter.h"
+#include "criterion.h"
+
+namespace {
+
+    bool isSeparator(wchar_t character)
+    {
+        return character == L'\\' || character == L'/';
+    }
+
+    //No file name can contain a pipe, so this names a directory which is
+    //below a node but matches none of its children.
+    const wchar_t unmatchedComponent[] = L"\\|";
+
+}
+
+directoryFilter::directoryFilter(const criterion& tree_) : tree(tree_)
+{
+    nodes.push_back(node());
+    std::vector<std::wstring> paths;
+    tree.directoryPaths(paths);
+    for (std::vector<std::wstring>::const_iterator it = paths.begin(); it != paths.end(); ++it)
+    {
+        std::size_t current = 0;
+        std::size_t position = 0;
+        while (nextComponent(*it, position, componentBuffer))
+        {
+            std::unordered_map<std::wstring, std::size_t>::const_iterator child = nodes[current].children.find(componentBuffer);
+            if (child != nodes[current].children.end())
+            {
+                current = child->second;
+                continue;
+            }
+            std::size_t added = nodes.size();
+            nodes[current].children.insert(std::make_pair(componentBuffer, added));
+            nodes.push_back(node());
+            nodes[added].representative.assign(*it, 0, position);
+            current = added;
+        }
+    }
+}
+
+directoryFilter::node::node() : exact(DIRECTORY_UNKNOWN), below(DIRECTORY_UNKNOWN)
+{}
+
+unsigned int directoryFilter::check(const std::wstring& directory)
+{
+    std::size_t current = 0;
+    std::size_t position = 0;
+    while (nextComponent(directory, position, componentBuffer))
+    {
+        std::unordered_map<std::wstring, std::size_t>::const_iterator child = nodes[current].children.find(componentBuffer);
+        if (child == nodes[current].children.end())
+        {
+            if (nodes[current].below == DIRECTORY_UNKNOWN)
+                nodes[current].below = tree.directoryCheck(nodes[current].representative + (current ? unmatchedComponent : unmatchedComponent + 1));
+            return nodes[current].below;
+        }
+        current = child->second;
+    }
+    //No directory is the empty path, so the root has no answer of its own
+    if (nodes[current].exact == DIRECTORY_UNKNOWN)
+        nodes[current].exact = current ? tree.directoryCheck(nodes[current].representative) : DIRECTORY_DONTCARE;
+    return nodes[current].exact;
+}
+
+bool directoryFilter::nextComponent(const std::wstring& path, std::size_t& position, std::wstring& component)
+{
+    while (position < path.size() && isSeparator(path[position]))
+        ++position;
+    if (position == path.size())
+        return false;
+    component.clear();
+    for (; position < path.size() && !isSeparator(path[position]); ++position)
+        component.push_back(static_cast<wchar_t>(std::towupper(path[position])));
+    return true;
+}
+
+bool directoryFilter::samePath(const std::wstring& a, const std::wstring& b)
+{
+    std::size_t positionA = 0;
+    std::size_t positionB = 0;
+    for (;;)
+    {
+        while (positionA < a.size() && isSeparator(a[positionA]))
+            ++positionA;
+        while (positionB < b.size() && isSeparator(b[positionB]))
+            ++positionB;
+        if (positionA == a.size() || positionB == b.size())
+            return positionA == a.size() && positionB == b.size();
+        for (; positionA < a.size() && !isSeparator(a[positionA]); ++positionA, ++positionB)
+        {
+            if (positionB == b.size() || isSeparator(b[positionB]))
+                return false;
+            if (a[positionA] != b[positionB] && std::towupper(a[positionA]) != std::towupper(b[positionB]))
+                return false;
+        }
+        if (positionB < b.size() && !isSeparator(b[positionB]))
+            return false;
+    }
+}
@@ -0,0 +1,53 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// directoryFilter.h -- Decides which directories the scanner descends into.
+// The only criteria whose directoryCheck depends on the directory are -skip
+// paths and the roots of vFind regexes, and they only care how a directory is
+// related to their path: the same, above it, below it, or neither. Every
+// directory reaching the same place in a case insensitive trie of those paths'
+// components therefore gets the same answer from the tree, so the answers are
+// worked out once per trie node, and a lookup costs one step per component.
+#pragma once
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+class criterion;
+
+class directoryFilter
+{
+    //Not yet asked of the tree
+    static const unsigned int DIRECTORY_UNKNOWN = 3;
+    struct node
+    {
+        //The path up to this node, as it was first given
+        std::wstring representative;
+        //Indexes into nodes, by uppercased component
+        std::unordered_map<std::wstring, std::size_t> children;
+        //The tree's answer for this node's directory
+        unsigned int exact;
+        //The tree's answer for directories below this one not in the trie
+        unsigned int below;
+        node();
+    };
+    const criterion& tree;
+    std::vector<node> nodes;
+    std::wstring componentBuffer;
+    directoryFilter(const directoryFilter&);
+    directoryFilter& operator=(const directoryFilter&);
+public:
+    //Builds the trie over the paths the tree reports from directoryPaths.
+    //Each node asks the tree for its answers the first time it is reached.
+    explicit directoryFilter(const criterion& tree_);
+    //One of the DIRECTORY_ constants, as tree.directoryCheck(directory) would give
+    unsigned int check(const std::wstring& directory);
+    //Reads the component of path starting at or after position into component,
+    //uppercased, and moves position past it. Both slashes separate components,
+    //and empty components are skipped. Returns false at the end of the path.
+    static bool nextComponent(const std::wstring& path, std::size_t& position, std::wstring& component);
+    //True if a and b name the same directory, ignoring case and separators.
+    static bool samePath(const std::wstring& a, const std::wstring& b);
+};
@@ -0,0 +1,206 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// dupes.cpp -- Implements the DUPES subprogram. Candidates are narrowed
+// in stages from cheapest to most expensive: by size, then by a hash of
+// the first block, and only then by a hash of the whole file. Files with
+// a unique size are never opened.
+
+#include "pch.hpp"
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <stdexcept>
+#include <vector>
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "dupes.h"
+#include "vFind.h"
+#include "fileData.h"
+#include "globalOptions.h"
+#include "logger.h"
+#include "utility.h"
+#include "parallel.h"
+
+namespace dupes {
+
+    //Files no larger than this are settled completely by the head block stage.
+    static const DWORD headBlockSize = 4096;
+
+    struct candidate
+    {
+        FileData* file;
+        unsigned __int64 size;
+        DWORD error;
+        unsigned char digest[CryptoPP::SHA256::DIGESTSIZE];
+    };
+
+    static bool sizeLess(const candidate& lhs, const candidate& rhs)
+    {
+        return lhs.size < rhs.size;
+    }
+    static bool sizeEqual(const candidate& lhs, const candidate& rhs)
+    {
+        return lhs.size == rhs.size;
+    }
+    static bool contentLess(const candidate& lhs, const candidate& rhs)
+    {
+        if (lhs.size != rhs.size)
+            return lhs.size < rhs.size;
+        return std::memcmp(lhs.digest, rhs.digest, sizeof(lhs.digest)) < 0;
+    }
+    static bool contentEqual(const candidate& lhs, const candidate& rhs)
+    {
+        return lhs.size == rhs.size && std::memcmp(lhs.digest, rhs.digest, sizeof(lhs.digest)) == 0;
+    }
+    //Largest sets first, so the most space is reported at the top
+    static bool outputLess(const candidate& lhs, const candidate& rhs)
+    {
+        if (lhs.size != rhs.size)
+            return lhs.size > rhs.size;
+        int digestOrder = std::memcmp(lhs.digest, rhs.digest, sizeof(lhs.digest));
+        if (digestOrder != 0)
+            return digestOrder < 0;
+        return lhs.file->getFileName() < rhs.file->getFileName();
+    }
+
+    static bool failed(const candidate& entry)
+    {
+        return entry.error != ERROR_SUCCESS;
+    }
+
+    //Sorts candidates and drops every entry which is not equal to a neighbour.
+    template <typename Less, typename Equal>
+    static void keepCollisions(std::vector<candidate>& candidates, Less less, Equal equal)
+    {
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(), failed), candidates.end());
+        std::sort(candidates.begin(), candidates.end(), less);
+        std::vector<candidate>::iterator out = candidates.begin();
+        std::vector<candidate>::iterator first = candidates.begin();
+        while (first != candidates.end())
+        {
+            std::vector<candidate>::iterator last = first + 1;
+            while (last != candidates.end() && equal(*first, *last))
+                ++last;
+            if (last - first > 1)
+                out = std::copy(first, last, out);
+            first = last;
+        }
+        candidates.erase(out, candidates.end());
+    }
+
+    static DWORD hashHead(candidate& entry)
+    {
+        Instalog::UniqueHandle file(entry.file->getFileHandle());
+        if (!file.IsOpen())
+            return GetLastError();
+        unsigned char buffer[headBlockSize];
+        DWORD total = 0;
+        for (;;)
+        {
+            DWORD bytesRead = 0;
+            if (!ReadFile(file.Get(), buffer + total, headBlockSize - total, &bytesRead, NULL))
+                return GetLastError();
+            if (bytesRead == 0)
+                break;
+            total += bytesRead;
+            if (total == headBlockSize)
+                break;
+        }
+        CryptoPP::SHA256().CalculateDigest(entry.digest, buffer, total);
+        return ERROR_SUCCESS;
+    }
+
+int main(int, wchar_t* [])
+{
+    int setupResult = vFind::prepare(L"dupes");
+    if (setupResult)
+        return setupResult;
+    if (globalOptions::killProc)
+        throw std::invalid_argument("DUPES cannot be combined with -k.");
+
+    std::list<FileData> matches;
+    vFind::collect(matches);
+
+    std::vector<candidate> candidates;
+    for (std::list<FileData>::iterator it = matches.begin(); it != matches.end(); ++it)
+    {
+        if (it->isDirectory())
+            continue;
+        candidate entry;
+        entry.file = &*it;
+        entry.size = 0;
+        entry.error = ERROR_SUCCESS;
+        candidates.push_back(entry);
+    }
+    const std::size_t fileCount = candidates.size();
+
+    //Stage 1: group by size. Sizes come from the file system, not the file.
+    parallelFor(candidates.size(), [&](std::size_t idx) {
+        candidates[idx].size = candidates[idx].file->getSize();
+    });
+    //Empty files are all "identical"; they are not interesting here.
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+        [](const candidate& entry) { return entry.size == 0; }), candidates.end());
+    keepCollisions(candidates, sizeLess, sizeEqual);
+    const std::size_t sizeCollisions = candidates.size();
+
+    //Stage 2: hash the first block of each remaining file.
+    unsigned __int64 bytesRead = 0;
+    parallelFor(candidates.size(), [&](std::size_t idx) {
+        candidates[idx].error = hashHead(candidates[idx]);
+    });
+    for (std::vector<candidate>::iterator it = candidates.begin(); it != candidates.end(); ++it)
+        bytesRead += std::min<unsigned __int64>(it->size, headBlockSize);
+    keepCollisions(candidates, contentLess, contentEqual);
+    const std::size_t headCollisions = candidates.size();
+
+    //Stage 3: fully hash what still collides. Files which fit in the head
+    //block were read whole above, so their digests are already final.
+    std::vector<std::size_t> fullHashes;
+    for (std::size_t idx = 0; idx < candidates.size(); ++idx)
+        if (candidates[idx].size > headBlockSize)
+            fullHashes.push_back(idx);
+    parallelFor(fullHashes.size(), [&](std::size_t idx) {
+        candidate& entry = candidates[fullHashes[idx]];
+        entry.error = entry.file->SHA256Digest(entry.digest);
+    });
+    for (std::vector<std::size_t>::iterator it = fullHashes.begin(); it != fullHashes.end(); ++it)
+        bytesRead += candidates[*it].size;
+    keepCollisions(candidates, contentLess, contentEqual);
+
+    //Print each set, separated by blank lines.
+    std::sort(candidates.begin(), candidates.end(), outputLess);
+    std::size_t sets = 0;
+    unsigned __int64 reclaimable = 0;
+    for (std::vector<candidate>::iterator it = candidates.begin(); it != candidates.end(); ++it)
+    {
+        if (it == candidates.begin() || !contentEqual(*(it - 1), *it))
+        {
+            if (it != candidates.begin())
+                logger << L"\r\n";
+            ++sets;
+        }
+        else
+        {
+            reclaimable += it->size;
+        }
+        it->file->write();
+    }
+
+    if (globalOptions::summary)
+    {
+        logger << L"\r\n Files:       " << rightPad(getSizeString(fileCount), 12)
+            << L"  Same size:  " << getSizeString(sizeCollisions)
+            << L"\r\n Same head:   " << rightPad(getSizeString(headCollisions), 12)
+            << L"  Duplicates: " << getSizeString(candidates.size())
+            << L"\r\n Sets:        " << rightPad(getSizeString(sets), 12)
+            << L"  Reclaimable bytes: " << getSizeString(reclaimable)
+            << L"\r\n Bytes read:  " << getSizeString(bytesRead) << L"\r\n";
+    }
+    return sets ? 0 : 4;
+}
+
+}; //namespace dupes
@@ -0,0 +1,11 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// dupes.h -- Defines the "DUPES" subprogram, which finds sets of
+// identical files among the matches of a vFind command line.
+
+namespace dupes {
+    int main(int argc, wchar_t* argv[]);
+}; //namespace dupes
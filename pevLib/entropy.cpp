@@ -0,0 +1,161 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// entropy.cpp -- Implements the byte histogram and entropy measurements.
+
+#include "pch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "entropy.h"
+#include "peHeaders.h"
+
+namespace {
+
+    // A lane receives at most a quarter of the bytes (plus a few from the
+    // tail) between flushes, which keeps its 32 bit counters from wrapping.
+    const std::uint64_t bytesPerFlush = 0x80000000ull;
+
+}
+
+byteHistogram::byteHistogram()
+    : total(0)
+    , pending(0)
+{
+    std::memset(lanes, 0, sizeof(lanes));
+    std::memset(counts, 0, sizeof(counts));
+}
+
+void byteHistogram::flush()
+{
+    for (std::size_t value = 0; value < 256; ++value)
+        counts[value] += static_cast<std::uint64_t>(lanes[0][value]) + lanes[1][value] + lanes[2][value] + lanes[3][value];
+    std::memset(lanes, 0, sizeof(lanes));
+    total += pending;
+    pending = 0;
+}
+
+void byteHistogram::Update(unsigned char const* data, std::size_t length)
+{
+    while (length)
+    {
+        if (pending == bytesPerFlush)
+            flush();
+        std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(length, bytesPerFlush - pending));
+        pending += chunk;
+        length -= chunk;
+        // Eight bytes per load; which byte goes to which lane does not matter.
+        for (; chunk >= 8; chunk -= 8, data += 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+            ++lanes[0][word & 0xFF];
+            ++lanes[1][(word >> 8) & 0xFF];
+            ++lanes[2][(word >> 16) & 0xFF];
+            ++lanes[3][(word >> 24) & 0xFF];
+            ++lanes[0][(word >> 32) & 0xFF];
+            ++lanes[1][(word >> 40) & 0xFF];
+            ++lanes[2][(word >> 48) & 0xFF];
+            ++lanes[3][word >> 56];
+        }
+        for (; chunk; --chunk, ++data)
+            ++lanes[0][*data];
+    }
+}
+
+double byteHistogram::Final()
+{
+    flush();
+    if (total == 0)
+        return 0.0;
+    // H = log2(n) - sum(c * log2(c)) / n
+    double weighted = 0.0;
+    for (std::size_t value = 0; value < 256; ++value)
+    {
+        if (counts[value])
+        {
+            double const count = static_cast<double>(counts[value]);
+            weighted += count * std::log(count);
+        }
+    }
+    double const n = static_cast<double>(total);
+    double const result = (std::log(n) - weighted / n) / std::log(2.0);
+    return std::max(0.0, std::min(8.0, result));
+}
+
+peEntropy::peEntropy(const peHeaders* headers)
+    : histograms(1)
+    , entryPointSection(0)
+    , position(0)
+    , fileEntropy(0.0)
+{
+    if (!headers || !headers->isPE())
+        return;
+    std::vector<peHeaders::section> const& table = headers->getSections();
+    std::size_t entryPoint = table.size();
+    for (std::size_t idx = 0; idx < table.size(); ++idx)
+    {
+        std::uint32_t const extent = std::max(table[idx].virtualSize, table[idx].sizeOfRawData);
+        if (headers->getEntryPoint() >= table[idx].virtualAddress
+            && headers->getEntryPoint() - table[idx].virtualAddress < extent)
+        {
+            entryPoint = idx;
+            break;
+        }
+    }
+
+    sections.reserve(std::min<std::size_t>(table.size(), MAX_SECTIONS + 1));
+    for (std::size_t idx = 0; idx < table.size(); ++idx)
+    {
+        if (idx >= MAX_SECTIONS && idx != entryPoint)
+            continue;
+        if (idx == entryPoint)
+            entryPointSection = sections.size();
+        peHeaders::section const& source = table[idx];
+        section measured;
+        measured.name = source.name;
+        measured.characteristics = source.characteristics;
+        measured.size = 0;
+        measured.entropy = 0.0;
+        sections.push_back(measured);
+        if (source.sizeOfRawData && source.pointerToRawData)
+        {
+            range covered;
+            covered.begin = source.pointerToRawData;
+            covered.end = covered.begin + source.sizeOfRawData;
+            covered.histogram = sections.size();
+            ranges.push_back(covered);
+        }
+    }
+    if (entryPoint == table.size())
+        entryPointSection = sections.size();
+    histograms.resize(sections.size() + 1);
+}
+
+void peEntropy::Update(unsigned char const* data, std::size_t length)
+{
+    histograms[0].Update(data, length);
+    std::uint64_t const end = position + length;
+    for (std::vector<range>::const_iterator it = ranges.begin(); it != ranges.end(); ++it)
+    {
+        std::uint64_t const begin = std::max(it->begin, position);
+        std::uint64_t const stop = std::min(it->end, end);
+        if (begin < stop)
+            histograms[it->histogram].Update(data + (begin - position), static_cast<std::size_t>(stop - begin));
+    }
+    position = end;
+}
+
+void peEntropy::Final()
+{
+    fileEntropy = histograms[0].Final();
+    for (std::size_t idx = 0; idx < sections.size(); ++idx)
+    {
+        sections[idx].size = static_cast<std::uint32_t>(histograms[idx + 1].getTotal());
+        sections[idx].entropy = histograms[idx + 1].Final();
+    }
+    // The histograms are several kilobytes each and no longer needed.
+    std::vector<byteHistogram>().swap(histograms);
+}
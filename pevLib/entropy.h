@@ -0,0 +1,81 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// entropy.h -- Shannon entropy, in bits per byte, of a whole file and of
+// each section of a PE image. Like peChecksum, data arrives through Update
+// in arbitrary chunks, so the counts are taken during FileData's shared read.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class peHeaders;
+
+class byteHistogram
+{
+    // This is a scalar loop; counting has no useful SSE2 form, as it needs a
+    // scatter with conflict detection. Four interleaved tables keep
+    // neighbouring bytes with the same value from waiting on each other's
+    // increments.
+    std::uint32_t lanes[4][256];
+    std::uint64_t counts[256];
+    std::uint64_t total;
+    std::uint64_t pending; // Bytes counted in lanes but not yet in counts
+    void flush();
+public:
+    byteHistogram();
+    void Update(unsigned char const* data, std::size_t length);
+    std::uint64_t getTotal() const { return total + pending; }
+    // Between 0 (a single repeated value, or no data) and 8 (uniform)
+    double Final();
+};
+
+class peEntropy
+{
+public:
+    enum
+    {
+        // Each measured section costs a histogram of about 6 KB, and an image
+        // may declare 65535 sections. Only the first MAX_SECTIONS, and the
+        // one holding the entry point, are measured; 96 is the most loaders
+        // before Windows Vista accepted.
+        MAX_SECTIONS = 96
+    };
+    struct section
+    {
+        std::string name;
+        std::uint32_t characteristics;
+        std::uint32_t size; // Bytes of raw data in the file
+        double entropy;
+    };
+private:
+    struct range
+    {
+        std::uint64_t begin;
+        std::uint64_t end;
+        std::size_t histogram; // Index into histograms
+    };
+    // The whole file, then each section; released by Final
+    std::vector<byteHistogram> histograms;
+    std::vector<range> ranges;
+    std::vector<section> sections;
+    std::size_t entryPointSection;
+    std::uint64_t position;
+    double fileEntropy;
+public:
+    // headers may be null, in which case only the whole file is measured.
+    explicit peEntropy(const peHeaders* headers);
+    // Takes the whole file, in order.
+    void Update(unsigned char const* data, std::size_t length);
+    // Computes the results; call once, after the last Update.
+    void Final();
+
+    double getFileEntropy() const { return fileEntropy; }
+    // The measured sections, in the order of the section table
+    std::vector<section> const& getSections() const { return sections; }
+    // Index of the section holding the entry point, or getSections().size()
+    std::size_t getEntryPointSection() const { return entryPointSection; }
+};
@@ -0,0 +1,147 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// entryBlock.cpp -- Implements the columnar block of directory entries.
+
+#include "pch.hpp"
+#include <algorithm>
+#include <iterator>
+#include "entryBlock.h"
+#include "fileData.h"
+#include "criterion.h"
+
+namespace {
+
+    unsigned __int64 fileTimeValue(const FILETIME& time)
+    {
+        return (static_cast<unsigned __int64>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    }
+
+    FILETIME fileTimeFromValue(unsigned __int64 value)
+    {
+        FILETIME time;
+        time.dwLowDateTime = static_cast<DWORD>(value);
+        time.dwHighDateTime = static_cast<DWORD>(value >> 32);
+        return time;
+    }
+
+}
+
+entryBlock::entryBlock()
+{
+    win32Attributes.reserve(capacity);
+    nameOffsets.reserve(capacity + 1);
+    recordIndex.reserve(capacity);
+    //Never reallocated, so references from materialize stay valid
+    records.reserve(capacity);
+    attributes.reserve(capacity);
+    sizes.reserve(capacity);
+    accessTimes.reserve(capacity);
+    modifiedTimes.reserve(capacity);
+    creationTimes.reserve(capacity);
+    nameOffsets.push_back(0);
+}
+
+entryBlock::~entryBlock()
+{}
+
+void entryBlock::reset(const std::wstring& root_)
+{
+    root = root_;
+    win32Attributes.clear();
+    nameOffsets.assign(1, 0);
+    names.clear();
+    recordIndex.clear();
+    records.clear();
+    attributes.clear();
+    sizes.clear();
+    accessTimes.clear();
+    modifiedTimes.clear();
+    creationTimes.clear();
+}
+
+void entryBlock::add(const WIN32_FIND_DATA& entry)
+{
+    win32Attributes.push_back(entry.dwFileAttributes);
+    names.append(entry.cFileName);
+    nameOffsets.push_back(names.size());
+    recordIndex.push_back(static_cast<unsigned __int16>(capacity));
+    attributes.push_back(FileData::attributeBitsFor(entry.dwFileAttributes));
+    if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        sizes.push_back(0);
+    else
+        sizes.push_back((static_cast<unsigned __int64>(entry.nFileSizeHigh) << 32) | entry.nFileSizeLow);
+    accessTimes.push_back(fileTimeValue(entry.ftLastAccessTime));
+    modifiedTimes.push_back(fileTimeValue(entry.ftLastWriteTime));
+    creationTimes.push_back(fileTimeValue(entry.ftCreationTime));
+}
+
+void entryBlock::selectAll(selection& rows) const
+{
+    rows.resize(size());
+    for (std::size_t row = 0; row < rows.size(); ++row)
+        rows[row] = static_cast<unsigned __int16>(row);
+}
+
+FileData& entryBlock::materialize(std::size_t row)
+{
+    if (recordIndex[row] == capacity)
+    {
+        //The record reports the size and times the compiled criteria tested,
+        //rather than reading them again.
+        WIN32_FILE_ATTRIBUTE_DATA listed;
+        listed.dwFileAttributes = win32Attributes[row];
+        listed.ftCreationTime = fileTimeFromValue(creationTimes[row]);
+        listed.ftLastAccessTime = fileTimeFromValue(accessTimes[row]);
+        listed.ftLastWriteTime = fileTimeFromValue(modifiedTimes[row]);
+        listed.nFileSizeHigh = static_cast<DWORD>(sizes[row] >> 32);
+        listed.nFileSizeLow = static_cast<DWORD>(sizes[row]);
+        recordIndex[row] = static_cast<unsigned __int16>(records.size());
+        records.push_back(FileData(root, names.c_str() + nameOffsets[row], nameOffsets[row + 1] - nameOffsets[row], listed));
+    }
+    return records[recordIndex[row]];
+}
+
+void entryBlock::subtract(selection& rows, const selection& removed)
+{
+    std::size_t kept = 0;
+    selection::const_iterator next = removed.begin();
+    for (std::size_t idx = 0; idx < rows.size(); ++idx)
+    {
+        while (next != removed.end() && *next < rows[idx])
+            ++next;
+        if (next != removed.end() && *next == rows[idx])
+            continue;
+        rows[kept++] = rows[idx];
+    }
+    rows.resize(kept);
+}
+
+void entryBlock::unite(selection& rows, const selection& added)
+{
+    selection result;
+    result.reserve(rows.size() + added.size());
+    std::set_union(rows.begin(), rows.end(), added.begin(), added.end(), std::back_inserter(result));
+    rows.swap(result);
+}
+
+void entryBlock::symmetricDifference(selection& rows, const selection& other)
+{
+    selection result;
+    result.reserve(rows.size() + other.size());
+    std::set_symmetric_difference(rows.begin(), rows.end(), other.begin(), other.end(), std::back_inserter(result));
+    rows.swap(result);
+}
+
+//The default for criteria with no columnar form: make each row's record and
+//ask include() about it.
+void criterion::filterBlock(entryBlock& block, entryBlock::selection& rows) const
+{
+    std::size_t kept = 0;
+    for (std::size_t idx = 0; idx < rows.size(); ++idx)
+        if (include(block.materialize(rows[idx])))
+            rows[kept++] = rows[idx];
+    rows.resize(kept);
+}
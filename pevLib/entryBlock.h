@@ -0,0 +1,61 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// entryBlock.h -- A block of directory entries stored as columns, filled
+// straight from FindNextFile's results. The criterion tree filters a block
+// with criterion::filterBlock, narrowing a selection vector of row numbers;
+// compiled criteria test whole columns at once, and a FileData record is
+// only made for a row when an opaque criterion or the output needs one.
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+class FileData;
+
+class entryBlock
+{
+public:
+    //Row numbers of a block, in increasing order
+    typedef std::vector<unsigned __int16> selection;
+    static const std::size_t capacity = 1024;
+private:
+    std::wstring root;
+    std::vector<DWORD> win32Attributes;
+    //Offsets into names; row i's name ends where row i + 1's begins
+    std::vector<std::size_t> nameOffsets;
+    std::wstring names;
+    //Index into records of each row's FileData, or capacity if not made yet
+    std::vector<unsigned __int16> recordIndex;
+    std::vector<FileData> records;
+    entryBlock(const entryBlock&);
+    entryBlock& operator=(const entryBlock&);
+public:
+    //The columns which compiled criteria test
+    std::vector<DWORD> attributes;     //As FileData's ARCHIVE through TEMPORARY bits
+    std::vector<unsigned __int64> sizes;   //Zero for directories, as FileData::getSize
+    std::vector<unsigned __int64> accessTimes;
+    std::vector<unsigned __int64> modifiedTimes;
+    std::vector<unsigned __int64> creationTimes;
+
+    entryBlock();
+    ~entryBlock();
+    //Empties the block; the entries added next are in directory root.
+    void reset(const std::wstring& root_);
+    void add(const WIN32_FIND_DATA& entry);
+    std::size_t size() const { return win32Attributes.size(); }
+    bool full() const { return size() == capacity; }
+    //Every row of the block
+    void selectAll(selection& rows) const;
+    //The full record for a row, made the first time it is asked for
+    FileData& materialize(std::size_t row);
+
+    //Set operations on selections
+    static void subtract(selection& rows, const selection& removed);
+    static void unite(selection& rows, const selection& added);
+    static void symmetricDifference(selection& rows, const selection& other);
+};
@@ -9,6 +9,8 @@
 #include <algorithm>
 #include <cstring>
 #include <cstdio>
+#include <map>
+#include <mutex>
 #include <windows.h>
 #include <shlwapi.h>
 #include <Wincrypt.h>
@@ -22,6 +24,17 @@
 #include "logger.h"
 #include "fileData.h"
 #include "globalOptions.h"
+#include "hashSet.h"
+#include "peHeaders.h"
+#include "versionInfo.h"
+#include "peChecksum.h"
+#include "authenticode.h"
+#include "catalogIndex.h"
+#include "catalogIndexFile.h"
+#include "peImports.h"
+#include "entropy.h"
+#include "contentSearch.h"
+#include "printableStrings.h"
 #include "../LogCommon/OptimisticBuffer.hpp"
 
 //Constants
@@ -36,13 +49,29 @@ FileData::FileData(const WIN32_FIND_DATA &rawData, const std::wstring& root)
     //Copy the contents of the win32finddata structure to our internals
     std::size_t cFileNameLen = std::wcslen(rawData.cFileName);
     fileName.reserve(root.size() + cFileNameLen);
-    fileName.append(root).append(rawData.cFileName, cFileNameLen);
+    fileName.insert(fileName.end(), root.begin(), root.end());
+    fileName.insert(fileName.end(), rawData.cFileName, rawData.cFileName + cFileNameLen);
     setAttributesAccordingToDWORD(rawData.dwFileAttributes);
+    attributeData.dwFileAttributes = rawData.dwFileAttributes;
+    attributeData.ftCreationTime = rawData.ftCreationTime;
+    attributeData.ftLastAccessTime = rawData.ftLastAccessTime;
+    attributeData.ftLastWriteTime = rawData.ftLastWriteTime;
+    attributeData.nFileSizeHigh = rawData.nFileSizeHigh;
+    attributeData.nFileSizeLow = rawData.nFileSizeLow;
+    bits |= ATTRIBUTESREAD;
 }
-FileData::FileData(const std::wstring& fileNameBuild) : fileName(fileNameBuild), versionInformationBlock(NULL)
+FileData::FileData(const std::wstring& fileNameBuild) : fileName(fileNameBuild)
 {
     bits = 0;
 }
+FileData::FileData(const std::wstring& root, const wchar_t* name, std::size_t nameLength, const WIN32_FILE_ATTRIBUTE_DATA& listed)
+    : attributeData(listed)
+{
+    bits = attributeBitsFor(listed.dwFileAttributes) | ATTRIBUTESREAD;
+    fileName.reserve(root.size() + nameLength);
+    fileName.insert(fileName.end(), root.begin(), root.end());
+    fileName.insert(fileName.end(), name, name + nameLength);
+}
 
 //Sort function. Sorts are tried until either a mismatch is found, or the end of user specified sorts
 //is found.
@@ -63,15 +92,16 @@ bool FileData::operator<(FileData& rhs)
                 return getSize() > rhs.getSize();
             break;
         case globalOptions::NAME: //Name
-            if (fileName != rhs.getFileName())
+            if (!boost::algorithm::equals(fileName, rhs.getFileName()))
             {
                 return ! boost::algorithm::lexicographical_compare(fileName,rhs.getFileName());
             }
             break;
         case globalOptions::INAME: //Case insensitive name
+            //path compares the uppercase copies
             if (fileName != rhs.getFileName())
             {
-                return ! boost::algorithm::ilexicographical_compare(fileName,rhs.getFileName());
+                return ! (fileName < rhs.getFileName());
             }
             break;
         case globalOptions::ADATE: //Access date
@@ -96,7 +126,7 @@ bool FileData::operator<(FileData& rhs)
                 return getSize() < rhs.getSize();
             break;
         case globalOptions::DNAME: //Name
-            if (fileName != rhs.getFileName())
+            if (!boost::algorithm::equals(fileName, rhs.getFileName()))
             {
                 return boost::algorithm::lexicographical_compare(fileName,rhs.getFileName());
             }
@@ -104,7 +134,7 @@ bool FileData::operator<(FileData& rhs)
         case globalOptions::DINAME: //Case insensitive name
             if (fileName != rhs.getFileName())
             {
-                return boost::algorithm::ilexicographical_compare(fileName,rhs.getFileName());
+                return fileName < rhs.getFileName();
             }
             break;
         case globalOptions::DADATE: //Access date
@@ -180,27 +210,32 @@ void inline FileData::appendAttributeCharacter(std::wstring &result, const TCHAR
 }
 void FileData::setAttributesAccordingToDWORD(DWORD win32Attribs) const
 {
+    bits |= attributeBitsFor(win32Attribs);
+}
+DWORD FileData::attributeBitsFor(DWORD win32Attribs)
+{
+    DWORD result = WIN32ENUMD;
     if (win32Attribs & FILE_ATTRIBUTE_ARCHIVE)
-        bits |= ARCHIVE;
+        result |= ARCHIVE;
     if (win32Attribs & FILE_ATTRIBUTE_COMPRESSED)
-        bits |= COMPRESSED;
+        result |= COMPRESSED;
     if (win32Attribs & FILE_ATTRIBUTE_DIRECTORY)
-        bits |= DIRECTORY;
+        result |= DIRECTORY;
     else
-        bits |= FILE;
+        result |= FILE;
     if (win32Attribs & FILE_ATTRIBUTE_HIDDEN)
-        bits |= HIDDEN;
+        result |= HIDDEN;
     if (win32Attribs & FILE_ATTRIBUTE_READONLY)
-        bits |= READONLY;
+        result |= READONLY;
     else
-        bits |= WRITABLE;
+        result |= WRITABLE;
     if (win32Attribs & FILE_ATTRIBUTE_SYSTEM)
-        bits |= SYSTEM;
+        result |= SYSTEM;
     if (win32Attribs & FILE_ATTRIBUTE_TEMPORARY)
-        bits |= TEMPORARY;
+        result |= TEMPORARY;
     if (win32Attribs & FILE_ATTRIBUTE_REPARSE_POINT)
-        bits |= REPARSE;
-    bits |= WIN32ENUMD;
+        result |= REPARSE;
+    return result;
 }
 void FileData::initPortableExecutable() const
 {
@@ -216,149 +251,71 @@ void FileData::initPortableExecutable() const
     //Get a handle to the file
     auto hFile = getFileHandle();
     //Report false if the file could not be obtained
-    if (hFile.Get() == INVALID_HANDLE_VALUE)
+    if (!hFile.IsOpen())
         return;
 
-    //A common DWORD for remembering the length of returned file data.
+    //Read the start of the file once, and decode every header from that buffer.
+    std::vector<unsigned char> buffer(peHeaders::HEADER_READ_SIZE);
     DWORD lengthRead = 0;
-
-    //Check for the MZ signature at the beginning of the PE file.
-    BYTE mzCheck[2];
-    ReadFile(hFile.Get(), mzCheck, 2, &lengthRead, NULL);
-    if (lengthRead != 2 || memcmp(mzCheck, "MZ", 2))
+    if (!ReadFile(hFile.Get(), &buffer[0], static_cast<DWORD>(buffer.size()), &lengthRead, NULL))
         return;
+    //The magic numbers are in the same block, so classify the file while it is here.
+    if (!(bits & MAGICCHECKED))
+    {
+        contentType = fileMagic::classify(&buffer[0], lengthRead);
+        bits |= MAGICCHECKED;
+    }
+    std::shared_ptr<peHeaders> headers(std::make_shared<peHeaders>());
+    while (headers->parse(&buffer[0], lengthRead) == peHeaders::PARSE_TRUNCATED)
+    {
+        //Headers which run past the first block are rare; read up to where they end.
+        if (lengthRead < buffer.size())
+            break; //The file ends first
+        std::size_t oldSize = buffer.size();
+        buffer.resize(headers->bytesNeeded());
+        DWORD moreRead = 0;
+        if (!ReadFile(hFile.Get(), &buffer[oldSize], static_cast<DWORD>(buffer.size() - oldSize), &moreRead, NULL))
+            return;
+        lengthRead += moreRead;
+    }
 
-    bits |= ISMZ;
-
-    //Seek to offset 0x3C,which contains the offset to the PE header
-    if (SetFilePointer(hFile.Get(), 0x3c, NULL, FILE_BEGIN) == INVALID_SET_FILE_POINTER)
+    switch (headers->getType())
+    {
+    case peHeaders::IMAGE_NONE:
         return;
-    //Get the offset
-    LONG peOffset;
-    if (!ReadFile(hFile.Get(), &peOffset, sizeof(LONG), &lengthRead, NULL))
+    case peHeaders::IMAGE_MZ:
+        bits |= ISMZ;
         return;
-    //Seek to the offset
-    if (SetFilePointer(hFile.Get(), peOffset, NULL, FILE_BEGIN) == INVALID_SET_FILE_POINTER)
+    case peHeaders::IMAGE_NE:
+        bits |= ISMZ | ISNE;
         return;
-
-    //Check for PE Signature
-    BYTE peSig[4];
-    ReadFile(hFile.Get(), peSig, 4, &lengthRead, NULL);
-    if (lengthRead != 4)
+    case peHeaders::IMAGE_LE:
+        bits |= ISMZ | ISLE;
         return;
+    case peHeaders::IMAGE_PE:
+        break;
+    }
 
-    if (!memcmp(peSig, "NE", 2))
-    {
-        bits |= ISNE;
-    } else if (!memcmp(peSig, "LE", 2))
-    {
-        bits |= ISLE;
-    } else if (!memcmp(peSig, "PE\0", 4))
-    {
-        //Get the IMAGE_FILE_HEADER
-        IMAGE_FILE_HEADER fileHeader;
-        memset(&fileHeader, 0, sizeof(IMAGE_FILE_HEADER));
-        if (!ReadFile(hFile.Get(), &fileHeader, sizeof(IMAGE_FILE_HEADER), &lengthRead, NULL))
-            return;
-
-        //Extract PE Header timestamp
-        headerTime = UnixTimeToFileTime(fileHeader.TimeDateStamp);
-
-        //Set characteristics bits
-        if (!(fileHeader.Characteristics & IMAGE_FILE_DEBUG_STRIPPED))
-            bits |= DEBUG;
-        if (fileHeader.Characteristics & IMAGE_FILE_DLL)
-            bits |= DLL;
-
-        //Read the magic number from the optional header
-        BYTE optionalHeaderMagic[2];
-        if (!ReadFile(hFile.Get(), optionalHeaderMagic, 2, &lengthRead, NULL))
-            return;
-
-        //Check for valid magic
-        if (optionalHeaderMagic[0] != 0x0B)
-            return;
-
-        //Hold which PE version it is -- PE32 or PE32+.
-        //PE32+ is used on x64 machines.
-        bool isPEPlus;
-
-        //Calculate the above using the magic value
-        if      (optionalHeaderMagic[1] == 0x01)
-            isPEPlus = false;
-        else if (optionalHeaderMagic[1] == 0x02)
-            isPEPlus = true;
-        else
-            return;
-
-        //All three magic numbers are correct here, we have a PE file on our hands
-        bits |= ISPE;
-
-        //Get the base address of the image for future calculations. 64 bit value for PE32+
-        __int64 imageBaseAddress = 0;
-
-        if (isPEPlus)
-        {
-            //In PE32+, the offset for the base address is 24, and is eight bytes long
-            if (SetFilePointer(hFile.Get(), 22, NULL, FILE_CURRENT) == INVALID_SET_FILE_POINTER)
-                return;
-            if (!ReadFile(hFile.Get(), &imageBaseAddress, 8, &lengthRead, NULL))
-                return;
-            bits |= PEPLUS;
-        } else
-        {
-            //In PE32, the offset for the base address is 28, and is four bytes long.
-            if (SetFilePointer(hFile.Get(), 26, NULL, FILE_CURRENT) == INVALID_SET_FILE_POINTER)
-                return;
-            if (!ReadFile(hFile.Get(), &imageBaseAddress, 4, &lengthRead, NULL))
-                return;
-        }
-
-        //Find headerSum
-        //Offset from the base address is 32 (64 from beginning of the optional header)
-        if (SetFilePointer(hFile.Get(), 32, NULL, FILE_CURRENT) == INVALID_SET_FILE_POINTER)
-            return;
-        //Read headerSum
-        if (!ReadFile(hFile.Get(), &headerSum, sizeof(DWORD), &lengthRead, NULL))
-            return;
-
-        //Find number of PE data sections
-        DWORD numberOfSections;
-        if (isPEPlus)
-        {
-            if (SetFilePointer(hFile.Get(), 32, NULL, FILE_CURRENT) == INVALID_SET_FILE_POINTER)
-                return;
-        } else
-        {
-            if (SetFilePointer(hFile.Get(), 40, NULL, FILE_CURRENT) == INVALID_SET_FILE_POINTER)
-                return;
-        }
-        //Read NumberOfRvaAndSizes
-        if (!ReadFile(hFile.Get(), &numberOfSections, sizeof(DWORD), &lengthRead, NULL))
-            return;
+    bits |= ISMZ | ISPE;
+    if (headers->isPEPlus())
+        bits |= PEPLUS;
 
-        //There can be no signature in the file if the number of sections is less than 5,
-        //because the certificate table is the 5th section.
-        if (numberOfSections < 5)
-            return;
+    //Extract PE Header timestamp
+    headerTime = UnixTimeToFileTime(headers->getTimeDateStamp());
 
-        //Check for certificates
-        //Look for "Certificate Table", 32 bytes from the RvaAndSizes
-        if (SetFilePointer(hFile.Get(), 32, NULL, FILE_CURRENT) == INVALID_SET_FILE_POINTER)
-            return;
+    //Set characteristics bits
+    if (!headers->isDebugStripped())
+        bits |= DEBUG;
+    if (headers->isDLL())
+        bits |= DLL;
 
-        //The certificate table pointer is 8 bytes long -- it will be all zeros if the table is not present.
-        DWORD CertVirtualAddress, CertSize;
-        if (!ReadFile(hFile.Get(), &CertVirtualAddress, sizeof(DWORD), &lengthRead, NULL))
-            return;
-        if (!ReadFile(hFile.Get(), &CertSize, sizeof(DWORD), &lengthRead, NULL))
-            return;
+    headerSum = headers->getCheckSum();
 
-        //If the size of the certificate section is not 0, set the sigpresent flag.
-        if (CertSize)
-            bits |= SIGPRESENT;
-    }
+    //If the certificate table is not empty, set the sigpresent flag.
+    if (headers->getDataDirectory(peHeaders::DIRECTORY_SECURITY).size)
+        bits |= SIGPRESENT;
 
+    peInfo = headers;
 }
 
 class CatalogAdminContext;
@@ -440,16 +397,143 @@ static bool CallWinVerifyTrust(WINTRUST_DATA& wintrustStructure)
     return returnVal == 0;
 }
 
-void FileData::sigVerify() const
+//WinVerifyTrust verdicts for embedded signatures, keyed by the SHA1 of the
+//PKCS#7 blob. A key is only looked up once the image digest is known to match
+//the digest in the blob, so the blob alone decides the verdict.
+static std::map<std::string, bool> signatureVerdicts;
+static std::mutex signatureVerdictsLock;
+
+template <typename hashType>
+DWORD FileData::authenticodeDigest(std::vector<unsigned char>& digest) const
 {
-    WINTRUST_DATA WintrustStructure = { sizeof(WINTRUST_DATA) };
-    
-    //Open file.
-    Instalog::UniqueHandle fileHandle = this->getFileHandle(true);
-    if( !fileHandle.IsOpen() )
+    hashType hash;
+    authenticodeHasher<hashType> sink(hash, *peInfo);
+    DWORD error = readContents(sink);
+    if (error != ERROR_SUCCESS)
+        return error;
+    digest.resize(hashType::DIGESTSIZE);
+    hash.Final(&digest[0]);
+    return ERROR_SUCCESS;
+}
+
+bool FileData::embeddedSignatureVerdict(HANDLE file, bool& valid, std::string& verdictKey) const
+{
+    //Only PE images are understood here; leave everything else to WinVerifyTrust.
+    if (!(bits & ISPE) || !peInfo)
+        return false;
+    valid = false;
+    if (!(bits & SIGPRESENT))
+        return true; //No certificate table, so nothing can be embedded
+
+    //Read the certificate table. Its "virtual address" is a file offset.
+    peHeaders::dataDirectory const table = peInfo->getDataDirectory(peHeaders::DIRECTORY_SECURITY);
+    DWORD const maxCertificateTable = 0x1000000;
+    if (table.size > maxCertificateTable)
+        return false;
+    std::vector<unsigned char> certificates(table.size);
+    LARGE_INTEGER tableOffset;
+    tableOffset.QuadPart = table.virtualAddress;
+    DWORD lengthRead = 0;
+    if (!SetFilePointerEx(file, tableOffset, NULL, FILE_BEGIN)
+        || !ReadFile(file, &certificates[0], table.size, &lengthRead, NULL)
+        || lengthRead != table.size)
+        return false;
+
+    authenticodeSignature signature;
+    if (!signature.parseCertificateTable(&certificates[0], certificates.size()))
+        return false;
+
+    //Hash the image the way the signer did. Only a match is trusted: a file
+    //changed after signing and a signer which hashed differently from
+    //authenticodeHasher both mismatch, so WinVerifyTrust decides those.
+    std::vector<unsigned char> digest;
+    DWORD error;
+    switch (signature.getDigestAlgorithm())
     {
-        return;
+    case authenticodeSignature::DIGEST_MD5:
+        error = authenticodeDigest<CryptoPP::Weak::MD5>(digest);
+        break;
+    case authenticodeSignature::DIGEST_SHA1:
+        error = authenticodeDigest<CryptoPP::SHA1>(digest);
+        break;
+    case authenticodeSignature::DIGEST_SHA256:
+        error = authenticodeDigest<CryptoPP::SHA256>(digest);
+        break;
+    case authenticodeSignature::DIGEST_SHA384:
+        error = authenticodeDigest<CryptoPP::SHA384>(digest);
+        break;
+    case authenticodeSignature::DIGEST_SHA512:
+        error = authenticodeDigest<CryptoPP::SHA512>(digest);
+        break;
+    default:
+        return false;
+    }
+    if (error != ERROR_SUCCESS)
+        return false;
+    if (digest != signature.getDigest())
+        return false;
+
+    std::vector<unsigned char> const& blob = signature.getSignedData();
+    unsigned char blobHash[CryptoPP::SHA1::DIGESTSIZE];
+    CryptoPP::SHA1().CalculateDigest(blobHash, &blob[0], blob.size());
+    verdictKey.assign(reinterpret_cast<const char*>(blobHash), sizeof(blobHash));
+    std::lock_guard<std::mutex> lock(signatureVerdictsLock);
+    std::map<std::string, bool>::const_iterator verdict = signatureVerdicts.find(verdictKey);
+    if (verdict == signatureVerdicts.end())
+        return false;
+    valid = verdict->second;
+    return true;
+}
+
+//The index of the system's catalogs, loaded the first time a signature is
+//checked; only with -catindex, which keeps it between runs.
+static std::shared_ptr<const catalogIndex> systemCatalogs;
+static bool systemCatalogsLoaded = false;
+static std::mutex systemCatalogsLock;
+
+//WinVerifyTrust verdicts for catalogs. Membership is established from the
+//index, so every member of a catalog shares the catalog's verdict.
+static std::map<std::wstring, bool> catalogVerdicts;
+
+bool FileData::findCatalog(HANDLE file, std::vector<unsigned char>& hash, std::wstring& catalogFile) const
+{
+    std::shared_ptr<const catalogIndex> catalogs;
+    {
+        std::lock_guard<std::mutex> lock(systemCatalogsLock);
+        if (!systemCatalogsLoaded)
+        {
+            systemCatalogs = loadSystemCatalogIndex(globalOptions::catalogIndexFile);
+            systemCatalogsLoaded = true;
+        }
+        catalogs = systemCatalogs;
+    }
+
+    if (catalogs)
+    {
+        //Catalogs hold the SHA1 Authenticode digest of PE images, and the
+        //SHA1 of anything else; the same hashes CryptCATAdminCalcHashFromFileHandle makes.
+        initPortableExecutable();
+        DWORD error;
+        if ((bits & ISPE) && peInfo)
+            error = authenticodeDigest<CryptoPP::SHA1>(hash);
+        else
+        {
+            hash.resize(CryptoPP::SHA1::DIGESTSIZE);
+            error = SHA1Digest(&hash[0]);
+        }
+        if (error != ERROR_SUCCESS)
+            return false;
+        const catalogIndex::catalog* found = catalogs->find(&hash[0], hash.size());
+        if (found)
+        {
+            catalogFile = found->path;
+            return true;
+        }
     }
+
+    //Not in the index, or there is none. The index leaves out catalogs it
+    //could not parse and those installed since it was saved, and our hash
+    //may differ from the system's, so ask the system to search its catalogs.
     try
     {
         //Get a context for signature verification.
@@ -459,41 +543,74 @@ void FileData::sigVerify() const
         // is 20 bytes.
         DWORD const hashGuess = 20;
         DWORD hashSize = hashGuess;
-        Instalog::OptimisticBuffer<hashGuess> hash(hashSize);
+        Instalog::OptimisticBuffer<hashGuess> osHash(hashSize);
 
         //Actually calculate the hash
-        if( !CryptCATAdminCalcHashFromFileHandle(fileHandle.Get(), &hashSize, hash.Get(), 0) )
+        if( !CryptCATAdminCalcHashFromFileHandle(file, &hashSize, osHash.Get(), 0) )
         {
             if (::GetLastError() != ERROR_INSUFFICIENT_BUFFER)
             {
-                return;
+                return false;
             }
 
             assert(false && "SHA-1 guess wrong.");
-            hash.Resize(hashSize);
-            if( !CryptCATAdminCalcHashFromFileHandle(fileHandle.Get(), &hashSize, hash.Get(), 0) )
+            osHash.Resize(hashSize);
+            if( !CryptCATAdminCalcHashFromFileHandle(file, &hashSize, osHash.Get(), 0) )
             {
-                return;
+                return false;
             }
         }
 
-        //Convert the hash to a string.
-        std::unique_ptr<wchar_t> hashString(new wchar_t[hashSize * 2 + 1]);
-        for( unsigned int i = 0; i < hashSize; i++ )
+        CatalogHandle catalog = adminContext.EnumCatalogFromHash(osHash.Get(), hashSize);
+        CATALOG_INFO info = catalog.GetInfo();
+        hash.assign(osHash.Get(), osHash.Get() + hashSize);
+        catalogFile = info.wszCatalogFile;
+        return true;
+    }
+    catch (Instalog::SystemFacades::Win32Exception const&)
+    {
+        return false;
+    }
+}
+
+void FileData::sigVerify() const
+{
+    bits |= SIGENUMERATED;
+    WINTRUST_DATA WintrustStructure = { sizeof(WINTRUST_DATA) };
+    
+    //Open file.
+    Instalog::UniqueHandle fileHandle = this->getFileHandle(true);
+    if( !fileHandle.IsOpen() )
+    {
+        return;
+    }
+
+    std::vector<unsigned char> hash;
+    std::wstring catalogFile;
+    if (findCatalog(fileHandle.Get(), hash, catalogFile))
+    {
         {
-            ::swprintf_s(hashString.get() + (i * 2), 3, L"%02X", hash[i]);
+            std::lock_guard<std::mutex> lock(signatureVerdictsLock);
+            std::map<std::wstring, bool>::const_iterator verdict = catalogVerdicts.find(catalogFile);
+            if (verdict != catalogVerdicts.end())
+            {
+                if (verdict->second)
+                    bits |= SIGVALID;
+                return;
+            }
         }
 
-        CatalogHandle catalog = adminContext.EnumCatalogFromHash(hash.Get(), hashSize);
-        CATALOG_INFO info = catalog.GetInfo();
+        //Convert the hash to a string.
+        std::wstring hashString(hashSet::formatHexDigest(&hash[0], hash.size()));
+        boost::algorithm::to_upper(hashString);
 
         //Fill in catalog info structure.
         WINTRUST_CATALOG_INFO WintrustCatalogStructure = { sizeof(WINTRUST_CATALOG_INFO) };
         WintrustCatalogStructure.dwCatalogVersion = 0;
-        WintrustCatalogStructure.pcwszCatalogFilePath = info.wszCatalogFile;
-        WintrustCatalogStructure.cbCalculatedFileHash = hashSize;
-        WintrustCatalogStructure.pbCalculatedFileHash = hash.Get();
-        WintrustCatalogStructure.pcwszMemberTag = hashString.get();
+        WintrustCatalogStructure.pcwszCatalogFilePath = catalogFile.c_str();
+        WintrustCatalogStructure.cbCalculatedFileHash = static_cast<DWORD>(hash.size());
+        WintrustCatalogStructure.pbCalculatedFileHash = &hash[0];
+        WintrustCatalogStructure.pcwszMemberTag = hashString.c_str();
         WintrustCatalogStructure.pcwszMemberFilePath = this->fileName.c_str();
 
         WintrustStructure.cbStruct = sizeof(WINTRUST_DATA);
@@ -506,29 +623,48 @@ void FileData::sigVerify() const
         WintrustStructure.dwStateAction = WTD_STATEACTION_VERIFY;
         WintrustStructure.dwUIContext = WTD_UICONTEXT_EXECUTE;
         WintrustStructure.dwProvFlags = WTD_CACHE_ONLY_URL_RETRIEVAL;
-        if (CallWinVerifyTrust(WintrustStructure))
+        bool const trusted = CallWinVerifyTrust(WintrustStructure);
+        if (trusted)
         {
             bits |= SIGVALID;
         }
+        std::lock_guard<std::mutex> lock(signatureVerdictsLock);
+        catalogVerdicts[catalogFile] = trusted;
+        return;
     }
-    catch (Instalog::SystemFacades::Win32Exception const&)
-    {
-        WINTRUST_FILE_INFO WintrustFileStructure = { sizeof(WINTRUST_FILE_INFO) };
-        WintrustFileStructure.pcwszFilePath = this->fileName.c_str();
-        WintrustFileStructure.hFile = fileHandle.Get();
-        WintrustFileStructure.pgKnownSubject = NULL;
 
-        WintrustStructure.cbStruct = sizeof(WINTRUST_DATA);
-        WintrustStructure.dwUnionChoice = WTD_CHOICE_FILE;
-        WintrustStructure.pFile = &WintrustFileStructure;
-        WintrustStructure.dwUIChoice = WTD_UI_NONE;
-        WintrustStructure.fdwRevocationChecks = WTD_REVOKE_NONE;
-        WintrustStructure.dwStateAction = WTD_STATEACTION_VERIFY;
-        WintrustStructure.dwProvFlags = WTD_SAFER_FLAG | WTD_CACHE_ONLY_URL_RETRIEVAL;
-        if (CallWinVerifyTrust(WintrustStructure))
-        {
+    //Not in a catalog, so any signature is embedded. Answer from the image
+    //and the verdict cache where possible.
+    bool valid = false;
+    std::string verdictKey;
+    if (embeddedSignatureVerdict(fileHandle.Get(), valid, verdictKey))
+    {
+        if (valid)
             bits |= SIGVALID;
-        }
+        return;
+    }
+
+    WINTRUST_FILE_INFO WintrustFileStructure = { sizeof(WINTRUST_FILE_INFO) };
+    WintrustFileStructure.pcwszFilePath = this->fileName.c_str();
+    WintrustFileStructure.hFile = fileHandle.Get();
+    WintrustFileStructure.pgKnownSubject = NULL;
+
+    WintrustStructure.cbStruct = sizeof(WINTRUST_DATA);
+    WintrustStructure.dwUnionChoice = WTD_CHOICE_FILE;
+    WintrustStructure.pFile = &WintrustFileStructure;
+    WintrustStructure.dwUIChoice = WTD_UI_NONE;
+    WintrustStructure.fdwRevocationChecks = WTD_REVOKE_NONE;
+    WintrustStructure.dwStateAction = WTD_STATEACTION_VERIFY;
+    WintrustStructure.dwProvFlags = WTD_SAFER_FLAG | WTD_CACHE_ONLY_URL_RETRIEVAL;
+    bool const trusted = CallWinVerifyTrust(WintrustStructure);
+    if (trusted)
+    {
+        bits |= SIGVALID;
+    }
+    if (!verdictKey.empty())
+    {
+        std::lock_guard<std::mutex> lock(signatureVerdictsLock);
+        signatureVerdicts[verdictKey] = trusted;
     }
 }
 
@@ -547,23 +683,35 @@ inline std::wstring GetHashErrorMessage(DWORD error)
     }
 }
 
-template <typename hashType> 
-std::wstring FileData::getHash() const
+//Sinks normally take the whole file; a content search can stop early.
+template <typename sinkType>
+static bool sinkIsDone(const sinkType&)
+{
+    return false;
+}
+static bool sinkIsDone(const contentScanner& scanner)
+{
+    return scanner.isDone();
+}
+
+template <typename sinkType> 
+DWORD FileData::readContents(sinkType& sink) const
 {
     using std::swap;
 
     OVERLAPPED overlappedIoBlock = {};
     HANDLE file;
-    disable64.disableFS();
-    file = ::CreateFileW(getFileName().c_str(),GENERIC_READ,FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,NULL,OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_OVERLAPPED, nullptr);
-    DWORD error = GetLastError();
-    disable64.enableFS();
+    DWORD error;
+    {
+        scopedDisable64 redirection;
+        file = ::CreateFileW(getFileName().c_str(),GENERIC_READ,FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,NULL,OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_OVERLAPPED, nullptr);
+        error = GetLastError();
+    }
     if (file == INVALID_HANDLE_VALUE)
     {
-        return GetHashErrorMessage(error);
+        return error;
     }
 
-    hashType hash;
     typedef unsigned char byte;
     auto const bytesToAttempt = 1024 * 4; //4k
     byte backingBuffer[bytesToAttempt * 2];
@@ -589,22 +737,29 @@ std::wstring FileData::getHash() const
             {
                 if (lastBytesRead != 0)
                 {
-                    // Hash what we just read
-                    hash.Update(hashingBuffer, lastBytesRead);
+                    // Consume what we just read
+                    sink.Update(hashingBuffer, lastBytesRead);
                 }
                 break;
             }
             else if (error != ERROR_IO_PENDING)
             {
                 CloseHandle(file);
-                return GetHashErrorMessage(error);
+                return error;
             }
         }
 
         if (lastBytesRead != 0)
         {
-            // Hash what we just read
-            hash.Update(hashingBuffer, lastBytesRead);
+            // Consume what we just read
+            sink.Update(hashingBuffer, lastBytesRead);
+            if (sinkIsDone(sink))
+            {
+                // The read in flight targets our stack; let it finish before returning.
+                ::CancelIo(file);
+                ::GetOverlappedResult(file, &overlappedIoBlock, &lastBytesRead, true);
+                break;
+            }
         }
 
         ::WaitForSingleObject(file, INFINITE);
@@ -618,7 +773,7 @@ std::wstring FileData::getHash() const
             else if (error != 0)
             {
                 CloseHandle(file);
-                return GetHashErrorMessage(error);
+                return error;
             }
         }
 
@@ -627,14 +782,68 @@ std::wstring FileData::getHash() const
     }
 
     CloseHandle(file);
+    return ERROR_SUCCESS;
+}
+
+namespace {
+    //Feeds one read of a file to a hash and, optionally, the PE checksum.
+    template <typename hashType>
+    struct checksummingSink
+    {
+        hashType& hash;
+        peChecksum* checksum;
+        checksummingSink(hashType& hashTarget, peChecksum* checksumTarget)
+            : hash(hashTarget)
+            , checksum(checksumTarget)
+        {}
+        void Update(const unsigned char* data, std::size_t length)
+        {
+            hash.Update(data, length);
+            if (checksum)
+                checksum->Update(data, length);
+        }
+    private:
+        checksummingSink& operator=(const checksummingSink&);
+    };
+}
 
-    std::unique_ptr<byte[]> rawHash(new byte[hash.DigestSize()]);
-    hash.Final(rawHash.get());
+template <typename hashType> 
+DWORD FileData::hashContents(unsigned char* digest) const
+{
+    hashType hash;
+    //If the file is already known to be a PE whose checksum has not been
+    //calculated, calculate it from the same read, as #z, #p and -tk will
+    //probably want it.
+    bool const wantChecksum = (bits & PEENUMERATED) && (bits & ISPE) && !(bits & PECHKSUM);
+    peChecksum checksum;
+    checksummingSink<hashType> sink(hash, wantChecksum ? &checksum : nullptr);
+    DWORD error = readContents(sink);
+    if (error != ERROR_SUCCESS)
+        return error;
+    hash.Final(digest);
+    if (wantChecksum)
+    {
+        calcSum = checksum.Final(headerSum);
+        bits |= PECHKSUM;
+    }
+    return ERROR_SUCCESS;
+}
+
+template <typename hashType> 
+std::wstring FileData::getHash() const
+{
+    typedef unsigned char byte;
+    byte rawHash[hashType::DIGESTSIZE];
+    DWORD error = hashContents<hashType>(rawHash);
+    if (error != ERROR_SUCCESS)
+    {
+        return GetHashErrorMessage(error);
+    }
 
     std::wstring result;
     static const wchar_t constantHexArray[] = L"0123456789ABCDEF";
-    result.resize(hash.DigestSize() * 2);
-    DWORD len = hash.DigestSize();
+    result.resize(hashType::DIGESTSIZE * 2);
+    DWORD len = hashType::DIGESTSIZE;
     for (unsigned short int idx = 0; idx < len; idx++)
     {
         result[(len*2-1)-2*idx] = constantHexArray[(rawHash[(len-1)-idx] & 0x0F)];
@@ -670,83 +879,292 @@ std::wstring FileData::SHA512() const
 {
     return getHash<CryptoPP::SHA512>();
 }
+DWORD FileData::MD5Digest(unsigned char* digest) const
+{
+    return hashContents<CryptoPP::Weak::MD5>(digest);
+}
+DWORD FileData::SHA1Digest(unsigned char* digest) const
+{
+    return hashContents<CryptoPP::SHA1>(digest);
+}
+DWORD FileData::SHA224Digest(unsigned char* digest) const
+{
+    return hashContents<CryptoPP::SHA224>(digest);
+}
+DWORD FileData::SHA256Digest(unsigned char* digest) const
+{
+    return hashContents<CryptoPP::SHA256>(digest);
+}
+DWORD FileData::SHA384Digest(unsigned char* digest) const
+{
+    return hashContents<CryptoPP::SHA384>(digest);
+}
+DWORD FileData::SHA512Digest(unsigned char* digest) const
+{
+    return hashContents<CryptoPP::SHA512>(digest);
+}
 #pragma warning (pop)
+DWORD FileData::SampleDigest(unsigned char* digest) const
+{
+    Instalog::UniqueHandle file;
+    DWORD error;
+    {
+        scopedDisable64 redirection;
+        file = Instalog::UniqueHandle(::CreateFileW(getFileName().c_str(),GENERIC_READ,FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,NULL,OPEN_EXISTING,FILE_FLAG_RANDOM_ACCESS, nullptr));
+        error = GetLastError();
+    }
+    if (!file.IsOpen())
+    {
+        return error;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!::GetFileSizeEx(file.Get(), &fileSize))
+    {
+        return GetLastError();
+    }
+    unsigned __int64 const size = fileSize.QuadPart;
+    unsigned __int64 const blockSize = globalOptions::sampleBlockSize;
+
+    // The size and block size lead the digest, so samples taken with different
+    // settings never compare equal, and neither do files which share their
+    // sampled blocks but differ in length.
+    CryptoPP::SHA1 hash;
+    unsigned char prefix[12];
+    for (int idx = 0; idx < 8; ++idx)
+        prefix[idx] = static_cast<unsigned char>(size >> (idx * 8));
+    for (int idx = 0; idx < 4; ++idx)
+        prefix[8 + idx] = static_cast<unsigned char>(blockSize >> (idx * 8));
+    hash.Update(prefix, sizeof(prefix));
+
+    // Files no larger than the three blocks are hashed whole.
+    unsigned __int64 extents[3][2] = {
+        { 0, size },
+        { (size - blockSize) / 2, blockSize },
+        { size - blockSize, blockSize }
+    };
+    std::size_t extentCount = 1;
+    if (size > blockSize * 3)
+    {
+        extents[0][1] = blockSize;
+        extentCount = 3;
+    }
+
+    std::vector<unsigned char> buffer(static_cast<std::size_t>(blockSize));
+    for (std::size_t idx = 0; idx < extentCount; ++idx)
+    {
+        unsigned __int64 offset = extents[idx][0];
+        unsigned __int64 remaining = extents[idx][1];
+        while (remaining)
+        {
+            OVERLAPPED position = {};
+            position.Offset = static_cast<DWORD>(offset);
+            position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD toRead = static_cast<DWORD>(std::min<unsigned __int64>(remaining, blockSize));
+            DWORD bytesRead = 0;
+            if (!::ReadFile(file.Get(), &buffer[0], toRead, &bytesRead, &position))
+            {
+                error = GetLastError();
+                if (error != ERROR_HANDLE_EOF)
+                    return error;
+            }
+            if (bytesRead == 0)
+                break; // Truncated underneath us; hash what we have.
+            hash.Update(&buffer[0], bytesRead);
+            offset += bytesRead;
+            remaining -= bytesRead;
+        }
+    }
+
+    hash.Final(digest);
+    return ERROR_SUCCESS;
+}
+std::wstring FileData::SampleHash() const
+{
+    unsigned char rawHash[CryptoPP::SHA1::DIGESTSIZE];
+    DWORD error = SampleDigest(rawHash);
+    if (error != ERROR_SUCCESS)
+    {
+        return GetHashErrorMessage(error);
+    }
+    return hashSet::formatHexDigest(rawHash, sizeof(rawHash));
+}
 void FileData::enumVersionInformationBlock() const
 {
     bits |= VERSIONINFOCHECKED;
+    if (!isMZ())
+        return;
+    std::shared_ptr<versionInfo> decoded(std::make_shared<versionInfo>());
+    const peHeaders* headers = getPEHeaders();
+    if (headers && headers->getDataDirectory(peHeaders::DIRECTORY_RESOURCE).size)
+    {
+        //Walk the resource directory of a mapped view ourselves; this avoids
+        //the loader and the copy GetFileVersionInfo makes.
+        std::shared_ptr<const void> view;
+        std::size_t viewSize = 0;
+        try
+        {
+            scopedDisable64 redirection;
+            view = mapFile(std::wstring(fileName.begin(), fileName.end()), viewSize);
+        }
+        catch (std::runtime_error&)
+        {
+        }
+        if (view)
+        {
+            if (decoded->parseImage(*headers, static_cast<const unsigned char*>(view.get()), viewSize))
+                versionInformation = decoded;
+            return;
+        }
+    }
+    //NE and LE images, or PE images we could not map; let the system find the block.
     wchar_t filePathBuffer[MAX_PATH];
     if (!PathSearchAndQualify(getFileName().c_str(), filePathBuffer, MAX_PATH)) return;
-    disable64.disableFS();
-    DWORD zero = 0;
-    DWORD lengthOfVersionData =
-    GetFileVersionInfoSize(filePathBuffer,&zero);
-    if (!lengthOfVersionData)
+    std::vector<unsigned char> block;
     {
-        disable64.enableFS();
-        return;
+        scopedDisable64 redirection;
+        DWORD zero = 0;
+        DWORD lengthOfVersionData =
+        GetFileVersionInfoSize(filePathBuffer,&zero);
+        block.resize(lengthOfVersionData);
+        if (lengthOfVersionData && !GetFileVersionInfo(filePathBuffer,zero,lengthOfVersionData,&block[0]))
+            block.clear();
     }
-    versionInformationBlock.resize(lengthOfVersionData);
-    GetFileVersionInfo(filePathBuffer,zero,lengthOfVersionData,&versionInformationBlock[0]);
-    LANGANDCODEPAGE *languageBlock;
-    UINT translationsCount;
-    VerQueryValue(&versionInformationBlock[0],L"\\VarFileInfo\\Translation",(LPVOID*)&languageBlock,&translationsCount);
-    translationsCount /= sizeof(struct LANGANDCODEPAGE);
-    versionTranslations.assign(languageBlock, languageBlock + translationsCount);
-    LANGANDCODEPAGE enUs;
-    enUs.wCodePage = 1200;
-    enUs.wLanguage = 1033;
-    versionTranslations.push_back(enUs);
-    enUs.wCodePage = 0x04E4;
-    versionTranslations.push_back(enUs);
-    std::sort(versionTranslations.begin(), versionTranslations.end());
-    versionTranslations.erase(
-        std::unique(versionTranslations.begin(), versionTranslations.end()),
-        versionTranslations.end());
-    disable64.enableFS();
+    if (!block.empty() && decoded->parseBlock(&block[0], block.size()))
+        versionInformation = decoded;
 }
 std::wstring FileData::getVersionInformationString(const std::wstring& requestedResourceType) const
 {
     if (!(bits & VERSIONINFOCHECKED))
         enumVersionInformationBlock();
-    if (versionInformationBlock.empty())
+    if (!versionInformation)
         return L"------";
-    LPCTSTR retString;
-    UINT retStringLength;
-    std::wstring result;
-    for( size_t idx = 0; idx < versionTranslations.size(); idx++ )
+    return versionInformation->queryString(requestedResourceType);
+}
+void FileData::enumImports() const
+{
+    bits |= IMPORTSENUMERATED;
+    //Only decode images which passed the cheap header check.
+    if (!isPE())
+        return;
+    const peHeaders* headers = getPEHeaders();
+    if (!headers)
+        return;
+    std::shared_ptr<const void> view;
+    std::size_t viewSize = 0;
+    try
     {
-        std::wstringstream versionQuery;
-        versionQuery << L"\\StringFileInfo\\";
-        versionQuery << std::hex << std::setw(4) << std::setfill(L'0')
-            << versionTranslations[idx].wLanguage;
-        versionQuery << std::hex << std::setw(4) << std::setfill(L'0')
-            << versionTranslations[idx].wCodePage;
-        versionQuery << L'\\' << requestedResourceType;
-        std::wstring versionQueryString(versionQuery.str());
-        VerQueryValue(versionInformationBlock.data(),versionQueryString.c_str(),(LPVOID *)&retString,&retStringLength);
-        if (retStringLength)
-        {
-            if (!result.empty())
-            {
-                result.append(L" / ");
-            }
-
-            // Remove trailing null if it exists.
-            if (retStringLength != 0 && retString[retStringLength - 1] == L'\0')
-            {
-                --retStringLength;
-            }
-
-            result.append(retString, retStringLength);
-        }
+        scopedDisable64 redirection;
+        view = mapFile(std::wstring(fileName.begin(), fileName.end()), viewSize);
     }
-    return result;
+    catch (std::runtime_error&)
+    {
+    }
+    if (!view)
+        return;
+    std::shared_ptr<peImports> decoded(std::make_shared<peImports>());
+    decoded->parseImage(*headers, static_cast<const unsigned char*>(view.get()), viewSize);
+    importInformation = decoded;
+}
+const peImports* FileData::getImports() const
+{
+    if (!(bits & IMPORTSENUMERATED))
+        enumImports();
+    return importInformation.get();
+}
+void FileData::enumEntropy() const
+{
+    bits |= ENTROPYENUMERATED;
+    if (isDirectory())
+        return;
+    //Sections are measured from the same read as the whole file, and so is
+    //the PE checksum if it is still needed.
+    const peHeaders* headers = getPEHeaders();
+    std::shared_ptr<peEntropy> measured(std::make_shared<peEntropy>(headers));
+    bool const wantChecksum = headers && !(bits & PECHKSUM);
+    peChecksum checksum;
+    checksummingSink<peEntropy> sink(*measured, wantChecksum ? &checksum : nullptr);
+    if (readContents(sink) != ERROR_SUCCESS)
+        return;
+    measured->Final();
+    entropyInformation = measured;
+    if (wantChecksum)
+    {
+        calcSum = checksum.Final(headerSum);
+        bits |= PECHKSUM;
+    }
+}
+const peEntropy* FileData::getEntropy() const
+{
+    if (!(bits & ENTROPYENUMERATED))
+        enumEntropy();
+    return entropyInformation.get();
+}
+bool FileData::containsPattern(const contentPatterns& patterns, std::size_t search) const
+{
+    if (search < contentMatches.size() && contentMatches[search])
+        return true;
+    if (bits & CONTENTSEARCHED)
+        return false;
+    if (isDirectory())
+    {
+        bits |= CONTENTSEARCHED;
+        return false;
+    }
+    //Stop at the first hit for this search. Other searches found on the way
+    //are remembered, but one not yet found needs a rescan unless the whole
+    //file was read.
+    contentScanner scanner(patterns, search);
+    if (readContents(scanner) != ERROR_SUCCESS)
+    {
+        bits |= CONTENTSEARCHED;
+        return false;
+    }
+    contentMatches = scanner.getFound();
+    if (!scanner.isDone() || scanner.foundAll())
+        bits |= CONTENTSEARCHED;
+    return contentMatches[search];
+}
+fileMagic::type FileData::getContentType() const
+{
+    if (bits & MAGICCHECKED)
+        return contentType;
+    //Usually the PE header read classifies the file; it skips small files.
+    initPortableExecutable();
+    if (bits & MAGICCHECKED)
+        return contentType;
+    bits |= MAGICCHECKED;
+    contentType = fileMagic::TYPE_UNKNOWN;
+    if (isDirectory())
+        return contentType;
+    if (getSize() == 0)
+        return contentType = fileMagic::TYPE_EMPTY;
+    auto hFile = getFileHandle();
+    if (!hFile.IsOpen())
+        return contentType;
+    unsigned char buffer[peHeaders::HEADER_READ_SIZE];
+    DWORD lengthRead = 0;
+    if (ReadFile(hFile.Get(), buffer, sizeof(buffer), &lengthRead, NULL) && lengthRead)
+        contentType = fileMagic::classify(buffer, lengthRead);
+    return contentType;
+}
+std::wstring FileData::getImportHash() const
+{
+    const peImports* imports = getImports();
+    if (!imports)
+        return std::wstring(32, L'-');
+    std::string const hashInput(imports->getImportHashInput());
+    if (hashInput.empty())
+        return std::wstring(32, L'-');
+    unsigned char digest[CryptoPP::Weak::MD5::DIGESTSIZE];
+    CryptoPP::Weak::MD5().CalculateDigest(digest, reinterpret_cast<const unsigned char*>(hashInput.data()), hashInput.size());
+    return hashSet::formatHexDigest(digest, sizeof(digest));
 }
 
 
 Instalog::UniqueHandle FileData::getFileHandle(bool readOnly) const
 {
-    disable64.disableFS();
+    scopedDisable64 redirection;
     HANDLE result = CreateFile(
         fileName.c_str(),
         readOnly ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
@@ -756,84 +1174,17 @@ Instalog::UniqueHandle FileData::getFileHandle(bool readOnly) const
         NULL,
         NULL
     );
-    disable64.enableFS();
     return Instalog::UniqueHandle(result);
 }
-/************************************************************************************
- *
- * Disclaimer -- the checksum function is not my code. I used example code
- * from this codeproject article -> http://www.codeproject.com/KB/cpp/PEChecksum.aspx
- * This is because pevFind cannot require IMAGEHLP.DLL
- *
- ************************************************************************************/
-#pragma warning (push)
-#pragma warning (disable: 4244)
-WORD FileData::ChkSum(WORD oldChk, USHORT * ptr, DWORD len) const
+DWORD FileData::GetPEChkSum() const
 {
-    DWORD c = oldChk;
-    while (len)
-    {
-        DWORD l = std::min(len, 0x4000ul);
-        len -= l;
-        for (DWORD j=0; j<l; ++j)
-        {
-            c += *ptr++;
-        }
-        c = (c&0xffff) + (c>>16);
-    }
-    c = (c&0xffff) + (c>>16);
-    return (WORD)c;
-}
-
-DWORD FileData::GetPEChkSum(LPCTSTR filename) const
-{
-    HANDLE hf = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
-    if (hf == INVALID_HANDLE_VALUE) return 0;
-
-    DWORD dwRead = 0;
-    DWORD dwSize = GetFileSize(hf, 0);
-    IMAGE_DOS_HEADER dosh;
-    IMAGE_NT_HEADERS nth;
-    ReadFile(hf, &dosh, sizeof(dosh), &dwRead, 0);
-    SetFilePointer(hf, dosh.e_lfanew, 0, FILE_BEGIN);
-    ReadFile(hf, &nth, sizeof(nth), &dwRead, 0);
-    SetFilePointer(hf, 0, 0, FILE_BEGIN);
-
-    const int sz = 0x10000;
-    BYTE mem[sz];
-    DWORD dwCheck = 0;
-
-    dwRead = 0;
-
-    while (ReadFile(hf, mem, sz, &dwRead, 0) && dwRead > 0)
-    {
-        dwCheck = ChkSum(dwCheck, (PUSHORT)mem, dwRead/2);
-    }
-
-    if (dwRead & 1)
-    {
-        dwCheck += mem[dwRead-1];
-        dwCheck = (dwCheck>>16) + (dwCheck&0xffff);
-    }
-    CloseHandle(hf);
-
-    DWORD yy = 0;
-    if (dwCheck-1 < nth.OptionalHeader.CheckSum)
-    {
-        yy = (dwCheck-1) - nth.OptionalHeader.CheckSum;
-    }
-    else
-    {
-        yy = dwCheck - nth.OptionalHeader.CheckSum;
-    }
-    yy = (yy&0xffff) + (yy>>16);
-    yy = (yy&0xffff) + (yy>>16);
-    yy += dwSize;
-    return yy;
+    peChecksum checksum;
+    if (readContents(checksum) != ERROR_SUCCESS)
+        return 0;
+    return checksum.Final(headerSum);
 }
-#pragma warning(pop)
 
-std::vector<std::wstring> FileData::sfcFileStrings;
+std::vector<Instalog::Path::path> FileData::sfcFileStrings;
 unsigned int FileData::sfcState = NOT_CHECKED;
 
 typedef struct _PPROTECT_FILE_ENTRY {
@@ -878,9 +1229,7 @@ void FileData::buildSfcList() const
     for(ULONG idx = 0; idx < fileCount; idx++)
     {
         ExpandEnvironmentStrings(fileEntry->FileName, buffer, MAX_PATH);
-        std::wstring convertedBuffer(buffer);
-        boost::algorithm::to_upper(convertedBuffer);
-        sfcFileStrings.push_back(convertedBuffer);
+        sfcFileStrings.push_back(Instalog::Path::path(buffer));
         fileEntry++;
     }
     std::sort(sfcFileStrings.begin(), sfcFileStrings.end());
@@ -903,11 +1252,8 @@ bool FileData::isSfcProtected() const
     case NO_SFCFILES_DLL:
         return SfcIsFileProtected(NULL,getFileName().c_str()) != 0;
     case ENUMERATED:
-        {
-            std::wstring upCase;
-            upCase = boost::algorithm::to_upper_copy(getFileName());
-            return std::binary_search(sfcFileStrings.begin(), sfcFileStrings.end(), upCase);
-        }
+        //Compared by their uppercase copies, as the list was sorted
+        return std::binary_search(sfcFileStrings.begin(), sfcFileStrings.end(), fileName);
     default:
         return false;
     }
@@ -916,6 +1262,10 @@ bool FileData::isSfcProtected() const
 void FileData::resetPEHeaderCheckSum()
 {
     if (isPE() && peHeaderChecksumIsValid() && getPEHeaderCheckSum() != 0) return;
+    if (!peInfo)
+        return;
+
+    DWORD realSum = getPECalculatedCheckSum();
 
     //Get a handle to the file
     Instalog::UniqueHandle hFile(getFileHandle(false));
@@ -923,93 +1273,21 @@ void FileData::resetPEHeaderCheckSum()
     if (!hFile.IsOpen())
         return;
 
-    //A common DWORD for remembering the length of returned file data.
-    DWORD lengthRead = 0;
-
-    //Check for the MZ signature at the beginning of the PE file.
-    BYTE mzCheck[2];
-    ReadFile(hFile.Get(), mzCheck, 2, &lengthRead, NULL);
-    if (lengthRead != 2 || memcmp(mzCheck, "MZ", 2))
+    //The parser already knows where the headerSum lives
+    LARGE_INTEGER checkSumOffset;
+    checkSumOffset.QuadPart = peInfo->getCheckSumOffset();
+    if (!SetFilePointerEx(hFile.Get(), checkSumOffset, NULL, FILE_BEGIN))
         return;
 
-    //Seek to offset 0x3C,which contains the offset to the PE header
-    if (SetFilePointer(hFile.Get(), 0x3c, NULL, FILE_BEGIN) == INVALID_SET_FILE_POINTER)
-        return;
-    //Get the offset
-    LONG peOffset;
-    if (!ReadFile(hFile.Get(), &peOffset, sizeof(LONG), &lengthRead, NULL))
-        return;
-    //Seek to the offset
-    if (SetFilePointer(hFile.Get(), peOffset, NULL, FILE_BEGIN) == INVALID_SET_FILE_POINTER)
-        return;
-
-    //Check for PE Signature
-    BYTE peSig[4];
-    ReadFile(hFile.Get(), peSig, 4, &lengthRead, NULL);
-    if (lengthRead != 4)
-        return;
-
-    if (memcmp(peSig, "PE\0", 4))
-        return;
-    //Get the IMAGE_FILE_HEADER
-    IMAGE_FILE_HEADER fileHeader;
-    memset(&fileHeader, 0, sizeof(IMAGE_FILE_HEADER));
-    if (!ReadFile(hFile.Get(), &fileHeader, sizeof(IMAGE_FILE_HEADER), &lengthRead, NULL))
-        return;
-
-    //Read the magic number from the optional header
-    BYTE optionalHeaderMagic[2];
-    if (!ReadFile(hFile.Get(), optionalHeaderMagic, 2, &lengthRead, NULL))
-        return;
-
-    //Check for valid magic
-    if (optionalHeaderMagic[0] != 0x0B)
-        return;
-
-    //Hold which PE version it is -- PE32 or PE32+.
-    //PE32+ is used on x64 machines.
-    bool isPEPlus;
-
-    //Calculate the above using the magic value
-    if      (optionalHeaderMagic[1] == 0x01)
-        isPEPlus = false;
-    else if (optionalHeaderMagic[1] == 0x02)
-        isPEPlus = true;
-    else
-        return;
-
-    //Get the base address of the image for future calculations. 64 bit value for PE32+
-    __int64 imageBaseAddress = 0;
-
-    if (isPEPlus)
-    {
-        //In PE32+, the offset for the base address is 24, and is eight bytes long
-        if (SetFilePointer(hFile.Get(), 22, NULL, FILE_CURRENT) == INVALID_SET_FILE_POINTER)
-            return;
-        if (!ReadFile(hFile.Get(), &imageBaseAddress, 8, &lengthRead, NULL))
-            return;
-    } else
-    {
-        //In PE32, the offset for the base address is 28, and is four bytes long.
-        if (SetFilePointer(hFile.Get(), 26, NULL, FILE_CURRENT) == INVALID_SET_FILE_POINTER)
-            return;
-        if (!ReadFile(hFile.Get(), &imageBaseAddress, 4, &lengthRead, NULL))
-            return;
-    }
-
-    //Find headerSum
-    //Offset from the base address is 32 (64 from beginning of the optional header)
-    if (SetFilePointer(hFile.Get(), 32, NULL, FILE_CURRENT) == INVALID_SET_FILE_POINTER)
-        return;
-    
-    DWORD realSum = getPECalculatedCheckSum();
-        
     //Write new headerSum
-    if (!WriteFile(hFile.Get(), &realSum, sizeof(DWORD), &lengthRead, NULL))
+    DWORD lengthWritten = 0;
+    if (!WriteFile(hFile.Get(), &realSum, sizeof(DWORD), &lengthWritten, NULL))
         return;
         
     //Well the sum is correct now ;)
     headerSum = realSum;
+    //The write changed the modification time
+    bits &= ~ATTRIBUTESREAD;
 }
 
 void FileData::write()
@@ -1059,7 +1337,52 @@ void FileData::write()
                 line.push_back(isPEPlus() ? L'7' : L'-');
                 break;
             case L'8':
-                line.append(GetShortPathNameStr(getFileName()));
+                line.append(GetShortPathNameStr(std::wstring(fileName.begin(), fileName.end())));
+                break;
+            case L'9':
+                line.append(SampleHash());
+                break;
+            case L'0':
+                line.append(getImportHash());
+                break;
+            case L'$':
+                {
+                    const peEntropy* entropy = getEntropy();
+                    wchar_t entropyTemp[8];
+                    int result = swprintf_s(entropyTemp, L"%.3f", entropy ? entropy->getFileEntropy() : 0.0);
+                    line.append(entropyTemp, std::max(result, 0));
+                }
+                break;
+            case L'!':
+                {
+                    const peEntropy* entropy = getEntropy();
+                    if (!entropy || entropy->getSections().empty())
+                    {
+                        line.push_back(L'-');
+                        break;
+                    }
+                    std::vector<peEntropy::section> const& sections = entropy->getSections();
+                    for (std::vector<peEntropy::section>::const_iterator it = sections.begin(); it != sections.end(); ++it)
+                    {
+                        wchar_t entropyTemp[8];
+                        int result = swprintf_s(entropyTemp, L"%.2f", it->entropy);
+                        if (it != sections.begin())
+                            line.push_back(L',');
+                        line.append(convertUnicode(it->name)).push_back(L':');
+                        line.append(entropyTemp, std::max(result, 0));
+                    }
+                }
+                break;
+            case L'?':
+                line.append(convertUnicode(fileMagic::getName(getContentType())));
+                break;
+            case L'@':
+                {
+                    const peImports* imports = getImports();
+                    wchar_t exportTemp[11];
+                    int result = swprintf_s(exportTemp, L"%u", imports ? imports->getExportCount() : 0);
+                    line.append(exportTemp, std::max(result, 0));
+                }
                 break;
             case L'a':
             case L'A':
@@ -1083,7 +1406,7 @@ void FileData::write()
                 break;
             case L'f':
             case L'F':
-                line.append(getFileName());
+                line.append(fileName.begin(), fileName.end());
                 break;
             case L'G':
             case L'g':
@@ -1187,4 +1510,30 @@ void FileData::write()
         cursor++;
     }
     logger << line << L"\r\n";
+    if (globalOptions::stringsMinimum && !isDirectory())
+        writeStrings();
+}
+void FileData::writeStrings() const
+{
+    //Strings are handed to the logger in batches rather than one at a time.
+    static const std::size_t batchSize = 64 * 1024;
+    std::wstring batch;
+    printableStrings extractor(globalOptions::stringsMinimum,
+        [&batch](std::uint64_t offset, bool wide, std::string const& text) {
+            wchar_t prefix[24];
+            int result = swprintf_s(prefix, L"  %08I64X %c ", offset, wide ? L'U' : L'A');
+            batch.append(prefix, std::max(result, 0));
+            batch.append(text.begin(), text.end());
+            batch.append(L"\r\n");
+            if (batch.size() >= batchSize)
+            {
+                logger << batch;
+                batch.clear();
+            }
+        });
+    //A file which cannot be read to the end still reports what was found.
+    readContents(extractor);
+    extractor.Final();
+    if (!batch.empty())
+        logger << batch;
 }
@@ -22,11 +22,21 @@
 #include <cryptopp562/sha.h>
 #pragma warning(pop)
 #include "utility.h"
+#include "fileMagic.h"
 #include "../LogCommon/Win32Glue.hpp"
+#include "../LogCommon/Path.hpp"
+
+class peHeaders;
+class versionInfo;
+class peImports;
+class peEntropy;
+class contentPatterns;
 
 class FileData
 {
+public:
     //Defines for the individual bits in the bitset containing properties for this filedata object
+    //Public so that compiled criteria can test several attributes with one mask.
     enum
     {
         ARCHIVE =                0x00000001,  // Standard Win32 Attributes
@@ -59,38 +69,51 @@ class FileData
         SIGENUMERATED =            0x00400000,
         VERSIONINFOCHECKED =    0x01000000,
         //Looks like I had to add another executable attribute
-        PEPLUS =                0x02000000
+        PEPLUS =                0x02000000,
+        IMPORTSENUMERATED =        0x04000000,
+        ENTROPYENUMERATED =        0x08000000,
+        CONTENTSEARCHED =        0x10000000,
+        MAGICCHECKED =            0x20000000,
+        ATTRIBUTESREAD =        0x40000000
     };
+private:
 
     mutable DWORD bits; //Container for the bits in the enum above
                                       //This is mutable because constant functions
                                       //use the bitset to cache their responses
 
-    //Filename
-    std::wstring fileName;
+    //Filename, with an uppercase copy kept beside it so case insensitive
+    //comparisons need no folding
+    Instalog::Path::path fileName;
+
+    //Size and times; only valid once ATTRIBUTESREAD is set. Seeded from the
+    //directory listing when the record comes from one, so every criterion
+    //and the output see the values the block filters tested.
+    mutable WIN32_FILE_ATTRIBUTE_DATA attributeData;
     
     //PE Information
     mutable FILETIME headerTime;
     mutable DWORD headerSum;
     mutable DWORD calcSum;
+    //Parsed image headers; only set for PE files
+    mutable std::shared_ptr<const peHeaders> peInfo;
 
-    //Version information block
-    mutable std::vector<BYTE> versionInformationBlock;
-    struct LANGANDCODEPAGE {
-        WORD wLanguage;
-        WORD wCodePage;
-        bool operator==(LANGANDCODEPAGE &rhs)
-        {
-            return wLanguage == rhs.wLanguage && wCodePage == rhs.wCodePage;
-        };
-        bool operator<(LANGANDCODEPAGE &rhs)
-        {
-            if (wLanguage != rhs.wLanguage)
-                return wLanguage < rhs.wLanguage;
-            return wCodePage < rhs.wCodePage;
-        };
-    };
-    mutable std::vector<LANGANDCODEPAGE> versionTranslations;
+    //Decoded version resource; null if the file has none
+    mutable std::shared_ptr<const versionInfo> versionInformation;
+
+    //Decoded import and export directories; only set for PE files
+    mutable std::shared_ptr<const peImports> importInformation;
+
+    //Whole file and section entropy; null until something asks for it
+    mutable std::shared_ptr<const peEntropy> entropyInformation;
+
+    //Content searches found so far, indexed by search id. Only complete
+    //once CONTENTSEARCHED is set.
+    mutable std::vector<bool> contentMatches;
+
+    //What the magic numbers at the start of the file say it is; only valid
+    //once MAGICCHECKED is set.
+    mutable fileMagic::type contentType;
 
     //Enumeration functions
     //When the results aren't cached in the bitset bits, these functions calculate
@@ -98,6 +121,8 @@ class FileData
     void initPortableExecutable() const;
     void sigVerify() const;
     void enumVersionInformationBlock() const;
+    void enumImports() const;
+    void enumEntropy() const;
 
     //Group set functions
     //These functions set a large number of items according to an external data structure
@@ -106,14 +131,18 @@ class FileData
     //Internal calculation functions
     void inline appendAttributeCharacter(std::wstring &result, const TCHAR attributeCharacter, const size_t curBit) const;
     std::wstring getVersionInformationString(const std::wstring&) const;
+    template <typename sinkType> DWORD readContents(sinkType& sink) const;
+    template <typename hashType> DWORD hashContents(unsigned char* digest) const;
     template <typename hashType> std::wstring getHash() const;
+    template <typename hashType> DWORD authenticodeDigest(std::vector<unsigned char>& digest) const;
+    bool embeddedSignatureVerdict(HANDLE file, bool& valid, std::string& verdictKey) const;
+    bool findCatalog(HANDLE file, std::vector<unsigned char>& hash, std::wstring& catalogFile) const;
 
-    //PE Checksum functions (from Code Project)
-    WORD ChkSum(WORD oldChk, USHORT * ptr, DWORD len) const;
-    DWORD GetPEChkSum(LPCTSTR filename) const;
+    //PE Checksum functions
+    DWORD GetPEChkSum() const;
 
     //SFC Safe Mode Fix functions
-    static std::vector<std::wstring> sfcFileStrings;
+    static std::vector<Instalog::Path::path> sfcFileStrings;
     enum {
         NOT_CHECKED,
         NO_SFCFILES_DLL,
@@ -130,11 +159,13 @@ public:
     FileData(const WIN32_FIND_DATA &rawData, const std::wstring& root);
     //Construct a fileData record using a raw filename
     FileData(const std::wstring &fileNameBuild);
+    //Construct a fileData record from the parts of a Win32FindData structure entryBlock keeps
+    FileData(const std::wstring& root, const wchar_t* name, std::size_t nameLength, const WIN32_FILE_ATTRIBUTE_DATA& listed);
 
     //Type extensions
     //Used for comparisons and for getting implicit conversions
     bool operator<(FileData& rhs);
-    operator std::wstring () const {return getFileName(); };
+    operator std::wstring () const {return std::wstring(fileName.begin(), fileName.end()); };
 
     //Accessor methods
     //Return information about the current filedata object
@@ -142,10 +173,11 @@ public:
     //Size
     inline unsigned __int64 getSize() const;
 
-    //Filename
-    inline const std::wstring & getFileName() const;
+    //Filename; uc_str() and ubegin() give it in uppercase
+    inline const Instalog::Path::path & getFileName() const;
 
-    //Access times
+    //Access times. Read once, with GetFileAttributesEx, unless the record was
+    //made from a directory listing.
     inline const WIN32_FILE_ATTRIBUTE_DATA getAttributeData() const;
     inline const FILETIME getLastAccessTime() const;
     inline const FILETIME getLastModTime() const;
@@ -169,6 +201,10 @@ public:
     inline bool isWritable() const;
     inline bool isTemporary() const;
     inline bool isReparsePoint() const;
+    //All of the above at once, as ARCHIVE through TEMPORARY bits
+    inline DWORD getAttributeBits() const;
+    //The bits getAttributeBits returns for a file with the given Win32 attributes
+    static DWORD attributeBitsFor(DWORD win32Attributes);
     //PE Data Attributes
     inline bool isPE() const;
     inline bool isNE() const;
@@ -183,6 +219,22 @@ public:
     inline DWORD getPECalculatedCheckSum() const;
     void resetPEHeaderCheckSum();
     inline bool peHeaderTimeIsValid() const;
+    //The parsed image headers, or nullptr if the file is not a PE image
+    inline const peHeaders* getPEHeaders() const;
+    //The decoded import and export directories, or nullptr if the file is
+    //not a PE image or they could not be read
+    const peImports* getImports() const;
+    //MD5 of peImports::getImportHashInput, or dashes if there are no imports
+    std::wstring getImportHash() const;
+    //Entropy of the file and, for PE images, of each section. Reads the whole
+    //file the first time; nullptr if it could not be read.
+    const peEntropy* getEntropy() const;
+    //Whether the file contains a pattern satisfying the given search. All
+    //searches are run in one pass, which stops once this one is satisfied.
+    bool containsPattern(const contentPatterns& patterns, std::size_t search) const;
+    //The file's type according to its magic numbers, from the same read as
+    //the PE headers.
+    fileMagic::type getContentType() const;
     //Digital Signature Attributes
     inline bool hasValidDigitalSignature() const;
     //Windows File Protection Attributes
@@ -195,6 +247,20 @@ public:
     std::wstring SHA256() const;
     std::wstring SHA384() const;
     std::wstring SHA512() const;
+    //Raw hashing functions. These write the binary digest to digest, which must
+    //hold the digest size of the hash, and return ERROR_SUCCESS or the Win32 error
+    //which prevented the file from being hashed.
+    DWORD MD5Digest(unsigned char* digest) const;
+    DWORD SHA1Digest(unsigned char* digest) const;
+    DWORD SHA224Digest(unsigned char* digest) const;
+    DWORD SHA256Digest(unsigned char* digest) const;
+    DWORD SHA384Digest(unsigned char* digest) const;
+    DWORD SHA512Digest(unsigned char* digest) const;
+    //Sample hash: a SHA-1 over the file size and blocks of
+    //globalOptions::sampleBlockSize bytes from the head, middle and tail of the
+    //file. Reads at most three blocks no matter how large the file is.
+    std::wstring SampleHash() const;
+    DWORD SampleDigest(unsigned char* digest) const;
 
     // Version information functions
     inline std::wstring GetVerCompany() const;
@@ -211,6 +277,9 @@ public:
     
     // Logging function
     void write();
+    // Writes the printable strings in the file, one per line, after write's
+    // line; used by --strings and the STRINGS subprogram.
+    void writeStrings() const;
 };
 
 //
@@ -218,31 +287,29 @@ public:
 //
 inline unsigned __int64 FileData::getSize() const
 {
-    __int64 result;
-    WIN32_FILE_ATTRIBUTE_DATA attributeData;
-    if(!GetFileAttributesEx(fileName.c_str(), GetFileExInfoStandard, &attributeData))
-        return 0;
+    getAttributeData();
     if (attributeData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
         return 0;
-    result = attributeData.nFileSizeHigh;
+    unsigned __int64 result = attributeData.nFileSizeHigh;
     result = result << 32;
     result |= attributeData.nFileSizeLow;
     return result;
 }
-inline const std::wstring & FileData::getFileName() const
+inline const Instalog::Path::path & FileData::getFileName() const
 {
     return fileName;
 }
 
 inline const WIN32_FILE_ATTRIBUTE_DATA FileData::getAttributeData() const
 {
-    disable64.disableFS();
-    WIN32_FILE_ATTRIBUTE_DATA attributeData;
+    if (bits & ATTRIBUTESREAD)
+        return attributeData;
+    scopedDisable64 redirection;
     if(GetFileAttributesEx(fileName.c_str(), GetFileExInfoStandard, &attributeData) == 0)
     {
         ZeroMemory(&attributeData, sizeof(attributeData));
     }
-    disable64.enableFS();
+    bits |= ATTRIBUTESREAD;
     return attributeData;
 }
 
@@ -336,6 +403,12 @@ inline bool FileData::isReparsePoint() const
     return (bits & REPARSE) != 0;
 }
 
+inline DWORD FileData::getAttributeBits() const
+{
+    setupWin32Attributes();
+    return bits;
+}
+
 inline bool FileData::isPE() const
 {
     initPortableExecutable();
@@ -414,10 +487,19 @@ inline DWORD FileData::getPECalculatedCheckSum() const
     if (!(bits & ISPE))
         return 0;
     if (!(bits & PECHKSUM))
-        calcSum = GetPEChkSum(fileName.c_str());
+    {
+        calcSum = GetPEChkSum();
+        bits |= PECHKSUM;
+    }
     return calcSum;
 }
 
+inline const peHeaders* FileData::getPEHeaders() const
+{
+    initPortableExecutable();
+    return peInfo.get();
+}
+
 inline bool FileData::peHeaderTimeIsValid() const
 {
     SYSTEMTIME curTimeSys;
@@ -0,0 +1,184 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// fileMagic.cpp -- Implements the magic number classifier.
+
+#include "pch.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <boost/algorithm/string/predicate.hpp>
+#include "fileMagic.h"
+
+namespace {
+
+    char const* const typeNames[fileMagic::TYPE_COUNT] = {
+        "unknown", "empty", "exe", "elf", "macho", "script", "zip", "ooxml", "jar",
+        "ole", "rar", "7z", "gzip", "bzip2", "xz", "cab", "tar", "pdf", "rtf", "jpeg",
+        "png", "gif", "bmp", "lnk", "xml", "chm"
+    };
+
+    struct signature
+    {
+        fileMagic::type fileType;
+        std::size_t offset;
+        char const* bytes;
+        std::size_t length;
+        // Checked only once the first part matches; length zero if unused
+        std::size_t secondOffset;
+        char const* secondBytes;
+        std::size_t secondLength;
+    };
+
+#define MAGIC(text) text, sizeof(text) - 1
+#define NO_SECOND 0, "", 0
+    // When several signatures match a file, the longest wins, so a zip file
+    // holding an Office document is an ooxml file rather than a zip file.
+    const signature signatures[] = {
+        { fileMagic::TYPE_EXECUTABLE, 0, MAGIC("MZ"), NO_SECOND },
+        { fileMagic::TYPE_ELF, 0, MAGIC("\x7F" "ELF"), NO_SECOND },
+        { fileMagic::TYPE_MACHO, 0, MAGIC("\xFE\xED\xFA\xCE"), NO_SECOND },
+        { fileMagic::TYPE_MACHO, 0, MAGIC("\xCE\xFA\xED\xFE"), NO_SECOND },
+        { fileMagic::TYPE_MACHO, 0, MAGIC("\xFE\xED\xFA\xCF"), NO_SECOND },
+        { fileMagic::TYPE_MACHO, 0, MAGIC("\xCF\xFA\xED\xFE"), NO_SECOND },
+        { fileMagic::TYPE_SCRIPT, 0, MAGIC("#!"), NO_SECOND },
+        { fileMagic::TYPE_ZIP, 0, MAGIC("PK\x03\x04"), NO_SECOND },
+        { fileMagic::TYPE_ZIP, 0, MAGIC("PK\x05\x06"), NO_SECOND },
+        { fileMagic::TYPE_ZIP, 0, MAGIC("PK\x07\x08"), NO_SECOND },
+        { fileMagic::TYPE_OOXML, 0, MAGIC("PK\x03\x04"), 30, MAGIC("[Content_Types].xml") },
+        { fileMagic::TYPE_JAR, 0, MAGIC("PK\x03\x04"), 30, MAGIC("META-INF/") },
+        { fileMagic::TYPE_OLE, 0, MAGIC("\xD0\xCF\x11\xE0\xA1\xB1\x1A\xE1"), NO_SECOND },
+        { fileMagic::TYPE_RAR, 0, MAGIC("Rar!\x1A\x07"), NO_SECOND },
+        { fileMagic::TYPE_SEVENZIP, 0, MAGIC("7z\xBC\xAF\x27\x1C"), NO_SECOND },
+        { fileMagic::TYPE_GZIP, 0, MAGIC("\x1F\x8B\x08"), NO_SECOND },
+        { fileMagic::TYPE_BZIP2, 0, MAGIC("BZh"), NO_SECOND },
+        { fileMagic::TYPE_XZ, 0, MAGIC("\xFD" "7zXZ\x00"), NO_SECOND },
+        { fileMagic::TYPE_CAB, 0, MAGIC("MSCF\x00\x00\x00\x00"), NO_SECOND },
+        { fileMagic::TYPE_TAR, 257, MAGIC("ustar"), NO_SECOND },
+        { fileMagic::TYPE_PDF, 0, MAGIC("%PDF-"), NO_SECOND },
+        { fileMagic::TYPE_RTF, 0, MAGIC("{\\rtf"), NO_SECOND },
+        { fileMagic::TYPE_JPEG, 0, MAGIC("\xFF\xD8\xFF"), NO_SECOND },
+        { fileMagic::TYPE_PNG, 0, MAGIC("\x89PNG\x0D\x0A\x1A\x0A"), NO_SECOND },
+        { fileMagic::TYPE_GIF, 0, MAGIC("GIF87a"), NO_SECOND },
+        { fileMagic::TYPE_GIF, 0, MAGIC("GIF89a"), NO_SECOND },
+        { fileMagic::TYPE_BMP, 0, MAGIC("BM"), NO_SECOND },
+        { fileMagic::TYPE_LNK, 0, MAGIC("\x4C\x00\x00\x00\x01\x14\x02\x00"), NO_SECOND },
+        { fileMagic::TYPE_XML, 0, MAGIC("<?xml"), NO_SECOND },
+        { fileMagic::TYPE_XML, 0, MAGIC("\xEF\xBB\xBF<?xml"), NO_SECOND },
+        { fileMagic::TYPE_CHM, 0, MAGIC("ITSF"), NO_SECOND }
+    };
+#undef NO_SECOND
+#undef MAGIC
+
+    std::size_t totalLength(const signature& candidate)
+    {
+        return candidate.length + candidate.secondLength;
+    }
+
+    bool longerSignature(const signature* left, const signature* right)
+    {
+        return totalLength(*left) > totalLength(*right);
+    }
+
+    // The signatures which share an offset, bucketed by the byte found there.
+    // Each bucket is sorted longest first, so the first match in a bucket is
+    // the best one it has.
+    struct offsetGroup
+    {
+        std::size_t offset;
+        std::size_t bucketBegin[257];
+        std::vector<const signature*> candidates;
+    };
+
+    class signatureIndex
+    {
+        std::vector<offsetGroup> groups;
+    public:
+        signatureIndex()
+        {
+            std::vector<std::size_t> offsets;
+            for (std::size_t idx = 0; idx < sizeof(signatures) / sizeof(signatures[0]); ++idx)
+                offsets.push_back(signatures[idx].offset);
+            std::sort(offsets.begin(), offsets.end());
+            offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+            groups.resize(offsets.size());
+            for (std::size_t group = 0; group < offsets.size(); ++group)
+            {
+                offsetGroup& current = groups[group];
+                current.offset = offsets[group];
+                std::vector<std::vector<const signature*> > buckets(256);
+                for (std::size_t idx = 0; idx < sizeof(signatures) / sizeof(signatures[0]); ++idx)
+                    if (signatures[idx].offset == current.offset)
+                        buckets[static_cast<unsigned char>(signatures[idx].bytes[0])].push_back(&signatures[idx]);
+                for (std::size_t byte = 0; byte < 256; ++byte)
+                {
+                    current.bucketBegin[byte] = current.candidates.size();
+                    std::stable_sort(buckets[byte].begin(), buckets[byte].end(), longerSignature);
+                    current.candidates.insert(current.candidates.end(), buckets[byte].begin(), buckets[byte].end());
+                }
+                current.bucketBegin[256] = current.candidates.size();
+            }
+        }
+
+        fileMagic::type classify(unsigned char const* data, std::size_t length) const
+        {
+            fileMagic::type result = fileMagic::TYPE_UNKNOWN;
+            std::size_t bestLength = 0;
+            for (std::vector<offsetGroup>::const_iterator group = groups.begin(); group != groups.end(); ++group)
+            {
+                if (group->offset >= length)
+                    continue;
+                unsigned char const byte = data[group->offset];
+                for (std::size_t idx = group->bucketBegin[byte]; idx < group->bucketBegin[byte + 1]; ++idx)
+                {
+                    const signature& candidate = *group->candidates[idx];
+                    if (totalLength(candidate) <= bestLength)
+                        break;
+                    if (candidate.offset + candidate.length > length
+                        || std::memcmp(data + candidate.offset, candidate.bytes, candidate.length) != 0)
+                        continue;
+                    if (candidate.secondLength && (candidate.secondOffset + candidate.secondLength > length
+                        || std::memcmp(data + candidate.secondOffset, candidate.secondBytes, candidate.secondLength) != 0))
+                        continue;
+                    result = candidate.fileType;
+                    bestLength = totalLength(candidate);
+                    break;
+                }
+            }
+            return result;
+        }
+    };
+
+    // Built during static initialization, before any file is examined.
+    const signatureIndex signatureLookup;
+
+}
+
+fileMagic::type fileMagic::classify(unsigned char const* data, std::size_t length)
+{
+    if (length == 0)
+        return TYPE_EMPTY;
+    return signatureLookup.classify(data, length);
+}
+
+char const* fileMagic::getName(type fileType)
+{
+    if (fileType < 0 || fileType >= TYPE_COUNT)
+        return typeNames[TYPE_UNKNOWN];
+    return typeNames[fileType];
+}
+
+bool fileMagic::fromName(const std::string& name, type& fileType)
+{
+    for (std::size_t idx = 0; idx < TYPE_COUNT; ++idx)
+    {
+        if (boost::algorithm::iequals(name, typeNames[idx]))
+        {
+            fileType = static_cast<type>(idx);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,55 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// fileMagic.h -- Classifies files by the magic numbers at the start of their
+// contents rather than by their names. Only the block FileData already reads
+// for the PE headers is examined, so classifying a file costs no extra I/O.
+#pragma once
+#include <cstddef>
+#include <string>
+
+class fileMagic
+{
+public:
+    // Keep in step with the name table in fileMagic.cpp.
+    enum type
+    {
+        TYPE_UNKNOWN,
+        TYPE_EMPTY,
+        TYPE_EXECUTABLE, // Any MZ executable: PE, NE, LE or DOS
+        TYPE_ELF,
+        TYPE_MACHO,
+        TYPE_SCRIPT,     // Starts with #!
+        TYPE_ZIP,
+        TYPE_OOXML,      // Office 2007 and later documents, which are zip files
+        TYPE_JAR,
+        TYPE_OLE,        // Compound documents: older Office documents, .msi
+        TYPE_RAR,
+        TYPE_SEVENZIP,
+        TYPE_GZIP,
+        TYPE_BZIP2,
+        TYPE_XZ,
+        TYPE_CAB,
+        TYPE_TAR,
+        TYPE_PDF,
+        TYPE_RTF,
+        TYPE_JPEG,
+        TYPE_PNG,
+        TYPE_GIF,
+        TYPE_BMP,
+        TYPE_LNK,
+        TYPE_XML,
+        TYPE_CHM,
+        TYPE_COUNT
+    };
+
+    // Returns the type of a file whose first length bytes are data; length is
+    // zero only for an empty file.
+    static type classify(unsigned char const* data, std::size_t length);
+    // The short lower case name used for output and by -magic
+    static char const* getName(type fileType);
+    // Looks up a name case insensitively; returns false if there is no such type.
+    static bool fromName(const std::string& name, type& fileType);
+};
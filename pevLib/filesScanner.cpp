@@ -24,6 +24,20 @@ namespace scanners {
 void filesScanner::scan()
 {
     std::list<FileData> results;
+    collect(results);
+    if (globalOptions::sortMethod[0]) //Print results
+        results.sort();
+    for(std::list<FileData>::iterator it = results.begin(); it != results.end(); it++)
+    {
+        it->write();
+    }
+    if (!globalOptions::zipFileName.empty())
+        zipIt(globalOptions::zipFileName, results);
+    printSummary();
+}
+
+void filesScanner::collect(std::list<FileData>& results)
+{
     //Loop through files the user has entered
     for( std::vector<std::wstring>::iterator it = globalOptions::fileList.begin(); it != globalOptions::fileList.end(); it++ )
     {
@@ -36,15 +50,6 @@ void filesScanner::scan()
             continue; //Skip to the next file otherwise
         results.push_back(curFileStructed); //File exists, add it to results
     }
-    if (globalOptions::sortMethod[0]) //Print results
-        results.sort();
-    for(std::list<FileData>::iterator it = results.begin(); it != results.end(); it++)
-    {
-        it->write();
-    }
-    if (!globalOptions::zipFileName.empty())
-        zipIt(globalOptions::zipFileName, results);
-    printSummary();
 }
 
 }; //Namespace scanners
\ No newline at end of file
@@ -13,6 +13,8 @@ class filesScanner
 {
 public:
     void scan();
+    //Stores every match in results instead of printing it
+    void collect(std::list<FileData>& results);
 };
 
 }; //Namespace scanners
@@ -26,6 +26,8 @@ globalOptions::sorts globalOptions::sortMethod[6] = {globalOptions::NONE, global
 globalOptions::encodings globalOptions::encoding = globalOptions::ENCODING_TYPE_ACP;
 unsigned __int64 globalOptions::lineLimit = static_cast <unsigned int> (-1);
 unsigned __int32 globalOptions::timeout = std::numeric_limits<unsigned __int32>::max();
+unsigned __int32 globalOptions::sampleBlockSize = 64 * 1024;
+unsigned __int32 globalOptions::stringsMinimum = 0;
 bool globalOptions::cancel = false;
 unsigned __int64 globalOptions::totalEntries = 0;
 unsigned __int64 globalOptions::visibleEntries = 0;
@@ -37,4 +39,6 @@ std::vector<std::wstring> globalOptions::fileList;
 bool globalOptions::expandRegex = false;
 bool globalOptions::disable64Redirector = true;
 std::wstring globalOptions::zipFileName;
-bool globalOptions::killProc = false;
\ No newline at end of file
+std::wstring globalOptions::catalogIndexFile;
+bool globalOptions::killProc = false;
+bool globalOptions::explain = false;
\ No newline at end of file
@@ -61,6 +61,8 @@ public:
     static encodings encoding;
     static unsigned __int64 lineLimit;
     static unsigned __int32 timeout;
+    static unsigned __int32 sampleBlockSize;
+    static unsigned __int32 stringsMinimum; //Zero unless --strings is given
     static bool cancel;
     static void addSort( sorts toAdd )
     {
@@ -76,6 +78,8 @@ public:
     static bool expandRegex;
     static bool disable64Redirector;
     static std::wstring zipFileName;
+    static std::wstring catalogIndexFile;
     static bool killProc;
+    static bool explain; //Print the evaluated tree with its measurements after the search
 };
 #endif //_GLOBAL_OPTIONS_H_INCLUDED
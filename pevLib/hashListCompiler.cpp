@@ -0,0 +1,82 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// hashListCompiler.cpp -- Implements the HASHLIST subprogram.
+#include "pch.hpp"
+#include <stdexcept>
+#include <vector>
+#include <boost/algorithm/string/predicate.hpp>
+#include "hashListCompiler.h"
+#include "hashListFile.h"
+#include "hashSet.h"
+#include "logger.h"
+#include "utility.h"
+
+namespace hashListCompiler {
+
+    //Guesses the digest length of a text list from its first non blank line.
+    static std::size_t detectDigestLength(const std::vector<std::wstring>& lines)
+    {
+        for (std::vector<std::wstring>::const_iterator it = lines.begin(); it != lines.end(); ++it)
+        {
+            std::wstring::size_type first = it->find_first_not_of(L" \t");
+            if (first == std::wstring::npos)
+                continue;
+            std::wstring::size_type last = it->find_first_of(L" \t,", first);
+            if (last == std::wstring::npos)
+                last = it->size();
+            if ((last - first) % 2 || !hashSet::isSupportedDigestLength((last - first) / 2))
+                throw std::runtime_error("The input hash list does not hold MD5, SHA-1 or SHA-2 digests.");
+            return (last - first) / 2;
+        }
+        throw std::runtime_error("The input hash list is empty.");
+    }
+
+    static int compile(const std::wstring& inFileName, const std::wstring& outFileName)
+    {
+        std::vector<std::wstring> lines(loadStringsFromFile(inFileName));
+        std::size_t digestLength = detectDigestLength(lines);
+        hashSet hashes(lines, digestLength);
+        std::vector<std::wstring>().swap(lines);
+        writeHashList(hashes, outFileName);
+        logger << L"Compiled " << getSizeString(hashes.size()) << L" hashes of "
+            << getSizeString(digestLength * 8) << L" bits"
+            << (hashes.hasSizes() ? L" with file sizes" : L"") << L".\r\n";
+        return 0;
+    }
+
+    static int info(const std::wstring& fileName)
+    {
+        //A compiled list's header gives its digest length; a text list is
+        //read once, and its length guessed as COMPILE would.
+        std::size_t imageSize = 0;
+        std::shared_ptr<const void> backing(mapFile(fileName, imageSize));
+        const unsigned char* image = static_cast<const unsigned char*>(backing.get());
+        std::shared_ptr<hashSet> hashes;
+        if (image != nullptr && hashSet::isImage(image, imageSize))
+            hashes = std::make_shared<hashSet>(image, imageSize, backing);
+        else
+        {
+            backing.reset();
+            std::vector<std::wstring> lines(loadStringsFromFile(fileName));
+            hashes = std::make_shared<hashSet>(lines, detectDigestLength(lines));
+        }
+        logger << L"Hashes:      " << getSizeString(hashes->size())
+            << L"\r\nDigest bits: " << getSizeString(hashes->digestLength() * 8)
+            << L"\r\nFile sizes:  " << (hashes->hasSizes() ? L"yes" : L"no") << L"\r\n";
+        return 0;
+    }
+
+int main(int argc, wchar_t* argv[])
+{
+    using namespace boost::algorithm;
+    if (argc == 4 && iequals(argv[1], L"COMPILE"))
+        return compile(argv[2], argv[3]);
+    if (argc == 3 && iequals(argv[1], L"INFO"))
+        return info(argv[2]);
+    throw std::invalid_argument("Usage: HASHLIST COMPILE <INFILE> <OUTFILE> | HASHLIST INFO <FILE>");
+}
+
+}; //namespace hashListCompiler
@@ -0,0 +1,11 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// hashListCompiler.h -- Defines the "HASHLIST" subprogram, which
+// compiles text hash lists into pevFind's binary list format.
+
+namespace hashListCompiler {
+    int main(int argc, wchar_t* argv[]);
+}; //namespace hashListCompiler
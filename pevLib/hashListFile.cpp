@@ -0,0 +1,71 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// hashListFile.cpp -- Implements loading and saving of hash lists.
+
+#include "pch.hpp"
+#include <stdexcept>
+#include <algorithm>
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "hashListFile.h"
+#include "utility.h"
+#include "../LogCommon/Win32Glue.hpp"
+
+static void writeAll(HANDLE file, const void* data, unsigned __int64 length)
+{
+    const unsigned char* cursor = static_cast<const unsigned char*>(data);
+    while (length)
+    {
+        DWORD chunk = static_cast<DWORD>(std::min<unsigned __int64>(length, 0x40000000ull));
+        DWORD written = 0;
+        if (!WriteFile(file, cursor, chunk, &written, NULL) || written != chunk)
+            throw std::runtime_error("Could not write to output file.");
+        cursor += chunk;
+        length -= chunk;
+    }
+}
+
+namespace {
+
+    struct fileWriter
+    {
+        HANDLE file;
+        void operator()(const void* data, unsigned __int64 length) const
+        {
+            writeAll(file, data, length);
+        }
+    };
+
+}
+
+std::shared_ptr<hashSet> loadHashList(const std::wstring& fileName, std::size_t digestLength)
+{
+    //Compiled lists are used straight from the mapped view. The view is shared
+    //with every other process using the same list, and nothing in it is parsed
+    //or copied at startup.
+    std::size_t imageSize = 0;
+    std::shared_ptr<const void> backing(mapFile(fileName, imageSize));
+    const unsigned char* image = static_cast<const unsigned char*>(backing.get());
+    if (image != nullptr && hashSet::isImage(image, imageSize))
+    {
+        std::shared_ptr<hashSet> result(std::make_shared<hashSet>(image, imageSize, backing));
+        if (result->digestLength() != digestLength)
+            throw std::runtime_error("The compiled hash list \"" + convertUnicode(fileName) + "\" holds a different type of hash.");
+        return result;
+    }
+    backing.reset();
+
+    return std::make_shared<hashSet>(loadStringsFromFile(fileName), digestLength);
+}
+
+void writeHashList(const hashSet& hashes, const std::wstring& fileName)
+{
+    Instalog::UniqueHandle file(CreateFileW(fileName.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL));
+    if (!file.IsOpen())
+        throw std::runtime_error("Could not open output file.");
+    fileWriter writer = { file.Get() };
+    hashes.writeImage(writer);
+}
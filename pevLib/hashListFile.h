@@ -0,0 +1,15 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// hashListFile.h -- Loads and saves hash lists. Lists compiled with
+// HASHLIST COMPILE are mapped into memory and used in place; anything
+// else is treated as a newline delimited text list.
+#pragma once
+#include <string>
+#include <memory>
+#include "hashSet.h"
+
+std::shared_ptr<hashSet> loadHashList(const std::wstring& fileName, std::size_t digestLength);
+void writeHashList(const hashSet& hashes, const std::wstring& fileName);
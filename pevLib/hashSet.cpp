@@ -0,0 +1,422 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// hashSet.cpp -- Implements the packed binary digest set.
+
+#include "pch.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "hashSet.h"
+
+namespace {
+
+    //Fixed width view of one key, so that the flat key array can be handed to
+    //std::sort and std::unique directly without an index array.
+    template <std::size_t length>
+    struct packedKey
+    {
+        unsigned char bytes[length];
+        bool operator<(packedKey const& rhs) const
+        {
+            return std::memcmp(bytes, rhs.bytes, length) < 0;
+        }
+        bool operator==(packedKey const& rhs) const
+        {
+            return std::memcmp(bytes, rhs.bytes, length) == 0;
+        }
+    };
+
+    template <std::size_t length>
+    std::size_t sortAndUnique(std::vector<unsigned char>& keys)
+    {
+        packedKey<length>* first = reinterpret_cast<packedKey<length>*>(keys.data());
+        packedKey<length>* last = first + keys.size() / length;
+        std::sort(first, last);
+        return std::unique(first, last) - first;
+    }
+
+    int hexValue(wchar_t character)
+    {
+        if (character >= L'0' && character <= L'9')
+            return character - L'0';
+        if (character >= L'A' && character <= L'F')
+            return character - L'A' + 10;
+        if (character >= L'a' && character <= L'f')
+            return character - L'a' + 10;
+        return -1;
+    }
+
+    //Digests are uniformly distributed, so their leading bytes make a good
+    //interpolation key and their raw words make good Bloom filter hashes.
+    std::uint64_t prefixOf(unsigned char const* digest)
+    {
+        std::uint64_t result = 0;
+        for (int idx = 0; idx < 8; ++idx)
+            result = (result << 8) | digest[idx];
+        return result;
+    }
+
+    std::uint64_t wordAt(unsigned char const* digest, std::size_t offset)
+    {
+        std::uint64_t result;
+        std::memcpy(&result, digest + offset, sizeof(result));
+        return result;
+    }
+
+    bool isSeparator(wchar_t character)
+    {
+        return character == L' ' || character == L'\t' || character == L',';
+    }
+
+    //Parses the optional file size which follows the digest on a hash list line.
+    bool parseSize(std::wstring::const_iterator first, std::wstring::const_iterator last, std::uint64_t& result)
+    {
+        while (first != last && isSeparator(*first))
+            ++first;
+        while (first != last && isSeparator(*(last - 1)))
+            --last;
+        if (first == last)
+            return false;
+        result = 0;
+        for (; first != last; ++first)
+        {
+            if (*first < L'0' || *first > L'9')
+                return false;
+            result = result * 10 + (*first - L'0');
+        }
+        return true;
+    }
+
+    std::uint64_t roundUp8(std::uint64_t offset)
+    {
+        return (offset + 7) & ~std::uint64_t(7);
+    }
+
+    const char imageMagic[8] = { 'P', 'E', 'V', 'H', 'L', 'S', 'T', '\0' };
+}
+
+hashSet::hashSet(std::vector<std::wstring> const& lines, std::size_t digestLength)
+    : keyLength(digestLength)
+    , keyCount(0)
+    , keys(nullptr)
+    , bloom(nullptr)
+    , bloomMask(0)
+    , sizes(nullptr)
+    , sizeCount(0)
+{
+    if (!isSupportedDigestLength(keyLength))
+        throw std::invalid_argument("Unsupported digest length for a hash list.");
+    ownedKeys.resize(lines.size() * keyLength);
+    ownedSizes.reserve(lines.size());
+    bool everyEntryHasSize = true;
+    for (std::vector<std::wstring>::const_iterator it = lines.begin(); it != lines.end(); ++it)
+    {
+        std::wstring::const_iterator digestBegin = std::find_if_not(it->begin(), it->end(), isSeparator);
+        std::wstring::const_iterator digestEnd = std::find_if(digestBegin, it->end(), isSeparator);
+        if (!parseHexDigest(std::wstring(digestBegin, digestEnd), &ownedKeys[keyCount * keyLength], keyLength))
+            continue;
+        ++keyCount;
+        std::uint64_t fileSize;
+        if (everyEntryHasSize && parseSize(digestEnd, it->end(), fileSize))
+            ownedSizes.push_back(fileSize);
+        else
+            everyEntryHasSize = false;
+    }
+    ownedKeys.resize(keyCount * keyLength);
+    sortAndIndex(everyEntryHasSize);
+}
+
+hashSet::hashSet(std::vector<std::shared_ptr<hashSet> > const& sets)
+    : keyLength(sets.front()->digestLength())
+    , keyCount(0)
+    , keys(nullptr)
+    , bloom(nullptr)
+    , bloomMask(0)
+    , sizes(nullptr)
+    , sizeCount(0)
+{
+    bool everySetHasSizes = true;
+    for (std::vector<std::shared_ptr<hashSet> >::const_iterator it = sets.begin(); it != sets.end(); ++it)
+    {
+        hashSet const& source = **it;
+        if (source.keyLength != keyLength)
+            throw std::invalid_argument("Hash lists of different digest lengths cannot be merged.");
+        ownedKeys.insert(ownedKeys.end(), source.keys, source.keys + source.keyCount * keyLength);
+        if (source.sizes != nullptr)
+            ownedSizes.insert(ownedSizes.end(), source.sizes, source.sizes + source.sizeCount);
+        else
+            everySetHasSizes = false;
+    }
+    keyCount = ownedKeys.size() / keyLength;
+    sortAndIndex(everySetHasSizes);
+}
+
+//Sorts and deduplicates the keyCount keys in ownedKeys, and the sizes if they
+//are kept, then builds the Bloom filter over them.
+void hashSet::sortAndIndex(bool keepSizes)
+{
+    switch (keyLength)
+    {
+    case 16:
+        keyCount = sortAndUnique<16>(ownedKeys);
+        break;
+    case 20:
+        keyCount = sortAndUnique<20>(ownedKeys);
+        break;
+    case 28:
+        keyCount = sortAndUnique<28>(ownedKeys);
+        break;
+    case 32:
+        keyCount = sortAndUnique<32>(ownedKeys);
+        break;
+    case 48:
+        keyCount = sortAndUnique<48>(ownedKeys);
+        break;
+    case 64:
+        keyCount = sortAndUnique<64>(ownedKeys);
+        break;
+    default:
+        throw std::invalid_argument("Unsupported digest length for a hash list.");
+    }
+    ownedKeys.resize(keyCount * keyLength);
+    ownedKeys.shrink_to_fit();
+    keys = ownedKeys.data();
+
+    if (keepSizes && keyCount != 0)
+    {
+        std::sort(ownedSizes.begin(), ownedSizes.end());
+        ownedSizes.erase(std::unique(ownedSizes.begin(), ownedSizes.end()), ownedSizes.end());
+        ownedSizes.shrink_to_fit();
+        sizes = ownedSizes.data();
+        sizeCount = ownedSizes.size();
+    }
+    else
+    {
+        std::vector<std::uint64_t>().swap(ownedSizes);
+    }
+
+    buildBloom();
+}
+
+hashSet::hashSet(unsigned char const* image, std::size_t imageSize, std::shared_ptr<void const> backing_)
+    : keyLength(0)
+    , keyCount(0)
+    , keys(nullptr)
+    , bloom(nullptr)
+    , bloomMask(0)
+    , sizes(nullptr)
+    , sizeCount(0)
+    , backing(backing_)
+{
+    if (!isImage(image, imageSize))
+        throw std::runtime_error("The file is not a compiled hash list.");
+    imageHeader header;
+    std::memcpy(&header, image, sizeof(header));
+    if (header.version != IMAGE_VERSION)
+        throw std::runtime_error("The compiled hash list was made by an incompatible version of pevFind.");
+    if (!isSupportedDigestLength(header.digestLength) || header.bloomHashes != BLOOM_HASHES)
+        throw std::runtime_error("The compiled hash list header is corrupt.");
+
+    //Check that every section lies within the image before trusting it.
+    std::uint64_t const imageLength = imageSize;
+    std::uint64_t const keyBytes = header.keyCount * header.digestLength;
+    if (header.keyCount > imageLength / header.digestLength
+        || header.keysOffset % 8 || header.keysOffset > imageLength || keyBytes > imageLength - header.keysOffset
+        || header.bloomOffset % 8 || header.bloomOffset > imageLength || header.bloomWords > (imageLength - header.bloomOffset) / 8
+        || header.bloomWords == 0 || (header.bloomWords & (header.bloomWords - 1)) != 0)
+        throw std::runtime_error("The compiled hash list is truncated or corrupt.");
+    if (header.sizesOffset != 0
+        && (header.sizesOffset % 8 || header.sizesOffset > imageLength || header.sizeCount > (imageLength - header.sizesOffset) / 8))
+        throw std::runtime_error("The compiled hash list is truncated or corrupt.");
+
+    keyLength = header.digestLength;
+    keyCount = static_cast<std::size_t>(header.keyCount);
+    keys = image + header.keysOffset;
+    bloom = reinterpret_cast<std::uint64_t const*>(image + header.bloomOffset);
+    bloomMask = header.bloomWords * 64 - 1;
+    if (header.sizesOffset != 0)
+    {
+        sizes = reinterpret_cast<std::uint64_t const*>(image + header.sizesOffset);
+        sizeCount = static_cast<std::size_t>(header.sizeCount);
+    }
+
+    //Both searches need strictly ascending keys and sizes; a hand made or
+    //damaged list would otherwise give wrong answers rather than an error.
+    for (std::size_t idx = 1; idx < keyCount; ++idx)
+        if (std::memcmp(keyAt(idx - 1), keyAt(idx), keyLength) >= 0)
+            throw std::runtime_error("The compiled hash list is not sorted.");
+    for (std::size_t idx = 1; idx < sizeCount; ++idx)
+        if (sizes[idx - 1] >= sizes[idx])
+            throw std::runtime_error("The compiled hash list is not sorted.");
+}
+
+bool hashSet::isImage(unsigned char const* image, std::size_t imageSize)
+{
+    return imageSize >= sizeof(imageHeader) && std::memcmp(image, imageMagic, sizeof(imageMagic)) == 0;
+}
+
+bool hashSet::isSupportedDigestLength(std::size_t length)
+{
+    switch (length)
+    {
+    case 16:
+    case 20:
+    case 28:
+    case 32:
+    case 48:
+    case 64:
+        return true;
+    default:
+        return false;
+    }
+}
+
+hashSet::imageHeader hashSet::makeImageHeader() const
+{
+    imageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, imageMagic, sizeof(imageMagic));
+    header.version = IMAGE_VERSION;
+    header.digestLength = static_cast<std::uint32_t>(keyLength);
+    header.bloomHashes = BLOOM_HASHES;
+    header.keyCount = keyCount;
+    header.keysOffset = roundUp8(sizeof(imageHeader));
+    header.bloomOffset = roundUp8(header.keysOffset + header.keyCount * keyLength);
+    header.bloomWords = (bloomMask + 1) / 64;
+    if (sizes != nullptr)
+    {
+        header.sizesOffset = header.bloomOffset + header.bloomWords * 8;
+        header.sizeCount = sizeCount;
+    }
+    return header;
+}
+
+void hashSet::buildBloom()
+{
+    std::uint64_t bits = 64;
+    while (bits < static_cast<std::uint64_t>(keyCount) * BLOOM_BITS_PER_KEY)
+        bits <<= 1;
+    bloomMask = bits - 1;
+    ownedBloom.assign(static_cast<std::size_t>(bits / 64), 0);
+    for (std::size_t idx = 0; idx < keyCount; ++idx)
+    {
+        unsigned char const* key = keyAt(idx);
+        std::uint64_t h1 = wordAt(key, 0);
+        std::uint64_t h2 = wordAt(key, 8) | 1;
+        for (int hashIdx = 0; hashIdx < BLOOM_HASHES; ++hashIdx)
+        {
+            std::uint64_t bit = (h1 + hashIdx * h2) & bloomMask;
+            ownedBloom[static_cast<std::size_t>(bit >> 6)] |= std::uint64_t(1) << (bit & 63);
+        }
+    }
+    bloom = ownedBloom.data();
+}
+
+bool hashSet::mayContainSize(std::uint64_t size) const
+{
+    if (sizes == nullptr)
+        return true;
+    return std::binary_search(sizes, sizes + sizeCount, size);
+}
+
+bool hashSet::bloomMayContain(unsigned char const* digest) const
+{
+    std::uint64_t h1 = wordAt(digest, 0);
+    std::uint64_t h2 = wordAt(digest, 8) | 1;
+    for (int hashIdx = 0; hashIdx < BLOOM_HASHES; ++hashIdx)
+    {
+        std::uint64_t bit = (h1 + hashIdx * h2) & bloomMask;
+        if (!(bloom[static_cast<std::size_t>(bit >> 6)] & (std::uint64_t(1) << (bit & 63))))
+            return false;
+    }
+    return true;
+}
+
+bool hashSet::searchKeys(unsigned char const* digest) const
+{
+    if (keyCount == 0)
+        return false;
+    std::size_t lo = 0;
+    std::size_t hi = keyCount - 1;
+    std::uint64_t target = prefixOf(digest);
+
+    //Interpolation search. Because the keys are uniformly distributed this
+    //lands within a few entries of the target in a couple of probes; if it
+    //does not converge quickly we finish with an ordinary binary search.
+    for (int probes = 0; probes < 4 && lo < hi; ++probes)
+    {
+        std::uint64_t loPrefix = prefixOf(keyAt(lo));
+        std::uint64_t hiPrefix = prefixOf(keyAt(hi));
+        if (target < loPrefix || target > hiPrefix)
+            return false;
+        if (hiPrefix == loPrefix)
+            break;
+        double fraction = static_cast<double>(target - loPrefix) / static_cast<double>(hiPrefix - loPrefix);
+        std::size_t probe = lo + static_cast<std::size_t>(fraction * static_cast<double>(hi - lo));
+        int comparison = std::memcmp(keyAt(probe), digest, keyLength);
+        if (comparison == 0)
+            return true;
+        if (comparison < 0)
+            lo = probe + 1;
+        else if (probe == 0)
+            return false;
+        else
+            hi = probe - 1;
+    }
+
+    while (lo <= hi)
+    {
+        std::size_t middle = lo + (hi - lo) / 2;
+        int comparison = std::memcmp(keyAt(middle), digest, keyLength);
+        if (comparison == 0)
+            return true;
+        if (comparison < 0)
+            lo = middle + 1;
+        else if (middle == 0)
+            return false;
+        else
+            hi = middle - 1;
+    }
+    return false;
+}
+
+bool hashSet::contains(unsigned char const* digest) const
+{
+    return bloomMayContain(digest) && searchKeys(digest);
+}
+
+bool hashSet::parseHexDigest(std::wstring const& hex, unsigned char* target, std::size_t length)
+{
+    std::wstring::const_iterator first = hex.begin();
+    std::wstring::const_iterator last = hex.end();
+    while (first != last && (*first == L' ' || *first == L'\t'))
+        ++first;
+    while (first != last && (*(last - 1) == L' ' || *(last - 1) == L'\t'))
+        --last;
+    if (static_cast<std::size_t>(last - first) != length * 2)
+        return false;
+    for (std::size_t idx = 0; idx < length; ++idx)
+    {
+        int high = hexValue(*first++);
+        int low = hexValue(*first++);
+        if (high < 0 || low < 0)
+            return false;
+        target[idx] = static_cast<unsigned char>((high << 4) | low);
+    }
+    return true;
+}
+
+std::wstring hashSet::formatHexDigest(unsigned char const* digest, std::size_t length)
+{
+    static const wchar_t hexDigits[] = L"0123456789ABCDEF";
+    std::wstring result(length * 2, L'0');
+    for (std::size_t idx = 0; idx < length; ++idx)
+    {
+        result[idx * 2] = hexDigits[digest[idx] >> 4];
+        result[idx * 2 + 1] = hexDigits[digest[idx] & 0x0F];
+    }
+    return result;
+}
@@ -0,0 +1,143 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// hashSet.h -- A compact set of fixed width binary digests used by the
+// hash list criteria. Digests are packed and sorted in one flat array,
+// and a Bloom filter sits in front of the array so that most misses
+// never touch the keys at all.
+//
+// The set can either own its storage (when built from a text list) or
+// sit directly on top of a compiled hash list image, such as a mapped
+// view of a file written by HASHLIST COMPILE.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+
+class hashSet
+{
+public:
+    //On disk header of a compiled hash list. All fields are little endian,
+    //and every section begins on an 8 byte boundary.
+    struct imageHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t digestLength;
+        std::uint32_t bloomHashes;
+        std::uint32_t reserved;
+        std::uint64_t keyCount;
+        std::uint64_t keysOffset;
+        std::uint64_t bloomOffset;
+        std::uint64_t bloomWords;
+        std::uint64_t sizesOffset; //Zero if the list carries no file sizes
+        std::uint64_t sizeCount;
+    };
+    enum
+    {
+        IMAGE_VERSION = 1,
+        BLOOM_BITS_PER_KEY = 10,
+        BLOOM_HASHES = 7
+    };
+private:
+    std::size_t keyLength;
+    std::size_t keyCount;
+    unsigned char const* keys;
+    std::uint64_t const* bloom;
+    std::uint64_t bloomMask;
+    std::uint64_t const* sizes;
+    std::size_t sizeCount;
+
+    //Storage used when the set is built in memory
+    std::vector<unsigned char> ownedKeys;
+    std::vector<std::uint64_t> ownedBloom;
+    std::vector<std::uint64_t> ownedSizes;
+    //Keeps a mapped image alive when the set is built over one
+    std::shared_ptr<void const> backing;
+    //keys, bloom and sizes point into the storage above, which a copy would
+    //not own
+    hashSet(const hashSet&);
+    hashSet& operator=(const hashSet&);
+
+    void sortAndIndex(bool keepSizes);
+    void buildBloom();
+    bool bloomMayContain(unsigned char const* digest) const;
+    bool searchKeys(unsigned char const* digest) const;
+public:
+    //Builds the set from the lines of a text hash list. Each line holds a hex
+    //digest, optionally followed by whitespace or a comma and the file size in
+    //bytes. Lines which are not valid digests of the requested length (such as
+    //blank lines) are ignored. Sizes are only kept if every entry has one.
+    hashSet(std::vector<std::wstring> const& lines, std::size_t digestLength);
+
+    //Builds the union of several sets of the same digest length; used when
+    //the criteria of one OR are merged. Sizes are kept if every set has them.
+    hashSet(std::vector<std::shared_ptr<hashSet> > const& sets);
+
+    //Builds the set on top of a compiled image without copying it. backing
+    //is held for the lifetime of the set. Throws std::runtime_error if the
+    //image is malformed, including keys or sizes out of order.
+    hashSet(unsigned char const* image, std::size_t imageSize, std::shared_ptr<void const> backing);
+
+    //Returns true if the digestLength() bytes at digest are a member of the set.
+    bool contains(unsigned char const* digest) const;
+    //Returns false only if the list records sizes and no entry has this size;
+    //lets callers skip hashing files which cannot possibly match.
+    bool mayContainSize(std::uint64_t size) const;
+
+    std::size_t size() const { return keyCount; }
+    std::size_t digestLength() const { return keyLength; }
+    bool hasSizes() const { return sizes != nullptr; }
+    unsigned char const* keyAt(std::size_t idx) const { return keys + idx * keyLength; }
+
+    //Compiled image support
+    imageHeader makeImageHeader() const;
+    unsigned char const* keyData() const { return keys; }
+    std::uint64_t const* bloomData() const { return bloom; }
+    std::uint64_t const* sizeData() const { return sizes; }
+    static bool isImage(unsigned char const* image, std::size_t imageSize);
+    //Passes the compiled image to write(data, length) one section at a time,
+    //in file order, so that large lists are never copied into one buffer.
+    template <typename writer> void writeImage(writer& write) const;
+
+    //Decides a hash list criterion for one file. hashFile(digest) stores
+    //digestLength() bytes and returns false if the file cannot be read; such
+    //files match only if matchUnreadable is set. An OR ERROR list must hash
+    //files of any size to find the unreadable ones, so only the other lists
+    //skip files of sizes the list does not hold.
+    template <typename hasher> bool matchFile(std::uint64_t fileSize, bool matchUnreadable, hasher hashFile) const;
+    //True for the lengths of MD5, SHA-1 and the SHA-2 family: 16, 20, 28,
+    //32, 48 and 64 bytes
+    static bool isSupportedDigestLength(std::size_t length);
+
+    static bool parseHexDigest(std::wstring const& hex, unsigned char* target, std::size_t length);
+    static std::wstring formatHexDigest(unsigned char const* digest, std::size_t length);
+};
+
+template <typename writer> void hashSet::writeImage(writer& write) const
+{
+    static const unsigned char padding[8] = {};
+    imageHeader const header(makeImageHeader());
+    std::uint64_t const keyBytes = header.keyCount * header.digestLength;
+    write(&header, sizeof(header));
+    write(padding, header.keysOffset - sizeof(header));
+    write(keys, keyBytes);
+    write(padding, header.bloomOffset - header.keysOffset - keyBytes);
+    write(bloom, header.bloomWords * 8);
+    if (header.sizesOffset)
+        write(sizes, header.sizeCount * 8);
+}
+
+template <typename hasher> bool hashSet::matchFile(std::uint64_t fileSize, bool matchUnreadable, hasher hashFile) const
+{
+    if (!matchUnreadable && !mayContainSize(fileSize))
+        return false;
+    unsigned char digest[64];
+    if (!hashFile(digest))
+        return matchUnreadable;
+    return contains(digest);
+}
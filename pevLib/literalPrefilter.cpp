@@ -0,0 +1,281 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// literalPrefilter.cpp -- Implements the required literal search.
+
+#include "pch.hpp"
+#include <cwchar>
+#include "literalPrefilter.h"
+
+//The vector scan compares eight 16 bit characters at once, so it needs the
+//two byte wchar_t of Windows.
+#if (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)) && WCHAR_MAX == 0xFFFF
+#include <emmintrin.h>
+#define PEV_PREFILTER_SSE2
+#endif
+
+namespace {
+
+    bool isAsciiLetter(wchar_t character)
+    {
+        return (character >= L'a' && character <= L'z') || (character >= L'A' && character <= L'Z');
+    }
+
+    bool isAsciiDigit(wchar_t character)
+    {
+        return character >= L'0' && character <= L'9';
+    }
+
+    bool isHexDigit(wchar_t character)
+    {
+        return isAsciiDigit(character) || (character >= L'a' && character <= L'f') || (character >= L'A' && character <= L'F');
+    }
+
+    //Whether character can be the character at position in a case insensitive
+    //match of the (lowercase) literal. The regex folds case with the runtime's
+    //locale, so any non-ASCII character might stand for an ASCII letter.
+    bool sameLetter(wchar_t character, wchar_t literal)
+    {
+        if (character == literal)
+            return true;
+        return isAsciiLetter(literal) && (character == literal - (L'a' - L'A') || character >= 0x80);
+    }
+
+    //Moves idx past the group or class starting at it; returns false if it
+    //is not closed
+    bool skipBracketed(const std::wstring& regex, std::size_t& idx)
+    {
+        std::size_t depth = 0;
+        while (idx < regex.size())
+        {
+            wchar_t character = regex[idx++];
+            if (character == L'\\')
+                ++idx;
+            else if (character == L'[')
+            {
+                //A ] first in a class is one of its characters
+                if (idx < regex.size() && regex[idx] == L'^')
+                    ++idx;
+                if (idx < regex.size() && regex[idx] == L']')
+                    ++idx;
+                while (idx < regex.size() && regex[idx] != L']')
+                    idx += regex[idx] == L'\\' ? 2 : 1;
+                if (idx >= regex.size())
+                    return false;
+                ++idx;
+                if (depth == 0)
+                    return true;
+            }
+            else if (character == L'(')
+                ++depth;
+            else if (character == L')')
+            {
+                if (depth == 0)
+                    return false;
+                if (--depth == 0)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    //Reads a {n}, {n,} or {n,m} quantifier after its {. Returns false if the
+    //brace does not start one.
+    bool readRepeat(const std::wstring& regex, std::size_t& idx, bool& optional)
+    {
+        std::size_t position = idx;
+        if (position == regex.size() || !isAsciiDigit(regex[position]))
+            return false;
+        optional = true;
+        for (; position < regex.size() && isAsciiDigit(regex[position]); ++position)
+            optional = optional && regex[position] == L'0';
+        if (position < regex.size() && regex[position] == L',')
+            for (++position; position < regex.size() && isAsciiDigit(regex[position]); ++position)
+                ;
+        if (position == regex.size() || regex[position] != L'}')
+            return false;
+        idx = position + 1;
+        return true;
+    }
+
+    void endRun(std::wstring& run, std::wstring& longest)
+    {
+        if (run.size() > longest.size())
+            longest = run;
+        run.clear();
+    }
+
+}
+
+//Reads the top level of the regex, collecting runs of plain ASCII characters
+//which are not repeated zero times. Anything the scan does not understand,
+//and any top level alternation, leaves no literal at all.
+literalPrefilter::literalPrefilter(const std::wstring& regex)
+{
+    std::wstring run;
+    //The last character of run is the last thing read, so a quantifier
+    //applies to it alone
+    bool lastInRun = false;
+    std::size_t idx = 0;
+    while (idx < regex.size())
+    {
+        wchar_t character = regex[idx++];
+        bool optional = false;
+        switch (character)
+        {
+        case L'(':
+            //Inline options such as (?x) change how the rest is read
+            if (idx + 1 < regex.size() && regex[idx] == L'?' && std::wstring(L":=!<").find(regex[idx + 1]) == std::wstring::npos)
+            {
+                literal.clear();
+                return;
+            }
+            --idx;
+            if (!skipBracketed(regex, idx))
+            {
+                literal.clear();
+                return;
+            }
+            endRun(run, literal);
+            lastInRun = false;
+            break;
+        case L'[':
+            --idx;
+            if (!skipBracketed(regex, idx))
+            {
+                literal.clear();
+                return;
+            }
+            endRun(run, literal);
+            lastInRun = false;
+            break;
+        case L'\\':
+            if (idx == regex.size())
+            {
+                literal.clear();
+                return;
+            }
+            character = regex[idx++];
+            if (character < 0x80 && !isAsciiLetter(character) && !isAsciiDigit(character))
+            {
+                run.push_back(character);
+                lastInRun = true;
+                break;
+            }
+            if (character == L'x' || character == L'u')
+            {
+                //Hex escapes; skip their digits
+                if (idx < regex.size() && regex[idx] == L'{')
+                    while (idx < regex.size() && regex[idx++] != L'}')
+                        ;
+                else
+                    for (std::size_t digits = character == L'x' ? 2 : 4; digits && idx < regex.size() && isHexDigit(regex[idx]); --digits)
+                        ++idx;
+            }
+            else if (isAsciiDigit(character))
+            {
+                //Backreferences and octal escapes
+                while (idx < regex.size() && isAsciiDigit(regex[idx]))
+                    ++idx;
+            }
+            else if (std::wstring(L"dDwWsSbBAzZGtnrfvae").find(character) == std::wstring::npos)
+            {
+                literal.clear();
+                return;
+            }
+            endRun(run, literal);
+            lastInRun = false;
+            break;
+        case L'{':
+            if (!readRepeat(regex, idx, optional))
+            {
+                literal.clear();
+                return;
+            }
+            //Fall through
+        case L'*':
+        case L'?':
+            if (character != L'{')
+                optional = true;
+            if (optional && lastInRun)
+                run.erase(run.size() - 1);
+            //Fall through
+        case L'+':
+            //Lazy and possessive forms
+            if (idx < regex.size() && (regex[idx] == L'?' || regex[idx] == L'+'))
+                ++idx;
+            endRun(run, literal);
+            lastInRun = false;
+            break;
+        case L'.':
+        case L'^':
+        case L'$':
+            endRun(run, literal);
+            lastInRun = false;
+            break;
+        case L'|':
+        case L')':
+            literal.clear();
+            return;
+        default:
+            if (character >= 0x80)
+            {
+                endRun(run, literal);
+                lastInRun = false;
+                break;
+            }
+            if (isAsciiLetter(character))
+                character |= 0x20;
+            run.push_back(character);
+            lastInRun = true;
+            break;
+        }
+    }
+    endRun(run, literal);
+}
+
+bool literalPrefilter::mayMatch(const wchar_t *data, std::size_t textLength) const
+{
+    std::size_t const length = literal.size();
+    if (length == 0)
+        return true;
+    if (textLength < length)
+        return false;
+    std::size_t const last = textLength - length;
+    wchar_t const first = literal[0];
+#if defined(PEV_PREFILTER_SSE2)
+    __m128i const lower = _mm_set1_epi16(static_cast<short>(first));
+    __m128i const upper = _mm_set1_epi16(static_cast<short>(isAsciiLetter(first) ? first - (L'a' - L'A') : first));
+    __m128i const wide = _mm_set1_epi16(static_cast<short>(isAsciiLetter(first) ? 0xFF80 : 0));
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const ones = _mm_cmpeq_epi16(zero, zero);
+#endif
+    std::size_t idx = 0;
+    while (idx <= last)
+    {
+#if defined(PEV_PREFILTER_SSE2)
+        //Skip eight characters at a time while none can start the literal
+        for (; idx + 8 <= last + 1; idx += 8)
+        {
+            __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + idx));
+            __m128i hits = _mm_or_si128(_mm_cmpeq_epi16(block, lower), _mm_cmpeq_epi16(block, upper));
+            hits = _mm_or_si128(hits, _mm_andnot_si128(_mm_cmpeq_epi16(_mm_and_si128(block, wide), zero), ones));
+            if (_mm_movemask_epi8(hits))
+                break;
+        }
+#endif
+        for (; idx <= last && !sameLetter(data[idx], first); ++idx)
+            ;
+        if (idx > last)
+            return false;
+        std::size_t matched = 1;
+        while (matched < length && sameLetter(data[idx + matched], literal[matched]))
+            ++matched;
+        if (matched == length)
+            return true;
+        ++idx;
+    }
+    return false;
+}
@@ -0,0 +1,24 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// literalPrefilter.h -- Rules out paths which cannot match a -preg or -lreg
+// regex before the regex runs. Most regexes have a run of plain characters
+// which every match contains, such as ".dll" in \\system32\\.*\.dll$. The
+// longest such run is found when the regex is compiled, and paths which do
+// not contain it, ignoring case, are rejected by a vectorized search.
+#pragma once
+#include <string>
+
+class literalPrefilter
+{
+    //The run, in lowercase ASCII; empty if the regex has none
+    std::wstring literal;
+public:
+    explicit literalPrefilter(const std::wstring& regex);
+    //False only if no match of the regex can be found in the length
+    //characters at text
+    bool mayMatch(const wchar_t *text, std::size_t length) const;
+    const std::wstring& getLiteral() const { return literal; }
+};
@@ -16,18 +16,67 @@
 #include "regex.h"
 #include "fileData.h"
 #include "zipIt.h"
+#include "entryBlock.h"
+#include "directoryFilter.h"
+#include "criterion.h"
 
 namespace scanners
 {
 
     void recursiveScanner::scan()
     {
-        HANDLE hFind;
-        WIN32_FIND_DATA findData;
         bool fastEcho = (!globalOptions::sortMethod[0]) && globalOptions::zipFileName.empty(); //cache whether we're able to output quickly or not
 
         //Create a list to hold our results
         std::list<FileData> results;
+        walk(results, fastEcho);
+
+        //If we're sorting, sort and print the results
+        if (globalOptions::sortMethod[0])
+        {
+            results.sort();
+            for(std::list<FileData>::iterator it = results.begin(); it != results.end(); it++)
+            {
+                it->write();
+            }
+        }
+        if (!globalOptions::zipFileName.empty()) //If there's a zip file name, do the zip.
+            zipIt(globalOptions::zipFileName, results);
+        printSummary();
+    }
+
+    void recursiveScanner::collect(std::list<FileData>& results)
+    {
+        walk(results, false);
+    }
+
+    //Filters a block of entries through the tree and prints or stores the
+    //survivors; only their records are made.
+    static void flushBlock(entryBlock& block, entryBlock::selection& rows, std::list<FileData>& results, bool fastEcho)
+    {
+        block.selectAll(rows);
+        globalOptions::logicalTree->filterBlock(block, rows);
+        for (entryBlock::selection::const_iterator it = rows.begin(); it != rows.end(); it++)
+        {
+            FileData& currentFile = block.materialize(*it);
+            //If we're sorting, store the file into the results list for sorting later.
+            //Otherwise just print it now
+            if (fastEcho)
+                currentFile.write();
+            else
+                results.push_back(currentFile);
+        }
+    }
+
+    void recursiveScanner::walk(std::list<FileData>& results, bool fastEcho)
+    {
+        HANDLE hFind;
+        WIN32_FIND_DATA findData;
+        //Entries are filtered a block at a time
+        entryBlock block;
+        entryBlock::selection rows;
+        //Which subdirectories to descend into, decided once per trie node
+        directoryFilter directories(*globalOptions::logicalTree);
 
         //This list is a queue of remaining folders to scan. Initialized with the common root of the regexes
         std::list<std::wstring> foldersToScan;
@@ -86,48 +135,35 @@ namespace scanners
             }
             std::list<std::wstring>::iterator insPos = foldersToScan.begin();
             insPos++;
+            block.reset(currentSearchDirectory);
             do { //Loop through the current directory
-                FileData currentFile(findData, currentSearchDirectory);
                 //If it's a directory and it passes the tree's directory check,
                 //add it to the list of directories to search
                 if (!globalOptions::noSubDirectories)
                 {
-                    if (currentFile.isDirectory() && !currentFile.isReparsePoint())
+                    if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && !(findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
                     {    
-                        if (globalOptions::logicalTree->directoryCheck(currentFile.getFileName()))
+                        std::wstring newDir(currentSearchDirectory);
+                        newDir.append(findData.cFileName);
+                        if (directories.check(newDir))
                         {
-                            std::wstring newDir(currentFile.getFileName());
                             newDir.append(L"\\*");
                             foldersToScan.insert(insPos,newDir);
                         }
                     }
                 }
-                //If the tree says this file doesn't match, go ahead and check the next one
-                if (!globalOptions::logicalTree->include(currentFile))
-                    continue;
-                //If we're sorting, store the file into the results list for sorting later.
-                //Otherwise just print it now
-                if (fastEcho)
-                    currentFile.write();
-                else
-                    results.push_back(currentFile);
+                block.add(findData);
+                if (block.full())
+                {
+                    flushBlock(block, rows, results, fastEcho);
+                    block.reset(currentSearchDirectory);
+                }
             } while (FindNextFile(hFind,&findData)); //While there's anything left
+            flushBlock(block, rows, results, fastEcho);
             FindClose(hFind);
             disable64.enableFS();
             foldersToScan.pop_front();
         } while(!foldersToScan.empty()); //Go until the queue is empty
-        //If we're sorting, sort and print the results
-        if (globalOptions::sortMethod[0])
-        {
-            results.sort();
-            for(std::list<FileData>::iterator it = results.begin(); it != results.end(); it++)
-            {
-                it->write();
-            }
-        }
-        if (!globalOptions::zipFileName.empty()) //If there's a zip file name, do the zip.
-            zipIt(globalOptions::zipFileName, results);
-        printSummary();
     }
 
     std::wstring getRegexesCommonRoot(std::vector<std::shared_ptr<regexClass> >& targets)
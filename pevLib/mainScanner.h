@@ -9,6 +9,7 @@
 // the one used by default. It recurses into subdirectories
 #include <string>
 #include <vector>
+#include <list>
 #include "regex.h"
 class FileData;
 
@@ -18,8 +19,11 @@ namespace scanners
     void printSummary();
     class recursiveScanner
     {    
+        void walk(std::list<FileData>& results, bool fastEcho);
     public:
         void scan();
+        //Stores every match in results instead of printing it
+        void collect(std::list<FileData>& results);
     };
 };
 #endif
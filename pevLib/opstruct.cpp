@@ -1,19 +1,65 @@
 #include "pch.hpp"
 #include <string>
+#include <functional>
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/lexical_cast.hpp>
 #include "opstruct.h"
+#include "compiledCriteria.h"
+#include "simplify.h"
 
 std::wstring operation::debugTreeInternal(const std::wstring& curOp) const
+{
+    return describeInternal(curOp, &criterion::debugTree);
+}
+std::wstring operation::identityInternal(const std::wstring& curOp) const
+{
+    return describeInternal(curOp, &criterion::identity);
+}
+std::wstring operation::describeInternal(const std::wstring& curOp, describer describe) const
 {
     std::wstring dbgMsg(L"- ");
     dbgMsg.append(curOp);
     dbgMsg.append(L"\r\n");
-    dbgMsg.append(operandA->debugTree());
+    dbgMsg.append(((*operandA).*describe)());
     dbgMsg.append(L"\r\n");
-    dbgMsg.append(operandB->debugTree());
+    dbgMsg.append(((*operandB).*describe)());
+    boost::algorithm::replace_all(dbgMsg, L"\r\n", L"\r\n   ");
+    return dbgMsg;
+}
+//Shared by the nodes which use an adaptiveOrder: lists the operands in the
+//order they ended up being evaluated, each with its measurements.
+static std::wstring explainOrdered(const std::wstring& curOp, const adaptiveOrder& ordering, criterion* const* operands)
+{
+    std::wstring dbgMsg(L"- ");
+    dbgMsg.append(curOp);
+    dbgMsg.append(L" (reordered ");
+    dbgMsg.append(boost::lexical_cast<std::wstring>(ordering.getReorderCount()));
+    dbgMsg.append(L" times)");
+    const std::vector<std::size_t>& order = ordering.getOrder();
+    for (std::vector<std::size_t>::const_iterator it = order.begin(); it != order.end(); it++)
+    {
+        dbgMsg.append(L"\r\n");
+        dbgMsg.append(ordering.describe(*it));
+        dbgMsg.append(operands[*it]->explainTree());
+    }
     boost::algorithm::replace_all(dbgMsg, L"\r\n", L"\r\n   ");
     return dbgMsg;
 }
+std::wstring operation::explainTreeInternal(const std::wstring& curOp, const adaptiveOrder& ordering) const
+{
+    criterion * const operands[] = { operandA.get(), operandB.get() };
+    return explainOrdered(curOp, ordering, operands);
+}
+//The directoryCheck of a node which matches when either of two operands
+//does: files below can only be ruled out if both operands rule them out.
+static unsigned int combineAlternatives(unsigned int resA, unsigned int resB)
+{
+    if (resA == DIRECTORY_EXCLUDE && resB == DIRECTORY_EXCLUDE)
+        return DIRECTORY_EXCLUDE;
+    if (resA == DIRECTORY_INCLUDE || resB == DIRECTORY_INCLUDE)
+        return DIRECTORY_INCLUDE;
+    return DIRECTORY_DONTCARE;
+}
 void operation::reorderTree()
 {
     if (operandA->getPriorityClass() > operandB->getPriorityClass())
@@ -33,11 +79,15 @@ unsigned __int32 operation::getPriorityClass() const
 };
 operation::operation(std::shared_ptr<criterion> a, std::shared_ptr<criterion> b) : operandA(a), operandB(b)
 {}
+void andAndClass::reorderTree()
+{
+    operation::reorderTree();
+    ordering.reset(2);
+}
 BOOL andAndClass::include(FileData &file) const
 {
-    if (this->operandA->include(file) && this->operandB->include(file))
-        return true;
-    return false;
+    criterion * const operands[] = { operandA.get(), operandB.get() };
+    return ordering.evaluate(operands, file);
 }
 unsigned int andAndClass::directoryCheck(const std::wstring& directory) const
 {
@@ -52,39 +102,55 @@ unsigned int andAndClass::directoryCheck(const std::wstring& directory) const
         return resA;
     return resA && resB;
 }
-andAndClass::andAndClass(std::shared_ptr<criterion> a, std::shared_ptr<criterion> b) : operation(a, b)
-{}
+andAndClass::andAndClass(std::shared_ptr<criterion> a, std::shared_ptr<criterion> b) : operation(a, b), ordering(false)
+{
+    ordering.reset(2);
+}
 std::wstring andAndClass::debugTree() const
 {
     return debugTreeInternal(L"AND");
 }
+std::wstring andAndClass::identity() const
+{
+    return identityInternal(L"AND");
+}
+std::wstring andAndClass::explainTree() const
+{
+    return explainTreeInternal(L"AND", ordering);
+}
+void orAndClass::reorderTree()
+{
+    operation::reorderTree();
+    ordering.reset(2);
+}
 BOOL orAndClass::include(FileData &file) const
 {
-    if (this->operandA->include(file))
-        return true;
-    if (this->operandB->include(file))
-        return true;
-    return false;
+    criterion * const operands[] = { operandA.get(), operandB.get() };
+    return ordering.evaluate(operands, file);
 }
 unsigned int orAndClass::directoryCheck(const std::wstring& directory) const
 {
     unsigned int resA, resB;
     resA = operandA->directoryCheck(directory);
     resB = operandB->directoryCheck(directory);
-    if (resA == DIRECTORY_DONTCARE && resB == DIRECTORY_DONTCARE)
-        return DIRECTORY_DONTCARE;
-    if (resA == DIRECTORY_DONTCARE)
-        return resB;
-    if (resB == DIRECTORY_DONTCARE)
-        return resA;
-    return resA || resB;
+    return combineAlternatives(resA, resB);
+}
+orAndClass::orAndClass(std::shared_ptr<criterion> a, std::shared_ptr<criterion> b) : operation(a, b), ordering(true)
+{
+    ordering.reset(2);
 }
-orAndClass::orAndClass(std::shared_ptr<criterion> a, std::shared_ptr<criterion> b) : operation(a, b)
-{}
 std::wstring orAndClass::debugTree() const
 {
     return debugTreeInternal(L"OR");
 }
+std::wstring orAndClass::identity() const
+{
+    return identityInternal(L"OR");
+}
+std::wstring orAndClass::explainTree() const
+{
+    return explainTreeInternal(L"OR", ordering);
+}
 BOOL xorAndClass::include(FileData &file) const
 {
     BOOL resA = this->operandA->include(file);
@@ -96,13 +162,7 @@ unsigned int xorAndClass::directoryCheck(const std::wstring& directory) const
     unsigned int resA, resB;
     resA = operandA->directoryCheck(directory);
     resB = operandB->directoryCheck(directory);
-    if (resA == DIRECTORY_DONTCARE && resB == DIRECTORY_DONTCARE)
-        return DIRECTORY_DONTCARE;
-    if (resA == DIRECTORY_DONTCARE)
-        return resB;
-    if (resB == DIRECTORY_DONTCARE)
-        return resA;
-    return (resA || resB) && !(resA && resB);
+    return combineAlternatives(resA, resB);
 }
 xorAndClass::xorAndClass(std::shared_ptr<criterion> a, std::shared_ptr<criterion> b) : operation(a, b)
 {}
@@ -110,6 +170,20 @@ std::wstring xorAndClass::debugTree() const
 {
     return debugTreeInternal(L"XOR");
 }
+std::wstring xorAndClass::identity() const
+{
+    return identityInternal(L"XOR");
+}
+std::wstring xorAndClass::explainTree() const
+{
+    //Both operands are always evaluated, so there is no order to explain.
+    std::wstring dbgMsg(L"- XOR\r\n");
+    dbgMsg.append(operandA->explainTree());
+    dbgMsg.append(L"\r\n");
+    dbgMsg.append(operandB->explainTree());
+    boost::algorithm::replace_all(dbgMsg, L"\r\n", L"\r\n   ");
+    return dbgMsg;
+}
 void notAndClass::reorderTree()
 {
     operand->reorderTree();
@@ -137,15 +211,34 @@ unsigned int notAndClass::directoryCheck(const std::wstring& directory) const
 notAndClass::notAndClass(std::shared_ptr<criterion> a) : operand(a)
 {}
 std::wstring notAndClass::debugTree() const
+{
+    return describeInternal(&criterion::debugTree);
+}
+std::wstring notAndClass::identity() const
+{
+    return describeInternal(&criterion::identity);
+}
+std::wstring notAndClass::describeInternal(describer describe) const
+{
+    std::wstring dbgMsg(L"- NOT\r\n");
+    dbgMsg.append(((*operand).*describe)());
+    boost::algorithm::replace_all(dbgMsg, L"\r\n", L"\r\n   ");
+    return dbgMsg;
+}
+std::wstring notAndClass::explainTree() const
 {
     std::wstring dbgMsg(L"- NOT\r\n");
-    dbgMsg.append(operand->debugTree());
+    dbgMsg.append(operand->explainTree());
     boost::algorithm::replace_all(dbgMsg, L"\r\n", L"\r\n   ");
     return dbgMsg;
 }
 void bracketClass::reorderTree()
 {
-    std::sort(expr.begin(), expr.end(),criterionByPriorityClass);
+    std::stable_sort(expr.begin(), expr.end(),criterionByPriorityClass);
+    for (std::vector<std::shared_ptr<criterion> >::iterator it = expr.begin(); it != expr.end(); it++)
+        (*it)->reorderTree();
+    std::transform(expr.begin(), expr.end(), operands.begin(), std::mem_fn(&std::shared_ptr<criterion>::get));
+    ordering.reset(operands.size());
 }
 unsigned __int32 bracketClass::getPriorityClass() const
 {
@@ -157,19 +250,17 @@ unsigned __int32 bracketClass::getPriorityClass() const
 }
 BOOL bracketClass::include(FileData &file) const
 {
-    for (register unsigned int idx = 0; idx < expr.size(); idx++)
-        if (!expr[idx]->include(file))
-            return FALSE;
-    return TRUE;
+    return ordering.evaluate(&operands[0], file);
 }
-unsigned int bracketClass::directoryCheck(const std::wstring& directory)
+unsigned int bracketClass::directoryCheck(const std::wstring& directory) const
 {
     bool allDontcares = true;
     for (register unsigned int idx = 0; idx < expr.size(); idx++)
     {
-        if (!expr[idx]->directoryCheck(directory))
+        unsigned int result = expr[idx]->directoryCheck(directory);
+        if (!result)
             return DIRECTORY_EXCLUDE;
-        if (expr[idx]->directoryCheck(directory) == DIRECTORY_INCLUDE)
+        if (result == DIRECTORY_INCLUDE)
             allDontcares = false;
     }
     if (allDontcares)
@@ -177,22 +268,36 @@ unsigned int bracketClass::directoryCheck(const std::wstring& directory)
     else
         return DIRECTORY_INCLUDE;
 }
-bracketClass::bracketClass(std::vector<std::shared_ptr<criterion> > exprA): expr(exprA)
+bracketClass::bracketClass(std::vector<std::shared_ptr<criterion> > exprA): expr(exprA), operands(exprA.size()), ordering(false)
 { 
     assert(expr.size() > 1);
+    std::transform(expr.begin(), expr.end(), operands.begin(), std::mem_fn(&std::shared_ptr<criterion>::get));
+    ordering.reset(operands.size());
 }
 std::wstring bracketClass::debugTree() const
+{
+    return describeInternal(&criterion::debugTree);
+}
+std::wstring bracketClass::identity() const
+{
+    return describeInternal(&criterion::identity);
+}
+std::wstring bracketClass::describeInternal(describer describe) const
 {
     std::wstring dbgMsg(L"- BRACKET\r\n");
     for (std::vector<std::shared_ptr<criterion> >::const_iterator it = expr.begin(); it != expr.end(); it++)
     {
-        dbgMsg.append((*it)->debugTree());
+        dbgMsg.append(((**it).*describe)());
         if (it + 1 != expr.end())
             dbgMsg.append(L"\r\n");
     }
     boost::algorithm::replace_all(dbgMsg, L"\r\n", L"\r\n   ");
     return dbgMsg;
 }
+std::wstring bracketClass::explainTree() const
+{
+    return explainOrdered(L"BRACKET", ordering, &operands[0]);
+}
 void ifClass::reorderTree()
 {
     condVal->reorderTree();
@@ -238,31 +343,40 @@ BOOL ifClass::include(FileData &file) const
 }
 unsigned int ifClass::directoryCheck(const std::wstring& directory) const
 {
-    if (condVal->directoryCheck(directory))    //See rationale in include() method
-    {
-        return tVal->directoryCheck(directory);
-    } else
+    if (!condVal->directoryCheck(directory))    //See rationale in include() method
     {
         if (!fVal)
             return DIRECTORY_DONTCARE;
         return fVal->directoryCheck(directory);
     }
+    //Files below may take either branch
+    if (!fVal)
+        return DIRECTORY_DONTCARE;
+    return combineAlternatives(tVal->directoryCheck(directory), fVal->directoryCheck(directory));
 }
 ifClass::ifClass(std::shared_ptr<criterion> condition,std::shared_ptr<criterion> valueIfTrue,std::shared_ptr<criterion> valueIfFalse)
     : condVal(condition), tVal(valueIfTrue), fVal(valueIfFalse)
 {}
 std::wstring ifClass::debugTree() const
+{
+    return describeInternal(&criterion::debugTree);
+}
+std::wstring ifClass::identity() const
+{
+    return describeInternal(&criterion::identity);
+}
+std::wstring ifClass::describeInternal(describer describe) const
 {
     std::wstring result;
 
     std::wstring condMsg(L"- IF\r\n");
-    condMsg.append(condVal->debugTree());
+    condMsg.append(((*condVal).*describe)());
     boost::algorithm::replace_all(condMsg, L"\r\n", L"\r\n   ");
     result.assign(condMsg);
     result.append(L"\r\n");
 
     std::wstring thenMsg(L"- THEN\r\n");
-    thenMsg.append(tVal->debugTree());
+    thenMsg.append(((*tVal).*describe)());
     boost::algorithm::replace_all(thenMsg, L"\r\n", L"\r\n   ");
     result.append(thenMsg);
     
@@ -271,13 +385,60 @@ std::wstring ifClass::debugTree() const
     {
         result.append(L"\r\n");
         elseMsg.assign(L"- ELSE\r\n");
-        elseMsg.append(fVal->debugTree());
+        elseMsg.append(((*fVal).*describe)());
         boost::algorithm::replace_all(elseMsg, L"\r\n", L"\r\n   ");
         result.append(elseMsg);
     }
 
     return result;
 }
+std::wstring ifClass::explainTree() const
+{
+    std::wstring result;
+    std::wstring part(L"- IF\r\n");
+    part.append(condVal->explainTree());
+    boost::algorithm::replace_all(part, L"\r\n", L"\r\n   ");
+    result.assign(part);
+    result.append(L"\r\n");
+    part.assign(L"- THEN\r\n");
+    part.append(tVal->explainTree());
+    boost::algorithm::replace_all(part, L"\r\n", L"\r\n   ");
+    result.append(part);
+    if (fVal)
+    {
+        result.append(L"\r\n");
+        part.assign(L"- ELSE\r\n");
+        part.append(fVal->explainTree());
+        boost::algorithm::replace_all(part, L"\r\n", L"\r\n   ");
+        result.append(part);
+    }
+    return result;
+}
+
+void operation::directoryPaths(std::vector<std::wstring>& paths) const
+{
+    operandA->directoryPaths(paths);
+    operandB->directoryPaths(paths);
+}
+
+void notAndClass::directoryPaths(std::vector<std::wstring>& paths) const
+{
+    operand->directoryPaths(paths);
+}
+
+void bracketClass::directoryPaths(std::vector<std::wstring>& paths) const
+{
+    for (std::vector<std::shared_ptr<criterion> >::const_iterator it = expr.begin(); it != expr.end(); it++)
+        (*it)->directoryPaths(paths);
+}
+
+void ifClass::directoryPaths(std::vector<std::wstring>& paths) const
+{
+    condVal->directoryPaths(paths);
+    tVal->directoryPaths(paths);
+    if (fVal)
+        fVal->directoryPaths(paths);
+}
 
 void operation::makeNonRecursive()
 {
@@ -305,3 +466,281 @@ void ifClass::makeNonRecursive()
     if (fVal.get())
         fVal->makeNonRecursive();
 }
+
+void operation::compileTree()
+{
+    flatProgram::compile(operandA);
+    flatProgram::compile(operandB);
+}
+
+bool andAndClass::lower(flatProgram& program) const
+{
+    //Lowering a whole chain at once lets all of its attribute tests fold
+    std::vector<const criterion *> operands;
+    gatherOperands(operands);
+    return program.lowerAnd(operands);
+}
+
+void andAndClass::gatherOperands(std::vector<const criterion *>& operands) const
+{
+    const criterion * const children[] = { operandA.get(), operandB.get() };
+    for (std::size_t idx = 0; idx < 2; idx++)
+    {
+        if (const andAndClass * nested = dynamic_cast<const andAndClass *>(children[idx]))
+            nested->gatherOperands(operands);
+        else
+            operands.push_back(children[idx]);
+    }
+}
+
+bool orAndClass::lower(flatProgram& program) const
+{
+    //Lowering a whole chain at once lets all of its attribute tests fold
+    std::vector<const criterion *> operands;
+    gatherOperands(operands);
+    return program.lowerOr(operands);
+}
+
+void orAndClass::gatherOperands(std::vector<const criterion *>& operands) const
+{
+    const criterion * const children[] = { operandA.get(), operandB.get() };
+    for (std::size_t idx = 0; idx < 2; idx++)
+    {
+        if (const orAndClass * nested = dynamic_cast<const orAndClass *>(children[idx]))
+            nested->gatherOperands(operands);
+        else
+            operands.push_back(children[idx]);
+    }
+}
+
+bool xorAndClass::lower(flatProgram& program) const
+{
+    return program.lowerXor(*operandA, *operandB);
+}
+
+bool notAndClass::lower(flatProgram& program) const
+{
+    return program.lowerNot(*operand);
+}
+
+void notAndClass::compileTree()
+{
+    flatProgram::compile(operand);
+}
+
+bool bracketClass::lower(flatProgram& program) const
+{
+    return program.lowerAnd(std::vector<const criterion *>(operands.begin(), operands.end()));
+}
+
+void bracketClass::compileTree()
+{
+    //The children which lower completely are gathered into one program, so
+    //that all of their tests together cost one call.
+    std::vector<std::shared_ptr<criterion> > lowered;
+    std::vector<std::shared_ptr<criterion> > remaining;
+    for (std::vector<std::shared_ptr<criterion> >::iterator it = expr.begin(); it != expr.end(); it++)
+    {
+        flatProgram probe;
+        if ((*it)->lower(probe))
+            lowered.push_back(*it);
+        else
+        {
+            (*it)->compileTree();
+            remaining.push_back(*it);
+        }
+    }
+    if (lowered.size() > 1)
+    {
+        std::shared_ptr<criterion> group(new bracketClass(lowered));
+        lowered.assign(1, group);
+    }
+    if (!lowered.empty())
+    {
+        flatProgram::compile(lowered[0]);
+        remaining.insert(remaining.begin(), lowered[0]);
+    }
+    expr.swap(remaining);
+    operands.resize(expr.size());
+    std::transform(expr.begin(), expr.end(), operands.begin(), std::mem_fn(&std::shared_ptr<criterion>::get));
+    ordering.reset(operands.size());
+}
+
+bool ifClass::lower(flatProgram& program) const
+{
+    return program.lowerIf(*condVal, *tVal, fVal.get());
+}
+
+void ifClass::compileTree()
+{
+    flatProgram::compile(condVal);
+    flatProgram::compile(tVal);
+    if (fVal)
+        flatProgram::compile(fVal);
+}
+
+void andAndClass::filterBlock(entryBlock& block, entryBlock::selection& rows) const
+{
+    criterion * const operands[] = { operandA.get(), operandB.get() };
+    ordering.filterBlock(operands, block, rows);
+}
+
+void orAndClass::filterBlock(entryBlock& block, entryBlock::selection& rows) const
+{
+    criterion * const operands[] = { operandA.get(), operandB.get() };
+    ordering.filterBlock(operands, block, rows);
+}
+
+void xorAndClass::filterBlock(entryBlock& block, entryBlock::selection& rows) const
+{
+    entryBlock::selection passedB(rows);
+    operandA->filterBlock(block, rows);
+    operandB->filterBlock(block, passedB);
+    entryBlock::symmetricDifference(rows, passedB);
+}
+
+void notAndClass::filterBlock(entryBlock& block, entryBlock::selection& rows) const
+{
+    entryBlock::selection passed(rows);
+    operand->filterBlock(block, passed);
+    entryBlock::subtract(rows, passed);
+}
+
+void bracketClass::filterBlock(entryBlock& block, entryBlock::selection& rows) const
+{
+    ordering.filterBlock(&operands[0], block, rows);
+}
+
+void ifClass::filterBlock(entryBlock& block, entryBlock::selection& rows) const
+{
+    entryBlock::selection otherwise(rows);
+    condVal->filterBlock(block, rows);
+    entryBlock::subtract(otherwise, rows);
+    tVal->filterBlock(block, rows);
+    if (fVal)
+        fVal->filterBlock(block, otherwise);
+    entryBlock::unite(rows, otherwise);
+}
+
+void andAndClass::gatherOperands(std::vector<std::shared_ptr<criterion> >& operands) const
+{
+    const std::shared_ptr<criterion> * const children[] = { &operandA, &operandB };
+    for (std::size_t idx = 0; idx < 2; idx++)
+    {
+        if (const andAndClass * nested = dynamic_cast<const andAndClass *>(children[idx]->get()))
+            nested->gatherOperands(operands);
+        else
+            operands.push_back(*children[idx]);
+    }
+}
+
+bool andAndClass::simplify(std::shared_ptr<criterion>& replacement)
+{
+    std::vector<std::shared_ptr<criterion> > operands;
+    gatherOperands(operands);
+    replacement = treeSimplifier::conjunction(operands);
+    return true;
+}
+
+void orAndClass::gatherOperands(std::vector<std::shared_ptr<criterion> >& operands) const
+{
+    const std::shared_ptr<criterion> * const children[] = { &operandA, &operandB };
+    for (std::size_t idx = 0; idx < 2; idx++)
+    {
+        if (const orAndClass * nested = dynamic_cast<const orAndClass *>(children[idx]->get()))
+            nested->gatherOperands(operands);
+        else
+            operands.push_back(*children[idx]);
+    }
+}
+
+bool orAndClass::simplify(std::shared_ptr<criterion>& replacement)
+{
+    std::vector<std::shared_ptr<criterion> > operands;
+    gatherOperands(operands);
+    replacement = treeSimplifier::disjunction(operands);
+    return true;
+}
+
+bool xorAndClass::simplify(std::shared_ptr<criterion>& replacement)
+{
+    treeSimplifier::simplify(operandA);
+    treeSimplifier::simplify(operandB);
+    bool value;
+    if (treeSimplifier::isConstant(*operandA, value))
+        replacement = value ? treeSimplifier::negation(operandB) : operandB;
+    else if (treeSimplifier::isConstant(*operandB, value))
+        replacement = value ? treeSimplifier::negation(operandA) : operandA;
+    else if (treeSimplifier::identity(*operandA) == treeSimplifier::identity(*operandB))
+        replacement = treeSimplifier::constant(false);
+    else
+        return false;
+    return true;
+}
+
+bool notAndClass::simplify(std::shared_ptr<criterion>& replacement)
+{
+    treeSimplifier::simplify(operand);
+    bool value;
+    if (notAndClass * nested = dynamic_cast<notAndClass *>(operand.get()))
+        replacement = nested->operand;
+    else if (treeSimplifier::isConstant(*operand, value))
+        replacement = treeSimplifier::constant(!value);
+    else
+        return false;
+    return true;
+}
+
+bool bracketClass::simplify(std::shared_ptr<criterion>& replacement)
+{
+    replacement = treeSimplifier::conjunction(expr);
+    return true;
+}
+
+bool ifClass::simplify(std::shared_ptr<criterion>& replacement)
+{
+    treeSimplifier::simplify(condVal);
+    treeSimplifier::simplify(tVal);
+    if (fVal)
+        treeSimplifier::simplify(fVal);
+    bool value;
+    if (!treeSimplifier::isConstant(*condVal, value))
+        return false;
+    if (value)
+        replacement = tVal;
+    else if (fVal)
+        replacement = fVal;
+    else
+        replacement = treeSimplifier::constant(true);
+    return true;
+}
+
+unsigned __int32 constantClass::getPriorityClass() const
+{
+    return PRIORITY_FAST_FILTER;
+}
+
+BOOL constantClass::include(FileData & /*file*/) const
+{
+    return value;
+}
+
+constantClass::constantClass(bool value_) : value(value_)
+{}
+
+std::wstring constantClass::debugTree() const
+{
+    return value ? L"+ TRUE" : L"+ FALSE";
+}
+
+bool constantClass::lower(flatProgram& program) const
+{
+    program.constant(value);
+    return true;
+}
+
+void constantClass::filterBlock(entryBlock& /*block*/, entryBlock::selection& rows) const
+{
+    if (!value)
+        rows.clear();
+}
@@ -0,0 +1,55 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// parallel.h -- A small parallel loop used by the subprograms which
+// hash large numbers of files.
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+//Calls func(idx) for every idx in [0, count), spread across one thread per
+//processor (the calling thread included). Indexes are handed out one at a
+//time, so a handful of huge files do not leave the other threads idle. The
+//first exception thrown by func stops the loop and is rethrown here once
+//every thread has finished.
+//
+//FileData's hashing functions may be called from func; they keep their
+//WOW64 redirection state in a scopedDisable64 on the worker's own stack.
+template <typename Func>
+void parallelFor(std::size_t count, Func func)
+{
+    std::atomic<std::size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::exception_ptr failure;
+    auto worker = [&]() {
+        try
+        {
+            for (std::size_t idx = next++; idx < count && !failed; idx = next++)
+                func(idx);
+        }
+        catch (...)
+        {
+            if (!failed.exchange(true))
+                failure = std::current_exception();
+        }
+    };
+
+    unsigned int threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0)
+        threadCount = 1;
+    if (threadCount > count)
+        threadCount = static_cast<unsigned int>(count);
+    std::vector<std::thread> threads;
+    for (unsigned int idx = 1; idx < threadCount; ++idx)
+        threads.push_back(std::thread(worker));
+    worker();
+    for (std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); ++it)
+        it->join();
+    if (failure)
+        std::rethrow_exception(failure);
+}
@@ -0,0 +1,143 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// peChecksum.cpp -- Implements the PE image checksum.
+
+#include "pch.hpp"
+#include <algorithm>
+#include "peChecksum.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PEV_CHECKSUM_AVX2
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PEV_CHECKSUM_SSE2
+#endif
+
+namespace {
+
+    // The checksum is a one's complement sum of the little endian 16 bit
+    // words of the file. Addition is order independent, so the words are
+    // summed in wide lanes and folded down to 16 bits only at the end.
+
+    std::uint64_t sumWordsScalar(unsigned char const* data, std::size_t words)
+    {
+        std::uint64_t total = 0;
+        for (std::size_t idx = 0; idx < words; ++idx, data += 2)
+            total += static_cast<std::uint32_t>(data[0] | (data[1] << 8));
+        return total;
+    }
+
+    // Each 32 bit lane gains at most 2 * 0xFFFF per vector, so this many
+    // vectors can be accumulated before a lane could overflow.
+    const std::size_t vectorsPerFlush = 0x8000;
+
+#if defined(PEV_CHECKSUM_AVX2)
+    std::uint64_t sumWords(unsigned char const* data, std::size_t words)
+    {
+        std::uint64_t total = 0;
+        __m256i const zero = _mm256_setzero_si256();
+        while (words >= 16)
+        {
+            std::size_t const vectors = std::min(words / 16, vectorsPerFlush);
+            __m256i accumulator = zero;
+            for (std::size_t idx = 0; idx < vectors; ++idx, data += 32)
+            {
+                __m256i const block = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data));
+                accumulator = _mm256_add_epi32(accumulator, _mm256_unpacklo_epi16(block, zero));
+                accumulator = _mm256_add_epi32(accumulator, _mm256_unpackhi_epi16(block, zero));
+            }
+            std::uint32_t lanes[8];
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), accumulator);
+            for (std::size_t idx = 0; idx < 8; ++idx)
+                total += lanes[idx];
+            words -= vectors * 16;
+        }
+        return total + sumWordsScalar(data, words);
+    }
+#elif defined(PEV_CHECKSUM_SSE2)
+    std::uint64_t sumWords(unsigned char const* data, std::size_t words)
+    {
+        std::uint64_t total = 0;
+        __m128i const zero = _mm_setzero_si128();
+        while (words >= 8)
+        {
+            std::size_t const vectors = std::min(words / 8, vectorsPerFlush);
+            __m128i accumulator = zero;
+            for (std::size_t idx = 0; idx < vectors; ++idx, data += 16)
+            {
+                __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data));
+                accumulator = _mm_add_epi32(accumulator, _mm_unpacklo_epi16(block, zero));
+                accumulator = _mm_add_epi32(accumulator, _mm_unpackhi_epi16(block, zero));
+            }
+            std::uint32_t lanes[4];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), accumulator);
+            total += static_cast<std::uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+            words -= vectors * 8;
+        }
+        return total + sumWordsScalar(data, words);
+    }
+#else
+    std::uint64_t sumWords(unsigned char const* data, std::size_t words)
+    {
+        return sumWordsScalar(data, words);
+    }
+#endif
+
+}
+
+peChecksum::peChecksum()
+    : wordSum(0)
+    , length(0)
+    , oddBytePending(false)
+    , oddByte(0)
+{}
+
+void peChecksum::Update(unsigned char const* data, std::size_t dataLength)
+{
+    length += dataLength;
+    if (dataLength == 0)
+        return;
+    // A word may straddle the boundary between two chunks
+    if (oddBytePending)
+    {
+        wordSum += static_cast<std::uint32_t>(oddByte | (data[0] << 8));
+        oddBytePending = false;
+        ++data;
+        --dataLength;
+    }
+    wordSum += sumWords(data, dataLength / 2);
+    if (dataLength & 1)
+    {
+        oddBytePending = true;
+        oddByte = data[dataLength - 1];
+    }
+}
+
+/************************************************************************************
+ *
+ * The adjustment for the stored checksum is from the example code in this
+ * codeproject article -> http://www.codeproject.com/KB/cpp/PEChecksum.aspx
+ * This is because pevFind cannot require IMAGEHLP.DLL
+ *
+ ************************************************************************************/
+std::uint32_t peChecksum::Final(std::uint32_t storedSum) const
+{
+    // A trailing odd byte is summed as if the file were padded with a zero
+    std::uint64_t folded = wordSum + (oddBytePending ? oddByte : 0);
+    while (folded >> 16)
+        folded = (folded & 0xFFFF) + (folded >> 16);
+    std::uint32_t const check = static_cast<std::uint32_t>(folded);
+
+    std::uint32_t result;
+    if (check - 1 < storedSum)
+        result = (check - 1) - storedSum;
+    else
+        result = check - storedSum;
+    result = (result & 0xFFFF) + (result >> 16);
+    result = (result & 0xFFFF) + (result >> 16);
+    return result + static_cast<std::uint32_t>(length);
+}
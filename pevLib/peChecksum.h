@@ -0,0 +1,26 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// peChecksum.h -- An incremental implementation of the checksum stored in
+// the optional header of PE images (what CheckSumMappedFile computes). It
+// takes data through Update in arbitrary chunks, just like the CryptoPP
+// hashes, so it can share a single read of a file with them.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+class peChecksum
+{
+    std::uint64_t wordSum;
+    std::uint64_t length;
+    bool oddBytePending;
+    unsigned char oddByte;
+public:
+    peChecksum();
+    void Update(unsigned char const* data, std::size_t length);
+    // Returns the checksum of everything passed to Update, given the
+    // checksum field currently stored in the image's header.
+    std::uint32_t Final(std::uint32_t storedSum) const;
+};
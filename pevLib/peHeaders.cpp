@@ -0,0 +1,211 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// peHeaders.cpp -- Implements the portable image header parser.
+
+#include "pch.hpp"
+#include <cstring>
+#include "peHeaders.h"
+
+namespace {
+
+    // All multi byte fields in an image are little endian.
+    std::uint16_t read16(unsigned char const* data)
+    {
+        return static_cast<std::uint16_t>(data[0] | (data[1] << 8));
+    }
+    std::uint32_t read32(unsigned char const* data)
+    {
+        return static_cast<std::uint32_t>(data[0])
+            | (static_cast<std::uint32_t>(data[1]) << 8)
+            | (static_cast<std::uint32_t>(data[2]) << 16)
+            | (static_cast<std::uint32_t>(data[3]) << 24);
+    }
+    std::uint64_t read64(unsigned char const* data)
+    {
+        return read32(data) | (static_cast<std::uint64_t>(read32(data + 4)) << 32);
+    }
+
+    // Offsets within the headers, from the PE/COFF specification
+    const std::size_t dosNewHeaderField = 0x3C;
+    const std::size_t fileHeaderSize = 20;
+    const std::size_t sectionHeaderSize = 40;
+    const std::uint16_t pe32Magic = 0x10B;
+    const std::uint16_t pe32PlusMagic = 0x20B;
+    // Where the data directories begin in each optional header flavour
+    const std::size_t pe32DirectoriesOffset = 96;
+    const std::size_t pe32PlusDirectoriesOffset = 112;
+    // The specification defines 16 directories; more than that is corrupt
+    const std::uint32_t maxDirectories = 16;
+
+}
+
+peHeaders::peHeaders()
+    : type(IMAGE_NONE)
+    , needed(0)
+    , newHeaderOffset(0)
+    , machine(0)
+    , timeDateStamp(0)
+    , characteristics(0)
+    , plus(false)
+    , entryPoint(0)
+    , imageBase(0)
+    , sectionAlignment(0)
+    , fileAlignment(0)
+    , sizeOfImage(0)
+    , sizeOfHeaders(0)
+    , checkSum(0)
+    , checkSumOffset(0)
+    , subsystem(0)
+    , dllCharacteristics(0)
+    , directoryTableOffset(0)
+{}
+
+peHeaders::parseResult peHeaders::truncated(std::size_t length)
+{
+    needed = length;
+    return PARSE_TRUNCATED;
+}
+
+peHeaders::parseResult peHeaders::parse(unsigned char const* data, std::size_t length)
+{
+    *this = peHeaders();
+
+    if (length < 2 || data[0] != 'M' || data[1] != 'Z')
+        return PARSE_COMPLETE;
+    type = IMAGE_MZ;
+
+    if (length < dosNewHeaderField + 4)
+        return PARSE_COMPLETE; // Too small to have a new header at all
+    newHeaderOffset = read32(data + dosNewHeaderField);
+    if (newHeaderOffset > MAX_HEADER_SIZE)
+        return PARSE_COMPLETE;
+    if (length < static_cast<std::size_t>(newHeaderOffset) + 4)
+        return truncated(newHeaderOffset + 4);
+
+    unsigned char const* signature = data + newHeaderOffset;
+    if (signature[0] == 'N' && signature[1] == 'E')
+    {
+        type = IMAGE_NE;
+        return PARSE_COMPLETE;
+    }
+    if (signature[0] == 'L' && signature[1] == 'E')
+    {
+        type = IMAGE_LE;
+        return PARSE_COMPLETE;
+    }
+    if (std::memcmp(signature, "PE\0\0", 4) != 0)
+        return PARSE_COMPLETE;
+
+    // COFF file header
+    std::size_t const fileHeaderOffset = newHeaderOffset + 4;
+    std::size_t const optionalHeaderOffset = fileHeaderOffset + fileHeaderSize;
+    if (length < optionalHeaderOffset + 2)
+        return truncated(optionalHeaderOffset + 2);
+    unsigned char const* fileHeader = data + fileHeaderOffset;
+    machine = read16(fileHeader);
+    std::uint16_t const numberOfSections = read16(fileHeader + 2);
+    timeDateStamp = read32(fileHeader + 4);
+    std::uint16_t const sizeOfOptionalHeader = read16(fileHeader + 16);
+    characteristics = read16(fileHeader + 18);
+
+    // Optional header. The image is only treated as PE if the magic is sane.
+    unsigned char const* optionalHeader = data + optionalHeaderOffset;
+    std::uint16_t const magic = read16(optionalHeader);
+    std::size_t directoriesOffset;
+    if (magic == pe32Magic)
+        directoriesOffset = pe32DirectoriesOffset;
+    else if (magic == pe32PlusMagic)
+        directoriesOffset = pe32PlusDirectoriesOffset;
+    else
+        return PARSE_COMPLETE;
+    plus = magic == pe32PlusMagic;
+    type = IMAGE_PE;
+
+    if (length < optionalHeaderOffset + directoriesOffset)
+        return truncated(optionalHeaderOffset + directoriesOffset);
+    entryPoint = read32(optionalHeader + 16);
+    imageBase = plus ? read64(optionalHeader + 24) : read32(optionalHeader + 28);
+    sectionAlignment = read32(optionalHeader + 32);
+    fileAlignment = read32(optionalHeader + 36);
+    sizeOfImage = read32(optionalHeader + 56);
+    sizeOfHeaders = read32(optionalHeader + 60);
+    checkSumOffset = static_cast<std::uint32_t>(optionalHeaderOffset + 64);
+    checkSum = read32(optionalHeader + 64);
+    subsystem = read16(optionalHeader + 68);
+    dllCharacteristics = read16(optionalHeader + 70);
+    std::uint32_t numberOfRvaAndSizes = read32(optionalHeader + directoriesOffset - 4);
+
+    // Data directories, bounded by both the count and the declared header size
+    if (numberOfRvaAndSizes > maxDirectories)
+        numberOfRvaAndSizes = maxDirectories;
+    if (sizeOfOptionalHeader < directoriesOffset)
+        numberOfRvaAndSizes = 0;
+    else if (numberOfRvaAndSizes > (sizeOfOptionalHeader - directoriesOffset) / 8)
+        numberOfRvaAndSizes = static_cast<std::uint32_t>((sizeOfOptionalHeader - directoriesOffset) / 8);
+    std::size_t const directoriesEnd = optionalHeaderOffset + directoriesOffset + numberOfRvaAndSizes * 8;
+    if (length < directoriesEnd)
+        return truncated(directoriesEnd);
+    directoryTableOffset = static_cast<std::uint32_t>(optionalHeaderOffset + directoriesOffset);
+    directories.resize(numberOfRvaAndSizes);
+    for (std::uint32_t idx = 0; idx < numberOfRvaAndSizes; ++idx)
+    {
+        unsigned char const* entry = optionalHeader + directoriesOffset + idx * 8;
+        directories[idx].virtualAddress = read32(entry);
+        directories[idx].size = read32(entry + 4);
+    }
+
+    // Section table
+    std::size_t const sectionTableOffset = optionalHeaderOffset + sizeOfOptionalHeader;
+    std::size_t const sectionTableEnd = sectionTableOffset + numberOfSections * sectionHeaderSize;
+    if (sectionTableEnd > MAX_HEADER_SIZE)
+        return PARSE_COMPLETE;
+    if (length < sectionTableEnd)
+        return truncated(sectionTableEnd);
+    sections.resize(numberOfSections);
+    for (std::uint16_t idx = 0; idx < numberOfSections; ++idx)
+    {
+        unsigned char const* entry = data + sectionTableOffset + idx * sectionHeaderSize;
+        section& target = sections[idx];
+        std::memcpy(target.name, entry, 8);
+        target.name[8] = '\0';
+        target.virtualSize = read32(entry + 8);
+        target.virtualAddress = read32(entry + 12);
+        target.sizeOfRawData = read32(entry + 16);
+        target.pointerToRawData = read32(entry + 20);
+        target.characteristics = read32(entry + 36);
+    }
+    return PARSE_COMPLETE;
+}
+
+peHeaders::dataDirectory peHeaders::getDataDirectory(std::size_t idx) const
+{
+    if (idx < directories.size())
+        return directories[idx];
+    dataDirectory empty = { 0, 0 };
+    return empty;
+}
+
+bool peHeaders::rvaToOffset(std::uint32_t rva, std::uint32_t& offset) const
+{
+    if (rva < sizeOfHeaders)
+    {
+        offset = rva;
+        return true;
+    }
+    for (std::vector<section>::const_iterator it = sections.begin(); it != sections.end(); ++it)
+    {
+        std::uint32_t extent = it->virtualSize ? it->virtualSize : it->sizeOfRawData;
+        if (rva >= it->virtualAddress && rva - it->virtualAddress < extent)
+        {
+            std::uint32_t delta = rva - it->virtualAddress;
+            if (delta >= it->sizeOfRawData)
+                return false; // Uninitialised data has no file backing
+            offset = it->pointerToRawData + delta;
+            return true;
+        }
+    }
+    return false;
+}
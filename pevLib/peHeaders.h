@@ -0,0 +1,139 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// peHeaders.h -- A portable parser for the headers of MZ, NE, LE and PE
+// images. It decodes the DOS header, the file header, the optional header
+// (PE32 and PE32+), the data directories and the section table from one
+// buffer holding the start of the file, so callers need a single read (or
+// a mapped view) rather than a seek and read per field. Nothing here
+// depends on Windows, so it can be exercised on any platform.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class peHeaders
+{
+public:
+    enum imageType
+    {
+        IMAGE_NONE = 0, // Not even an MZ file
+        IMAGE_MZ,       // DOS executable, no recognised new header
+        IMAGE_NE,
+        IMAGE_LE,
+        IMAGE_PE
+    };
+    enum parseResult
+    {
+        PARSE_COMPLETE,
+        PARSE_TRUNCATED // The headers extend past the buffer; see bytesNeeded()
+    };
+    enum
+    {
+        // Enough for the headers of nearly every image
+        HEADER_READ_SIZE = 4096,
+        // Callers should give up rather than read more than this
+        MAX_HEADER_SIZE = 0x100000
+    };
+    enum dataDirectoryIndex
+    {
+        DIRECTORY_EXPORT = 0,
+        DIRECTORY_IMPORT = 1,
+        DIRECTORY_RESOURCE = 2,
+        DIRECTORY_EXCEPTION = 3,
+        DIRECTORY_SECURITY = 4,
+        DIRECTORY_BASERELOC = 5,
+        DIRECTORY_DEBUG = 6,
+        DIRECTORY_DELAY_IMPORT = 13,
+        DIRECTORY_COM_DESCRIPTOR = 14
+    };
+    enum fileCharacteristics
+    {
+        CHARACTERISTIC_DEBUG_STRIPPED = 0x0200,
+        CHARACTERISTIC_DLL = 0x2000
+    };
+    struct dataDirectory
+    {
+        std::uint32_t virtualAddress; // A file offset for DIRECTORY_SECURITY
+        std::uint32_t size;
+    };
+    struct section
+    {
+        char name[9]; // Null terminated
+        std::uint32_t virtualSize;
+        std::uint32_t virtualAddress;
+        std::uint32_t sizeOfRawData;
+        std::uint32_t pointerToRawData;
+        std::uint32_t characteristics;
+    };
+private:
+    imageType type;
+    std::size_t needed;
+    std::uint32_t newHeaderOffset;
+    std::uint16_t machine;
+    std::uint32_t timeDateStamp;
+    std::uint16_t characteristics;
+    bool plus;
+    std::uint32_t entryPoint;
+    std::uint64_t imageBase;
+    std::uint32_t sectionAlignment;
+    std::uint32_t fileAlignment;
+    std::uint32_t sizeOfImage;
+    std::uint32_t sizeOfHeaders;
+    std::uint32_t checkSum;
+    std::uint32_t checkSumOffset;
+    std::uint16_t subsystem;
+    std::uint16_t dllCharacteristics;
+    std::uint32_t directoryTableOffset;
+    std::vector<dataDirectory> directories;
+    std::vector<section> sections;
+
+    parseResult truncated(std::size_t length);
+public:
+    peHeaders();
+
+    // Parses the first length bytes of a file. If the result is
+    // PARSE_TRUNCATED, call again with at least bytesNeeded() bytes;
+    // everything decoded so far is still valid.
+    parseResult parse(unsigned char const* data, std::size_t length);
+    std::size_t bytesNeeded() const { return needed; }
+
+    imageType getType() const { return type; }
+    bool isMZ() const { return type != IMAGE_NONE; }
+    bool isPE() const { return type == IMAGE_PE; }
+    bool isPEPlus() const { return plus; }
+    bool isDLL() const { return (characteristics & CHARACTERISTIC_DLL) != 0; }
+    bool isDebugStripped() const { return (characteristics & CHARACTERISTIC_DEBUG_STRIPPED) != 0; }
+
+    std::uint32_t getNewHeaderOffset() const { return newHeaderOffset; }
+    std::uint16_t getMachine() const { return machine; }
+    std::uint32_t getTimeDateStamp() const { return timeDateStamp; }
+    std::uint16_t getCharacteristics() const { return characteristics; }
+    std::uint32_t getEntryPoint() const { return entryPoint; }
+    std::uint64_t getImageBase() const { return imageBase; }
+    std::uint32_t getSectionAlignment() const { return sectionAlignment; }
+    std::uint32_t getFileAlignment() const { return fileAlignment; }
+    std::uint32_t getSizeOfImage() const { return sizeOfImage; }
+    std::uint32_t getSizeOfHeaders() const { return sizeOfHeaders; }
+    std::uint32_t getCheckSum() const { return checkSum; }
+    // File offset of the CheckSum field of the optional header
+    std::uint32_t getCheckSumOffset() const { return checkSumOffset; }
+    std::uint16_t getSubsystem() const { return subsystem; }
+    std::uint16_t getDllCharacteristics() const { return dllCharacteristics; }
+
+    std::vector<dataDirectory> const& getDataDirectories() const { return directories; }
+    // Returns an empty directory if the image has fewer directories than idx + 1
+    dataDirectory getDataDirectory(std::size_t idx) const;
+    // File offset of the idx-th entry of the data directory table
+    std::uint32_t getDataDirectoryEntryOffset(std::size_t idx) const
+    {
+        return directoryTableOffset + static_cast<std::uint32_t>(idx * 8);
+    }
+    std::vector<section> const& getSections() const { return sections; }
+
+    // Translates a relative virtual address to a file offset. Returns false
+    // if no section (or the headers) contains the address.
+    bool rvaToOffset(std::uint32_t rva, std::uint32_t& offset) const;
+};
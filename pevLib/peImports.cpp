@@ -0,0 +1,319 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// peImports.cpp -- Implements the import and export directory decoder.
+
+#include "pch.hpp"
+#include <algorithm>
+#include "peImports.h"
+#include "peHeaders.h"
+
+namespace {
+
+    // Bounds for hostile images; real images are nowhere near these.
+    const std::size_t maxModules = 0x1000;
+    const std::size_t maxFunctionsPerModule = 0x10000;
+    const std::size_t maxNameLength = 0x200;
+
+    std::uint32_t read32(unsigned char const* data)
+    {
+        return static_cast<std::uint32_t>(data[0])
+            | (static_cast<std::uint32_t>(data[1]) << 8)
+            | (static_cast<std::uint32_t>(data[2]) << 16)
+            | (static_cast<std::uint32_t>(data[3]) << 24);
+    }
+    std::uint64_t read64(unsigned char const* data)
+    {
+        return read32(data) | (static_cast<std::uint64_t>(read32(data + 4)) << 32);
+    }
+
+    // Resolves relative virtual addresses in an image held as a file.
+    class imageReader
+    {
+        const peHeaders& headers;
+        unsigned char const* image;
+        std::size_t length;
+        imageReader& operator=(const imageReader&);
+    public:
+        imageReader(const peHeaders& headers_, unsigned char const* image_, std::size_t length_)
+            : headers(headers_)
+            , image(image_)
+            , length(length_)
+        {}
+        // Returns a pointer to size bytes at rva, or nullptr if they are not in the file.
+        unsigned char const* at(std::uint32_t rva, std::size_t size) const
+        {
+            std::uint32_t offset;
+            if (!headers.rvaToOffset(rva, offset) || offset > length || length - offset < size)
+                return nullptr;
+            return image + offset;
+        }
+        bool readString(std::uint32_t rva, std::string& result) const
+        {
+            std::uint32_t offset;
+            if (!headers.rvaToOffset(rva, offset) || offset >= length)
+                return false;
+            unsigned char const* begin = image + offset;
+            std::size_t const limit = std::min(length - offset, maxNameLength);
+            std::size_t size = 0;
+            while (size < limit && begin[size])
+                ++size;
+            if (size == limit)
+                return false;
+            result.assign(reinterpret_cast<const char*>(begin), size);
+            return true;
+        }
+    };
+
+    // Walks an import name table. Each entry is a pointer sized value: either
+    // an ordinal (top bit set) or the address of a hint and a name, less
+    // nameBias (the image base for old delay load tables, otherwise 0).
+    void readThunks(const imageReader& reader, bool plus, std::uint32_t thunkRva, std::uint32_t nameBias,
+        const std::string& module, bool delayLoaded, std::vector<peImports::importedFunction>& imports)
+    {
+        std::size_t const thunkSize = plus ? 8 : 4;
+        for (std::size_t idx = 0; idx < maxFunctionsPerModule; ++idx)
+        {
+            unsigned char const* thunk = reader.at(static_cast<std::uint32_t>(thunkRva + idx * thunkSize), thunkSize);
+            if (!thunk)
+                return;
+            std::uint64_t const value = plus ? read64(thunk) : read32(thunk);
+            if (value == 0)
+                return;
+            peImports::importedFunction function;
+            function.module = module;
+            function.ordinal = 0;
+            function.delayLoaded = delayLoaded;
+            bool const byOrdinal = plus ? (value >> 63) != 0 : (value >> 31) != 0;
+            if (byOrdinal)
+                function.ordinal = static_cast<std::uint16_t>(value);
+            else if (!reader.readString(static_cast<std::uint32_t>(value) - nameBias + 2, function.name))
+                return;
+            imports.push_back(function);
+        }
+    }
+
+    void appendDecimal(std::string& target, unsigned int value)
+    {
+        char digits[10];
+        std::size_t count = 0;
+        do
+        {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value);
+        while (count)
+            target.push_back(digits[--count]);
+    }
+
+    char toLower(char ch)
+    {
+        if (ch >= 'A' && ch <= 'Z')
+            return static_cast<char>(ch - 'A' + 'a');
+        return ch;
+    }
+
+    std::string toLower(std::string text)
+    {
+        for (std::string::iterator it = text.begin(); it != text.end(); ++it)
+            *it = toLower(*it);
+        return text;
+    }
+
+    // Compares text with lower, which is already lower case, ignoring case.
+    bool equalsLower(const char* text, std::size_t length, const char* lower, std::size_t lowerLength)
+    {
+        if (length != lowerLength)
+            return false;
+        for (std::size_t idx = 0; idx < length; ++idx)
+            if (toLower(text[idx]) != lower[idx])
+                return false;
+        return true;
+    }
+    bool equalsLower(const char* text, std::size_t length, const std::string& lower)
+    {
+        return equalsLower(text, length, lower.data(), lower.size());
+    }
+
+}
+
+peImports::peImports()
+    : exportCount(0)
+{}
+
+bool peImports::parseImage(const peHeaders& headers, unsigned char const* image, std::size_t length)
+{
+    imports.clear();
+    exportNames.clear();
+    exportCount = 0;
+    if (!headers.isPE())
+        return false;
+    imageReader reader(headers, image, length);
+    bool const plus = headers.isPEPlus();
+
+    // IMAGE_IMPORT_DESCRIPTOR: OriginalFirstThunk, TimeDateStamp,
+    // ForwarderChain, Name, FirstThunk; terminated by a zeroed entry.
+    peHeaders::dataDirectory const importDirectory = headers.getDataDirectory(peHeaders::DIRECTORY_IMPORT);
+    if (importDirectory.virtualAddress)
+    {
+        for (std::size_t idx = 0; idx < maxModules; ++idx)
+        {
+            unsigned char const* descriptor = reader.at(static_cast<std::uint32_t>(importDirectory.virtualAddress + idx * 20), 20);
+            if (!descriptor)
+                break;
+            std::uint32_t const nameTable = read32(descriptor);
+            std::uint32_t const name = read32(descriptor + 12);
+            std::uint32_t const addressTable = read32(descriptor + 16);
+            if (name == 0 && addressTable == 0)
+                break;
+            std::string module;
+            if (!reader.readString(name, module))
+                continue;
+            // Bound images may have overwritten the address table; the name
+            // table is intact when present.
+            readThunks(reader, plus, nameTable ? nameTable : addressTable, 0, module, false, imports);
+        }
+    }
+
+    // ImgDelayDescr: grAttrs, rvaDLLName, rvaHmod, rvaIAT, rvaINT, rvaBoundIAT,
+    // rvaUnloadIAT, dwTimeStamp. Without dlattrRva (bit 0 of grAttrs) the
+    // "RVAs" are virtual addresses, as old linkers wrote them.
+    peHeaders::dataDirectory const delayDirectory = headers.getDataDirectory(peHeaders::DIRECTORY_DELAY_IMPORT);
+    if (delayDirectory.virtualAddress)
+    {
+        for (std::size_t idx = 0; idx < maxModules; ++idx)
+        {
+            unsigned char const* descriptor = reader.at(static_cast<std::uint32_t>(delayDirectory.virtualAddress + idx * 32), 32);
+            if (!descriptor)
+                break;
+            std::uint32_t const attributes = read32(descriptor);
+            std::uint32_t name = read32(descriptor + 4);
+            std::uint32_t nameTable = read32(descriptor + 16);
+            if (name == 0)
+                break;
+            std::uint32_t bias = 0;
+            if (!(attributes & 1))
+            {
+                bias = static_cast<std::uint32_t>(headers.getImageBase());
+                name -= bias;
+                nameTable -= bias;
+            }
+            std::string module;
+            if (!reader.readString(name, module))
+                continue;
+            readThunks(reader, plus, nameTable, bias, module, true, imports);
+        }
+    }
+
+    // IMAGE_EXPORT_DIRECTORY: NumberOfFunctions at 20, NumberOfNames at 24,
+    // AddressOfNames at 32.
+    peHeaders::dataDirectory const exportDirectory = headers.getDataDirectory(peHeaders::DIRECTORY_EXPORT);
+    if (exportDirectory.virtualAddress)
+    {
+        unsigned char const* directory = reader.at(exportDirectory.virtualAddress, 40);
+        if (directory)
+        {
+            exportCount = read32(directory + 20);
+            std::uint32_t const nameCount = read32(directory + 24);
+            std::uint32_t const names = read32(directory + 32);
+            for (std::uint32_t idx = 0; idx < nameCount && idx < maxFunctionsPerModule; ++idx)
+            {
+                unsigned char const* entry = reader.at(names + idx * 4, 4);
+                std::string name;
+                if (!entry || !reader.readString(read32(entry), name))
+                    break;
+                exportNames.push_back(name);
+            }
+        }
+    }
+
+    return !imports.empty() || exportCount != 0;
+}
+
+std::string peImports::getImportHashInput() const
+{
+    std::string result;
+    for (std::vector<importedFunction>::const_iterator it = imports.begin(); it != imports.end(); ++it)
+    {
+        if (it->delayLoaded)
+            continue;
+        if (!result.empty())
+            result.push_back(',');
+        result.append(normalizeModuleName(it->module)).push_back('.');
+        if (it->name.empty())
+        {
+            result.append("ord");
+            appendDecimal(result, it->ordinal);
+        }
+        else
+            result.append(toLower(it->name));
+    }
+    return result;
+}
+
+std::string peImports::normalizeModuleName(const std::string& module)
+{
+    std::string result(toLower(module));
+    std::size_t const dot = result.rfind('.');
+    if (dot != std::string::npos)
+    {
+        std::string const extension(result.substr(dot + 1));
+        if (extension == "dll" || extension == "sys" || extension == "ocx")
+            result.erase(dot);
+    }
+    return result;
+}
+
+std::string peImports::makeImportKey(const std::string& module, const std::string& function)
+{
+    return normalizeModuleName(module) + '!' + toLower(function);
+}
+
+bool peImports::matchesImport(const importedFunction& function, const std::string& module, const std::string& name)
+{
+    if (function.name.empty())
+    {
+        // "#" and at most five digits
+        char ordinal[6];
+        std::size_t length = 0;
+        unsigned int value = function.ordinal;
+        do
+        {
+            ordinal[length++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value);
+        if (name.size() != length + 1 || name[0] != '#')
+            return false;
+        for (std::size_t idx = 0; idx < length; ++idx)
+            if (name[idx + 1] != ordinal[length - 1 - idx])
+                return false;
+    }
+    else if (!equalsLower(function.name.data(), function.name.size(), name))
+        return false;
+    if (module.empty())
+        return true;
+
+    // As normalizeModuleName, without the copy
+    std::size_t length = function.module.size();
+    std::size_t const dot = function.module.rfind('.');
+    if (dot != std::string::npos)
+    {
+        char const* extension = function.module.data() + dot + 1;
+        std::size_t const extensionLength = length - dot - 1;
+        if (equalsLower(extension, extensionLength, "dll", 3) || equalsLower(extension, extensionLength, "sys", 3)
+            || equalsLower(extension, extensionLength, "ocx", 3))
+            length = dot;
+    }
+    return equalsLower(function.module.data(), length, module);
+}
+
+std::string peImports::makeImportKey(const importedFunction& function)
+{
+    if (!function.name.empty())
+        return makeImportKey(function.module, function.name);
+    std::string ordinal("#");
+    appendDecimal(ordinal, function.ordinal);
+    return makeImportKey(function.module, ordinal);
+}
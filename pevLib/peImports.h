@@ -0,0 +1,61 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// peImports.h -- A portable decoder for the import, delay import and export
+// directories of a PE image. Like versionInfo, it works on the whole file
+// (typically a mapped view) using the headers peHeaders already decoded.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class peHeaders;
+
+class peImports
+{
+public:
+    struct importedFunction
+    {
+        std::string module;    // As written in the image
+        std::string name;      // Empty if imported by ordinal
+        std::uint16_t ordinal; // Only meaningful if name is empty
+        bool delayLoaded;
+    };
+private:
+    std::vector<importedFunction> imports;
+    std::vector<std::string> exportNames;
+    std::uint32_t exportCount;
+public:
+    peImports();
+
+    // Decodes the directories of an image. Directories which are absent or
+    // malformed are left empty; returns false only if nothing could be read.
+    bool parseImage(const peHeaders& headers, unsigned char const* image, std::size_t length);
+
+    // Regular imports first, in the image's order, then delay loaded imports
+    std::vector<importedFunction> const& getImports() const { return imports; }
+    std::vector<std::string> const& getExportNames() const { return exportNames; }
+    // The number of entries in the export address table, named or not
+    std::uint32_t getExportCount() const { return exportCount; }
+
+    // Returns the text whose MD5 is the image's import hash ("imphash"):
+    // "module.function" for each regular import, comma separated, in lower
+    // case, with .dll, .sys and .ocx removed from module names and ordinal
+    // imports written as "ordN".
+    std::string getImportHashInput() const;
+
+    // Lower cases a module name and removes a .dll, .sys or .ocx extension,
+    // so that "KERNEL32.dll" and "kernel32" compare equal.
+    static std::string normalizeModuleName(const std::string& module);
+    // "module!function" with both parts normalized; the key import criteria
+    // match against.
+    static std::string makeImportKey(const std::string& module, const std::string& function);
+    static std::string makeImportKey(const importedFunction& function);
+    // True if function's key would be module!name, where module and name are
+    // already normalized; an empty module matches any. Compares in place, so
+    // filters can test every import of a file without allocating.
+    static bool matchesImport(const importedFunction& function, const std::string& module, const std::string& name);
+};
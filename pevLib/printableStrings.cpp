@@ -0,0 +1,260 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// printableStrings.cpp -- Implements the printable string extractor. Bytes
+// are classified 64 at a time into bit masks, and strings are found with
+// bit operations on the masks; single bytes are only touched to copy the
+// text of strings which are long enough to report.
+
+#include "pch.hpp"
+#include "printableStrings.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PEV_STRINGS_SSE2
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+    const unsigned blockSize = 64;
+
+    bool isPrintable(unsigned char byte)
+    {
+        return (byte >= 0x20 && byte <= 0x7E) || byte == '\t';
+    }
+
+    // Bits [0, count) set
+    std::uint64_t lowBits(unsigned count)
+    {
+        return count >= 64 ? ~0ull : (1ull << count) - 1;
+    }
+
+    // Index of the lowest set bit; value must not be zero.
+    unsigned lowestSetBit(std::uint64_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+#if defined(_M_X64)
+        _BitScanForward64(&index, value);
+        return index;
+#else
+        if (_BitScanForward(&index, static_cast<unsigned long>(value)))
+            return index;
+        _BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+        return index + 32;
+#endif
+#else
+        return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+    }
+
+    // Index of the lowest clear bit; 64 if every bit is set.
+    unsigned lowestClearBit(std::uint64_t value)
+    {
+        return ~value ? lowestSetBit(~value) : 64;
+    }
+
+    // Index of the highest set bit; value must not be zero.
+    unsigned highestSetBit(std::uint64_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+#if defined(_M_X64)
+        _BitScanReverse64(&index, value);
+        return index;
+#else
+        if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+            return index + 32;
+        _BitScanReverse(&index, static_cast<unsigned long>(value));
+        return index;
+#endif
+#else
+        return 63 - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+    }
+
+    // Packs bits 0, 2, 4 ... 62 of value into bits 0 to 31.
+    std::uint64_t evenBits(std::uint64_t value)
+    {
+        value &= 0x5555555555555555ull;
+        value = (value | (value >> 1)) & 0x3333333333333333ull;
+        value = (value | (value >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+        value = (value | (value >> 4)) & 0x00FF00FF00FF00FFull;
+        value = (value | (value >> 8)) & 0x0000FFFF0000FFFFull;
+        return (value | (value >> 16)) & 0x00000000FFFFFFFFull;
+    }
+
+    // Sets bit i of printable if block[i] is printable, and of zero if it is 0.
+    void classifyBlock(unsigned char const* block, std::uint64_t& printable, std::uint64_t& zero)
+    {
+        printable = 0;
+        zero = 0;
+#if defined(PEV_STRINGS_SSE2)
+        // 0x20 to 0x7E, compared as signed after moving 0x20 down to -128
+        __m128i const bias = _mm_set1_epi8(0x20);
+        __m128i const flip = _mm_set1_epi8(-128);
+        __m128i const limit = _mm_set1_epi8(-128 + 0x5F);
+        __m128i const tab = _mm_set1_epi8('\t');
+        for (unsigned offset = 0; offset < blockSize; offset += 16)
+        {
+            __m128i const bytes = _mm_loadu_si128(reinterpret_cast<__m128i const*>(block + offset));
+            __m128i const inRange = _mm_cmplt_epi8(_mm_xor_si128(_mm_sub_epi8(bytes, bias), flip), limit);
+            __m128i const isTab = _mm_cmpeq_epi8(bytes, tab);
+            printable |= static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_or_si128(inRange, isTab))) << offset;
+            zero |= static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128()))) << offset;
+        }
+#else
+        for (unsigned idx = 0; idx < blockSize; ++idx)
+        {
+            printable |= static_cast<std::uint64_t>(isPrintable(block[idx])) << idx;
+            zero |= static_cast<std::uint64_t>(block[idx] == 0) << idx;
+        }
+#endif
+    }
+
+}
+
+printableStrings::printableStrings(std::size_t minimumLength_, handler found_)
+    : minimumLength(minimumLength_ ? minimumLength_ : 1)
+    , found(found_)
+    , position(0)
+    , previousByte(0)
+    , previousPrintable(false)
+{
+    ascii.start = 0;
+    wide[0].start = 0;
+    wide[1].start = 0;
+}
+
+// Adds the characters in slots [begin, end) to a run.
+void printableStrings::append(run& target, std::uint64_t offset, unsigned char const* first, unsigned stride,
+    unsigned begin, unsigned end)
+{
+    if (target.text.empty())
+        target.start = offset + begin * stride;
+    if (stride == 1)
+        target.text.append(reinterpret_cast<char const*>(first) + begin, end - begin);
+    else
+        for (unsigned slot = begin; slot < end; ++slot)
+            target.text.push_back(static_cast<char>(first[slot * stride]));
+}
+
+void printableStrings::end(run& target, bool isWide)
+{
+    if (target.text.empty())
+        return;
+    if (target.text.size() >= minimumLength)
+        found(target.start, isWide, target.text);
+    target.text.clear();
+}
+
+// Handles one block's worth of a mask whose bit i says whether the
+// character at first[i * stride] belongs to a string.
+void printableStrings::scanMask(run& target, bool isWide, std::uint64_t mask, unsigned slots,
+    unsigned char const* first, unsigned stride, std::uint64_t offset)
+{
+    unsigned done = 0;
+    if (!target.text.empty())
+    {
+        done = lowestClearBit(mask);
+        if (done)
+            append(target, offset, first, stride, 0, done);
+        if (done == slots)
+            return;
+        end(target, isWide);
+    }
+    std::uint64_t const remaining = mask & ~lowBits(done);
+    if (remaining == 0)
+        return;
+    // Only runs which are long enough, or which may go on into the next
+    // block, are copied; binary data is mostly short runs.
+    std::uint64_t starts = 0;
+    if (minimumLength <= slots)
+    {
+        starts = remaining;
+        for (std::size_t shift = 1; shift < minimumLength && starts; ++shift)
+            starts &= remaining >> shift;
+    }
+    if ((remaining >> (slots - 1)) & 1)
+    {
+        std::uint64_t const gaps = ~remaining & lowBits(slots);
+        starts |= 1ull << (gaps ? highestSetBit(gaps) + 1 : 0);
+    }
+    while (starts)
+    {
+        unsigned const begin = lowestSetBit(starts);
+        unsigned const stop = begin + lowestClearBit(remaining >> begin);
+        append(target, offset, first, stride, begin, stop);
+        if (stop == slots)
+            return;
+        end(target, isWide);
+        starts &= ~lowBits(stop);
+    }
+}
+
+// Settles the UTF-16 character starting at the byte before position.
+void printableStrings::settleWide(bool isWide)
+{
+    if (position == 0)
+        return;
+    run& target = wide[(position - 1) & 1];
+    if (isWide)
+        append(target, position - 1, &previousByte, 1, 0, 1);
+    else
+        end(target, true);
+}
+
+void printableStrings::updateBlock(unsigned char const* block)
+{
+    std::uint64_t printable;
+    std::uint64_t zero;
+    classifyBlock(block, printable, zero);
+    scanMask(ascii, false, printable, blockSize, block, 1, position);
+
+    // UTF-16LE: a character starting at i is printable if block[i] is and
+    // block[i + 1] is zero. The one starting at the last byte of the
+    // previous block is settled by this block's first byte, and the one
+    // starting at this block's last byte by the next block. Each run takes
+    // every other byte, so the even and odd starts are scanned separately.
+    settleWide(previousPrintable && (zero & 1));
+    std::uint64_t const characters = printable & (zero >> 1) & lowBits(blockSize - 1);
+    scanMask(wide[position & 1], true, evenBits(characters), blockSize / 2, block, 2, position);
+    scanMask(wide[(position + 1) & 1], true, evenBits(characters >> 1), blockSize / 2 - 1, block + 1, 2, position + 1);
+    previousByte = block[blockSize - 1];
+    previousPrintable = (printable >> (blockSize - 1)) & 1;
+    position += blockSize;
+}
+
+void printableStrings::updateByte(unsigned char byte)
+{
+    bool const printable = isPrintable(byte);
+    if (printable)
+        append(ascii, position, &byte, 1, 0, 1);
+    else
+        end(ascii, false);
+    settleWide(previousPrintable && byte == 0);
+    previousByte = byte;
+    previousPrintable = printable;
+    ++position;
+}
+
+void printableStrings::Update(unsigned char const* data, std::size_t length)
+{
+    std::size_t idx = 0;
+    for (; idx + blockSize <= length; idx += blockSize)
+        updateBlock(data + idx);
+    for (; idx < length; ++idx)
+        updateByte(data[idx]);
+}
+
+void printableStrings::Final()
+{
+    end(ascii, false);
+    end(wide[0], true);
+    end(wide[1], true);
+}
@@ -0,0 +1,51 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// printableStrings.h -- Finds runs of printable ASCII and UTF-16LE text in
+// binary data, as the Unix strings tool does. Data arrives through Update in
+// arbitrary chunks, so this can be a sink of FileData's shared read.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+class printableStrings
+{
+public:
+    // Receives each string once it ends: its offset in the data, whether it
+    // was UTF-16LE, and its text (printable ASCII only, either way).
+    typedef std::function<void (std::uint64_t offset, bool wide, std::string const& text)> handler;
+private:
+    struct run
+    {
+        std::uint64_t start;
+        std::string text;
+    };
+    std::size_t minimumLength;
+    handler found;
+    run ascii;
+    // UTF-16 characters start at even or odd offsets; one run for each.
+    run wide[2];
+    std::uint64_t position;
+    // The last byte seen, which may be the low half of a UTF-16 character.
+    unsigned char previousByte;
+    bool previousPrintable;
+    printableStrings& operator=(const printableStrings&);
+
+    void append(run& target, std::uint64_t offset, unsigned char const* first, unsigned stride,
+        unsigned begin, unsigned end);
+    void end(run& target, bool isWide);
+    void scanMask(run& target, bool isWide, std::uint64_t mask, unsigned slots,
+        unsigned char const* first, unsigned stride, std::uint64_t offset);
+    void settleWide(bool isWide);
+    void updateBlock(unsigned char const* block);
+    void updateByte(unsigned char byte);
+public:
+    printableStrings(std::size_t minimumLength, handler found);
+    void Update(unsigned char const* data, std::size_t length);
+    // Reports the strings still open at the end of the data.
+    void Final();
+};
@@ -8,6 +8,7 @@
 #include "pch.hpp"
 #include <string>
 #include <algorithm>
+#include <cwchar>
 #include <boost/algorithm/string/predicate.hpp>
 #include "regex.h"
 #include "fpattern.h"
@@ -34,6 +35,7 @@ vFindRegex::vFindRegex(std::wstring patternInput, bool recursive)
         delete [] tempExpandedPath;
     }
     std::wstring::const_iterator middle(std::find(patternInput.rbegin(), patternInput.rend(), L'\\').base());
+    std::wstring regex;
     if (middle == patternInput.begin())
     {
         regex = patternInput;
@@ -44,7 +46,22 @@ vFindRegex::vFindRegex(std::wstring patternInput, bool recursive)
     }
     if (!fpattern_isvalid(regex.c_str()))
         throw L"There is an error in the syntax of your VFIND regular expression.";
+    regexes.push_back(regex);
+    patterns.reset(new wildcardSet(regexes));
     stripEscapes(pathRoot);
+    foldedRoot = Instalog::Path::path(pathRoot);
+}
+
+vFindRegex::vFindRegex(const std::wstring& pathRootInput, const std::vector<std::wstring>& regexesInput, bool recursive)
+    : regexes(regexesInput)
+{
+    if (recursive)
+        state = new RvFindRegex();
+    else
+        state = new NRvFindRegex();
+    pathRoot = pathRootInput;
+    foldedRoot = Instalog::Path::path(pathRoot);
+    patterns.reset(new wildcardSet(regexes));
 }
 
 vFindRegex::~vFindRegex()
@@ -59,7 +76,7 @@ unsigned __int32 vFindRegex::getPriorityClass() const
 
 BOOL vFindRegex::include(FileData &file) const
 {
-    return state->include(file, regex, pathRoot);
+    return state->include(file, *patterns, foldedRoot);
 }
 
 unsigned int vFindRegex::directoryCheck(const std::wstring& directory) const
@@ -67,29 +84,37 @@ unsigned int vFindRegex::directoryCheck(const std::wstring& directory) const
     return state->directoryCheck(directory, pathRoot);
 }
 
-bool vFindRegex::isRecursive()
+void vFindRegex::directoryPaths(std::vector<std::wstring>& paths) const
+{
+    if (!pathRoot.empty())
+        paths.push_back(pathRoot);
+}
+
+bool vFindRegex::isRecursive() const
 {
     return state->isRecursive();
 }
 
-BOOL RvFindRegex::include(FileData &file, const std::wstring& regex, const std::wstring& pathRoot) const
+//Both compare the roots by the uppercase copies paths keep
+BOOL RvFindRegex::include(FileData &file, const wildcardSet& patterns, const Instalog::Path::path& pathRoot) const
 {
+    const Instalog::Path::path& fileName = file.getFileName();
     if (pathRoot.size())
     {
-        if (!boost::algorithm::istarts_with(file.getFileName(), pathRoot))
+        if (fileName.size() < pathRoot.size() || std::wmemcmp(fileName.uc_str(), pathRoot.uc_str(), pathRoot.size()) != 0)
             return false;
     }
-    return fpattern_matchn(regex.c_str() , file.getFileName().c_str() + (std::find(file.getFileName().rbegin(), file.getFileName().rend(), L'\\').base() - file.getFileName().begin()));
+    return patterns.match(std::find(fileName.rbegin(), fileName.rend(), L'\\').base());
 }
 
-BOOL NRvFindRegex::include(FileData &file, const std::wstring& regex, const std::wstring& pathRoot) const
+BOOL NRvFindRegex::include(FileData &file, const wildcardSet& patterns, const Instalog::Path::path& pathRoot) const
 {
-    if (!boost::algorithm::iequals(pathRoot,
-        boost::make_iterator_range(file.getFileName().begin(),
-        std::find(file.getFileName().rbegin(), file.getFileName().rend(), L'\\').base())
-        ))
+    const Instalog::Path::path& fileName = file.getFileName();
+    const wchar_t *name = std::find(fileName.rbegin(), fileName.rend(), L'\\').base();
+    std::size_t directoryLength = name - fileName.begin();
+    if (directoryLength != pathRoot.size() || std::wmemcmp(fileName.uc_str(), pathRoot.uc_str(), directoryLength) != 0)
         return false;
-    return fpattern_matchn(regex.c_str(), file.getFileName().c_str() + (file.getFileName().end() - (std::find(file.getFileName().rbegin(), file.getFileName().rend(), L'\\').base() + 1)) );
+    return patterns.match(name);
 }
 
 unsigned int RvFindRegex::directoryCheck(const std::wstring& directory, const std::wstring& pathRoot) const
@@ -119,7 +144,14 @@ unsigned int NRvFindRegex::directoryCheck(const std::wstring& directory, const s
 
 std::wstring vFindRegex::debugTree() const
 {
-    return std::wstring(L"- VFIND REGEX\r\n   + DIR:   ") + std::wstring(pathRoot) + std::wstring(L"\r\n   + REGEX: ") + std::wstring(regex) + std::wstring(L"\r\n");
+    std::wstring result(std::wstring(L"- VFIND REGEX\r\n   + DIR:   ") + std::wstring(pathRoot) + std::wstring(L"\r\n"));
+    for (std::vector<std::wstring>::const_iterator it = regexes.begin(); it != regexes.end(); ++it)
+        result.append(L"   + REGEX: ").append(*it).append(L"\r\n");
+    return result;
+}
+std::wstring vFindRegex::identity() const
+{
+    return std::wstring(isRecursive() ? L"RECURSIVE " : L"NONRECURSIVE ") + debugTree();
 }
 
 unsigned int filesRegexPlaceHolder::directoryCheck(const std::wstring& /*directory*/) const
@@ -146,8 +178,11 @@ unsigned __int32 perlRegex::getPriorityClass() const
 };
 BOOL perlRegex::include(FileData &file) const
 {
-    boost::xpressive::wsmatch results;
-    if (boost::xpressive::regex_search(file.getFileName().begin(), file.getFileName().end(), results, regex))
+    const Instalog::Path::path& fileName = file.getFileName();
+    if (!prefilter.mayMatch(fileName.c_str(), fileName.size()))
+        return false;
+    boost::xpressive::wcmatch results;
+    if (boost::xpressive::regex_search(fileName.begin(), fileName.end(), results, regex))
         return true;
     return false;
 };
@@ -159,10 +194,42 @@ std::wstring perlRegex::debugTree() const
 {
     return std::wstring(L"- PERL REGEX: ") + regexString + std::wstring(L"\r\n");
 };
-perlRegex::perlRegex(const std::wstring& inRegex) : regexString(inRegex)
+std::wstring perlRegex::identity() const
+{
+    //The engine and the flags perlRegex compiles with, then the pattern
+    return L"PERL ICASE " + regexString;
+}
+perlRegex::perlRegex(const std::wstring& inRegex) : regexString(inRegex), prefilter(inRegex)
+{
+    regex = boost::xpressive::wcregex::compile(inRegex.begin(), inRegex.end(), boost::xpressive::regex_constants::icase | boost::xpressive::regex_constants::optimize);
+}
+
+unsigned __int32 linearRegex::getPriorityClass() const
+{
+    return PRIORITY_PERL_REGEX;
+};
+BOOL linearRegex::include(FileData &file) const
+{
+    const Instalog::Path::path& fileName = file.getFileName();
+    if (!prefilter.mayMatch(fileName.c_str(), fileName.size()))
+        return false;
+    return automaton.search(fileName.c_str(), fileName.size());
+};
+unsigned int linearRegex::directoryCheck(const std::wstring& /*directory*/) const
+{
+    return DIRECTORY_DONTCARE;
+};
+std::wstring linearRegex::debugTree() const
+{
+    return std::wstring(L"- LINEAR REGEX: ") + regexString + std::wstring(L"\r\n");
+};
+std::wstring linearRegex::identity() const
 {
-    regex = boost::xpressive::wsregex::compile(inRegex.begin(), inRegex.end(), boost::xpressive::regex_constants::icase | boost::xpressive::regex_constants::optimize);
+    //regexAutomaton always folds case
+    return L"LINEAR ICASE " + regexString;
 }
+linearRegex::linearRegex(const std::wstring& inRegex) : regexString(inRegex), prefilter(inRegex), automaton(inRegex)
+{}
 
 void vFindRegex::makeNonRecursive()
 {
@@ -9,14 +9,19 @@
 // as the placeholder used by the --files switch
 #include "criterion.h"
 #include <string>
+#include <memory>
 #include <boost/xpressive/xpressive_dynamic.hpp>
+#include "wildcardAutomaton.h"
+#include "literalPrefilter.h"
+#include "regexAutomaton.h"
+#include "../LogCommon/Path.hpp"
 
 class regexClass : public criterion
 {
 protected:
     std::wstring pathRoot;
 public:
-    const std::wstring& getPathRoot() { return pathRoot; }
+    const std::wstring& getPathRoot() const { return pathRoot; }
 };
 
 /******************************
@@ -24,7 +29,7 @@ public:
  ******************************/
 struct vFindRegexType
 {
-    virtual BOOL include(FileData &file, const std::wstring& regex, const std::wstring& pathRoot) const = 0;
+    virtual BOOL include(FileData &file, const wildcardSet& patterns, const Instalog::Path::path& pathRoot) const = 0;
     virtual unsigned int directoryCheck(const std::wstring& directory, const std::wstring& pathRoot) const = 0;
     virtual bool isRecursive() const = 0;
     virtual ~vFindRegexType() {};
@@ -32,14 +37,14 @@ struct vFindRegexType
 
 struct RvFindRegex : public vFindRegexType
 {
-    BOOL include(FileData &file, const std::wstring& regex, const std::wstring& pathRoot) const;
+    BOOL include(FileData &file, const wildcardSet& patterns, const Instalog::Path::path& pathRoot) const;
     unsigned int directoryCheck(const std::wstring& directory, const std::wstring& pathRoot) const;
     bool isRecursive() const { return true; };
 };
 
 struct NRvFindRegex : public vFindRegexType
 {
-    BOOL include(FileData &file, const std::wstring& regex, const std::wstring& pathRoot) const;
+    BOOL include(FileData &file, const wildcardSet& patterns, const Instalog::Path::path& pathRoot) const;
     unsigned int directoryCheck(const std::wstring& directory, const std::wstring& pathRoot) const;
     bool isRecursive() const { return false; };
 };
@@ -47,15 +52,25 @@ struct NRvFindRegex : public vFindRegexType
 class vFindRegex : public regexClass
 {
     vFindRegexType *state;
-    std::wstring regex;
+    //Any of these, more than one if the simplifier merged an OR of regexes
+    std::vector<std::wstring> regexes;
+    std::unique_ptr<wildcardSet> patterns;
+    //pathRoot with its uppercase copy, compared against file names' own
+    Instalog::Path::path foldedRoot;
 public:
     unsigned __int32 getPriorityClass() const;
     BOOL include(FileData &file) const;
     unsigned int directoryCheck(const std::wstring& directory) const;
-    bool isRecursive();
+    void directoryPaths(std::vector<std::wstring>& paths) const;
+    bool isRecursive() const;
+    const std::vector<std::wstring>& getRegexes() const { return regexes; }
     vFindRegex(std::wstring patternInput, bool recursive = true);
+    //Matches any of regexesInput under the same root
+    vFindRegex(const std::wstring& pathRootInput, const std::vector<std::wstring>& regexesInput, bool recursive);
     ~vFindRegex();
     std::wstring debugTree() const;
+    //The debug text with the recursion, which it leaves out
+    std::wstring identity() const;
     void makeNonRecursive();
 };
 
@@ -72,13 +87,31 @@ class perlRegex : public regexClass
 {
 private:
     std::wstring regexString;
-    boost::xpressive::basic_regex< std::wstring::const_iterator > regex;
+    literalPrefilter prefilter;
+    boost::xpressive::wcregex regex;
 public:
     unsigned __int32 getPriorityClass() const;
     BOOL include(FileData &file) const;
     unsigned int directoryCheck(const std::wstring& /*directory*/) const;
     std::wstring debugTree() const;
+    std::wstring identity() const;
     perlRegex(const std::wstring& inRegex);
 };
 
+//A perl regex run by the linear time engine, for -lreg
+class linearRegex : public regexClass
+{
+private:
+    std::wstring regexString;
+    literalPrefilter prefilter;
+    regexAutomaton automaton;
+public:
+    unsigned __int32 getPriorityClass() const;
+    BOOL include(FileData &file) const;
+    unsigned int directoryCheck(const std::wstring& /*directory*/) const;
+    std::wstring debugTree() const;
+    std::wstring identity() const;
+    linearRegex(const std::wstring& inRegex);
+};
+
 #endif // _REGEX_H_INCLUDED 
@@ -0,0 +1,579 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// regexAutomaton.cpp -- Implements the linear time regex engine.
+
+#include "pch.hpp"
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <cwctype>
+#include "regexAutomaton.h"
+#include "wildcardAutomaton.h"
+
+namespace {
+
+    const unsigned int UNBOUNDED = static_cast<unsigned int>(-1);
+
+    //The largest count allowed in {n,m}
+    const unsigned int REPEAT_LIMIT = 1000;
+
+    void unsupported(const char *feature)
+    {
+        throw std::runtime_error(std::string("-lreg does not support ") + feature + ", which needs a backtracking engine. Use -preg instead.");
+    }
+
+    void malformed()
+    {
+        throw std::runtime_error("There is an error in the syntax of your -lreg regular expression.");
+    }
+
+    bool isDigit(wchar_t character)
+    {
+        return character >= L'0' && character <= L'9';
+    }
+
+    int hexValue(wchar_t character)
+    {
+        if (character >= L'0' && character <= L'9')
+            return character - L'0';
+        if (character >= L'a' && character <= L'f')
+            return character - L'a' + 10;
+        if (character >= L'A' && character <= L'F')
+            return character - L'A' + 10;
+        return -1;
+    }
+
+}
+
+struct regexAutomaton::term
+{
+    enum termKind
+    {
+        //One character of classes[set]
+        CHARACTERS,
+        SEQUENCE,
+        ALTERNATIVE,
+        //children[0], from minimum to maximum times
+        REPEAT,
+        BEGIN,
+        END
+    };
+    termKind kind;
+    std::size_t set;
+    unsigned int minimum;
+    unsigned int maximum;
+    std::vector<std::shared_ptr<term> > children;
+    explicit term(termKind kind_) : kind(kind_), set(0), minimum(1), maximum(1)
+    {}
+};
+
+//Recursive descent over the perl syntax xpressive accepts, as far as it is regular
+class regexAutomaton::parser
+{
+    regexAutomaton& automaton;
+    const std::wstring& regex;
+    std::size_t position;
+    parser& operator=(const parser&);
+
+    bool atEnd() const { return position == regex.size(); }
+    wchar_t peek() const { return regex[position]; }
+
+    std::shared_ptr<term> characters(const characterClass& set)
+    {
+        std::shared_ptr<term> result(std::make_shared<term>(term::CHARACTERS));
+        result->set = automaton.classes.size();
+        automaton.classes.push_back(set);
+        return result;
+    }
+
+    unsigned int number()
+    {
+        if (atEnd() || !isDigit(peek()))
+            malformed();
+        unsigned int result = 0;
+        while (!atEnd() && isDigit(peek()))
+        {
+            result = result * 10 + (regex[position++] - L'0');
+            if (result > REPEAT_LIMIT)
+                throw std::runtime_error("A repeat count in your -lreg regular expression is too large.");
+        }
+        return result;
+    }
+
+    //Reads \xHH, \x{H...} or \uHHHH, after the x or u
+    wchar_t hexEscape(wchar_t kind)
+    {
+        unsigned int value = 0;
+        std::size_t digits = kind == L'u' ? 4 : 2;
+        bool braced = kind == L'x' && !atEnd() && peek() == L'{';
+        if (braced)
+        {
+            ++position;
+            digits = 4;
+        }
+        std::size_t count = 0;
+        for (; count < digits && !atEnd() && hexValue(peek()) >= 0; ++count)
+            value = value * 16 + hexValue(regex[position++]);
+        if (count == 0 || (!braced && count != digits))
+            malformed();
+        if (braced)
+        {
+            if (atEnd() || peek() != L'}')
+                malformed();
+            ++position;
+        }
+        return static_cast<wchar_t>(value);
+    }
+
+    //Reads the escape after a backslash. Returns the character it stands for,
+    //or sets predicates (\d and the like) or kind (assertions) instead.
+    wchar_t escape(unsigned int& predicates, term::termKind& kind)
+    {
+        if (atEnd())
+            malformed();
+        wchar_t character = regex[position++];
+        switch (character)
+        {
+        case L'd': predicates |= characterClass::DIGIT; break;
+        case L'D': predicates |= characterClass::NOT_DIGIT; break;
+        case L'w': predicates |= characterClass::WORD; break;
+        case L'W': predicates |= characterClass::NOT_WORD; break;
+        case L's': predicates |= characterClass::SPACE; break;
+        case L'S': predicates |= characterClass::NOT_SPACE; break;
+        case L't': return L'\t';
+        case L'n': return L'\n';
+        case L'r': return L'\r';
+        case L'f': return L'\f';
+        case L'v': return L'\v';
+        case L'a': return L'\a';
+        case L'e': return L'\x1B';
+        case L'x':
+        case L'u':
+            return hexEscape(character);
+        case L'A':
+            kind = term::BEGIN;
+            break;
+        case L'z':
+        case L'Z':
+            kind = term::END;
+            break;
+        case L'b':
+        case L'B':
+            unsupported("word boundaries");
+        default:
+            if (isDigit(character))
+                unsupported("backreferences");
+            if (std::iswalpha(character))
+                unsupported("this escape");
+            return character;
+        }
+        return 0;
+    }
+
+    std::shared_ptr<term> bracket()
+    {
+        characterClass set;
+        if (!atEnd() && peek() == L'^')
+        {
+            ++position;
+            set.negated = true;
+        }
+        bool first = true;
+        for (;;)
+        {
+            if (atEnd())
+                malformed();
+            wchar_t lo = regex[position++];
+            if (lo == L']' && !first)
+                break;
+            first = false;
+            if (lo == L'[' && !atEnd() && (peek() == L':' || peek() == L'=' || peek() == L'.'))
+                unsupported("POSIX classes");
+            if (lo == L'\\')
+            {
+                unsigned int predicates = 0;
+                term::termKind kind = term::CHARACTERS;
+                lo = escape(predicates, kind);
+                if (kind != term::CHARACTERS)
+                    malformed();
+                if (predicates)
+                {
+                    set.predicates |= predicates;
+                    continue;
+                }
+            }
+            wchar_t hi = lo;
+            if (position + 1 < regex.size() && peek() == L'-' && regex[position + 1] != L']')
+            {
+                ++position;
+                hi = regex[position++];
+                if (hi == L'\\')
+                {
+                    unsigned int predicates = 0;
+                    term::termKind kind = term::CHARACTERS;
+                    hi = escape(predicates, kind);
+                    if (predicates || kind != term::CHARACTERS)
+                        malformed();
+                }
+                if (hi < lo)
+                    malformed();
+            }
+            set.add(lo, hi);
+        }
+        return characters(set);
+    }
+
+    std::shared_ptr<term> atom()
+    {
+        wchar_t character = regex[position++];
+        switch (character)
+        {
+        case L'(':
+            {
+                if (!atEnd() && peek() == L'?')
+                {
+                    ++position;
+                    if (atEnd() || peek() != L':')
+                        unsupported("lookaround, named groups or inline options");
+                    ++position;
+                }
+                std::shared_ptr<term> inner(alternative());
+                if (atEnd() || peek() != L')')
+                    malformed();
+                ++position;
+                return inner;
+            }
+        case L'[':
+            return bracket();
+        case L'.':
+            {
+                characterClass any;
+                any.negated = true;
+                return characters(any);
+            }
+        case L'^':
+            return std::make_shared<term>(term::BEGIN);
+        case L'$':
+            return std::make_shared<term>(term::END);
+        case L'\\':
+            {
+                characterClass set;
+                term::termKind kind = term::CHARACTERS;
+                wchar_t escaped = escape(set.predicates, kind);
+                if (kind != term::CHARACTERS)
+                    return std::make_shared<term>(kind);
+                if (!set.predicates)
+                    set.add(escaped, escaped);
+                return characters(set);
+            }
+        case L'*':
+        case L'+':
+        case L'?':
+        case L'{':
+        case L')':
+            malformed();
+        default:
+            {
+                characterClass set;
+                set.add(character, character);
+                return characters(set);
+            }
+        }
+    }
+
+    //Applies the quantifiers after an atom
+    std::shared_ptr<term> quantified(std::shared_ptr<term> operand)
+    {
+        if (atEnd())
+            return operand;
+        unsigned int minimum;
+        unsigned int maximum;
+        switch (peek())
+        {
+        case L'*': minimum = 0; maximum = UNBOUNDED; ++position; break;
+        case L'+': minimum = 1; maximum = UNBOUNDED; ++position; break;
+        case L'?': minimum = 0; maximum = 1; ++position; break;
+        case L'{':
+            ++position;
+            minimum = maximum = number();
+            if (!atEnd() && peek() == L',')
+            {
+                ++position;
+                maximum = !atEnd() && peek() == L'}' ? UNBOUNDED : number();
+            }
+            if (atEnd() || peek() != L'}' || maximum < minimum)
+                malformed();
+            ++position;
+            break;
+        default:
+            return operand;
+        }
+        //Laziness does not change whether there is a match
+        if (!atEnd() && peek() == L'?')
+            ++position;
+        else if (!atEnd() && peek() == L'+')
+            unsupported("possessive quantifiers");
+        if (!atEnd() && (peek() == L'*' || peek() == L'+' || peek() == L'?' || peek() == L'{'))
+            malformed();
+        std::shared_ptr<term> result(std::make_shared<term>(term::REPEAT));
+        result->minimum = minimum;
+        result->maximum = maximum;
+        result->children.push_back(operand);
+        return result;
+    }
+
+    std::shared_ptr<term> sequence()
+    {
+        std::shared_ptr<term> result(std::make_shared<term>(term::SEQUENCE));
+        while (!atEnd() && peek() != L'|' && peek() != L')')
+            result->children.push_back(quantified(atom()));
+        return result;
+    }
+
+public:
+    parser(regexAutomaton& automaton_, const std::wstring& regex_)
+        : automaton(automaton_), regex(regex_), position(0)
+    {}
+
+    std::shared_ptr<term> alternative()
+    {
+        std::shared_ptr<term> result(std::make_shared<term>(term::ALTERNATIVE));
+        result->children.push_back(sequence());
+        while (!atEnd() && peek() == L'|')
+        {
+            ++position;
+            result->children.push_back(sequence());
+        }
+        return result;
+    }
+
+    std::shared_ptr<term> parse()
+    {
+        std::shared_ptr<term> result(alternative());
+        if (!atEnd())
+            malformed();
+        return result;
+    }
+};
+
+regexAutomaton::characterClass::characterClass() : predicates(0), negated(false)
+{}
+
+//Adds the folded forms of every character from lo to hi
+void regexAutomaton::characterClass::add(wchar_t lo, wchar_t hi)
+{
+    std::vector<wchar_t> folded;
+    for (unsigned int character = lo; character <= static_cast<unsigned int>(hi); ++character)
+        folded.push_back(wildcardAutomaton::fold(static_cast<wchar_t>(character)));
+    for (std::vector<std::pair<wchar_t, wchar_t> >::const_iterator it = ranges.begin(); it != ranges.end(); ++it)
+        for (unsigned int character = it->first; character <= static_cast<unsigned int>(it->second); ++character)
+            folded.push_back(static_cast<wchar_t>(character));
+    std::sort(folded.begin(), folded.end());
+    folded.erase(std::unique(folded.begin(), folded.end()), folded.end());
+    ranges.clear();
+    for (std::vector<wchar_t>::const_iterator it = folded.begin(); it != folded.end(); ++it)
+    {
+        if (!ranges.empty() && static_cast<unsigned int>(ranges.back().second) + 1 == static_cast<unsigned int>(*it))
+            ranges.back().second = *it;
+        else
+            ranges.push_back(std::make_pair(*it, *it));
+    }
+}
+
+bool regexAutomaton::characterClass::contains(wchar_t character) const
+{
+    wchar_t folded = wildcardAutomaton::fold(character);
+    std::vector<std::pair<wchar_t, wchar_t> >::const_iterator range =
+        std::upper_bound(ranges.begin(), ranges.end(), std::make_pair(folded, static_cast<wchar_t>(0xFFFF)));
+    bool found = range != ranges.begin() && (range - 1)->second >= folded;
+    if (!found && predicates)
+    {
+        bool const digit = std::iswdigit(character) != 0;
+        bool const word = std::iswalnum(character) != 0 || character == L'_';
+        bool const space = std::iswspace(character) != 0;
+        found = ((predicates & DIGIT) && digit) || ((predicates & NOT_DIGIT) && !digit)
+            || ((predicates & WORD) && word) || ((predicates & NOT_WORD) && !word)
+            || ((predicates & SPACE) && space) || ((predicates & NOT_SPACE) && !space);
+    }
+    return found != negated;
+}
+
+regexAutomaton::regexAutomaton(const std::wstring& regex)
+{
+    std::shared_ptr<term> parsed(parser(*this, regex).parse());
+    std::size_t match = add(instruction::MATCH, 0);
+    std::size_t start = emit(*parsed, match);
+    beginning.push_back(start);
+    closure(beginning, true, false);
+    restart.push_back(start);
+    closure(restart, false, false);
+}
+
+std::size_t regexAutomaton::add(instruction::opcode op, std::size_t next, std::size_t alternative, std::size_t set)
+{
+    if (program.size() == PROGRAM_LIMIT)
+        throw std::runtime_error("Your -lreg regular expression is too large.");
+    instruction added;
+    added.op = op;
+    added.next = next;
+    added.alternative = alternative;
+    added.set = set;
+    program.push_back(added);
+    return program.size() - 1;
+}
+
+//Lays out node so that it continues to next, and returns where it starts
+std::size_t regexAutomaton::emit(const term& node, std::size_t next)
+{
+    switch (node.kind)
+    {
+    case term::CHARACTERS:
+        return add(instruction::CHARACTER, next, 0, node.set);
+    case term::SEQUENCE:
+        for (std::size_t idx = node.children.size(); idx != 0; --idx)
+            next = emit(*node.children[idx - 1], next);
+        return next;
+    case term::ALTERNATIVE:
+        {
+            std::size_t result = emit(*node.children.back(), next);
+            for (std::size_t idx = node.children.size() - 1; idx != 0; --idx)
+                result = add(instruction::SPLIT, emit(*node.children[idx - 1], next), result);
+            return result;
+        }
+    case term::REPEAT:
+        {
+            const term& operand = *node.children[0];
+            std::size_t result = next;
+            if (node.maximum == UNBOUNDED)
+            {
+                std::size_t loop = add(instruction::SPLIT, 0, next);
+                //emit can grow program, so finish it before indexing
+                std::size_t body = emit(operand, loop);
+                program[loop].next = body;
+                result = loop;
+            }
+            else
+            {
+                for (unsigned int copy = node.minimum; copy < node.maximum; ++copy)
+                    result = add(instruction::SPLIT, emit(operand, result), next);
+            }
+            for (unsigned int copy = 0; copy < node.minimum; ++copy)
+                result = emit(operand, result);
+            return result;
+        }
+    case term::BEGIN:
+        return add(instruction::ASSERT_BEGIN, next);
+    case term::END:
+        return add(instruction::ASSERT_END, next);
+    }
+    return next;
+}
+
+//Follows the instructions in set which read nothing
+void regexAutomaton::closure(std::vector<std::size_t>& set, bool atBeginning, bool atEnd) const
+{
+    std::vector<bool> seen(program.size(), false);
+    std::vector<std::size_t> pending(set);
+    std::vector<std::size_t> result;
+    while (!pending.empty())
+    {
+        std::size_t current = pending.back();
+        pending.pop_back();
+        if (seen[current])
+            continue;
+        seen[current] = true;
+        const instruction& at = program[current];
+        switch (at.op)
+        {
+        case instruction::SPLIT:
+            pending.push_back(at.alternative);
+            pending.push_back(at.next);
+            break;
+        case instruction::ASSERT_BEGIN:
+            if (atBeginning)
+                pending.push_back(at.next);
+            break;
+        case instruction::ASSERT_END:
+            if (atEnd)
+                pending.push_back(at.next);
+            else
+                result.push_back(current);
+            break;
+        default:
+            result.push_back(current);
+            break;
+        }
+    }
+    std::sort(result.begin(), result.end());
+    set.swap(result);
+}
+
+int regexAutomaton::stateFor(std::vector<std::size_t>& set) const
+{
+    std::map<std::vector<std::size_t>, int>::const_iterator found = stateNumbers.find(set);
+    if (found != stateNumbers.end())
+        return found->second;
+    if (states.size() == STATE_LIMIT)
+    {
+        states.clear();
+        stateNumbers.clear();
+    }
+    dfaState added;
+    added.matched = false;
+    for (std::vector<std::size_t>::const_iterator it = set.begin(); it != set.end(); ++it)
+        added.matched = added.matched || program[*it].op == instruction::MATCH;
+    std::vector<std::size_t> ended(set);
+    closure(ended, false, true);
+    added.matchedAtEnd = false;
+    for (std::vector<std::size_t>::const_iterator it = ended.begin(); it != ended.end(); ++it)
+        added.matchedAtEnd = added.matchedAtEnd || program[*it].op == instruction::MATCH;
+    std::fill(added.next, added.next + 128, -1);
+    added.instructions.swap(set);
+    int number = static_cast<int>(states.size());
+    stateNumbers.insert(std::make_pair(added.instructions, number));
+    states.push_back(added);
+    return number;
+}
+
+int regexAutomaton::step(int state, wchar_t character) const
+{
+    if (character < 128 && states[state].next[character] >= 0)
+        return states[state].next[character];
+    std::vector<std::size_t> set(restart);
+    const std::vector<std::size_t>& current = states[state].instructions;
+    for (std::vector<std::size_t>::const_iterator it = current.begin(); it != current.end(); ++it)
+        if (program[*it].op == instruction::CHARACTER && classes[program[*it].set].contains(character))
+            set.push_back(program[*it].next);
+    closure(set, false, false);
+    std::size_t const cached = states.size();
+    int result = stateFor(set);
+    //Unless the cache was just emptied, remember the way for next time
+    if (character < 128 && states.size() >= cached)
+        states[state].next[character] = result;
+    return result;
+}
+
+bool regexAutomaton::search(const wchar_t *text, std::size_t length) const
+{
+    std::vector<std::size_t> set(beginning);
+    if (length == 0)
+    {
+        //Both the beginning and end assertions hold here
+        closure(set, true, true);
+        for (std::vector<std::size_t>::const_iterator it = set.begin(); it != set.end(); ++it)
+            if (program[*it].op == instruction::MATCH)
+                return true;
+        return false;
+    }
+    int state = stateFor(set);
+    for (const wchar_t *end = text + length; text != end; ++text)
+    {
+        if (states[state].matched)
+            return true;
+        state = step(state, *text);
+    }
+    return states[state].matchedAtEnd;
+}
@@ -0,0 +1,97 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// regexAutomaton.h -- A linear time engine for the regexes of -lreg.
+// xpressive backtracks, so a pattern like (a+)+b can take exponential time on
+// a long path. This engine compiles the regular subset of perl syntax into a
+// Thompson NFA and searches with a DFA built lazily from it, caching at most
+// STATE_LIMIT states, so every character of a path costs bounded work no
+// matter what the pattern is. Backreferences, lookaround, word boundaries and
+// possessive quantifiers need backtracking, and are rejected when compiled.
+#pragma once
+#include <vector>
+#include <string>
+#include <map>
+
+class regexAutomaton
+{
+    //A set of characters, compared case insensitively
+    struct characterClass
+    {
+        enum predicate
+        {
+            DIGIT = 1,
+            NOT_DIGIT = 2,
+            WORD = 4,
+            NOT_WORD = 8,
+            SPACE = 16,
+            NOT_SPACE = 32
+        };
+        //Sorted, disjoint inclusive ranges of folded characters
+        std::vector<std::pair<wchar_t, wchar_t> > ranges;
+        unsigned int predicates;
+        bool negated;
+        characterClass();
+        void add(wchar_t lo, wchar_t hi);
+        bool contains(wchar_t character) const;
+    };
+    struct instruction
+    {
+        enum opcode
+        {
+            //Reads a character of classes[set], then goes to next
+            CHARACTER,
+            //Goes to both next and alternative
+            SPLIT,
+            //^ and \A; only passed at the start of the text
+            ASSERT_BEGIN,
+            //$, \z and \Z; only passed at the end of the text
+            ASSERT_END,
+            MATCH
+        };
+        opcode op;
+        std::size_t next;
+        std::size_t alternative;
+        std::size_t set;
+    };
+    //The regex as parsed, before it is laid out as instructions
+    struct term;
+    class parser;
+    struct dfaState
+    {
+        //Sorted CHARACTER, ASSERT_END and MATCH instructions
+        std::vector<std::size_t> instructions;
+        //Reached MATCH, and would reach it if the text ended here
+        bool matched;
+        bool matchedAtEnd;
+        //Following states for ASCII characters, or -1 if not yet built
+        int next[128];
+    };
+    std::vector<characterClass> classes;
+    std::vector<instruction> program;
+    //Where searches begin: at the first character, and at every other one
+    std::vector<std::size_t> beginning;
+    std::vector<std::size_t> restart;
+    //The cache of DFA states, emptied when it outgrows STATE_LIMIT
+    mutable std::vector<dfaState> states;
+    mutable std::map<std::vector<std::size_t>, int> stateNumbers;
+
+    std::size_t emit(const term& node, std::size_t next);
+    std::size_t add(instruction::opcode op, std::size_t next, std::size_t alternative = 0, std::size_t set = 0);
+    void closure(std::vector<std::size_t>& set, bool atBeginning, bool atEnd) const;
+    int stateFor(std::vector<std::size_t>& set) const;
+    int step(int state, wchar_t character) const;
+public:
+    //The most DFA states cached, and the most instructions in a program
+    static const std::size_t STATE_LIMIT = 1024;
+    static const std::size_t PROGRAM_LIMIT = 20000;
+    //Compiles regex, matching without regard to case. Throws a message if the
+    //regex is malformed or needs backtracking.
+    explicit regexAutomaton(const std::wstring& regex);
+    //Same as regex_search over the length characters at text, which cannot
+    //contain newlines. Builds states into the cache, so it must not run on
+    //two threads at once.
+    bool search(const wchar_t *text, std::size_t length) const;
+};
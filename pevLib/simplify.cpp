@@ -0,0 +1,385 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// simplify.cpp -- Implements the simplification pass over the criterion tree.
+
+#include "pch.hpp"
+#include <algorithm>
+#include <functional>
+#include <set>
+#include "simplify.h"
+#include "opstruct.h"
+#include "filter.h"
+#include "fileData.h"
+#include "hashSet.h"
+#include "regex.h"
+
+namespace {
+
+    unsigned __int64 fileTimeValue(const FILETIME& time)
+    {
+        return (static_cast<unsigned __int64>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    }
+
+    //The quantities which size and date filters bound
+    enum quantity
+    {
+        SIZE,
+        ACCESS_TIME,
+        MODIFIED_TIME,
+        CREATION_TIME,
+        QUANTITY_COUNT
+    };
+
+    enum boundKind
+    {
+        NO_BOUND,
+        ABOVE,      //quantity > value
+        BELOW,      //quantity < value
+        EXACTLY,    //quantity == value
+        NOT_EXACTLY //quantity != value
+    };
+
+    template <typename filterType>
+    bool isSize(const criterion& term, unsigned __int64& value)
+    {
+        const filterType * filter = dynamic_cast<const filterType *>(&term);
+        if (filter)
+            value = filter->getSize();
+        return filter != 0;
+    }
+
+    template <typename filterType>
+    bool isDate(const criterion& term, unsigned __int64& value)
+    {
+        const filterType * filter = dynamic_cast<const filterType *>(&term);
+        if (filter)
+            value = fileTimeValue(filter->getDate());
+        return filter != 0;
+    }
+
+    boundKind classify(const criterion& term, quantity& which, unsigned __int64& value)
+    {
+        which = SIZE;
+        if (isSize<gtSizeFilter>(term, value))
+            return ABOVE;
+        if (isSize<ltSizeFilter>(term, value))
+            return BELOW;
+        if (isSize<isSizeFilter>(term, value))
+            return EXACTLY;
+        if (isSize<notSizeFilter>(term, value))
+            return NOT_EXACTLY;
+        which = ACCESS_TIME;
+        if (isDate<accessGDate>(term, value))
+            return ABOVE;
+        if (isDate<accessLDate>(term, value))
+            return BELOW;
+        which = MODIFIED_TIME;
+        if (isDate<modifiedGDate>(term, value))
+            return ABOVE;
+        if (isDate<modifiedLDate>(term, value))
+            return BELOW;
+        which = CREATION_TIME;
+        if (isDate<createdGDate>(term, value))
+            return ABOVE;
+        if (isDate<createdLDate>(term, value))
+            return BELOW;
+        return NO_BOUND;
+    }
+
+    void eraseTerms(std::vector<std::shared_ptr<criterion> >& terms, std::vector<std::size_t>& removed)
+    {
+        std::sort(removed.begin(), removed.end(), std::greater<std::size_t>());
+        removed.erase(std::unique(removed.begin(), removed.end()), removed.end());
+        for (std::vector<std::size_t>::const_iterator it = removed.begin(); it != removed.end(); ++it)
+            terms.erase(terms.begin() + *it);
+    }
+
+    //Merges the size and date bounds of an AND (any false) or OR (any true).
+    //An AND keeps only its tightest bound in each direction, and an OR its
+    //loosest. Returns false if the bounds alone decide the result, that is,
+    //if the AND can never be true or the OR is always true.
+    bool mergeBounds(std::vector<std::shared_ptr<criterion> >& terms, bool any)
+    {
+        for (int which = SIZE; which < QUANTITY_COUNT; ++which)
+        {
+            std::size_t const none = terms.size();
+            std::size_t above = none;
+            std::size_t below = none;
+            unsigned __int64 aboveValue = 0;
+            unsigned __int64 belowValue = 0;
+            std::vector<std::size_t> exactly;
+            std::vector<std::size_t> notExactly;
+            std::vector<std::size_t> removed;
+            std::vector<unsigned __int64> values(terms.size());
+            for (std::size_t idx = 0; idx < terms.size(); ++idx)
+            {
+                quantity termQuantity;
+                boundKind kind = classify(*terms[idx], termQuantity, values[idx]);
+                if (kind == NO_BOUND || termQuantity != which)
+                    continue;
+                unsigned __int64 const value = values[idx];
+                switch (kind)
+                {
+                case ABOVE:
+                    if (above == none || (any ? value < aboveValue : value > aboveValue))
+                    {
+                        if (above != none)
+                            removed.push_back(above);
+                        above = idx;
+                        aboveValue = value;
+                    }
+                    else
+                        removed.push_back(idx);
+                    break;
+                case BELOW:
+                    if (below == none || (any ? value > belowValue : value < belowValue))
+                    {
+                        if (below != none)
+                            removed.push_back(below);
+                        below = idx;
+                        belowValue = value;
+                    }
+                    else
+                        removed.push_back(idx);
+                    break;
+                case EXACTLY:
+                    exactly.push_back(idx);
+                    break;
+                case NOT_EXACTLY:
+                    notExactly.push_back(idx);
+                    break;
+                default:
+                    break;
+                }
+            }
+            if (any)
+            {
+                //Every value is either above a or below b if b > a
+                if (above != none && below != none && belowValue > aboveValue)
+                    return false;
+                for (std::vector<std::size_t>::const_iterator it = exactly.begin(); it != exactly.end(); ++it)
+                    if ((above != none && values[*it] > aboveValue) || (below != none && values[*it] < belowValue))
+                        removed.push_back(*it);
+            }
+            else
+            {
+                //The inclusive range of values which pass every bound
+                unsigned __int64 lowest = 0;
+                unsigned __int64 highest = static_cast<unsigned __int64>(-1);
+                if (above != none)
+                {
+                    if (aboveValue == highest)
+                        return false;
+                    lowest = aboveValue + 1;
+                }
+                if (below != none)
+                {
+                    if (belowValue == 0)
+                        return false;
+                    highest = belowValue - 1;
+                }
+                if (lowest > highest)
+                    return false;
+                for (std::vector<std::size_t>::const_iterator it = exactly.begin(); it != exactly.end(); ++it)
+                {
+                    if (values[*it] < lowest || values[*it] > highest)
+                        return false;
+                    lowest = highest = values[*it];
+                }
+                if (!exactly.empty())
+                {
+                    //The equality implies the other bounds
+                    if (above != none)
+                        removed.push_back(above);
+                    if (below != none)
+                        removed.push_back(below);
+                }
+                for (std::vector<std::size_t>::const_iterator it = notExactly.begin(); it != notExactly.end(); ++it)
+                {
+                    if (values[*it] < lowest || values[*it] > highest)
+                        removed.push_back(*it);
+                    else if (lowest == highest)
+                        return false;
+                }
+            }
+            eraseTerms(terms, removed);
+        }
+        return true;
+    }
+
+    //Merges the single hash matches and hash lists of one algorithm in an OR
+    //into one list, so that the file is hashed and looked up once.
+    template <typename matchType, typename listType>
+    void mergeHashes(std::vector<std::shared_ptr<criterion> >& terms, std::size_t digestLength)
+    {
+        std::vector<std::size_t> merged;
+        std::vector<std::wstring> digests;
+        std::vector<std::shared_ptr<hashSet> > sets;
+        std::vector<unsigned char> digest(digestLength);
+        for (std::size_t idx = 0; idx < terms.size(); ++idx)
+        {
+            if (const matchType * match = dynamic_cast<const matchType *>(terms[idx].get()))
+            {
+                //A value which is not a digest never matches, so it stays as it is
+                if (!hashSet::parseHexDigest(match->getValue(), &digest[0], digestLength))
+                    continue;
+                digests.push_back(match->getValue());
+                merged.push_back(idx);
+            }
+            else if (const listType * list = dynamic_cast<const listType *>(terms[idx].get()))
+            {
+                sets.push_back(list->getValues());
+                merged.push_back(idx);
+            }
+        }
+        if (merged.size() < 2)
+            return;
+        if (!digests.empty())
+            sets.push_back(std::make_shared<hashSet>(digests, digestLength));
+        terms[merged[0]] = std::make_shared<listType>(std::make_shared<hashSet>(sets));
+        merged.erase(merged.begin());
+        eraseTerms(terms, merged);
+    }
+
+    //Merges the vFind regexes of an OR which share a root and recursion into
+    //one, so that a name is matched against all of their patterns at once.
+    void mergePatterns(std::vector<std::shared_ptr<criterion> >& terms)
+    {
+        std::vector<bool> taken(terms.size(), false);
+        std::vector<std::size_t> merged;
+        for (std::size_t first = 0; first < terms.size(); ++first)
+        {
+            const vFindRegex * lead = dynamic_cast<const vFindRegex *>(terms[first].get());
+            if (!lead || taken[first])
+                continue;
+            std::wstring const root(lead->getPathRoot());
+            bool const recursive = lead->isRecursive();
+            std::vector<std::wstring> regexes(lead->getRegexes());
+            for (std::size_t idx = first + 1; idx < terms.size(); ++idx)
+            {
+                const vFindRegex * other = dynamic_cast<const vFindRegex *>(terms[idx].get());
+                if (!other || taken[idx] || other->isRecursive() != recursive || other->getPathRoot() != root)
+                    continue;
+                regexes.insert(regexes.end(), other->getRegexes().begin(), other->getRegexes().end());
+                taken[idx] = true;
+                merged.push_back(idx);
+            }
+            if (regexes.size() != lead->getRegexes().size())
+                terms[first] = std::make_shared<vFindRegex>(root, regexes, recursive);
+        }
+        eraseTerms(terms, merged);
+    }
+
+    //Drops repeated operands of an AND or OR. Returns false if one operand is
+    //the negation of another, which decides the result. Operands are only
+    //repeats if their identities match, so "-nrvf X -and X" keeps both: the
+    //regexes print alike, but only the second recurses.
+    bool removeDuplicates(std::vector<std::shared_ptr<criterion> >& terms)
+    {
+        std::set<std::wstring> seen;
+        std::vector<std::shared_ptr<criterion> > unique;
+        for (std::vector<std::shared_ptr<criterion> >::const_iterator it = terms.begin(); it != terms.end(); ++it)
+            if (seen.insert(treeSimplifier::identity(**it)).second)
+                unique.push_back(*it);
+        for (std::vector<std::shared_ptr<criterion> >::const_iterator it = unique.begin(); it != unique.end(); ++it)
+            if (const notAndClass * negated = dynamic_cast<const notAndClass *>(it->get()))
+                if (seen.count(treeSimplifier::identity(*negated->getOperand())))
+                    return false;
+        terms.swap(unique);
+        return true;
+    }
+
+}
+
+void treeSimplifier::simplify(std::shared_ptr<criterion>& node)
+{
+    std::shared_ptr<criterion> replacement;
+    if (node->simplify(replacement))
+        node = replacement;
+}
+
+std::shared_ptr<criterion> treeSimplifier::conjunction(const std::vector<std::shared_ptr<criterion> >& operands)
+{
+    std::vector<std::shared_ptr<criterion> > terms;
+    for (std::vector<std::shared_ptr<criterion> >::const_iterator it = operands.begin(); it != operands.end(); ++it)
+    {
+        std::shared_ptr<criterion> term(*it);
+        simplify(term);
+        bool value;
+        if (isConstant(*term, value))
+        {
+            if (!value)
+                return term;
+        }
+        else if (const bracketClass * nested = dynamic_cast<const bracketClass *>(term.get()))
+            terms.insert(terms.end(), nested->getExpression().begin(), nested->getExpression().end());
+        else
+            terms.push_back(term);
+    }
+    if (!mergeBounds(terms, false) || !removeDuplicates(terms))
+        return constant(false);
+    if (terms.empty())
+        return constant(true);
+    if (terms.size() == 1)
+        return terms[0];
+    return std::make_shared<bracketClass>(terms);
+}
+
+std::shared_ptr<criterion> treeSimplifier::disjunction(const std::vector<std::shared_ptr<criterion> >& operands)
+{
+    std::vector<std::shared_ptr<criterion> > terms;
+    for (std::vector<std::shared_ptr<criterion> >::const_iterator it = operands.begin(); it != operands.end(); ++it)
+    {
+        std::shared_ptr<criterion> term(*it);
+        simplify(term);
+        bool value;
+        if (isConstant(*term, value))
+        {
+            if (value)
+                return term;
+        }
+        else if (const orAndClass * nested = dynamic_cast<const orAndClass *>(term.get()))
+            nested->gatherOperands(terms);
+        else
+            terms.push_back(term);
+    }
+    if (!mergeBounds(terms, true) || !removeDuplicates(terms))
+        return constant(true);
+    mergeHashes<md5Match, md5List>(terms, CryptoPP::Weak::MD5::DIGESTSIZE);
+    mergeHashes<sha1Match, sha1List>(terms, CryptoPP::SHA1::DIGESTSIZE);
+    mergePatterns(terms);
+    if (terms.empty())
+        return constant(false);
+    std::shared_ptr<criterion> result(terms[0]);
+    for (std::size_t idx = 1; idx < terms.size(); ++idx)
+        result = std::make_shared<orAndClass>(result, terms[idx]);
+    return result;
+}
+
+std::shared_ptr<criterion> treeSimplifier::negation(const std::shared_ptr<criterion>& operand)
+{
+    std::shared_ptr<criterion> result(std::make_shared<notAndClass>(operand));
+    simplify(result);
+    return result;
+}
+
+std::shared_ptr<criterion> treeSimplifier::constant(bool value)
+{
+    return std::make_shared<constantClass>(value);
+}
+
+bool treeSimplifier::isConstant(const criterion& node, bool& value)
+{
+    const constantClass * folded = dynamic_cast<const constantClass *>(&node);
+    if (folded)
+        value = folded->getValue();
+    return folded != 0;
+}
+
+std::wstring treeSimplifier::identity(const criterion& node)
+{
+    return node.identity();
+}
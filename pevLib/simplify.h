@@ -0,0 +1,33 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// simplify.h -- Normalizes the criterion tree before it is reordered.
+// Command lines, especially once -loadline has expanded them, repeat regexes,
+// negate twice and bound one date in several options. The pass folds
+// constants, removes double negation, flattens nested ANDs and ORs, drops
+// duplicate operands, and merges size and date bounds, hash tests and vFind
+// regexes which can be checked as one.
+#pragma once
+#include <vector>
+#include <memory>
+#include <string>
+#include "criterion.h"
+
+class treeSimplifier
+{
+public:
+    //Replaces node with its simplest equivalent
+    static void simplify(std::shared_ptr<criterion>& node);
+    //The simplest equivalents of the AND, OR and NOT of operands
+    static std::shared_ptr<criterion> conjunction(const std::vector<std::shared_ptr<criterion> >& operands);
+    static std::shared_ptr<criterion> disjunction(const std::vector<std::shared_ptr<criterion> >& operands);
+    static std::shared_ptr<criterion> negation(const std::shared_ptr<criterion>& operand);
+    static std::shared_ptr<criterion> constant(bool value);
+    //Returns true, and sets value, if node is TRUE or FALSE
+    static bool isConstant(const criterion& node, bool& value);
+    //Criteria with the same identity always give the same result; see
+    //criterion::identity.
+    static std::wstring identity(const criterion& node);
+};
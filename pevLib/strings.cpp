@@ -0,0 +1,30 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// strings.cpp -- Implements the STRINGS subprogram. It is vFind with
+// --strings on by default; each match is read once, in large blocks, while
+// its strings are extracted.
+
+#include "pch.hpp"
+#include <stdexcept>
+#include "strings.h"
+#include "vFind.h"
+#include "globalOptions.h"
+
+namespace strings {
+
+int main(int, wchar_t* [])
+{
+    int setupResult = vFind::prepare(L"strings");
+    if (setupResult)
+        return setupResult;
+    if (globalOptions::killProc)
+        throw std::invalid_argument("STRINGS cannot be combined with -k.");
+    if (!globalOptions::stringsMinimum)
+        globalOptions::stringsMinimum = 4;
+    return vFind::run();
+}
+
+}; //namespace strings
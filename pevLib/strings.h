@@ -0,0 +1,11 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// strings.h -- Defines the "STRINGS" subprogram, which lists the printable
+// ASCII and UTF-16 strings in the matches of a vFind command line.
+
+namespace strings {
+    int main(int argc, wchar_t* argv[]);
+}; //namespace strings
@@ -12,6 +12,7 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include "utility.h"
+#include "../LogCommon/Win32Glue.hpp"
 
 std::wstring loadFileAsString(const std::wstring &fileName)
 {
@@ -70,6 +71,28 @@ std::vector<std::wstring> loadStringsFromFile(const std::wstring &fileName)
     return files;
 }
 
+std::shared_ptr<const void> mapFile(const std::wstring &fileName, std::size_t &size)
+{
+    Instalog::UniqueHandle file(CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL));
+    if (!file.IsOpen())
+        throw std::runtime_error("Could not open file \"" + convertUnicode(fileName) + "\"");
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file.Get(), &fileSize))
+        throw std::runtime_error("Could not read file \"" + convertUnicode(fileName) + "\"");
+    if (static_cast<unsigned __int64>(fileSize.QuadPart) > static_cast<std::size_t>(-1))
+        throw std::runtime_error("The file \"" + convertUnicode(fileName) + "\" is too large to map.");
+    size = static_cast<std::size_t>(fileSize.QuadPart);
+    if (size == 0)
+        return std::shared_ptr<const void>();
+    Instalog::UniqueHandle mapping(CreateFileMappingW(file.Get(), NULL, PAGE_READONLY, 0, 0, NULL));
+    if (!mapping.IsOpen())
+        throw std::runtime_error("Could not map file \"" + convertUnicode(fileName) + "\"");
+    const void* view = MapViewOfFile(mapping.Get(), FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+        throw std::runtime_error("Could not map file \"" + convertUnicode(fileName) + "\"");
+    return std::shared_ptr<const void>(view, UnmapViewOfFile);
+}
+
 FILETIME UnixTimeToFileTime(const DWORD &t)
 {
     FILETIME retVar;
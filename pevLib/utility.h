@@ -8,6 +8,7 @@
 // utility.h -- Provides a bunch of utility functions and classes.
 
 #include <string>
+#include <memory>
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include "globalOptions.h"
@@ -32,6 +33,7 @@ static class _disable64
 public:
     _disable64()
     {
+        disabled = false;
         functionsExist = true;
         BOOL is64ReturnValue;    
         kernel32 = LoadLibrary(L"kernel32.dll");
@@ -87,8 +89,41 @@ public:
         revertWow64(oldValue);
         disabled = false;
     };
+    //As above, but the caller keeps the cookie, so threads do not share it.
+    bool disableFS(LPVOID& cookie)
+    {
+        if (!functionsExist)
+            return false;
+        if (!globalOptions::disable64Redirector)
+            return false;
+        return disableWow64(&cookie) != FALSE;
+    };
+    void enableFS(LPVOID cookie)
+    {
+        revertWow64(cookie);
+    };
 } disable64;
 
+//Disables WOW64 file system redirection for the calling thread until the
+//end of the enclosing scope. Safe to use from parallelFor's workers.
+class scopedDisable64
+{
+    LPVOID oldValue;
+    bool disabled;
+    scopedDisable64(const scopedDisable64&);
+    scopedDisable64& operator=(const scopedDisable64&);
+public:
+    scopedDisable64()
+    {
+        disabled = disable64.disableFS(oldValue);
+    }
+    ~scopedDisable64()
+    {
+        if (disabled)
+            disable64.enableFS(oldValue);
+    }
+};
+
 bool operator<(const FILETIME &lhs, const FILETIME &rhs);
 bool operator>(const FILETIME &lhs, const FILETIME &rhs);
 bool operator!=(const FILETIME &lhs, const FILETIME &rhs);
@@ -99,6 +134,10 @@ const FILETIME operator+(const __int64 &lhs, const FILETIME &rhs);
 
 std::wstring loadFileAsString(const std::wstring &fileName);
 std::vector<std::wstring> loadStringsFromFile(const std::wstring &fileName);
+//Maps fileName into memory read only and stores its length in size. The view
+//is unmapped when the last copy of the returned pointer is released. Empty
+//files return a null view.
+std::shared_ptr<const void> mapFile(const std::wstring &fileName, std::size_t &size);
 
 std::string convertUnicode(const std::wstring &uni);
 std::wstring convertUnicode(const std::string &uni);
@@ -16,13 +16,18 @@
 #include "consoleParser.h"
 #include "globalOptions.h"
 #include "criterion.h"
+#include "compiledCriteria.h"
+#include "simplify.h"
+#include "fileData.h"
+#include "logger.h"
 
 namespace vFind {
 
-int main()
+int prepare(wchar_t const* subprogram)
 {
     consoleParser parseInstance;
-    globalOptions::logicalTree = parseInstance.parseCmdLine(GetCommandLine());
+    globalOptions::logicalTree = parseInstance.parseCmdLine(GetCommandLine(), subprogram);
+    treeSimplifier::simplify(globalOptions::logicalTree);
     if (globalOptions::debug)
     {
         std::puts("# DEBUGGING OUTPUT #");
@@ -64,6 +69,7 @@ int main()
         return 3;
     }
     globalOptions::logicalTree->reorderTree();
+    flatProgram::compile(globalOptions::logicalTree);
     if (globalOptions::debug)
     {
         std::wstring debugTree(globalOptions::logicalTree->debugTree());
@@ -73,12 +79,27 @@ int main()
     //If a timeout is set, start the watch thread to terminate this one if need be.
     if (globalOptions::timeout)
         CreateThread(NULL,50,&timeoutThread,reinterpret_cast<LPVOID>(globalOptions::timeout),NULL,NULL);
+    return 0;
+}
+
+void collect(std::list<FileData>& results)
+{
+    if (!globalOptions::fileList.empty())
+        scanners::filesScanner().collect(results);
+    else
+        scanners::recursiveScanner().collect(results);
+}
+
+int run()
+{
     if (!globalOptions::fileList.empty())
         scanners::filesScanner().scan();
     else if (globalOptions::killProc)
         scanners::processScanner().scan();
     else
         scanners::recursiveScanner().scan();
+    if (globalOptions::explain)
+        logger << L"\r\nEvaluation plan:\r\n" << globalOptions::logicalTree->explainTree() << L"\r\n";
 #ifndef NDEBUG
     system("pause");
 #endif
@@ -90,4 +111,12 @@ int main()
         return 4;
 }
 
+int main()
+{
+    int setupResult = prepare(L"vfind");
+    if (setupResult)
+        return setupResult;
+    return run();
+}
+
 } //namespace vFind
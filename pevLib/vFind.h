@@ -5,7 +5,21 @@
 //
 // vFind.h -- Defines the main entry point for vFind.
 
+#include <list>
+
+class FileData;
+
 namespace vFind {
     int main();
+    //Parses the command line (skipping the given subprogram name) into
+    //globalOptions::logicalTree and readies it for scanning. Returns zero,
+    //or the exit code to return if the search cannot run.
+    int prepare(wchar_t const* subprogram);
+    //Runs the scanner chosen by the command line, printing each match, and
+    //returns vFind's exit code.
+    int run();
+    //Runs the scanner chosen by the command line, storing every match in
+    //results rather than printing it.
+    void collect(std::list<FileData>& results);
 } //namespace vFind
 
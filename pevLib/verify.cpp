@@ -0,0 +1,371 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// verify.cpp -- Implements the VERIFY subprogram. The manifest is mapped
+// and indexed in place; only the offsets of each path are kept, and a path
+// is converted to a wide string only when its file is opened or reported.
+
+#include "pch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <boost/algorithm/string/predicate.hpp>
+#include "verify.h"
+#include "fileData.h"
+#include "logger.h"
+#include "utility.h"
+#include "parallel.h"
+
+namespace verify {
+
+    struct manifestEntry
+    {
+        std::size_t pathOffset; //In characters from the start of the text
+        std::size_t pathLength;
+        unsigned char digest[CryptoPP::SHA256::DIGESTSIZE];
+    };
+
+    enum entryStatus
+    {
+        STATUS_OK,
+        STATUS_CHANGED,
+        STATUS_MISSING,
+        STATUS_ERROR
+    };
+
+    class manifest
+    {
+        std::shared_ptr<const void> view;
+        const char* narrowText;
+        const wchar_t* wideText;
+        std::vector<manifestEntry> entries;
+
+        template <typename charT>
+        void index(const charT* text, const charT* end);
+    public:
+        manifest(const std::wstring& fileName);
+        std::size_t size() const { return entries.size(); }
+        const manifestEntry& operator[](std::size_t idx) const { return entries[idx]; }
+        std::wstring path(std::size_t idx) const;
+    };
+
+    template <typename charT>
+    static bool isBlank(charT ch)
+    {
+        return ch == ' ' || ch == '\t' || ch == '\r';
+    }
+
+    template <typename charT>
+    static bool parseDigest(const charT* hex, unsigned char* digest)
+    {
+        for (std::size_t idx = 0; idx < CryptoPP::SHA256::DIGESTSIZE * 2; ++idx)
+        {
+            unsigned int nibble;
+            charT ch = hex[idx];
+            if (ch >= '0' && ch <= '9')
+                nibble = ch - '0';
+            else if (ch >= 'a' && ch <= 'f')
+                nibble = ch - 'a' + 10;
+            else if (ch >= 'A' && ch <= 'F')
+                nibble = ch - 'A' + 10;
+            else
+                return false;
+            if (idx & 1)
+                digest[idx / 2] = static_cast<unsigned char>(digest[idx / 2] | nibble);
+            else
+                digest[idx / 2] = static_cast<unsigned char>(nibble << 4);
+        }
+        return true;
+    }
+
+    //Lines are "<SHA256> <PATH>", as written by sha256sum or by pevFind with
+    //--custom:##3 #f#. A '*' before the path is ignored, as are blank lines
+    //and lines beginning with '#' or ';'.
+    template <typename charT>
+    void manifest::index(const charT* text, const charT* end)
+    {
+        const std::size_t hexLength = CryptoPP::SHA256::DIGESTSIZE * 2;
+        std::size_t lineNumber = 0;
+        for (const charT* line = text; line != end;)
+        {
+            const charT* lineEnd = std::find(line, end, charT('\n'));
+            const charT* cursor = line;
+            const charT* last = lineEnd;
+            line = lineEnd == end ? end : lineEnd + 1;
+            ++lineNumber;
+
+            while (cursor != last && isBlank(*cursor))
+                ++cursor;
+            while (last != cursor && isBlank(last[-1]))
+                --last;
+            if (cursor == last || *cursor == '#' || *cursor == ';')
+                continue;
+
+            manifestEntry entry;
+            bool valid = static_cast<std::size_t>(last - cursor) > hexLength
+                && parseDigest(cursor, entry.digest)
+                && isBlank(cursor[hexLength]);
+            if (valid)
+            {
+                cursor += hexLength;
+                while (isBlank(*cursor))
+                    ++cursor;
+                if (*cursor == '*')
+                    ++cursor;
+                valid = cursor != last;
+            }
+            if (!valid)
+            {
+                char message[64];
+                sprintf_s(message, "Malformed manifest line %u.", static_cast<unsigned int>(lineNumber));
+                throw std::runtime_error(message);
+            }
+            entry.pathOffset = cursor - text;
+            entry.pathLength = last - cursor;
+            entries.push_back(entry);
+        }
+    }
+
+    manifest::manifest(const std::wstring& fileName) : narrowText(nullptr), wideText(nullptr)
+    {
+        std::size_t length = 0;
+        view = mapFile(fileName, length);
+        const unsigned char* bytes = static_cast<const unsigned char*>(view.get());
+        if (length >= 2 && bytes[0] == 0xFF && bytes[1] == 0xFE)
+        {
+            wideText = reinterpret_cast<const wchar_t*>(bytes + 2);
+            index(wideText, wideText + (length - 2) / sizeof(wchar_t));
+        }
+        else
+        {
+            if (length >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF)
+            {
+                bytes += 3;
+                length -= 3;
+            }
+            narrowText = reinterpret_cast<const char*>(bytes);
+            index(narrowText, narrowText + length);
+        }
+    }
+
+    std::wstring manifest::path(std::size_t idx) const
+    {
+        const manifestEntry& entry = entries[idx];
+        if (wideText)
+            return std::wstring(wideText + entry.pathOffset, entry.pathLength);
+        if (entry.pathLength == 0)
+            return std::wstring();
+        //UTF-8 unless the bytes are not valid UTF-8, in which case the ANSI
+        //code page is the best remaining guess.
+        const char* source = narrowText + entry.pathOffset;
+        int sourceLength = static_cast<int>(entry.pathLength);
+        UINT codePage = CP_UTF8;
+        int wideLength = MultiByteToWideChar(codePage, MB_ERR_INVALID_CHARS, source, sourceLength, NULL, 0);
+        if (wideLength == 0)
+        {
+            codePage = CP_ACP;
+            wideLength = MultiByteToWideChar(codePage, 0, source, sourceLength, NULL, 0);
+        }
+        std::wstring result(wideLength, L'\0');
+        if (wideLength)
+            MultiByteToWideChar(codePage, 0, source, sourceLength, &result[0], wideLength);
+        return result;
+    }
+
+    static bool isAbsolute(const std::wstring& path)
+    {
+        return (!path.empty() && (path[0] == L'\\' || path[0] == L'/'))
+            || (path.size() >= 2 && path[1] == L':');
+    }
+
+    //Case insensitive key for a relative path, used to spot files on disk
+    //which the manifest does not list.
+    static unsigned __int64 pathKey(std::wstring path)
+    {
+        if (!path.empty())
+            CharUpperBuffW(&path[0], static_cast<DWORD>(path.size()));
+        unsigned __int64 key = 14695981039346656037ull;
+        for (std::wstring::const_iterator it = path.begin(); it != path.end(); ++it)
+        {
+            key ^= (*it == L'/') ? L'\\' : *it;
+            key *= 1099511628211ull;
+        }
+        return key;
+    }
+
+    static double elapsedSeconds(const LARGE_INTEGER& start)
+    {
+        LARGE_INTEGER now, frequency;
+        QueryPerformanceCounter(&now);
+        QueryPerformanceFrequency(&frequency);
+        return static_cast<double>(now.QuadPart - start.QuadPart) / frequency.QuadPart;
+    }
+
+    //Calls found with the path (relative to root) of every file below root.
+    template <typename Func>
+    static void walkTree(const std::wstring& root, Func found)
+    {
+        std::vector<std::wstring> pending(1, std::wstring());
+        while (!pending.empty())
+        {
+            std::wstring relative(pending.back());
+            pending.pop_back();
+            WIN32_FIND_DATAW findData;
+            disable64.disableFS();
+            HANDLE hFind = FindFirstFileW((root + relative + L"*").c_str(), &findData);
+            disable64.enableFS();
+            if (hFind == INVALID_HANDLE_VALUE)
+                continue;
+            do
+            {
+                std::wstring name(findData.cFileName);
+                if (name == L"." || name == L"..")
+                    continue;
+                if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                {
+                    if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+                        pending.push_back(relative + name + L"\\");
+                }
+                else
+                {
+                    found(relative + name);
+                }
+            } while (FindNextFileW(hFind, &findData));
+            FindClose(hFind);
+        }
+    }
+
+int main(int argc, wchar_t* argv[])
+{
+    if (argc < 2 || argc > 3)
+        throw std::invalid_argument("Usage: VERIFY <MANIFEST> [ROOT]");
+
+    //Relative paths in the manifest are relative to ROOT, which defaults to
+    //the folder containing the manifest.
+    wchar_t fullManifestPath[MAX_PATH];
+    wchar_t* manifestName = nullptr;
+    if (!GetFullPathNameW(argv[1], MAX_PATH, fullManifestPath, &manifestName) || manifestName == nullptr)
+        throw std::invalid_argument("Invalid manifest path.");
+    std::wstring root;
+    if (argc == 3)
+    {
+        root = argv[2];
+        if (!root.empty() && root[root.size() - 1] != L'\\' && root[root.size() - 1] != L'/')
+            root.push_back(L'\\');
+    }
+    else
+    {
+        root.assign(fullManifestPath, manifestName);
+    }
+
+    manifest entries(fullManifestPath);
+    std::vector<unsigned char> status(entries.size(), STATUS_OK);
+    std::vector<DWORD> errors(entries.size(), ERROR_SUCCESS);
+    std::atomic<unsigned __int64> bytesHashed(0);
+
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+    parallelFor(entries.size(), [&](std::size_t idx) {
+        std::wstring path(entries.path(idx));
+        if (!isAbsolute(path))
+            path.insert(0, root);
+        FileData file(path);
+        unsigned char digest[CryptoPP::SHA256::DIGESTSIZE];
+        DWORD error = file.SHA256Digest(digest);
+        if (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND)
+        {
+            status[idx] = STATUS_MISSING;
+            return;
+        }
+        if (error != ERROR_SUCCESS)
+        {
+            status[idx] = STATUS_ERROR;
+            errors[idx] = error;
+            return;
+        }
+        bytesHashed += file.getSize();
+        if (std::memcmp(digest, entries[idx].digest, sizeof(digest)) != 0)
+            status[idx] = STATUS_CHANGED;
+    });
+    double seconds = elapsedSeconds(start);
+
+    std::size_t counts[STATUS_ERROR + 1] = {};
+    for (std::size_t idx = 0; idx < entries.size(); ++idx)
+    {
+        ++counts[status[idx]];
+        switch (status[idx])
+        {
+        case STATUS_CHANGED:
+            logger << L"CHANGED " << entries.path(idx) << L"\r\n";
+            break;
+        case STATUS_MISSING:
+            logger << L"MISSING " << entries.path(idx) << L"\r\n";
+            break;
+        case STATUS_ERROR:
+            {
+                wchar_t errorText[32];
+                swprintf_s(errorText, L"ERROR 0x%08X ", errors[idx]);
+                logger << errorText << entries.path(idx) << L"\r\n";
+            }
+            break;
+        }
+    }
+
+    //Extra files: anything under root that no relative manifest entry names.
+    std::vector<std::pair<unsigned __int64, std::size_t> > listed;
+    listed.reserve(entries.size());
+    for (std::size_t idx = 0; idx < entries.size(); ++idx)
+    {
+        std::wstring path(entries.path(idx));
+        if (!isAbsolute(path))
+            listed.push_back(std::make_pair(pathKey(path), idx));
+    }
+    std::sort(listed.begin(), listed.end());
+    std::size_t extras = 0;
+    if (!listed.empty())
+    {
+        std::wstring manifestRelative;
+        if (boost::algorithm::istarts_with(fullManifestPath, root))
+            manifestRelative.assign(fullManifestPath + root.size());
+        walkTree(root, [&](const std::wstring& relative) {
+            if (boost::algorithm::iequals(relative, manifestRelative))
+                return;
+            unsigned __int64 key = pathKey(relative);
+            std::vector<std::pair<unsigned __int64, std::size_t> >::const_iterator it =
+                std::lower_bound(listed.begin(), listed.end(), std::make_pair(key, std::size_t(0)));
+            for (; it != listed.end() && it->first == key; ++it)
+            {
+                std::wstring candidate(entries.path(it->second));
+                std::replace(candidate.begin(), candidate.end(), L'/', L'\\');
+                if (boost::algorithm::iequals(candidate, relative))
+                    return;
+            }
+            ++extras;
+            logger << L"EXTRA " << relative << L"\r\n";
+        });
+    }
+
+    unsigned __int64 totalBytes = bytesHashed;
+    wchar_t rate[64];
+    swprintf_s(rate, L"%.2f s, %.1f MB/s, %.0f files/s", seconds,
+        seconds > 0 ? totalBytes / 1048576.0 / seconds : 0.0,
+        seconds > 0 ? entries.size() / seconds : 0.0);
+    logger << L"\r\n Listed:  " << rightPad(getSizeString(entries.size()), 12)
+        << L"  OK:      " << getSizeString(counts[STATUS_OK])
+        << L"\r\n Changed: " << rightPad(getSizeString(counts[STATUS_CHANGED]), 12)
+        << L"  Missing: " << getSizeString(counts[STATUS_MISSING])
+        << L"\r\n Errors:  " << rightPad(getSizeString(counts[STATUS_ERROR]), 12)
+        << L"  Extra:   " << getSizeString(extras)
+        << L"\r\n Hashed:  " << getSizeString(totalBytes) << L" bytes in " << rate << L"\r\n";
+
+    return (counts[STATUS_OK] == entries.size() && extras == 0) ? 0 : 1;
+}
+
+}; //namespace verify
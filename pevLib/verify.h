@@ -0,0 +1,11 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// verify.h -- Defines the "VERIFY" subprogram, which checks files
+// against a manifest of SHA256 hashes.
+
+namespace verify {
+    int main(int argc, wchar_t* argv[]);
+}; //namespace verify
@@ -0,0 +1,276 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// versionInfo.cpp -- Implements the portable version resource decoder.
+
+#include "pch.hpp"
+#include <algorithm>
+#include "versionInfo.h"
+#include "peHeaders.h"
+
+namespace {
+
+    std::uint16_t read16(unsigned char const* data)
+    {
+        return static_cast<std::uint16_t>(data[0] | (data[1] << 8));
+    }
+    std::uint32_t read32(unsigned char const* data)
+    {
+        return static_cast<std::uint32_t>(data[0])
+            | (static_cast<std::uint32_t>(data[1]) << 8)
+            | (static_cast<std::uint32_t>(data[2]) << 16)
+            | (static_cast<std::uint32_t>(data[3]) << 24);
+    }
+    std::size_t align4(std::size_t offset)
+    {
+        return (offset + 3) & ~static_cast<std::size_t>(3);
+    }
+
+    // Resource strings are UTF-16; wchar_t is UTF-16 on Windows, and on other
+    // platforms each code unit is simply widened.
+    std::wstring readUtf16(unsigned char const* data, std::size_t characters)
+    {
+        std::wstring result(characters, L'\0');
+        for (std::size_t idx = 0; idx < characters; ++idx)
+            result[idx] = static_cast<wchar_t>(read16(data + idx * 2));
+        return result;
+    }
+
+    bool keyEquals(const std::wstring& lhs, const wchar_t* rhs)
+    {
+        std::size_t idx = 0;
+        for (; idx < lhs.size() && rhs[idx]; ++idx)
+        {
+            wchar_t left = lhs[idx];
+            wchar_t right = rhs[idx];
+            if (left >= L'a' && left <= L'z')
+                left = static_cast<wchar_t>(left - L'a' + L'A');
+            if (right >= L'a' && right <= L'z')
+                right = static_cast<wchar_t>(right - L'a' + L'A');
+            if (left != right)
+                return false;
+        }
+        return idx == lhs.size() && rhs[idx] == L'\0';
+    }
+
+    // One node of a VS_VERSIONINFO tree: wLength, wValueLength, wType, the
+    // null terminated key, then the value and children, each 32 bit aligned
+    // relative to the start of the block.
+    struct versionNode
+    {
+        std::size_t end;
+        std::size_t valueLength;
+        std::uint16_t type;
+        std::wstring key;
+        std::size_t valueOffset;
+        std::size_t childrenOffset;
+    };
+
+    bool readNode(unsigned char const* block, std::size_t limit, std::size_t offset, versionNode& node)
+    {
+        if (offset + 6 > limit)
+            return false;
+        std::size_t const length = read16(block + offset);
+        if (length < 6)
+            return false;
+        node.end = std::min(offset + length, limit);
+        node.valueLength = read16(block + offset + 2);
+        node.type = read16(block + offset + 4);
+
+        std::size_t keyEnd = offset + 6;
+        while (keyEnd + 2 <= node.end && read16(block + keyEnd) != 0)
+            keyEnd += 2;
+        if (keyEnd + 2 > node.end)
+            return false;
+        node.key = readUtf16(block + offset + 6, (keyEnd - offset - 6) / 2);
+        node.valueOffset = std::min(align4(keyEnd + 2), node.end);
+        std::size_t valueBytes = node.type == 1 ? node.valueLength * 2 : node.valueLength;
+        node.childrenOffset = std::min(align4(node.valueOffset + valueBytes), node.end);
+        return true;
+    }
+
+    bool parseTableKey(const std::wstring& key, versionInfo::translation& result)
+    {
+        if (key.size() != 8)
+            return false;
+        std::uint32_t value = 0;
+        for (std::size_t idx = 0; idx < 8; ++idx)
+        {
+            wchar_t ch = key[idx];
+            value <<= 4;
+            if (ch >= L'0' && ch <= L'9')
+                value |= ch - L'0';
+            else if (ch >= L'a' && ch <= L'f')
+                value |= ch - L'a' + 10;
+            else if (ch >= L'A' && ch <= L'F')
+                value |= ch - L'A' + 10;
+            else
+                return false;
+        }
+        result.language = static_cast<std::uint16_t>(value >> 16);
+        result.codePage = static_cast<std::uint16_t>(value);
+        return true;
+    }
+
+    // Resource directory layout, from the PE/COFF specification
+    const std::size_t resourceDirectorySize = 16;
+    const std::size_t resourceEntrySize = 8;
+    const std::uint32_t resourceSubdirectoryFlag = 0x80000000u;
+    const std::uint32_t resourceNameFlag = 0x80000000u;
+    const std::uint32_t rtVersion = 16;
+
+    // Finds the entry with the given integer id in the directory at offset
+    // (within the resource section), or the first entry if id is zero.
+    // Returns the entry's OffsetToData, or zero if there is none.
+    std::uint32_t findResourceEntry(unsigned char const* resources, std::size_t length, std::size_t offset, std::uint32_t id)
+    {
+        if (offset + resourceDirectorySize > length)
+            return 0;
+        std::size_t const namedEntries = read16(resources + offset + 12);
+        std::size_t const idEntries = read16(resources + offset + 14);
+        std::size_t const entries = offset + resourceDirectorySize;
+        for (std::size_t idx = 0; idx < namedEntries + idEntries; ++idx)
+        {
+            std::size_t const entry = entries + idx * resourceEntrySize;
+            if (entry + resourceEntrySize > length)
+                return 0;
+            std::uint32_t const name = read32(resources + entry);
+            if (id == 0 || (!(name & resourceNameFlag) && name == id))
+                return read32(resources + entry + 4);
+        }
+        return 0;
+    }
+
+}
+
+bool versionInfo::parseBlock(unsigned char const* block, std::size_t length)
+{
+    translations.clear();
+    tables.clear();
+
+    versionNode root;
+    if (!readNode(block, length, 0, root) || !keyEquals(root.key, L"VS_VERSION_INFO"))
+        return false;
+
+    for (std::size_t fileInfoOffset = root.childrenOffset; fileInfoOffset < root.end;)
+    {
+        versionNode fileInfo;
+        if (!readNode(block, root.end, fileInfoOffset, fileInfo))
+            break;
+        fileInfoOffset = align4(fileInfo.end);
+
+        if (keyEquals(fileInfo.key, L"StringFileInfo"))
+        {
+            for (std::size_t tableOffset = fileInfo.childrenOffset; tableOffset < fileInfo.end;)
+            {
+                versionNode tableNode;
+                if (!readNode(block, fileInfo.end, tableOffset, tableNode))
+                    break;
+                tableOffset = align4(tableNode.end);
+                stringTable table;
+                if (!parseTableKey(tableNode.key, table.key))
+                    continue;
+                for (std::size_t stringOffset = tableNode.childrenOffset; stringOffset < tableNode.end;)
+                {
+                    versionNode stringNode;
+                    if (!readNode(block, tableNode.end, stringOffset, stringNode))
+                        break;
+                    stringOffset = align4(stringNode.end);
+                    //String lengths are in characters whatever wType claims.
+                    std::size_t characters = std::min(stringNode.valueLength, (stringNode.end - stringNode.valueOffset) / 2);
+                    std::wstring value(readUtf16(block + stringNode.valueOffset, characters));
+                    //Remove a single trailing null if it exists.
+                    if (!value.empty() && value[value.size() - 1] == L'\0')
+                        value.erase(value.size() - 1);
+                    table.strings.push_back(std::make_pair(stringNode.key, value));
+                }
+                tables.push_back(table);
+            }
+        }
+        else if (keyEquals(fileInfo.key, L"VarFileInfo"))
+        {
+            for (std::size_t varOffset = fileInfo.childrenOffset; varOffset < fileInfo.end;)
+            {
+                versionNode varNode;
+                if (!readNode(block, fileInfo.end, varOffset, varNode))
+                    break;
+                varOffset = align4(varNode.end);
+                if (!keyEquals(varNode.key, L"Translation"))
+                    continue;
+                std::size_t valueEnd = std::min(varNode.valueOffset + varNode.valueLength, varNode.end);
+                for (std::size_t cursor = varNode.valueOffset; cursor + 4 <= valueEnd; cursor += 4)
+                {
+                    translation entry;
+                    entry.language = read16(block + cursor);
+                    entry.codePage = read16(block + cursor + 2);
+                    translations.push_back(entry);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool versionInfo::parseImage(const peHeaders& headers, unsigned char const* image, std::size_t length)
+{
+    peHeaders::dataDirectory directory = headers.getDataDirectory(peHeaders::DIRECTORY_RESOURCE);
+    std::uint32_t directoryOffset;
+    if (directory.size == 0 || !headers.rvaToOffset(directory.virtualAddress, directoryOffset) || directoryOffset >= length)
+        return false;
+    unsigned char const* resources = image + directoryOffset;
+    std::size_t const resourcesLength = length - directoryOffset;
+
+    //Type, then name, then language. Any name or language will do.
+    std::uint32_t entry = findResourceEntry(resources, resourcesLength, 0, rtVersion);
+    for (int level = 0; level < 2; ++level)
+    {
+        if (!(entry & resourceSubdirectoryFlag))
+            return false;
+        entry = findResourceEntry(resources, resourcesLength, entry & ~resourceSubdirectoryFlag, 0);
+    }
+    if (entry == 0 || (entry & resourceSubdirectoryFlag) || entry + 16 > resourcesLength)
+        return false;
+
+    std::uint32_t const dataRva = read32(resources + entry);
+    std::uint32_t const dataSize = read32(resources + entry + 4);
+    std::uint32_t dataOffset;
+    if (!headers.rvaToOffset(dataRva, dataOffset) || dataOffset >= length)
+        return false;
+    return parseBlock(image + dataOffset, std::min<std::size_t>(dataSize, length - dataOffset));
+}
+
+std::wstring versionInfo::queryString(const std::wstring& name) const
+{
+    std::vector<translation> order(translations);
+    translation enUs;
+    enUs.language = 1033;
+    enUs.codePage = 1200;
+    order.push_back(enUs);
+    enUs.codePage = 0x04E4;
+    order.push_back(enUs);
+    std::sort(order.begin(), order.end());
+    order.erase(std::unique(order.begin(), order.end()), order.end());
+
+    std::wstring result;
+    for (std::vector<translation>::const_iterator key = order.begin(); key != order.end(); ++key)
+    {
+        for (std::vector<stringTable>::const_iterator table = tables.begin(); table != tables.end(); ++table)
+        {
+            if (!(table->key == *key))
+                continue;
+            for (std::vector<std::pair<std::wstring, std::wstring> >::const_iterator it = table->strings.begin(); it != table->strings.end(); ++it)
+            {
+                if (!keyEquals(it->first, name.c_str()) || it->second.empty())
+                    continue;
+                if (!result.empty())
+                    result.append(L" / ");
+                result.append(it->second);
+                break;
+            }
+            break;
+        }
+    }
+    return result;
+}
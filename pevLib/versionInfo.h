@@ -0,0 +1,61 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// versionInfo.h -- A portable decoder for version resources. It walks
+// an image's resource directory to RT_VERSION and decodes VS_VERSIONINFO,
+// keeping every StringFileInfo string and the translation list, so all
+// of the version fields of a file come from a single pass.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class peHeaders;
+
+class versionInfo
+{
+public:
+    struct translation
+    {
+        std::uint16_t language;
+        std::uint16_t codePage;
+        bool operator==(const translation& rhs) const
+        {
+            return language == rhs.language && codePage == rhs.codePage;
+        }
+        bool operator<(const translation& rhs) const
+        {
+            if (language != rhs.language)
+                return language < rhs.language;
+            return codePage < rhs.codePage;
+        }
+    };
+    struct stringTable
+    {
+        translation key;
+        std::vector<std::pair<std::wstring, std::wstring> > strings; // name, value
+    };
+private:
+    std::vector<translation> translations;
+    std::vector<stringTable> tables;
+public:
+    // Decodes a VS_VERSIONINFO block, such as the one GetFileVersionInfo
+    // returns. Returns false if the block is malformed.
+    bool parseBlock(unsigned char const* block, std::size_t length);
+    // Finds the RT_VERSION resource of a PE image and decodes it. image holds
+    // the whole file (typically a mapped view). Returns false if the image
+    // has no version resource or it is malformed.
+    bool parseImage(const peHeaders& headers, unsigned char const* image, std::size_t length);
+
+    std::vector<translation> const& getTranslations() const { return translations; }
+    std::vector<stringTable> const& getStringTables() const { return tables; }
+
+    // Returns the named string (for example L"CompanyName") from every
+    // string table which has it, joined by " / ". The tables are tried in
+    // the order of the file's translations plus US English in the Unicode
+    // and Windows-1252 code pages, sorted and without duplicates.
+    std::wstring queryString(const std::wstring& name) const;
+};
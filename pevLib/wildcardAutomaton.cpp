@@ -0,0 +1,584 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// wildcardAutomaton.cpp -- Implements the compiled vFind wildcard patterns.
+
+#include "pch.hpp"
+#include <algorithm>
+#include <map>
+#include <cwchar>
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "wildcardAutomaton.h"
+#include "fpattern.h"
+
+namespace {
+
+    //Lowercase of every UTF-16 code unit, filled in by the first pattern compiled
+    std::vector<wchar_t> foldings;
+
+    //Returned in place of a start state when an automaton would be too large
+    const std::size_t TOO_LARGE = static_cast<std::size_t>(-1);
+
+    void buildFoldings()
+    {
+        foldings.resize(0x10000);
+        for (std::size_t idx = 0; idx < foldings.size(); ++idx)
+            foldings[idx] = static_cast<wchar_t>(idx);
+        //Surrogates are not characters on their own, so they fold to themselves
+        std::vector<wchar_t> source(foldings);
+        ::LCMapStringW(LOCALE_INVARIANT, LCMAP_LOWERCASE, &source[1], 0xD800 - 1, &foldings[1], 0xD800 - 1);
+        ::LCMapStringW(LOCALE_INVARIANT, LCMAP_LOWERCASE, &source[0xE000], 0x2000, &foldings[0xE000], 0x2000);
+    }
+
+    //One position of a pattern
+    struct element
+    {
+        enum elementKind
+        {
+            //One character in (or, if negated, not in) ranges
+            CHARACTER,
+            //* : any run of characters
+            ANY_RUN,
+            //^Z : any run of characters other than '.'
+            NAME_RUN,
+            //! : the rest of the pattern must not match the rest of the name
+            NOT
+        };
+        elementKind kind;
+        bool negated;
+        //Inclusive ranges of folded characters
+        std::vector<std::pair<unsigned int, unsigned int> > ranges;
+        element(elementKind kind_) : kind(kind_), negated(false)
+        {}
+    };
+
+    void addCharacter(std::vector<element>& elements, wchar_t character)
+    {
+        unsigned int folded = wildcardAutomaton::fold(character);
+        elements.push_back(element(element::CHARACTER));
+        elements.back().ranges.push_back(std::make_pair(folded, folded));
+    }
+
+    //Splits a pattern into elements, reading it exactly as fpattern_submatch
+    //does. fpattern_isvalid does not look at the character after a !, so an
+    //unfinished quote or set can still end the pattern; as in fpattern, it
+    //matches nothing.
+    std::vector<element> parse(const std::wstring& pattern)
+    {
+        std::vector<element> elements;
+        const wchar_t *pat = pattern.c_str();
+        while (*pat != L'\0')
+        {
+            wchar_t pch = *pat++;
+            switch (pch)
+            {
+            case FPAT_ANY:
+                elements.push_back(element(element::CHARACTER));
+                elements.back().negated = true;
+                break;
+            case FPAT_CLOS:
+                elements.push_back(element(element::ANY_RUN));
+                break;
+            case FPAT_CLOSP:
+                elements.push_back(element(element::NAME_RUN));
+                break;
+            case FPAT_QUOTE2:
+                if (*pat == L'\0')
+                {
+                    elements.push_back(element(element::CHARACTER));
+                    return elements;
+                }
+                addCharacter(elements, *pat++);
+                break;
+            case FPAT_SET_L:
+                elements.push_back(element(element::CHARACTER));
+                if (*pat == FPAT_SET_NOT)
+                {
+                    ++pat;
+                    elements.back().negated = true;
+                }
+                while (*pat != FPAT_SET_R && *pat != L'\0')
+                {
+                    if (*pat == FPAT_QUOTE2)
+                        ++pat;
+                    if (*pat == L'\0')
+                        break;
+                    wchar_t lo = *pat++;
+                    wchar_t hi = lo;
+                    if (*pat == FPAT_SET_THRU)
+                    {
+                        ++pat;
+                        if (*pat == FPAT_QUOTE2)
+                            ++pat;
+                        if (*pat == L'\0')
+                            break;
+                        hi = *pat++;
+                    }
+                    if (*pat == L'\0')
+                        break;
+                    unsigned int foldedLo = wildcardAutomaton::fold(lo);
+                    unsigned int foldedHi = wildcardAutomaton::fold(hi);
+                    if (foldedLo <= foldedHi)
+                        elements.back().ranges.push_back(std::make_pair(foldedLo, foldedHi));
+                }
+                if (*pat == L'\0')
+                {
+                    elements.back().negated = false;
+                    elements.back().ranges.clear();
+                    return elements;
+                }
+                ++pat;
+                break;
+            case FPAT_NOT:
+                elements.push_back(element(element::NOT));
+                break;
+            default:
+                addCharacter(elements, pch);
+                break;
+            }
+        }
+        return elements;
+    }
+
+    //If the elements from first on match only one text, sets text to it, folded
+    bool literalText(const std::vector<element>& elements, std::size_t first, std::wstring& text)
+    {
+        text.clear();
+        for (std::size_t idx = first; idx < elements.size(); ++idx)
+        {
+            const element& part = elements[idx];
+            if (part.kind != element::CHARACTER || part.negated || part.ranges.size() != 1 || part.ranges[0].first != part.ranges[0].second)
+                return false;
+            text.push_back(static_cast<wchar_t>(part.ranges[0].first));
+        }
+        return true;
+    }
+
+    //FNV-1a of the folded text
+    std::size_t foldedHash(const wchar_t *begin, std::size_t length)
+    {
+        unsigned __int32 hash = 2166136261U;
+        for (std::size_t idx = 0; idx < length; ++idx)
+        {
+            hash ^= foldings[static_cast<unsigned short>(begin[idx])];
+            hash *= 16777619U;
+        }
+        return hash;
+    }
+
+    //Classes of characters, as a flag per class
+    typedef std::vector<bool> classSet;
+
+    struct nfaState
+    {
+        //Characters of the set lead to the state
+        std::vector<std::pair<classSet, std::size_t> > edges;
+        std::vector<std::size_t> epsilons;
+        bool accepting;
+        nfaState() : accepting(false)
+        {}
+    };
+
+    struct dfa
+    {
+        std::vector<unsigned short> transitions;
+        std::vector<bool> accepting;
+        std::size_t size() const { return accepting.size(); }
+    };
+
+    //Builds the automata for a pattern over classes of folded characters
+    class patternCompiler
+    {
+        const std::vector<unsigned int>& bounds;
+        std::vector<nfaState> states;
+        std::size_t addState()
+        {
+            states.push_back(nfaState());
+            return states.size() - 1;
+        }
+        std::size_t classOfFolded(unsigned int folded) const
+        {
+            return std::upper_bound(bounds.begin(), bounds.end(), folded) - bounds.begin() - 1;
+        }
+        void closure(std::vector<std::size_t>& set) const
+        {
+            for (std::size_t idx = 0; idx < set.size(); ++idx)
+            {
+                const std::vector<std::size_t>& epsilons = states[set[idx]].epsilons;
+                for (std::vector<std::size_t>::const_iterator it = epsilons.begin(); it != epsilons.end(); ++it)
+                    if (std::find(set.begin(), set.end(), *it) == set.end())
+                        set.push_back(*it);
+            }
+            std::sort(set.begin(), set.end());
+        }
+    public:
+        patternCompiler(const std::vector<unsigned int>& bounds_) : bounds(bounds_)
+        {}
+        std::size_t size() const { return states.size(); }
+        const nfaState& operator[](std::size_t idx) const { return states[idx]; }
+        classSet characterClasses(const element& character) const
+        {
+            classSet result(bounds.size(), false);
+            for (std::vector<std::pair<unsigned int, unsigned int> >::const_iterator it = character.ranges.begin(); it != character.ranges.end(); ++it)
+            {
+                std::size_t last = classOfFolded(it->second);
+                for (std::size_t idx = classOfFolded(it->first); idx <= last; ++idx)
+                    result[idx] = true;
+            }
+            if (character.negated)
+                result.flip();
+            return result;
+        }
+        //Adds states matching elements from first on; returns the start state,
+        //or TOO_LARGE if a negated part has too large an automaton
+        std::size_t addPattern(const std::vector<element>& elements, std::size_t first)
+        {
+            std::size_t start = addState();
+            std::size_t current = start;
+            for (std::size_t idx = first; idx < elements.size(); ++idx)
+            {
+                const element& part = elements[idx];
+                //A ! with nothing after it matches nothing, like fpattern
+                if (part.kind == element::NOT && idx + 1 == elements.size())
+                    return start;
+                if (part.kind == element::NOT)
+                {
+                    std::size_t rest = addComplement(elements, idx + 1);
+                    if (rest == TOO_LARGE)
+                        return rest;
+                    states[current].epsilons.push_back(rest);
+                    return start;
+                }
+                if (part.kind == element::CHARACTER)
+                {
+                    std::size_t next = addState();
+                    states[current].edges.push_back(std::make_pair(characterClasses(part), next));
+                    current = next;
+                    continue;
+                }
+                classSet looped(bounds.size(), true);
+                if (part.kind == element::NAME_RUN)
+                    looped[classOfFolded(L'.')] = false;
+                std::size_t next = addState();
+                states[current].edges.push_back(std::make_pair(looped, current));
+                states[current].epsilons.push_back(next);
+                current = next;
+            }
+            states[current].accepting = true;
+            return start;
+        }
+        //Adds states accepting exactly the names elements from first on reject
+        std::size_t addComplement(const std::vector<element>& elements, std::size_t first)
+        {
+            std::size_t restStart = addPattern(elements, first);
+            dfa rest;
+            if (restStart == TOO_LARGE || !determinize(std::vector<std::size_t>(1, restStart), rest))
+                return TOO_LARGE;
+            std::size_t offset = states.size();
+            for (std::size_t state = 0; state < rest.size(); ++state)
+                addState();
+            for (std::size_t state = 0; state < rest.size(); ++state)
+            {
+                std::map<std::size_t, classSet> targets;
+                for (std::size_t character = 0; character < bounds.size(); ++character)
+                {
+                    classSet& target = targets[offset + rest.transitions[state * bounds.size() + character]];
+                    target.resize(bounds.size(), false);
+                    target[character] = true;
+                }
+                for (std::map<std::size_t, classSet>::const_iterator it = targets.begin(); it != targets.end(); ++it)
+                    states[offset + state].edges.push_back(std::make_pair(it->second, it->first));
+                states[offset + state].accepting = !rest.accepting[state];
+            }
+            return offset;
+        }
+        //Subset construction from the union of starts. Every state has a
+        //transition for every class; the empty subset is a rejecting state like
+        //any other. Returns false if the automaton would be over the size limit.
+        bool determinize(const std::vector<std::size_t>& starts, dfa& result) const
+        {
+            std::map<std::vector<std::size_t>, unsigned short> numbers;
+            std::vector<std::vector<std::size_t> > subsets(1, starts);
+            closure(subsets[0]);
+            numbers.insert(std::make_pair(subsets[0], static_cast<unsigned short>(0)));
+            for (std::size_t current = 0; current < subsets.size(); ++current)
+            {
+                bool accepting = false;
+                for (std::vector<std::size_t>::const_iterator it = subsets[current].begin(); it != subsets[current].end(); ++it)
+                    accepting = accepting || states[*it].accepting;
+                result.accepting.push_back(accepting);
+                for (std::size_t character = 0; character < bounds.size(); ++character)
+                {
+                    std::vector<std::size_t> next;
+                    for (std::vector<std::size_t>::const_iterator it = subsets[current].begin(); it != subsets[current].end(); ++it)
+                    {
+                        const std::vector<std::pair<classSet, std::size_t> >& edges = states[*it].edges;
+                        for (std::vector<std::pair<classSet, std::size_t> >::const_iterator edge = edges.begin(); edge != edges.end(); ++edge)
+                            if (edge->first[character] && std::find(next.begin(), next.end(), edge->second) == next.end())
+                                next.push_back(edge->second);
+                    }
+                    closure(next);
+                    std::map<std::vector<std::size_t>, unsigned short>::const_iterator found = numbers.find(next);
+                    if (found == numbers.end())
+                    {
+                        if (subsets.size() == wildcardAutomaton::STATE_LIMIT)
+                            return false;
+                        found = numbers.insert(std::make_pair(next, static_cast<unsigned short>(subsets.size()))).first;
+                        subsets.push_back(next);
+                    }
+                    result.transitions.push_back(found->second);
+                }
+            }
+            return true;
+        }
+    };
+
+}
+
+wildcardAutomaton::wildcardAutomaton(const std::vector<std::wstring>& patterns_)
+    : kind(BACKTRACKING), patterns(patterns_), firstAbsorbing(0), starts(0), skips(0), finals(0)
+{
+    if (foldings.empty())
+        buildFoldings();
+    std::vector<std::vector<element> > parsed;
+    bool negates = false;
+    bounds.push_back(0);
+    bounds.push_back(L'.');
+    bounds.push_back(L'.' + 1);
+    for (std::vector<std::wstring>::const_iterator pattern = patterns.begin(); pattern != patterns.end(); ++pattern)
+    {
+        parsed.push_back(parse(*pattern));
+        for (std::vector<element>::const_iterator it = parsed.back().begin(); it != parsed.back().end(); ++it)
+        {
+            negates = negates || it->kind == element::NOT;
+            for (std::vector<std::pair<unsigned int, unsigned int> >::const_iterator range = it->ranges.begin(); range != it->ranges.end(); ++range)
+            {
+                bounds.push_back(range->first);
+                bounds.push_back(range->second + 1);
+            }
+        }
+    }
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+    if (bounds.back() > 0xFFFF)
+        bounds.pop_back();
+    classCount = bounds.size();
+    for (wchar_t character = 0; character < 128; ++character)
+        asciiClasses[character] = static_cast<unsigned short>(std::upper_bound(bounds.begin(), bounds.end(), static_cast<unsigned int>(fold(character))) - bounds.begin() - 1);
+
+    patternCompiler compiler(bounds);
+    std::vector<std::size_t> startStates;
+    for (std::vector<std::vector<element> >::const_iterator it = parsed.begin(); it != parsed.end(); ++it)
+    {
+        startStates.push_back(compiler.addPattern(*it, 0));
+        if (startStates.back() == TOO_LARGE)
+            return;
+    }
+    dfa automaton;
+    if (compiler.determinize(startStates, automaton))
+    {
+        kind = DETERMINISTIC;
+        //An absorbing start state is the only state, so the start stays row 0
+        std::vector<std::size_t> order;
+        std::vector<std::size_t> absorbing;
+        for (std::size_t state = 0; state < automaton.size(); ++state)
+        {
+            unsigned short const *row = &automaton.transitions[state * classCount];
+            if (std::count(row, row + classCount, static_cast<unsigned short>(state)) == static_cast<std::ptrdiff_t>(classCount))
+                absorbing.push_back(state);
+            else
+                order.push_back(state);
+        }
+        firstAbsorbing = order.size() * classCount;
+        order.insert(order.end(), absorbing.begin(), absorbing.end());
+        std::vector<unsigned int> rows(order.size());
+        for (std::size_t idx = 0; idx < order.size(); ++idx)
+            rows[order[idx]] = static_cast<unsigned int>(idx * classCount);
+        for (std::size_t idx = 0; idx < order.size(); ++idx)
+        {
+            accepting.push_back(automaton.accepting[order[idx]]);
+            for (std::size_t character = 0; character < classCount; ++character)
+                transitions.push_back(rows[automaton.transitions[order[idx] * classCount + character]]);
+        }
+        return;
+    }
+    //Without negation, each pattern's NFA states are the positions between its
+    //elements, one after the other, and the last has no way out. The sets of
+    //states fit in a word if the patterns are short enough.
+    if (negates || compiler.size() > 64)
+        return;
+    kind = BIT_PARALLEL;
+    steps.resize(classCount, 0);
+    loops.resize(classCount, 0);
+    for (std::vector<std::size_t>::const_iterator it = startStates.begin(); it != startStates.end(); ++it)
+        starts |= static_cast<unsigned __int64>(1) << *it;
+    for (std::size_t state = 0; state < compiler.size(); ++state)
+    {
+        unsigned __int64 const bit = static_cast<unsigned __int64>(1) << state;
+        if (compiler[state].accepting)
+            finals |= bit;
+        if (!compiler[state].epsilons.empty())
+            skips |= bit;
+        const std::vector<std::pair<classSet, std::size_t> >& edges = compiler[state].edges;
+        for (std::vector<std::pair<classSet, std::size_t> >::const_iterator edge = edges.begin(); edge != edges.end(); ++edge)
+        {
+            std::vector<unsigned __int64>& masks = edge->second == state ? loops : steps;
+            for (std::size_t character = 0; character < classCount; ++character)
+                if (edge->first[character])
+                    masks[character] |= bit;
+        }
+    }
+}
+
+std::size_t wildcardAutomaton::classOf(wchar_t character) const
+{
+    if (character < 128)
+        return asciiClasses[character];
+    wchar_t folded = foldings[static_cast<unsigned short>(character)];
+    return std::upper_bound(bounds.begin(), bounds.end(), static_cast<unsigned int>(folded)) - bounds.begin() - 1;
+}
+
+unsigned __int64 wildcardAutomaton::skipAhead(unsigned __int64 positions) const
+{
+    for (;;)
+    {
+        unsigned __int64 reached = positions | ((positions & skips) << 1);
+        if (reached == positions)
+            return positions;
+        positions = reached;
+    }
+}
+
+bool wildcardAutomaton::match(const wchar_t *name) const
+{
+    if (kind == DETERMINISTIC)
+    {
+        std::size_t row = 0;
+        for (; *name != L'\0' && row < firstAbsorbing; ++name)
+            row = transitions[row + classOf(*name)];
+        return accepting[row / classCount];
+    }
+    if (kind == BIT_PARALLEL)
+    {
+        unsigned __int64 positions = skipAhead(starts);
+        for (; *name != L'\0' && positions; ++name)
+        {
+            std::size_t character = classOf(*name);
+            positions = skipAhead(((positions & steps[character]) << 1) | (positions & loops[character]));
+        }
+        return (positions & finals) != 0;
+    }
+    for (std::vector<std::wstring>::const_iterator it = patterns.begin(); it != patterns.end(); ++it)
+        if (fpattern_matchn(it->c_str(), name))
+            return true;
+    return false;
+}
+
+bool wildcardAutomaton::isCompiled() const
+{
+    return kind != BACKTRACKING;
+}
+
+wchar_t wildcardAutomaton::fold(wchar_t character)
+{
+    if (foldings.empty())
+        buildFoldings();
+    return foldings[static_cast<unsigned short>(character)];
+}
+
+void wildcardSet::stringTable::insert(const std::wstring& text)
+{
+    if (contains(text.c_str(), text.size()))
+        return;
+    entries.push_back(text);
+    if (entries.size() * 2 > slots.size())
+    {
+        slots.assign(std::max<std::size_t>(16, slots.size() * 2), 0);
+        for (std::size_t entry = 0; entry < entries.size(); ++entry)
+        {
+            std::size_t idx = foldedHash(entries[entry].c_str(), entries[entry].size()) & (slots.size() - 1);
+            while (slots[idx])
+                idx = (idx + 1) & (slots.size() - 1);
+            slots[idx] = entry + 1;
+        }
+        return;
+    }
+    std::size_t idx = foldedHash(text.c_str(), text.size()) & (slots.size() - 1);
+    while (slots[idx])
+        idx = (idx + 1) & (slots.size() - 1);
+    slots[idx] = entries.size();
+}
+
+bool wildcardSet::stringTable::contains(const wchar_t *begin, std::size_t length) const
+{
+    if (slots.empty())
+        return false;
+    for (std::size_t idx = foldedHash(begin, length) & (slots.size() - 1); slots[idx]; idx = (idx + 1) & (slots.size() - 1))
+    {
+        const std::wstring& entry = entries[slots[idx] - 1];
+        if (entry.size() != length)
+            continue;
+        std::size_t matched = 0;
+        while (matched < length && foldings[static_cast<unsigned short>(begin[matched])] == entry[matched])
+            ++matched;
+        if (matched == length)
+            return true;
+    }
+    return false;
+}
+
+wildcardSet::wildcardSet(const std::vector<std::wstring>& patterns)
+{
+    if (foldings.empty())
+        buildFoldings();
+    std::vector<std::wstring> others;
+    std::wstring text;
+    for (std::vector<std::wstring>::const_iterator it = patterns.begin(); it != patterns.end(); ++it)
+    {
+        std::vector<element> elements(parse(*it));
+        if (literalText(elements, 0, text))
+            names.insert(text);
+        else if (!elements.empty() && elements[0].kind == element::ANY_RUN && literalText(elements, 1, text))
+        {
+            suffixes.insert(text);
+            if (std::find(suffixLengths.begin(), suffixLengths.end(), text.size()) == suffixLengths.end())
+                suffixLengths.push_back(text.size());
+        }
+        else
+            others.push_back(*it);
+    }
+    if (!others.empty())
+        addAutomata(others.begin(), others.end());
+}
+
+//Puts the patterns in one automaton if it can be compiled, and otherwise
+//splits them in half until it can, or until they are on their own
+void wildcardSet::addAutomata(std::vector<std::wstring>::const_iterator first, std::vector<std::wstring>::const_iterator last)
+{
+    std::shared_ptr<wildcardAutomaton> automaton(std::make_shared<wildcardAutomaton>(std::vector<std::wstring>(first, last)));
+    if (automaton->isCompiled() || last - first == 1)
+    {
+        automata.push_back(automaton);
+        return;
+    }
+    std::vector<std::wstring>::const_iterator middle = first + (last - first) / 2;
+    addAutomata(first, middle);
+    addAutomata(middle, last);
+}
+
+bool wildcardSet::match(const wchar_t *name) const
+{
+    std::size_t length = std::wcslen(name);
+    if (names.contains(name, length))
+        return true;
+    for (std::vector<std::size_t>::const_iterator it = suffixLengths.begin(); it != suffixLengths.end(); ++it)
+        if (*it <= length && suffixes.contains(name + length - *it, *it))
+            return true;
+    for (std::vector<std::shared_ptr<wildcardAutomaton> >::const_iterator it = automata.begin(); it != automata.end(); ++it)
+        if ((*it)->match(name))
+            return true;
+    return false;
+}
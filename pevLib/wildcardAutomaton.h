@@ -0,0 +1,94 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// wildcardAutomaton.h -- Matches vFind wildcard patterns in one pass.
+// fpattern matches by backtracking, trying every split of the name at each *
+// and ^Z, and folds case with the C library's tolower. Here a pattern is
+// compiled once into a deterministic automaton over the classes of case
+// folded characters the pattern can tell apart, so a name costs one table
+// lookup per character. Patterns whose automaton would be too large run as a
+// bit-parallel NFA instead.
+// A wildcardSet matches any of many patterns, as an OR of vFind regexes with
+// the same root asks, in one pass: plain names and *.ext patterns are looked
+// up in hash tables, and the rest share as few automata as they fit in.
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+
+class wildcardAutomaton
+{
+    enum engine
+    {
+        DETERMINISTIC,
+        BIT_PARALLEL,
+        //Only for patterns the other engines cannot hold; runs fpattern
+        BACKTRACKING
+    };
+    engine kind;
+    std::vector<std::wstring> patterns;
+    //Class k holds the folded characters from bounds[k] up to bounds[k + 1]
+    std::vector<unsigned int> bounds;
+    //The classes of ASCII characters, before folding
+    unsigned short asciiClasses[128];
+    std::size_t classCount;
+    //DETERMINISTIC: each state is a row of classCount transitions, which hold
+    //the index of the row they lead to. The start state is row 0. States every
+    //character leads back to are numbered last, from the row firstAbsorbing.
+    std::vector<unsigned int> transitions;
+    std::vector<bool> accepting;
+    std::size_t firstAbsorbing;
+    //BIT_PARALLEL: per class, the positions a character of the class moves
+    //past, and those (at * or ^Z) it stays at
+    std::vector<unsigned __int64> steps;
+    std::vector<unsigned __int64> loops;
+    //The positions where patterns start, those which may be skipped without
+    //reading, and accepting positions
+    unsigned __int64 starts;
+    unsigned __int64 skips;
+    unsigned __int64 finals;
+    std::size_t classOf(wchar_t character) const;
+    unsigned __int64 skipAhead(unsigned __int64 positions) const;
+public:
+    //The largest deterministic automaton built
+    static const std::size_t STATE_LIMIT = 512;
+    //Compiles the union of patterns, which fpattern_isvalid must accept
+    explicit wildcardAutomaton(const std::vector<std::wstring>& patterns_);
+    //True if fpattern_matchn(pattern, name) is true for any of the patterns
+    bool match(const wchar_t *name) const;
+    //False if the patterns are run by fpattern, their automata being too large
+    bool isCompiled() const;
+    //The case folding used for names and patterns: Unicode lowercase in the
+    //invariant locale, the same for every user and thread.
+    static wchar_t fold(wchar_t character);
+};
+
+class wildcardSet
+{
+    //Open addressing table of case folded strings
+    class stringTable
+    {
+        std::vector<std::wstring> entries;
+        //One more than the index into entries, or 0 if empty
+        std::vector<std::size_t> slots;
+    public:
+        //Adds text, already folded
+        void insert(const std::wstring& text);
+        //True if the text of length characters at begin folds to an entry
+        bool contains(const wchar_t *begin, std::size_t length) const;
+    };
+    //Patterns without wildcards
+    stringTable names;
+    //Patterns of a * followed by text without wildcards, by that text
+    stringTable suffixes;
+    std::vector<std::size_t> suffixLengths;
+    std::vector<std::shared_ptr<wildcardAutomaton> > automata;
+    void addAutomata(std::vector<std::wstring>::const_iterator first, std::vector<std::wstring>::const_iterator last);
+public:
+    //Compiles patterns, which fpattern_isvalid must accept
+    explicit wildcardSet(const std::vector<std::wstring>& patterns);
+    //True if fpattern_matchn(pattern, name) is true for any of the patterns
+    bool match(const wchar_t *name) const;
+};
@@ -0,0 +1,244 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// authenticodeTests.cpp -- Tests for the DER reader, the embedded signature
+// decoder and the Authenticode image digest.
+
+#include <string>
+#include "test.h"
+#include "testImages.h"
+#include "der.h"
+#include "authenticode.h"
+
+namespace {
+
+    const unsigned char oidSpcIndirectData[] = { 0x2B, 0x06, 0x01, 0x04, 0x01, 0x82, 0x37, 0x02, 0x01, 0x04 };
+    const unsigned char oidSpcPeImageData[] = { 0x2B, 0x06, 0x01, 0x04, 0x01, 0x82, 0x37, 0x02, 0x01, 0x0F };
+    const unsigned char oidSha256[] = { 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01 };
+    const unsigned char oidCommonName[] = { 0x55, 0x04, 0x03 };
+    const unsigned char serial[] = { 0x01, 0x23, 0x45 };
+    const unsigned char otherSerial[] = { 0x67 };
+
+    void append(byteBuffer& target, const byteBuffer& source)
+    {
+        target.insert(target.end(), source.begin(), source.end());
+    }
+
+    byteBuffer name(const byteBuffer& commonName)
+    {
+        return derEncode(DER_SEQUENCE, derEncode(DER_SET, derEncode(DER_SEQUENCE, derBytes(DER_OID, oidCommonName), commonName)));
+    }
+
+    byteBuffer certificate(const byteBuffer& serialNumber, const byteBuffer& issuer, const byteBuffer& subject)
+    {
+        static const unsigned char version[] = { 2 };
+        byteBuffer tbs(derEncode(DER_CONTEXT_0, derBytes(DER_INTEGER, version)));
+        append(tbs, serialNumber);
+        append(tbs, derEncode(DER_SEQUENCE, derBytes(DER_OID, oidSha256)));
+        append(tbs, issuer);
+        append(tbs, derEncode(DER_SEQUENCE, byteBuffer()));
+        append(tbs, subject);
+        return derEncode(DER_SEQUENCE, derEncode(DER_SEQUENCE, tbs),
+            derEncode(DER_SEQUENCE, derBytes(DER_OID, oidSha256)), derEncode(0x03, byteBuffer(1, 0)));
+    }
+
+    byteBuffer digestBytes()
+    {
+        byteBuffer digest;
+        for (unsigned char idx = 0; idx < 32; ++idx)
+            digest.push_back(static_cast<unsigned char>(idx * 7));
+        return digest;
+    }
+
+    //A signature over digestBytes() by "Test Signer", issued by "Test CA".
+    //A second certificate with another serial number comes first.
+    byteBuffer signature(bool withSigner)
+    {
+        byteBuffer algorithm(derEncode(DER_SEQUENCE, derBytes(DER_OID, oidSha256), derEncode(0x05, byteBuffer())));
+        byteBuffer indirectData(derEncode(DER_SEQUENCE,
+            derEncode(DER_SEQUENCE, derBytes(DER_OID, oidSpcPeImageData)),
+            derEncode(DER_SEQUENCE, algorithm, derEncode(DER_OCTET_STRING, digestBytes()))));
+
+        byteBuffer issuer(name(derText(DER_UTF8_STRING, "Test CA")));
+        byteBuffer rest(derEncode(DER_CONTEXT_0,
+            certificate(derBytes(DER_INTEGER, otherSerial), issuer, name(derText(DER_PRINTABLE_STRING, "Someone Else"))),
+            certificate(derBytes(DER_INTEGER, serial), issuer, name(derText(DER_UTF8_STRING, "Test Signer")))));
+        if (withSigner)
+        {
+            static const unsigned char version[] = { 1 };
+            byteBuffer signerInfo(derEncode(DER_SEQUENCE, derBytes(DER_INTEGER, version),
+                derEncode(DER_SEQUENCE, issuer, derBytes(DER_INTEGER, serial))));
+            append(rest, derEncode(DER_SET, signerInfo));
+        }
+        return derSignedData(oidSpcIndirectData, indirectData, rest);
+    }
+
+    byteBuffer certificateEntry(std::uint16_t type, const byteBuffer& contents)
+    {
+        byteBuffer entry(8);
+        put32(entry, 0, static_cast<std::uint32_t>(8 + contents.size()));
+        put16(entry, 4, 0x200);
+        put16(entry, 6, type);
+        append(entry, contents);
+        while (entry.size() % 8)
+            entry.push_back(0);
+        return entry;
+    }
+
+}
+
+TEST(derReaderDecodesLengths)
+{
+    byteBuffer longContents(300, 0xAB);
+    byteBuffer encoded(derEncode(DER_OCTET_STRING, byteBuffer(3, 1)));
+    append(encoded, derEncode(DER_OCTET_STRING, longContents));
+    CHECK(encoded[6] == 0x82);
+
+    derReader reader(&encoded[0], encoded.size());
+    derElement element;
+    CHECK(reader.next(element, DER_OCTET_STRING) && element.length == 3 && element.encodedLength == 5);
+    CHECK(reader.next(element, DER_OCTET_STRING) && element.length == 300 && element.encodedLength == 304);
+    CHECK(reader.atEnd());
+    CHECK(!reader.next(element));
+}
+
+TEST(derReaderRejectsMalformedElements)
+{
+    derElement element;
+    //Indefinite length
+    unsigned char const indefinite[] = { 0x30, 0x80, 0x00, 0x00 };
+    CHECK(!derReader(indefinite, sizeof(indefinite)).next(element));
+    //Five length bytes
+    unsigned char const tooLong[] = { 0x04, 0x85, 0, 0, 0, 0, 1, 0 };
+    CHECK(!derReader(tooLong, sizeof(tooLong)).next(element));
+    //High tag number
+    unsigned char const highTag[] = { 0x1F, 0x01, 0x00 };
+    CHECK(!derReader(highTag, sizeof(highTag)).next(element));
+    //Longer than the buffer, in both forms
+    unsigned char const overrun[] = { 0x04, 0x03, 0x00, 0x00 };
+    CHECK(!derReader(overrun, sizeof(overrun)).next(element));
+    unsigned char const longOverrun[] = { 0x04, 0x84, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+    CHECK(!derReader(longOverrun, sizeof(longOverrun)).next(element));
+    unsigned char const missingLength[] = { 0x04, 0x82, 0x01 };
+    CHECK(!derReader(missingLength, sizeof(missingLength)).next(element));
+    //A wrong tag is read, but not accepted
+    unsigned char const integer[] = { 0x02, 0x01, 0x05 };
+    derReader reader(integer, sizeof(integer));
+    CHECK(!reader.next(element, DER_SEQUENCE));
+    CHECK(reader.atEnd());
+}
+
+TEST(authenticodeDecodesSignedData)
+{
+    byteBuffer blob(signature(true));
+    authenticodeSignature decoded;
+    CHECK(decoded.parseSignedData(&blob[0], blob.size()));
+    CHECK(decoded.getDigestAlgorithm() == authenticodeSignature::DIGEST_SHA256);
+    CHECK(decoded.getDigest() == digestBytes());
+    CHECK(decoded.getSignedData() == blob);
+    CHECK(decoded.getIssuerName() == L"Test CA");
+    CHECK(decoded.getSignerName() == L"Test Signer");
+    CHECK(decoded.getSerialNumber() == byteBuffer(serial, serial + sizeof(serial)));
+    CHECK(authenticodeSignature::getDigestLength(decoded.getDigestAlgorithm()) == 32);
+}
+
+TEST(authenticodeKeepsTheDigestWithoutASigner)
+{
+    byteBuffer blob(signature(false));
+    authenticodeSignature decoded;
+    CHECK(decoded.parseSignedData(&blob[0], blob.size()));
+    CHECK(decoded.getDigest() == digestBytes());
+    CHECK(decoded.getSignerName().empty());
+    CHECK(decoded.getIssuerName().empty());
+}
+
+TEST(authenticodeRejectsOtherContent)
+{
+    static const unsigned char oidCertificateTrustList[] = { 0x2B, 0x06, 0x01, 0x04, 0x01, 0x82, 0x37, 0x0A, 0x01 };
+    byteBuffer blob(derSignedData(oidCertificateTrustList, derEncode(DER_SEQUENCE, byteBuffer()), byteBuffer()));
+    authenticodeSignature decoded;
+    CHECK(!decoded.parseSignedData(&blob[0], blob.size()));
+    CHECK(decoded.getDigest().empty());
+}
+
+TEST(authenticodeRejectsEveryTruncation)
+{
+    byteBuffer const blob(signature(true));
+    authenticodeSignature decoded;
+    for (std::size_t length = 0; length < blob.size(); ++length)
+    {
+        //A copy of exactly length bytes, so reads past it are caught
+        byteBuffer prefix(blob.begin(), blob.begin() + length);
+        prefix.push_back(0);
+        CHECK(!decoded.parseSignedData(&prefix[0], length));
+    }
+}
+
+TEST(authenticodeFindsThePkcsEntryOfACertificateTable)
+{
+    byteBuffer blob(signature(true));
+    byteBuffer table(certificateEntry(1, byteBuffer(5, 0xEE)));
+    append(table, certificateEntry(2, blob));
+    CHECK(table.size() % 8 == 0);
+
+    authenticodeSignature decoded;
+    CHECK(decoded.parseCertificateTable(&table[0], table.size()));
+    CHECK(decoded.getSignerName() == L"Test Signer");
+
+    //The first entry claims to run past the table.
+    byteBuffer overrun(table);
+    put32(overrun, 0, static_cast<std::uint32_t>(table.size() + 1));
+    CHECK(!decoded.parseCertificateTable(&overrun[0], overrun.size()));
+    put32(overrun, 0, 4);
+    CHECK(!decoded.parseCertificateTable(&overrun[0], overrun.size()));
+
+    //No PKCS#7 entry
+    byteBuffer other(certificateEntry(1, byteBuffer(5, 0xEE)));
+    CHECK(!decoded.parseCertificateTable(&other[0], other.size()));
+}
+
+namespace {
+
+    struct byteCollector
+    {
+        byteBuffer bytes;
+        void Update(unsigned char const* data, std::size_t length)
+        {
+            bytes.insert(bytes.end(), data, data + length);
+        }
+    };
+
+}
+
+TEST(authenticodeHasherSkipsTheSignatureFields)
+{
+    testImage image(0x80, false, 1);
+    image.setSection(0, ".text", 0x1000, 0x200, 0x400, 0x200);
+    std::uint32_t const certificates = static_cast<std::uint32_t>(image.data.size());
+    image.setDirectory(peHeaders::DIRECTORY_SECURITY, certificates, 0x18);
+    put32(image.data, image.optionalHeader + 64, 0xDEADBEEF);
+    image.data.resize(certificates + 0x18);
+    for (std::size_t idx = 0x400; idx < image.data.size(); ++idx)
+        image.data[idx] = static_cast<unsigned char>(idx * 13);
+    peHeaders headers;
+    CHECK(headers.parse(&image.data[0], image.data.size()) == peHeaders::PARSE_COMPLETE);
+
+    byteBuffer expected;
+    std::size_t const checkSum = headers.getCheckSumOffset();
+    std::size_t const entry = headers.getDataDirectoryEntryOffset(peHeaders::DIRECTORY_SECURITY);
+    for (std::size_t idx = 0; idx < certificates; ++idx)
+        if ((idx < checkSum || idx >= checkSum + 4) && (idx < entry || idx >= entry + 8))
+            expected.push_back(image.data[idx]);
+
+    //Whatever the chunking, the same bytes are hashed.
+    for (std::size_t chunk = 1; chunk < 0x300; chunk += 37)
+    {
+        byteCollector collector;
+        authenticodeHasher<byteCollector> hasher(collector, headers);
+        for (std::size_t offset = 0; offset < image.data.size(); offset += chunk)
+            hasher.Update(&image.data[offset], std::min(chunk, image.data.size() - offset));
+        CHECK(collector.bytes == expected);
+    }
+}
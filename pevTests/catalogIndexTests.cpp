@@ -0,0 +1,194 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// catalogIndexTests.cpp -- Tests for the catalog decoder and its index.
+
+#include <string>
+#include "test.h"
+#include "testImages.h"
+#include "der.h"
+#include "catalogIndex.h"
+
+namespace {
+
+    const unsigned char oidCertificateTrustList[] = { 0x2B, 0x06, 0x01, 0x04, 0x01, 0x82, 0x37, 0x0A, 0x01 };
+    const unsigned char oidCatalogList[] = { 0x2B, 0x06, 0x01, 0x04, 0x01, 0x82, 0x37, 0x0C, 0x01, 0x01 };
+    const unsigned char oidCatalogMember[] = { 0x2B, 0x06, 0x01, 0x04, 0x01, 0x82, 0x37, 0x0C, 0x01, 0x02 };
+    const unsigned char oidSpcIndirectData[] = { 0x2B, 0x06, 0x01, 0x04, 0x01, 0x82, 0x37, 0x02, 0x01, 0x04 };
+    const unsigned char oidSha1[] = { 0x2B, 0x0E, 0x03, 0x02, 0x1A };
+
+    void append(byteBuffer& target, const byteBuffer& source)
+    {
+        target.insert(target.end(), source.begin(), source.end());
+    }
+
+    std::string digestOf(unsigned char seed)
+    {
+        std::string digest(20, '\0');
+        for (std::size_t idx = 0; idx < digest.size(); ++idx)
+            digest[idx] = static_cast<char>(seed + idx * 11);
+        return digest;
+    }
+
+    //A member identified by its tag: the digest in hex, as UTF-16
+    byteBuffer hexTagMember(const std::string& digest)
+    {
+        static const char hex[] = "0123456789ABCDEF";
+        byteBuffer tag;
+        for (std::size_t idx = 0; idx < digest.size(); ++idx)
+        {
+            unsigned char const value = static_cast<unsigned char>(digest[idx]);
+            tag.push_back(hex[value >> 4]);
+            tag.push_back(0);
+            tag.push_back(hex[value & 0xF]);
+            tag.push_back(0);
+        }
+        return derEncode(DER_SEQUENCE, derEncode(DER_OCTET_STRING, tag));
+    }
+
+    //A member with an opaque tag and an SpcIndirectDataContent attribute
+    byteBuffer attributeMember(const std::string& digest)
+    {
+        byteBuffer algorithm(derEncode(DER_SEQUENCE, derBytes(DER_OID, oidSha1)));
+        byteBuffer indirectData(derEncode(DER_SEQUENCE, derEncode(DER_SEQUENCE, byteBuffer()),
+            derEncode(DER_SEQUENCE, algorithm, derEncode(DER_OCTET_STRING, byteBuffer(digest.begin(), digest.end())))));
+        byteBuffer attribute(derEncode(DER_SEQUENCE, derBytes(DER_OID, oidSpcIndirectData), derEncode(DER_SET, indirectData)));
+        byteBuffer unrelated(derEncode(DER_SEQUENCE, derBytes(DER_OID, oidCatalogMember), derEncode(DER_SET, byteBuffer())));
+        return derEncode(DER_SEQUENCE, derText(DER_OCTET_STRING, "opaque tag"), derEncode(DER_SET, unrelated, attribute));
+    }
+
+    byteBuffer catalogFile(const byteBuffer& members, bool withMembers)
+    {
+        byteBuffer trustList(derEncode(DER_SEQUENCE, derBytes(DER_OID, oidCatalogList)));
+        append(trustList, derText(DER_OCTET_STRING, "list identifier"));
+        append(trustList, derText(0x17, "121231235959Z"));
+        append(trustList, derEncode(DER_SEQUENCE, derBytes(DER_OID, oidCatalogMember)));
+        if (withMembers)
+            append(trustList, derEncode(DER_SEQUENCE, members));
+        return derSignedData(oidCertificateTrustList, derEncode(DER_SEQUENCE, trustList), byteBuffer());
+    }
+
+    byteBuffer twoMemberCatalog()
+    {
+        byteBuffer members(hexTagMember(digestOf(1)));
+        append(members, attributeMember(digestOf(2)));
+        //A tag which is not hex is skipped.
+        append(members, derEncode(DER_SEQUENCE, derText(DER_OCTET_STRING, "not a digest")));
+        return catalogFile(members, true);
+    }
+
+    catalogIndex::catalog catalogNamed(const wchar_t *path)
+    {
+        catalogIndex::catalog result;
+        result.path = path;
+        result.lastWriteTime = 0x01CDABCDEF012345ull;
+        result.size = 1234;
+        return result;
+    }
+
+}
+
+TEST(catalogIndexDecodesMembers)
+{
+    byteBuffer file(twoMemberCatalog());
+    std::vector<std::string> digests;
+    CHECK(catalogIndex::parseCatalog(&file[0], file.size(), digests));
+    CHECK(digests.size() == 2 && digests[0] == digestOf(1) && digests[1] == digestOf(2));
+
+    digests.clear();
+    byteBuffer empty(catalogFile(byteBuffer(), false));
+    CHECK(catalogIndex::parseCatalog(&empty[0], empty.size(), digests));
+    CHECK(digests.empty());
+}
+
+TEST(catalogIndexRejectsOtherFiles)
+{
+    byteBuffer signature(derSignedData(oidSpcIndirectData, derEncode(DER_SEQUENCE, byteBuffer()), byteBuffer()));
+    std::vector<std::string> digests;
+    CHECK(!catalogIndex::parseCatalog(&signature[0], signature.size(), digests));
+
+    byteBuffer const file(twoMemberCatalog());
+    for (std::size_t length = 0; length < file.size(); ++length)
+    {
+        byteBuffer prefix(file.begin(), file.begin() + length);
+        prefix.push_back(0);
+        CHECK(!catalogIndex::parseCatalog(&prefix[0], length, digests));
+    }
+    CHECK(digests.empty());
+}
+
+TEST(catalogIndexFindsMembers)
+{
+    byteBuffer first(twoMemberCatalog());
+    byteBuffer second(catalogFile(hexTagMember(digestOf(2)), true));
+    catalogIndex index;
+    CHECK(index.addCatalog(catalogNamed(L"a.cat"), &first[0], first.size()));
+    CHECK(index.addCatalog(catalogNamed(L"b.cat"), &second[0], second.size()));
+    CHECK(!index.addCatalog(catalogNamed(L"unreadable.cat"), nullptr, 0));
+    CHECK(index.getCatalogs().size() == 3);
+    CHECK(index.memberCount() == 2);
+
+    std::string const one(digestOf(1));
+    std::string const two(digestOf(2));
+    std::string const three(digestOf(3));
+    const catalogIndex::catalog *found = index.find(reinterpret_cast<const unsigned char*>(one.data()), one.size());
+    CHECK(found && found->path == L"a.cat");
+    //The first catalog with a member wins.
+    found = index.find(reinterpret_cast<const unsigned char*>(two.data()), two.size());
+    CHECK(found && found->path == L"a.cat");
+    CHECK(!index.find(reinterpret_cast<const unsigned char*>(three.data()), three.size()));
+    CHECK(!index.find(reinterpret_cast<const unsigned char*>(one.data()), one.size() - 1));
+}
+
+TEST(catalogIndexRoundTrips)
+{
+    byteBuffer file(twoMemberCatalog());
+    catalogIndex index;
+    index.addCatalog(catalogNamed(L"C:\\Windows\\System32\\CatRoot\\a.cat"), &file[0], file.size());
+    index.addCatalog(catalogNamed(L"empty.cat"), nullptr, 0);
+    byteBuffer serialized(index.serialize());
+
+    catalogIndex loaded;
+    CHECK(loaded.deserialize(&serialized[0], serialized.size()));
+    CHECK(loaded.getCatalogs() == index.getCatalogs());
+    CHECK(loaded.memberCount() == 2);
+    std::string const two(digestOf(2));
+    const catalogIndex::catalog *found = loaded.find(reinterpret_cast<const unsigned char*>(two.data()), two.size());
+    CHECK(found && found->path == L"C:\\Windows\\System32\\CatRoot\\a.cat");
+}
+
+TEST(catalogIndexRejectsCorruptIndexes)
+{
+    byteBuffer file(twoMemberCatalog());
+    catalogIndex index;
+    index.addCatalog(catalogNamed(L"a.cat"), &file[0], file.size());
+    byteBuffer const serialized(index.serialize());
+
+    catalogIndex loaded;
+    for (std::size_t length = 0; length < serialized.size(); ++length)
+    {
+        byteBuffer prefix(serialized.begin(), serialized.begin() + length);
+        prefix.push_back(0);
+        CHECK(!loaded.deserialize(&prefix[0], length));
+        CHECK(loaded.getCatalogs().empty() && loaded.memberCount() == 0);
+    }
+
+    byteBuffer corrupt(serialized);
+    corrupt[0] = 'X';
+    CHECK(!loaded.deserialize(&corrupt[0], corrupt.size()));
+
+    //A member naming a catalog which does not exist
+    corrupt = serialized;
+    put32(corrupt, corrupt.size() - 4, 1);
+    CHECK(!loaded.deserialize(&corrupt[0], corrupt.size()));
+
+    //Counts far larger than the file can hold are refused before allocating.
+    corrupt = serialized;
+    put32(corrupt, 12, 0xFFFFFFFF);
+    CHECK(!loaded.deserialize(&corrupt[0], corrupt.size()));
+    corrupt = serialized;
+    put32(corrupt, 16, 0xFFFFFFFF);
+    CHECK(!loaded.deserialize(&corrupt[0], corrupt.size()));
+}
@@ -0,0 +1,162 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// commandLexerTests.cpp -- Tests the single pass command line tokenizer
+// against the regex tokenizer it replaces.
+
+#include <cstdlib>
+#include <regex>
+#include <string>
+#include "test.h"
+#include "commandLexer.h"
+
+namespace {
+
+    //Each token as [argument|option]
+    std::wstring readAll(commandLexer& lexer)
+    {
+        std::wstring result;
+        std::wstring argument;
+        std::wstring option;
+        while (lexer.next(argument, option))
+            result += L"[" + argument + L"|" + option + L"]";
+        return result;
+    }
+
+    std::wstring lex(const std::wstring& line)
+    {
+        commandLexer lexer;
+        lexer.push(line);
+        return readAll(lexer);
+    }
+
+    //The regex tokenizer's grammar. The argument is whichever of the first
+    //set of groups matched and the option whichever of the second.
+    std::wstring lexWithRegex(const std::wstring& line)
+    {
+        static const std::wregex tokenRegex(
+            L"(\\{)|(\\})"
+            L"|\"-*(-[^\\s\"#{}]+)(?:#((?:#[A-Za-z0-9#]|[^#])+)#|\"((?:\"\"|[^\"])+)\")?\""
+            L"|\"((?:\"\"|[^\"])+)\""
+            L"|-*(-[^\\s\"#{}]+)(?:#((?:#[A-Za-z0-9#]|[^#])+)#|\"((?:\"\"|[^\"])+)\")?"
+            L"|(\\S+)");
+        static const int argumentGroups[] = { 1, 2, 3, 6, 7, 10 };
+        static const int optionGroups[] = { 4, 5, 8, 9 };
+        std::wstring result;
+        for (std::wsregex_iterator it(line.begin(), line.end(), tokenRegex), end; it != end; ++it)
+        {
+            std::wstring argument;
+            std::wstring option;
+            for (std::size_t idx = 0; idx < sizeof(argumentGroups) / sizeof(argumentGroups[0]); ++idx)
+                if ((*it)[argumentGroups[idx]].matched)
+                    argument = (*it)[argumentGroups[idx]];
+            for (std::size_t idx = 0; idx < sizeof(optionGroups) / sizeof(optionGroups[0]); ++idx)
+                if ((*it)[optionGroups[idx]].matched)
+                    option = (*it)[optionGroups[idx]];
+            result += L"[" + argument + L"|" + option + L"]";
+        }
+        return result;
+    }
+
+    struct lexCase
+    {
+        const wchar_t *line;
+        const wchar_t *tokens;
+    };
+
+}
+
+TEST(commandLexerSplitsTokens)
+{
+    static const lexCase cases[] = {
+        //Empty lines and plain words
+        { L"", L"" },
+        { L" \t  ", L"" },
+        { L"pevFind vfind -r *.exe", L"[pevFind|][vfind|][-r|][*.exe|]" },
+        { L"{ a or b }", L"[{|][a|][or|][b|][}|]" },
+        { L"{a}", L"[{|][a}|]" },
+        { L"-x{y}", L"[-x|][{|][y}|]" },
+        //Dashes: the last is kept, and a run of them alone keeps two
+        { L"-", L"[-|]" },
+        { L"---", L"[--|]" },
+        { L"--long", L"[-long|]" },
+        //Options in #s and quotes
+        { L"-r#a b#", L"[-r|a b]" },
+        { L"-r\"a b\"", L"[-r|a b]" },
+        { L"-t#a#-f", L"[-t|a][-f|]" },
+        { L"-r#x# next", L"[-r|x][next|]" },
+        { L"--loadline#list.txt#", L"[-loadline|list.txt]" },
+        { L"-r#a", L"[-r|][#a|]" },
+        //A # in a #option# is doubled or followed by a letter or digit
+        { L"-r#a##b#", L"[-r|a##b]" },
+        { L"-r#a#b#", L"[-r|a#b]" },
+        { L"-r#a ## b#", L"[-r|a ## b]" },
+        { L"-r#50%#", L"[-r|50%]" },
+        //Quoted modifiers and text
+        { L"\"-r#a b#\"", L"[-r|a b]" },
+        { L"\"-r\" -s", L"[-r|][-s|]" },
+        { L"\"C:\\Program Files\\x.exe\"", L"[C:\\Program Files\\x.exe|]" },
+        { L"\"{\"", L"[{|]" },
+        { L"\"a\"b", L"[a|][b|]" },
+        { L"a\"b", L"[a\"b|]" },
+        { L"#x#", L"[#x#|]" },
+        //Escaped quotes are doubled, and kept as written
+        { L"\"say \"\"hi\"\"\"", L"[say \"\"hi\"\"|]" },
+        { L"-r\"a\"\"b\"", L"[-r|a\"\"b]" },
+        { L"-r\"x\"\"\"", L"[-r|x\"\"]" },
+        { L"\"-r\"x\"\"", L"[-r|x]" },
+        { L"\"\"\"\"", L"[\"\"|]" },
+        //Empty quotes and options are not tokens of their own kind
+        { L"\"\"", L"[\"\"|]" },
+        { L"\"", L"[\"|]" },
+        { L"-r##", L"[-r|][##|]" },
+        { L"-r\"\"", L"[-r|][\"\"|]" },
+    };
+    for (std::size_t idx = 0; idx < sizeof(cases) / sizeof(cases[0]); ++idx)
+    {
+        CHECK(lex(cases[idx].line) == cases[idx].tokens);
+        CHECK(lexWithRegex(cases[idx].line) == cases[idx].tokens);
+    }
+}
+
+TEST(commandLexerReadsLoadlineFilesInPlace)
+{
+    //consoleParser pushes a -loadline file's text when it reads the
+    //-loadline token; its tokens come next, then the rest of the line.
+    commandLexer lexer;
+    lexer.push(L"-a --loadline#one.txt# -z");
+    std::wstring argument;
+    std::wstring option;
+    CHECK(lexer.next(argument, option) && argument == L"-a");
+    CHECK(lexer.next(argument, option) && argument == L"-loadline" && option == L"one.txt");
+    lexer.push(L"-b\r\n--loadline#two.txt#\r\n-c");
+    CHECK(lexer.next(argument, option) && argument == L"-b");
+    CHECK(lexer.next(argument, option) && argument == L"-loadline" && option == L"two.txt");
+    lexer.push(L"{ -d }");
+    lexer.push(L"");
+    CHECK(readAll(lexer) == L"[{|][-d|][}|][-c|][-z|]");
+    CHECK(!lexer.next(argument, option));
+
+    //clear drops every stream
+    lexer.push(L"-a");
+    lexer.push(L"-b");
+    lexer.clear();
+    CHECK(!lexer.next(argument, option));
+}
+
+TEST(commandLexerAgreesWithTheRegexTokenizer)
+{
+    //The characters which mean something to the grammar, with spacing
+    static const wchar_t alphabet[] = L"--##\"\"{} a1x.\t";
+    std::srand(7);
+    for (int round = 0; round < 20000; ++round)
+    {
+        std::wstring line;
+        std::size_t const length = std::rand() % 24;
+        for (std::size_t idx = 0; idx < length; ++idx)
+            line.push_back(alphabet[std::rand() % (sizeof(alphabet) / sizeof(alphabet[0]) - 1)]);
+        CHECK(lex(line) == lexWithRegex(line));
+    }
+}
@@ -0,0 +1,113 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// contentSearchTests.cpp -- Tests for the multi-pattern content search.
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include "test.h"
+#include "testImages.h"
+#include "contentSearch.h"
+
+namespace {
+
+    void addText(contentPatterns& patterns, std::size_t search, const char *text)
+    {
+        patterns.addPattern(search, reinterpret_cast<const unsigned char*>(text), std::strlen(text));
+    }
+
+    //Whether each search is found in data, fed in chunks of the given size
+    std::vector<bool> scan(const contentPatterns& patterns, const byteBuffer& data, std::size_t chunk)
+    {
+        contentScanner scanner(patterns, patterns.searchCount());
+        for (std::size_t offset = 0; offset < data.size() && !scanner.isDone(); offset += chunk)
+            scanner.Update(&data[offset], std::min(chunk, data.size() - offset));
+        return scanner.getFound();
+    }
+
+}
+
+TEST(contentSearchWithoutPatterns)
+{
+    //A search with no patterns compiles to a start state nothing leaves.
+    contentPatterns patterns;
+    patterns.addSearch();
+    patterns.compile();
+    byteBuffer data(100, 'a');
+    std::vector<bool> found(scan(patterns, data, data.size()));
+    CHECK(found.size() == 1 && !found[0]);
+
+    unsigned char const byte = 0;
+    bool threw = false;
+    try
+    {
+        patterns.addPattern(0, &byte, 0);
+    }
+    catch (std::runtime_error&)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+TEST(contentSearchFindsEveryPattern)
+{
+    contentPatterns patterns;
+    std::size_t const he = patterns.addSearch();
+    std::size_t const she = patterns.addSearch();
+    std::size_t const hers = patterns.addSearch();
+    std::size_t const absent = patterns.addSearch();
+    addText(patterns, he, "he");
+    addText(patterns, she, "she");
+    addText(patterns, hers, "hers");
+    addText(patterns, absent, "his");
+    addText(patterns, absent, "hex");
+    patterns.compile();
+
+    //Long runs of bytes no pattern starts with exercise the skip ahead.
+    byteBuffer data(1000, '.');
+    putBytes(data, 500, "ushers", 6);
+    for (std::size_t chunk = 1; chunk < 40; chunk += 3)
+    {
+        std::vector<bool> found(scan(patterns, data, chunk));
+        CHECK(found[he] && found[she] && found[hers] && !found[absent]);
+    }
+    putBytes(data, 995, "hex", 3);
+    CHECK(scan(patterns, data, 7)[absent]);
+}
+
+TEST(contentSearchAgreesWithANaiveSearch)
+{
+    //Up to six distinct first bytes, either side of the vector limit
+    std::srand(1234);
+    for (int round = 0; round < 300; ++round)
+    {
+        contentPatterns patterns;
+        std::vector<std::string> texts;
+        std::size_t const count = 1 + std::rand() % 6;
+        for (std::size_t idx = 0; idx < count; ++idx)
+        {
+            std::string text;
+            std::size_t const length = 1 + std::rand() % 4;
+            for (std::size_t ch = 0; ch < length; ++ch)
+                text.push_back(static_cast<char>('a' + std::rand() % 6));
+            texts.push_back(text);
+            patterns.addPattern(patterns.addSearch(), reinterpret_cast<const unsigned char*>(text.data()), text.size());
+        }
+        patterns.compile();
+
+        std::string haystack;
+        std::size_t const length = std::rand() % 200;
+        for (std::size_t ch = 0; ch < length; ++ch)
+            haystack.push_back(static_cast<char>(std::rand() % 4 == 0 ? 'a' + std::rand() % 8 : 'z'));
+        byteBuffer data(haystack.begin(), haystack.end());
+        data.push_back(0);
+        contentScanner scanner(patterns, patterns.searchCount());
+        scanner.Update(&data[0], haystack.size());
+        for (std::size_t idx = 0; idx < count; ++idx)
+            CHECK(scanner.getFound()[idx] == (haystack.find(texts[idx]) != std::string::npos));
+    }
+}
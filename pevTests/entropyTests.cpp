@@ -0,0 +1,108 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// entropyTests.cpp -- Tests for the byte histogram and entropy measurements.
+
+#include <cmath>
+#include <cstdio>
+#include "test.h"
+#include "testImages.h"
+#include "peHeaders.h"
+#include "entropy.h"
+
+namespace {
+
+    bool near(double lhs, double rhs)
+    {
+        return std::fabs(lhs - rhs) < 1e-9;
+    }
+
+}
+
+TEST(byteHistogramMeasuresEntropy)
+{
+    byteHistogram empty;
+    CHECK(empty.Final() == 0.0);
+
+    byteBuffer uniform;
+    for (std::size_t idx = 0; idx < 256 * 16; ++idx)
+        uniform.push_back(static_cast<unsigned char>(idx));
+    byteHistogram all;
+    all.Update(&uniform[0], uniform.size());
+    CHECK(all.getTotal() == uniform.size());
+    CHECK(near(all.Final(), 8.0));
+
+    byteHistogram constant;
+    byteBuffer same(1000, 'A');
+    constant.Update(&same[0], same.size());
+    CHECK(near(constant.Final(), 0.0));
+
+    //Two values, equally often, in chunks which split the eight byte loads
+    byteHistogram two;
+    byteBuffer alternating;
+    for (std::size_t idx = 0; idx < 1001; ++idx)
+        alternating.push_back(idx % 2 ? 'x' : 'y');
+    alternating.push_back('x');
+    for (std::size_t offset = 0; offset < alternating.size(); offset += 13)
+        two.Update(&alternating[offset], std::min<std::size_t>(13, alternating.size() - offset));
+    CHECK(two.getTotal() == alternating.size());
+    CHECK(near(two.Final(), 1.0));
+}
+
+TEST(peEntropyMeasuresEachSection)
+{
+    testImage image(0x80, false, 2);
+    put32(image.data, image.optionalHeader + 16, 0x2010);
+    image.setSection(0, ".data", 0x1000, 0x400, 0x400, 0x400);
+    image.setSection(1, ".text", 0x2000, 0x400, 0x800, 0x400);
+    for (std::size_t idx = 0; idx < 0x400; ++idx)
+        image.data[0x800 + idx] = static_cast<unsigned char>(idx);
+    peHeaders headers;
+    CHECK(headers.parse(&image.data[0], image.data.size()) == peHeaders::PARSE_COMPLETE);
+
+    peEntropy entropy(&headers);
+    entropy.Update(&image.data[0], 0x401);
+    entropy.Update(&image.data[0x401], image.data.size() - 0x401);
+    entropy.Final();
+    CHECK(entropy.getSections().size() == 2);
+    CHECK(entropy.getEntryPointSection() == 1);
+    CHECK(entropy.getSections()[0].size == 0x400 && near(entropy.getSections()[0].entropy, 0.0));
+    CHECK(entropy.getSections()[1].size == 0x400 && near(entropy.getSections()[1].entropy, 8.0));
+    CHECK(entropy.getFileEntropy() > 0.0 && entropy.getFileEntropy() < 8.0);
+}
+
+TEST(peEntropyMeasuresAtMostMaxSectionsAndTheEntryPoint)
+{
+    std::uint16_t const count = 300;
+    testImage image(0x80, false, count);
+    std::uint32_t const rawStart = static_cast<std::uint32_t>((image.data.size() + 0x1FF) & ~0x1FF);
+    for (std::uint16_t idx = 0; idx < count; ++idx)
+    {
+        char name[9];
+        std::sprintf(name, "s%u", static_cast<unsigned int>(idx));
+        image.setSection(idx, name, 0x1000 + idx * 0x1000, 0x200, rawStart + idx * 0x200, 0x200);
+    }
+    put32(image.data, image.optionalHeader + 16, 0x1000 + 250 * 0x1000 + 4);
+    peHeaders headers;
+    CHECK(headers.parse(&image.data[0], image.data.size()) == peHeaders::PARSE_COMPLETE);
+    CHECK(headers.getSections().size() == count);
+
+    peEntropy entropy(&headers);
+    entropy.Update(&image.data[0], image.data.size());
+    entropy.Final();
+    std::vector<peEntropy::section> const& sections = entropy.getSections();
+    CHECK(sections.size() == peEntropy::MAX_SECTIONS + 1);
+    CHECK(entropy.getEntryPointSection() == peEntropy::MAX_SECTIONS);
+    CHECK(sections.size() == peEntropy::MAX_SECTIONS + 1 && sections[peEntropy::MAX_SECTIONS].name == "s250");
+    CHECK(sections.size() == peEntropy::MAX_SECTIONS + 1 && sections[peEntropy::MAX_SECTIONS].size == 0x200);
+
+    //Without an entry point in any section, only the first MAX_SECTIONS
+    put32(image.data, image.optionalHeader + 16, 0);
+    CHECK(headers.parse(&image.data[0], image.data.size()) == peHeaders::PARSE_COMPLETE);
+    peEntropy noEntryPoint(&headers);
+    noEntryPoint.Final();
+    CHECK(noEntryPoint.getSections().size() == peEntropy::MAX_SECTIONS);
+    CHECK(noEntryPoint.getEntryPointSection() == peEntropy::MAX_SECTIONS);
+}
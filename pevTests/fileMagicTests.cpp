@@ -0,0 +1,214 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// fileMagicTests.cpp -- Tests for the magic number classifier behind -magic.
+
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "test.h"
+#include "testImages.h"
+#include "fileMagic.h"
+
+namespace {
+
+    //Each signature, and what the file is if the signature is cut short or
+    //damaged after its first part. Lengths are explicit as several
+    //signatures hold NULs.
+    struct magicCase
+    {
+        fileMagic::type expected;
+        std::size_t offset;
+        const char *bytes;
+        std::size_t length;
+        std::size_t secondOffset;
+        const char *secondBytes;
+        std::size_t secondLength;
+        fileMagic::type withoutSecond;
+    };
+
+#define MAGIC(text) text, sizeof(text) - 1
+#define NO_SECOND 0, "", 0, fileMagic::TYPE_UNKNOWN
+    const magicCase cases[] = {
+        { fileMagic::TYPE_EXECUTABLE, 0, MAGIC("MZ"), NO_SECOND },
+        { fileMagic::TYPE_ELF, 0, MAGIC("\x7F" "ELF"), NO_SECOND },
+        { fileMagic::TYPE_MACHO, 0, MAGIC("\xFE\xED\xFA\xCE"), NO_SECOND },
+        { fileMagic::TYPE_MACHO, 0, MAGIC("\xCE\xFA\xED\xFE"), NO_SECOND },
+        { fileMagic::TYPE_MACHO, 0, MAGIC("\xFE\xED\xFA\xCF"), NO_SECOND },
+        { fileMagic::TYPE_MACHO, 0, MAGIC("\xCF\xFA\xED\xFE"), NO_SECOND },
+        { fileMagic::TYPE_SCRIPT, 0, MAGIC("#!"), NO_SECOND },
+        { fileMagic::TYPE_ZIP, 0, MAGIC("PK\x03\x04"), NO_SECOND },
+        { fileMagic::TYPE_ZIP, 0, MAGIC("PK\x05\x06"), NO_SECOND },
+        { fileMagic::TYPE_ZIP, 0, MAGIC("PK\x07\x08"), NO_SECOND },
+        { fileMagic::TYPE_OOXML, 0, MAGIC("PK\x03\x04"), 30, MAGIC("[Content_Types].xml"), fileMagic::TYPE_ZIP },
+        { fileMagic::TYPE_JAR, 0, MAGIC("PK\x03\x04"), 30, MAGIC("META-INF/"), fileMagic::TYPE_ZIP },
+        { fileMagic::TYPE_OLE, 0, MAGIC("\xD0\xCF\x11\xE0\xA1\xB1\x1A\xE1"), NO_SECOND },
+        { fileMagic::TYPE_RAR, 0, MAGIC("Rar!\x1A\x07"), NO_SECOND },
+        { fileMagic::TYPE_SEVENZIP, 0, MAGIC("7z\xBC\xAF\x27\x1C"), NO_SECOND },
+        { fileMagic::TYPE_GZIP, 0, MAGIC("\x1F\x8B\x08"), NO_SECOND },
+        { fileMagic::TYPE_BZIP2, 0, MAGIC("BZh"), NO_SECOND },
+        { fileMagic::TYPE_XZ, 0, MAGIC("\xFD" "7zXZ\x00"), NO_SECOND },
+        { fileMagic::TYPE_CAB, 0, MAGIC("MSCF\x00\x00\x00\x00"), NO_SECOND },
+        { fileMagic::TYPE_TAR, 257, MAGIC("ustar"), NO_SECOND },
+        { fileMagic::TYPE_PDF, 0, MAGIC("%PDF-"), NO_SECOND },
+        { fileMagic::TYPE_RTF, 0, MAGIC("{\\rtf"), NO_SECOND },
+        { fileMagic::TYPE_JPEG, 0, MAGIC("\xFF\xD8\xFF"), NO_SECOND },
+        { fileMagic::TYPE_PNG, 0, MAGIC("\x89PNG\x0D\x0A\x1A\x0A"), NO_SECOND },
+        { fileMagic::TYPE_GIF, 0, MAGIC("GIF87a"), NO_SECOND },
+        { fileMagic::TYPE_GIF, 0, MAGIC("GIF89a"), NO_SECOND },
+        { fileMagic::TYPE_BMP, 0, MAGIC("BM"), NO_SECOND },
+        { fileMagic::TYPE_LNK, 0, MAGIC("\x4C\x00\x00\x00\x01\x14\x02\x00"), NO_SECOND },
+        { fileMagic::TYPE_XML, 0, MAGIC("<?xml"), NO_SECOND },
+        { fileMagic::TYPE_XML, 0, MAGIC("\xEF\xBB\xBF<?xml"), NO_SECOND },
+        { fileMagic::TYPE_CHM, 0, MAGIC("ITSF"), NO_SECOND }
+    };
+#undef NO_SECOND
+#undef MAGIC
+
+    //A byte which starts no signature, as the rest of every test file
+    const unsigned char filler = 0xAA;
+
+    byteBuffer fileOf(const magicCase& test, std::size_t size)
+    {
+        byteBuffer data(size, filler);
+        std::memcpy(&data[test.offset], test.bytes, test.length);
+        if (test.secondLength)
+            std::memcpy(&data[test.secondOffset], test.secondBytes, test.secondLength);
+        return data;
+    }
+
+    std::size_t endOf(const magicCase& test)
+    {
+        return test.secondLength ? test.secondOffset + test.secondLength : test.offset + test.length;
+    }
+
+    fileMagic::type classify(const byteBuffer& data, std::size_t length)
+    {
+        return fileMagic::classify(data.empty() ? 0 : &data[0], length);
+    }
+
+    fileMagic::type classify(const byteBuffer& data)
+    {
+        return classify(data, data.size());
+    }
+
+}
+
+TEST(fileMagicFindsEverySignature)
+{
+    bool covered[fileMagic::TYPE_COUNT] = {};
+    for (std::size_t idx = 0; idx < sizeof(cases) / sizeof(cases[0]); ++idx)
+    {
+        //Exactly the signature, and the signature followed by more data
+        CHECK(classify(fileOf(cases[idx], endOf(cases[idx]))) == cases[idx].expected);
+        CHECK(classify(fileOf(cases[idx], 600)) == cases[idx].expected);
+        covered[cases[idx].expected] = true;
+    }
+    for (std::size_t type = fileMagic::TYPE_EXECUTABLE; type < fileMagic::TYPE_COUNT; ++type)
+        CHECK(covered[type]);
+
+    byteBuffer const unknown(600, filler);
+    CHECK(classify(unknown) == fileMagic::TYPE_UNKNOWN);
+    CHECK(classify(unknown, 1) == fileMagic::TYPE_UNKNOWN);
+}
+
+TEST(fileMagicRejectsTruncatedAndDamagedSignatures)
+{
+    for (std::size_t idx = 0; idx < sizeof(cases) / sizeof(cases[0]); ++idx)
+    {
+        const magicCase& test = cases[idx];
+        byteBuffer const data(fileOf(test, 600));
+
+        //Cut short anywhere inside the signature; a zip file cut short before
+        //the name of its first entry is still a zip file
+        for (std::size_t length = 1; length < endOf(test); ++length)
+        {
+            fileMagic::type const expected = length >= test.offset + test.length ? test.withoutSecond : fileMagic::TYPE_UNKNOWN;
+            CHECK(classify(data, length) == expected);
+        }
+
+        //Any one byte wrong, including the NULs of xz, cab and lnk
+        for (std::size_t at = 0; at < test.length; ++at)
+        {
+            byteBuffer damaged(data);
+            damaged[test.offset + at] ^= 0xFF;
+            CHECK(classify(damaged) == fileMagic::TYPE_UNKNOWN);
+        }
+        for (std::size_t at = 0; at < test.secondLength; ++at)
+        {
+            byteBuffer damaged(data);
+            damaged[test.secondOffset + at] ^= 0xFF;
+            CHECK(classify(damaged) == test.withoutSecond);
+        }
+    }
+}
+
+TEST(fileMagicPrefersTheLongestSignature)
+{
+    //A zip file's first entry decides between zip, ooxml and jar
+    byteBuffer zip(600, filler);
+    std::memcpy(&zip[0], "PK\x03\x04", 4);
+    std::memcpy(&zip[30], "word/document.xml", 17);
+    CHECK(classify(zip) == fileMagic::TYPE_ZIP);
+    std::memcpy(&zip[30], "[Content_Types].xml", 19);
+    CHECK(classify(zip) == fileMagic::TYPE_OOXML);
+    std::memcpy(&zip[30], "META-INF/MANIFEST.MF", 20);
+    CHECK(classify(zip) == fileMagic::TYPE_JAR);
+    //The entry name must follow a local file header, not an end record
+    zip[2] = 0x05;
+    zip[3] = 0x06;
+    CHECK(classify(zip) == fileMagic::TYPE_ZIP);
+
+    //Signatures at different offsets: a tar file whose first member's name
+    //happens to start like a shorter signature is still a tar file
+    byteBuffer tar(600, filler);
+    std::memcpy(&tar[257], "ustar", 5);
+    std::memcpy(&tar[0], "MZ", 2);
+    CHECK(classify(tar) == fileMagic::TYPE_TAR);
+    std::memcpy(&tar[0], "BZh", 3);
+    CHECK(classify(tar) == fileMagic::TYPE_TAR);
+    //but not one whose header is cut off before the signature
+    CHECK(classify(tar, 261) == fileMagic::TYPE_BZIP2);
+    CHECK(classify(tar, 262) == fileMagic::TYPE_TAR);
+
+    //Shared first bytes: BZh and BM, and 7z and xz's 7zXZ after its first byte
+    byteBuffer bitmap(600, filler);
+    std::memcpy(&bitmap[0], "BMZh", 4);
+    CHECK(classify(bitmap) == fileMagic::TYPE_BMP);
+    byteBuffer sevenZip(600, filler);
+    std::memcpy(&sevenZip[0], "7zXZ\x00", 5);
+    CHECK(classify(sevenZip) == fileMagic::TYPE_UNKNOWN);
+}
+
+TEST(fileMagicClassifiesTheEmptyFile)
+{
+    byteBuffer const empty;
+    CHECK(classify(empty) == fileMagic::TYPE_EMPTY);
+    //Length alone decides; the pointer is not read
+    byteBuffer const data(fileOf(cases[0], 600));
+    CHECK(classify(data, 0) == fileMagic::TYPE_EMPTY);
+}
+
+TEST(fileMagicNamesRoundTrip)
+{
+    for (std::size_t idx = 0; idx < fileMagic::TYPE_COUNT; ++idx)
+    {
+        fileMagic::type const current = static_cast<fileMagic::type>(idx);
+        fileMagic::type found = fileMagic::TYPE_COUNT;
+        std::string name(fileMagic::getName(current));
+        CHECK(!name.empty());
+        CHECK(fileMagic::fromName(name, found) && found == current);
+        for (std::size_t ch = 0; ch < name.size(); ++ch)
+            name[ch] = static_cast<char>(std::toupper(static_cast<unsigned char>(name[ch])));
+        CHECK(fileMagic::fromName(name, found) && found == current);
+    }
+    fileMagic::type found = fileMagic::TYPE_PDF;
+    CHECK(!fileMagic::fromName("document", found) && found == fileMagic::TYPE_PDF);
+    CHECK(!fileMagic::fromName("", found));
+    CHECK(std::string(fileMagic::getName(fileMagic::TYPE_COUNT)) == "unknown");
+    CHECK(std::string(fileMagic::getName(fileMagic::TYPE_OOXML)) == "ooxml");
+    CHECK(std::string(fileMagic::getName(fileMagic::TYPE_SEVENZIP)) == "7z");
+}
@@ -0,0 +1,406 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// hashSetTests.cpp -- Tests for the packed digest set behind the hash list
+// criteria.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <memory>
+#include "test.h"
+#include "hashSet.h"
+
+namespace {
+
+    std::string randomDigest(std::size_t length)
+    {
+        std::string result;
+        for (std::size_t idx = 0; idx < length; ++idx)
+            result.push_back(static_cast<char>(std::rand()));
+        return result;
+    }
+
+    //Digests sharing their first bytes, which defeat the interpolation
+    //search's guesses and its Bloom filter's first hash word
+    std::string skewedDigest(std::size_t length)
+    {
+        std::string result(randomDigest(length));
+        std::size_t const shared = std::rand() % 3 == 0 ? 8 : 6;
+        for (std::size_t idx = 0; idx < shared; ++idx)
+            result[idx] = static_cast<char>(idx == shared - 1 ? std::rand() % 2 : 0);
+        return result;
+    }
+
+    std::wstring hexOf(const std::string& digest)
+    {
+        return hashSet::formatHexDigest(reinterpret_cast<const unsigned char*>(digest.data()), digest.size());
+    }
+
+    bool contains(const hashSet& hashes, const std::string& digest)
+    {
+        return hashes.contains(reinterpret_cast<const unsigned char*>(digest.data()));
+    }
+
+    struct imageWriter
+    {
+        std::vector<unsigned char> *image;
+        void operator()(const void* data, std::uint64_t length) const
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            image->insert(image->end(), bytes, bytes + length);
+        }
+    };
+
+    std::vector<unsigned char> imageOf(const hashSet& hashes)
+    {
+        std::vector<unsigned char> image;
+        imageWriter writer = { &image };
+        hashes.writeImage(writer);
+        return image;
+    }
+
+    //Loads image through the image constructor; false if it is rejected
+    bool loads(const std::vector<unsigned char>& image, std::size_t size)
+    {
+        try
+        {
+            hashSet loaded(image.data(), size, std::shared_ptr<void const>());
+        }
+        catch (std::runtime_error&)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    bool loads(const std::vector<unsigned char>& image)
+    {
+        return loads(image, image.size());
+    }
+
+    //image with one header field replaced
+    std::vector<unsigned char> withField(std::vector<unsigned char> image, std::size_t offset, std::uint64_t value, std::size_t width)
+    {
+        std::memcpy(&image[offset], &value, width);
+        return image;
+    }
+
+    struct digestSource
+    {
+        const std::string *digest;
+        bool readable;
+        int *calls;
+        bool operator()(unsigned char* target) const
+        {
+            ++*calls;
+            if (!readable)
+                return false;
+            std::memcpy(target, digest->data(), digest->size());
+            return true;
+        }
+    };
+
+    std::shared_ptr<hashSet> setOf(const std::vector<std::string>& digests, std::size_t length)
+    {
+        std::vector<std::wstring> lines;
+        for (std::size_t idx = 0; idx < digests.size(); ++idx)
+            lines.push_back(hexOf(digests[idx]));
+        return std::make_shared<hashSet>(lines, length);
+    }
+
+}
+
+TEST(hashSetFindsMembersAndOnlyMembers)
+{
+    std::size_t const lengths[] = { 16, 20, 28, 32, 48, 64 };
+    std::size_t const counts[] = { 0, 1, 2, 7, 100, 5000 };
+    std::srand(2626);
+    for (std::size_t length = 0; length < sizeof(lengths) / sizeof(lengths[0]); ++length)
+    {
+        for (std::size_t count = 0; count < sizeof(counts) / sizeof(counts[0]); ++count)
+        {
+            for (int skewed = 0; skewed < 2; ++skewed)
+            {
+                std::vector<std::string> digests;
+                for (std::size_t idx = 0; idx < counts[count]; ++idx)
+                    digests.push_back(skewed ? skewedDigest(lengths[length]) : randomDigest(lengths[length]));
+                std::set<std::string> const members(digests.begin(), digests.end());
+                std::shared_ptr<hashSet> const hashes(setOf(digests, lengths[length]));
+                CHECK(hashes->size() == members.size());
+                CHECK(hashes->digestLength() == lengths[length]);
+                for (std::size_t idx = 0; idx < digests.size(); ++idx)
+                    CHECK(contains(*hashes, digests[idx]));
+                for (int probe = 0; probe < 2000; ++probe)
+                {
+                    std::string const other(skewed ? skewedDigest(lengths[length]) : randomDigest(lengths[length]));
+                    CHECK(contains(*hashes, other) == (members.count(other) != 0));
+                }
+                //Just outside the keys at either end
+                if (!members.empty())
+                {
+                    std::string below(*members.begin());
+                    std::string above(*members.rbegin());
+                    below[lengths[length] - 1] = static_cast<char>(below[lengths[length] - 1] - 1);
+                    above[lengths[length] - 1] = static_cast<char>(above[lengths[length] - 1] + 1);
+                    CHECK(contains(*hashes, below) == (members.count(below) != 0));
+                    CHECK(contains(*hashes, above) == (members.count(above) != 0));
+                }
+            }
+        }
+    }
+}
+
+TEST(hashSetMergesSets)
+{
+    std::srand(2627);
+    std::vector<std::string> all;
+    std::vector<std::shared_ptr<hashSet> > sets;
+    for (int set = 0; set < 4; ++set)
+    {
+        std::vector<std::string> digests;
+        for (int idx = 0; idx < 300; ++idx)
+            digests.push_back(randomDigest(20));
+        //Some keys in every set
+        digests.push_back(std::string(20, 'x'));
+        all.insert(all.end(), digests.begin(), digests.end());
+        sets.push_back(setOf(digests, 20));
+    }
+    hashSet const merged(sets);
+    std::set<std::string> const members(all.begin(), all.end());
+    CHECK(merged.size() == members.size());
+    CHECK(!merged.hasSizes());
+    for (std::size_t idx = 0; idx < all.size(); ++idx)
+        CHECK(contains(merged, all[idx]));
+    for (int probe = 0; probe < 2000; ++probe)
+        CHECK(!contains(merged, randomDigest(20)));
+
+    //Keys come out in order, which the image format relies on
+    for (std::size_t idx = 1; idx < merged.size(); ++idx)
+        CHECK(std::memcmp(merged.keyAt(idx - 1), merged.keyAt(idx), 20) < 0);
+
+    sets.push_back(setOf(std::vector<std::string>(1, randomDigest(16)), 16));
+    bool threw = false;
+    try
+    {
+        hashSet mixed(sets);
+    }
+    catch (std::invalid_argument&)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+TEST(hashSetPrefiltersBySize)
+{
+    std::string const first(16, 'a');
+    std::string const second(16, 'b');
+    std::vector<std::wstring> lines;
+    lines.push_back(hexOf(first) + L" 100");
+    lines.push_back(hexOf(second) + L",4096");
+    lines.push_back(L"\t" + hexOf(first) + L"\t100 ");
+    std::vector<std::wstring> const sizedLines(lines);
+    hashSet const sized(sizedLines, 16);
+    CHECK(sized.size() == 2);
+    CHECK(sized.hasSizes());
+    CHECK(sized.mayContainSize(100) && sized.mayContainSize(4096));
+    CHECK(!sized.mayContainSize(0) && !sized.mayContainSize(101) && !sized.mayContainSize(5000));
+
+    //Sizes are only kept if every entry has one
+    lines.push_back(hexOf(std::string(16, 'c')));
+    std::vector<std::wstring> const partlyLines(lines);
+    hashSet const partly(partlyLines, 16);
+    CHECK(partly.size() == 3);
+    CHECK(!partly.hasSizes());
+    CHECK(partly.mayContainSize(12345));
+
+    //A union keeps sizes only if every set has them
+    std::vector<std::shared_ptr<hashSet> > sets;
+    sets.push_back(std::make_shared<hashSet>(sizedLines, 16));
+    std::vector<std::wstring> more(1, hexOf(std::string(16, 'd')) + L" 7");
+    sets.push_back(std::make_shared<hashSet>(more, 16));
+    hashSet const merged(sets);
+    CHECK(merged.hasSizes() && merged.mayContainSize(7) && merged.mayContainSize(4096) && !merged.mayContainSize(8));
+    sets.push_back(std::make_shared<hashSet>(partlyLines, 16));
+    CHECK(!hashSet(sets).hasSizes());
+}
+
+TEST(hashSetParsesTextLists)
+{
+    std::string const digest("\x01\x23\x45\x67\x89\xAB\xCD\xEF\xFE\xDC\xBA\x98\x76\x54\x32\x10", 16);
+    std::vector<std::wstring> lines;
+    lines.push_back(L"0123456789abcdefFEDCBA9876543210");
+    lines.push_back(L"");
+    lines.push_back(L"   ");
+    lines.push_back(L"0123456789abcdefFEDCBA987654321");      //Too short
+    lines.push_back(L"0123456789abcdefFEDCBA98765432100");    //Too long
+    lines.push_back(L"0123456789abcdefFEDCBA987654321g");     //Not hex
+    lines.push_back(L"0123456789abcdef FEDCBA9876543210");    //Split
+    lines.push_back(L"# a comment");
+    hashSet const hashes(lines, 16);
+    CHECK(hashes.size() == 1);
+    CHECK(contains(hashes, digest));
+    CHECK(hexOf(digest) == L"0123456789ABCDEFFEDCBA9876543210");
+
+    //A digest followed by something other than a size is kept, without sizes
+    std::vector<std::wstring> trailing(1, L"0123456789abcdefFEDCBA9876543210 12x");
+    hashSet const withJunk(trailing, 16);
+    CHECK(withJunk.size() == 1 && !withJunk.hasSizes());
+
+    unsigned char parsed[16];
+    CHECK(hashSet::parseHexDigest(L" \t0123456789ABCDEFfedcba9876543210\t", parsed, 16));
+    CHECK(std::memcmp(parsed, digest.data(), 16) == 0);
+    CHECK(!hashSet::parseHexDigest(L"0123", parsed, 16));
+
+    //Only the MD5, SHA-1 and SHA-2 lengths
+    std::size_t const lengths[] = { 0, 8, 15, 17, 24, 65 };
+    for (std::size_t idx = 0; idx < sizeof(lengths) / sizeof(lengths[0]); ++idx)
+    {
+        CHECK(!hashSet::isSupportedDigestLength(lengths[idx]));
+        bool threw = false;
+        try
+        {
+            hashSet unsupported(lines, lengths[idx]);
+        }
+        catch (std::invalid_argument&)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+}
+
+TEST(hashSetRoundTripsThroughItsImage)
+{
+    std::srand(2727);
+    std::size_t const counts[] = { 0, 1, 3, 1000 };
+    for (std::size_t count = 0; count < sizeof(counts) / sizeof(counts[0]); ++count)
+    {
+        for (int sized = 0; sized < 2; ++sized)
+        {
+            std::vector<std::string> digests;
+            std::vector<std::wstring> lines;
+            for (std::size_t idx = 0; idx < counts[count]; ++idx)
+            {
+                digests.push_back(randomDigest(20));
+                lines.push_back(hexOf(digests.back()) + (sized ? L" " + std::to_wstring(idx * 3 + 1) : std::wstring()));
+            }
+            hashSet const original(lines, 20);
+            std::vector<unsigned char> const image(imageOf(original));
+            hashSet::imageHeader const header(original.makeImageHeader());
+            CHECK(image.size() == (header.sizesOffset ? header.sizesOffset + header.sizeCount * 8 : header.bloomOffset + header.bloomWords * 8));
+            CHECK(hashSet::isImage(image.data(), image.size()));
+
+            //8 byte alignment of the sections is relative to the image, so
+            //copy it somewhere which is aligned itself
+            std::vector<std::uint64_t> aligned((image.size() + 7) / 8);
+            std::memcpy(aligned.data(), image.data(), image.size());
+            hashSet const loaded(reinterpret_cast<const unsigned char*>(aligned.data()), image.size(), std::shared_ptr<void const>());
+            CHECK(loaded.size() == original.size());
+            CHECK(loaded.digestLength() == 20);
+            CHECK(loaded.hasSizes() == (sized && counts[count] != 0));
+            for (std::size_t idx = 0; idx < digests.size(); ++idx)
+            {
+                CHECK(contains(loaded, digests[idx]));
+                CHECK(loaded.mayContainSize(idx * 3 + 1));
+            }
+            for (int probe = 0; probe < 500; ++probe)
+                CHECK(!contains(loaded, randomDigest(20)));
+            if (loaded.hasSizes())
+                CHECK(!loaded.mayContainSize(2) && !loaded.mayContainSize(counts[count] * 3 + 1));
+
+            //Writing the loaded set gives the same image back
+            CHECK(imageOf(loaded) == image);
+        }
+    }
+}
+
+TEST(hashSetRejectsDamagedImages)
+{
+    std::srand(2728);
+    std::vector<std::wstring> lines;
+    for (int idx = 0; idx < 50; ++idx)
+        lines.push_back(hexOf(randomDigest(16)) + L" " + std::to_wstring(idx + 10));
+    hashSet const original(lines, 16);
+    std::vector<unsigned char> const image(imageOf(original));
+    hashSet::imageHeader const header(original.makeImageHeader());
+    CHECK(loads(image));
+
+    //Cut short anywhere, including inside the header
+    for (std::size_t size = 0; size < image.size(); size += size < 80 ? 1 : 37)
+        CHECK(!loads(image, size));
+
+    //Sections which do not start on an 8 byte boundary, or run off the end
+    std::size_t const keysOffset = offsetof(hashSet::imageHeader, keysOffset);
+    std::size_t const bloomOffset = offsetof(hashSet::imageHeader, bloomOffset);
+    std::size_t const sizesOffset = offsetof(hashSet::imageHeader, sizesOffset);
+    CHECK(!loads(withField(image, keysOffset, header.keysOffset + 4, 8)));
+    CHECK(!loads(withField(image, bloomOffset, header.bloomOffset + 1, 8)));
+    CHECK(!loads(withField(image, sizesOffset, header.sizesOffset + 4, 8)));
+    CHECK(!loads(withField(image, keysOffset, image.size(), 8)));
+    CHECK(!loads(withField(image, bloomOffset, image.size() + 8, 8)));
+    CHECK(!loads(withField(image, sizesOffset, image.size() - 8, 8)));
+    CHECK(!loads(withField(image, offsetof(hashSet::imageHeader, keyCount), ~std::uint64_t(0) / 16 + 1, 8)));
+    CHECK(!loads(withField(image, offsetof(hashSet::imageHeader, sizeCount), header.sizeCount + 1, 8)));
+
+    //A Bloom filter which is empty or not a power of two words long
+    CHECK(!loads(withField(image, offsetof(hashSet::imageHeader, bloomWords), 0, 8)));
+    CHECK(!loads(withField(image, offsetof(hashSet::imageHeader, bloomWords), header.bloomWords - 1, 8)));
+
+    //Header fields
+    CHECK(!loads(withField(image, 0, 'X', 1)));
+    CHECK(!loads(withField(image, offsetof(hashSet::imageHeader, version), hashSet::IMAGE_VERSION + 1, 4)));
+    CHECK(!loads(withField(image, offsetof(hashSet::imageHeader, digestLength), 15, 4)));
+    CHECK(!loads(withField(image, offsetof(hashSet::imageHeader, digestLength), 8, 4)));
+    CHECK(!loads(withField(image, offsetof(hashSet::imageHeader, bloomHashes), hashSet::BLOOM_HASHES + 1, 4)));
+
+    //Keys or sizes out of order
+    std::vector<unsigned char> swapped(image);
+    std::swap_ranges(swapped.begin() + header.keysOffset, swapped.begin() + header.keysOffset + 16, swapped.begin() + header.keysOffset + 16);
+    CHECK(!loads(swapped));
+    std::vector<unsigned char> repeated(image);
+    std::copy(repeated.begin() + header.keysOffset, repeated.begin() + header.keysOffset + 16, repeated.begin() + header.keysOffset + 16);
+    CHECK(!loads(repeated));
+    CHECK(!loads(withField(image, header.sizesOffset + 8, 0, 8)));
+}
+
+TEST(hashSetMatchesFilesForTheListCriteria)
+{
+    std::string const member(20, 'm');
+    std::string const other(20, 'o');
+    std::vector<std::wstring> lines(1, hexOf(member) + L" 100");
+    hashSet const hashes(lines, 20);
+    int calls = 0;
+    digestSource const memberFile = { &member, true, &calls };
+    digestSource const otherFile = { &other, true, &calls };
+    digestSource const unreadable = { &member, false, &calls };
+
+    //Plain lists: only readable members of a listed size, and files of other
+    //sizes are never hashed
+    CHECK(hashes.matchFile(100, false, memberFile));
+    CHECK(!hashes.matchFile(100, false, otherFile));
+    CHECK(!hashes.matchFile(100, false, unreadable));
+    calls = 0;
+    CHECK(!hashes.matchFile(101, false, memberFile));
+    CHECK(!hashes.matchFile(101, false, unreadable));
+    CHECK(calls == 0);
+
+    //OR ERROR lists: unreadable files match whatever their size, so every
+    //file is hashed
+    CHECK(hashes.matchFile(100, true, memberFile));
+    CHECK(!hashes.matchFile(100, true, otherFile));
+    CHECK(hashes.matchFile(100, true, unreadable));
+    calls = 0;
+    CHECK(hashes.matchFile(101, true, unreadable));
+    CHECK(hashes.matchFile(101, true, memberFile));
+    CHECK(!hashes.matchFile(101, true, otherFile));
+    CHECK(calls == 3);
+}
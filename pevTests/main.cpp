@@ -0,0 +1,34 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// main.cpp -- Runs every registered test, or those whose names contain the
+// first argument.
+
+#include <cstring>
+#include "test.h"
+
+unsigned int testFailures = 0;
+
+std::vector<testCase>& testRegistry()
+{
+    static std::vector<testCase> registry;
+    return registry;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int ran = 0;
+    for (std::vector<testCase>::const_iterator it = testRegistry().begin(); it != testRegistry().end(); ++it)
+    {
+        if (argc > 1 && std::strstr(it->name, argv[1]) == nullptr)
+            continue;
+        unsigned int const failuresBefore = testFailures;
+        it->run();
+        std::printf("%s %s\n", testFailures == failuresBefore ? "PASS" : "FAIL", it->name);
+        ++ran;
+    }
+    std::printf("%u tests, %u failed checks\n", ran, testFailures);
+    return testFailures == 0 ? 0 : 1;
+}
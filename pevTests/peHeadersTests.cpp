@@ -0,0 +1,154 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// peHeadersTests.cpp -- Tests for the image header parser.
+
+#include "test.h"
+#include "testImages.h"
+#include "peHeaders.h"
+
+TEST(peHeadersRejectsNonMZ)
+{
+    unsigned char const text[] = "This is not an image";
+    peHeaders headers;
+    CHECK(headers.parse(text, sizeof(text)) == peHeaders::PARSE_COMPLETE);
+    CHECK(headers.getType() == peHeaders::IMAGE_NONE);
+    CHECK(!headers.isMZ());
+    CHECK(headers.parse(text, 0) == peHeaders::PARSE_COMPLETE);
+}
+
+TEST(peHeadersRecognisesNEAndLE)
+{
+    testImage image(0x80, false, 0);
+    image.data[0x80] = 'N';
+    image.data[0x81] = 'E';
+    peHeaders headers;
+    CHECK(headers.parse(&image.data[0], image.data.size()) == peHeaders::PARSE_COMPLETE);
+    CHECK(headers.getType() == peHeaders::IMAGE_NE);
+    image.data[0x80] = 'L';
+    CHECK(headers.parse(&image.data[0], image.data.size()) == peHeaders::PARSE_COMPLETE);
+    CHECK(headers.getType() == peHeaders::IMAGE_LE);
+}
+
+TEST(peHeadersDecodesPE32)
+{
+    testImage image(0x80, false, 2);
+    put32(image.data, image.optionalHeader + 16, 0x1234);
+    put32(image.data, image.optionalHeader + 28, 0x400000);
+    put32(image.data, image.optionalHeader + 64, 0xCAFEF00D);
+    image.setDirectory(peHeaders::DIRECTORY_IMPORT, 0x2000, 0x28);
+    image.setSection(0, ".text", 0x1000, 0x800, 0x400, 0x800);
+    image.setSection(1, ".bss", 0x2000, 0x1000, 0xC00, 0x200);
+
+    peHeaders headers;
+    CHECK(headers.parse(&image.data[0], image.data.size()) == peHeaders::PARSE_COMPLETE);
+    CHECK(headers.isPE());
+    CHECK(!headers.isPEPlus());
+    CHECK(headers.getMachine() == 0x14C);
+    CHECK(headers.getEntryPoint() == 0x1234);
+    CHECK(headers.getImageBase() == 0x400000);
+    CHECK(headers.getCheckSum() == 0xCAFEF00D);
+    CHECK(headers.getCheckSumOffset() == image.optionalHeader + 64);
+    CHECK(headers.getDataDirectories().size() == 16);
+    CHECK(headers.getDataDirectory(peHeaders::DIRECTORY_IMPORT).virtualAddress == 0x2000);
+    CHECK(headers.getDataDirectory(peHeaders::DIRECTORY_IMPORT).size == 0x28);
+    CHECK(headers.getDataDirectory(100).size == 0);
+    CHECK(headers.getSections().size() == 2);
+    CHECK(std::strcmp(headers.getSections()[0].name, ".text") == 0);
+
+    std::uint32_t offset = 0;
+    CHECK(headers.rvaToOffset(0x1010, offset) && offset == 0x410);
+    CHECK(headers.rvaToOffset(0x10, offset) && offset == 0x10);
+    //Past the raw data of .bss, and past every section
+    CHECK(!headers.rvaToOffset(0x2400, offset));
+    CHECK(!headers.rvaToOffset(0x5000, offset));
+}
+
+TEST(peHeadersDecodesPE32Plus)
+{
+    testImage image(0x40, true, 1);
+    put64(image.data, image.optionalHeader + 24, 0x140000000ull);
+    image.setSection(0, ".text", 0x1000, 0x200, 0x200, 0x200);
+
+    peHeaders headers;
+    CHECK(headers.parse(&image.data[0], image.data.size()) == peHeaders::PARSE_COMPLETE);
+    CHECK(headers.isPE());
+    CHECK(headers.isPEPlus());
+    CHECK(headers.getImageBase() == 0x140000000ull);
+    CHECK(headers.getDataDirectoryEntryOffset(peHeaders::DIRECTORY_SECURITY) == image.directories + 32);
+    CHECK(headers.getSections().size() == 1);
+}
+
+TEST(peHeadersRejectsBadOptionalHeaderMagic)
+{
+    testImage image(0x80, false, 1);
+    image.setSection(0, ".text", 0x1000, 0x200, 0x200, 0x200);
+    put16(image.data, image.optionalHeader, 0x107);
+
+    peHeaders headers;
+    CHECK(headers.parse(&image.data[0], image.data.size()) == peHeaders::PARSE_COMPLETE);
+    CHECK(headers.getType() == peHeaders::IMAGE_MZ);
+    CHECK(!headers.isPE());
+    CHECK(headers.getDataDirectories().empty());
+    CHECK(headers.getSections().empty());
+}
+
+TEST(peHeadersClampsDirectoriesToTheOptionalHeader)
+{
+    testImage image(0x80, false, 0);
+    put32(image.data, image.directories - 4, 0xFFFFFFFF);
+    peHeaders headers;
+    CHECK(headers.parse(&image.data[0], image.data.size()) == peHeaders::PARSE_COMPLETE);
+    CHECK(headers.getDataDirectories().size() == 16);
+
+    //SizeOfOptionalHeader leaves room for only two directories
+    put16(image.data, image.fileHeader + 16, 96 + 2 * 8);
+    CHECK(headers.parse(&image.data[0], image.data.size()) == peHeaders::PARSE_COMPLETE);
+    CHECK(headers.getDataDirectories().size() == 2);
+}
+
+TEST(peHeadersRequestsMoreOfATruncatedImage)
+{
+    testImage image(0x80, false, 3);
+    peHeaders headers;
+    CHECK(headers.parse(&image.data[0], 0x60) == peHeaders::PARSE_TRUNCATED);
+    CHECK(headers.bytesNeeded() == 0x84);
+    CHECK(headers.parse(&image.data[0], image.sectionTable) == peHeaders::PARSE_TRUNCATED);
+    CHECK(headers.bytesNeeded() == image.sectionTable + 3 * 40);
+    CHECK(headers.isPE());
+    CHECK(headers.parse(&image.data[0], headers.bytesNeeded()) == peHeaders::PARSE_COMPLETE);
+    CHECK(headers.getSections().size() == 3);
+}
+
+TEST(peHeadersAcceptsASectionTableEndingAtTheLimit)
+{
+    std::size_t const newHeader = peHeaders::MAX_HEADER_SIZE - 24 - 224 - 2 * 40;
+    testImage image(newHeader, false, 2);
+    CHECK(image.data.size() == peHeaders::MAX_HEADER_SIZE);
+
+    peHeaders headers;
+    CHECK(headers.parse(&image.data[0], peHeaders::HEADER_READ_SIZE) == peHeaders::PARSE_TRUNCATED);
+    CHECK(headers.bytesNeeded() == newHeader + 4);
+    CHECK(headers.parse(&image.data[0], image.data.size() - 1) == peHeaders::PARSE_TRUNCATED);
+    CHECK(headers.bytesNeeded() == peHeaders::MAX_HEADER_SIZE);
+    CHECK(headers.parse(&image.data[0], image.data.size()) == peHeaders::PARSE_COMPLETE);
+    CHECK(headers.getSections().size() == 2);
+}
+
+TEST(peHeadersRefusesASectionTablePastTheLimit)
+{
+    std::size_t const newHeader = peHeaders::MAX_HEADER_SIZE - 24 - 224 - 2 * 40 + 1;
+    testImage image(newHeader, false, 2);
+
+    //The headers are decoded, but no more is asked for than the limit.
+    peHeaders headers;
+    CHECK(headers.parse(&image.data[0], peHeaders::MAX_HEADER_SIZE) == peHeaders::PARSE_COMPLETE);
+    CHECK(headers.isPE());
+    CHECK(headers.getSections().empty());
+
+    put32(image.data, 0x3C, peHeaders::MAX_HEADER_SIZE + 1);
+    CHECK(headers.parse(&image.data[0], image.data.size()) == peHeaders::PARSE_COMPLETE);
+    CHECK(headers.getType() == peHeaders::IMAGE_MZ);
+}
@@ -0,0 +1,178 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// peImportsTests.cpp -- Tests for the import and export directory decoder.
+
+#include <string>
+#include "test.h"
+#include "testImages.h"
+#include "peHeaders.h"
+#include "peImports.h"
+
+namespace {
+
+    //An image whose 0x200 byte .idata section (at RVA 0x1000, file offset
+    //0x400, the end of the file) imports CreateFileW and ExitProcess from
+    //KERNEL32.dll and ordinal 115 from WS2_32.dll:
+    //  0x00  descriptors for each module, then a zeroed one
+    //  0x60  module names
+    //  0x80  KERNEL32.dll's thunks
+    //  0xA0  WS2_32.dll's thunks
+    //  0xC0  hints and names
+    //The rest of the section is left for each test.
+    testImage importImage(bool plus)
+    {
+        testImage image(0x80, plus, 1);
+        image.setSection(0, ".idata", 0x1000, 0x200, 0x400, 0x200);
+        image.setDirectory(peHeaders::DIRECTORY_IMPORT, 0x1000, 0x3C);
+        std::size_t const base = 0x400;
+        std::size_t const thunkSize = plus ? 8 : 4;
+        put32(image.data, base + 0x00, 0x1080);
+        put32(image.data, base + 0x0C, 0x1060);
+        put32(image.data, base + 0x10, 0x1080);
+        put32(image.data, base + 0x14, 0x10A0);
+        put32(image.data, base + 0x20, 0x1070);
+        put32(image.data, base + 0x24, 0x10A0);
+        putBytes(image.data, base + 0x60, "KERNEL32.dll", 13);
+        putBytes(image.data, base + 0x70, "WS2_32.dll", 11);
+        put32(image.data, base + 0x80, 0x10C0);
+        put32(image.data, base + 0x80 + thunkSize, 0x10D0);
+        if (plus)
+            put64(image.data, base + 0xA0, 0x8000000000000073ull);
+        else
+            put32(image.data, base + 0xA0, 0x80000073u);
+        putBytes(image.data, base + 0xC2, "CreateFileW", 12);
+        putBytes(image.data, base + 0xD2, "ExitProcess", 12);
+        return image;
+    }
+
+    bool parse(const testImage& image, peImports& imports)
+    {
+        peHeaders headers;
+        if (headers.parse(&image.data[0], image.data.size()) != peHeaders::PARSE_COMPLETE)
+            return false;
+        return imports.parseImage(headers, &image.data[0], image.data.size());
+    }
+
+}
+
+TEST(peImportsDecodesNamesAndOrdinals)
+{
+    for (int plus = 0; plus < 2; ++plus)
+    {
+        peImports imports;
+        CHECK(parse(importImage(plus != 0), imports));
+        std::vector<peImports::importedFunction> const& functions = imports.getImports();
+        CHECK(functions.size() == 3);
+        if (functions.size() != 3)
+            continue;
+        CHECK(functions[0].module == "KERNEL32.dll" && functions[0].name == "CreateFileW");
+        CHECK(functions[1].module == "KERNEL32.dll" && functions[1].name == "ExitProcess");
+        CHECK(functions[2].module == "WS2_32.dll" && functions[2].name.empty() && functions[2].ordinal == 115);
+        CHECK(!functions[0].delayLoaded);
+        CHECK(imports.getImportHashInput() == "kernel32.createfilew,kernel32.exitprocess,ws2_32.ord115");
+    }
+}
+
+TEST(peImportsIgnoresDescriptorsOutOfBounds)
+{
+    peImports imports;
+
+    //The directory lies past every section.
+    testImage image(importImage(false));
+    image.setDirectory(peHeaders::DIRECTORY_IMPORT, 0x5000, 0x3C);
+    CHECK(!parse(image, imports));
+    CHECK(imports.getImports().empty());
+
+    //The first descriptor straddles the end of the section's raw data.
+    image.setDirectory(peHeaders::DIRECTORY_IMPORT, 0x1000 + 0x200 - 8, 0x3C);
+    CHECK(!parse(image, imports));
+
+    //The descriptor table has no terminator before the section ends. Twelve
+    //descriptors fit; the thirteenth straddles the end.
+    image = importImage(false);
+    image.setDirectory(peHeaders::DIRECTORY_IMPORT, 0x1100, 0x100);
+    for (std::size_t offset = 0x500; offset + 20 <= 0x600; offset += 20)
+    {
+        put32(image.data, offset + 12, 0x1070);
+        put32(image.data, offset + 16, 0x10A0);
+    }
+    CHECK(parse(image, imports));
+    CHECK(imports.getImports().size() == 12);
+
+    //A module name and a thunk table outside the image
+    image = importImage(false);
+    put32(image.data, 0x400 + 0x0C, 0x9000);
+    put32(image.data, 0x400 + 0x24, 0x9000);
+    put32(image.data, 0x400 + 0x14, 0x9000);
+    CHECK(!parse(image, imports));
+    CHECK(imports.getImports().empty());
+
+    //A name which runs to the end of the file without a terminator ends
+    //its module's thunks.
+    image = importImage(false);
+    image.data.resize(0x400 + 0xD6);
+    image.setSection(0, ".idata", 0x1000, 0xD6, 0x400, 0xD6);
+    CHECK(parse(image, imports));
+    CHECK(imports.getImports().size() == 2);
+    CHECK(imports.getImports().size() == 2 && imports.getImports()[1].ordinal == 115);
+}
+
+TEST(peImportsMatchesLikeImportKeys)
+{
+    const char *modules[] = { "KERNEL32.dll", "kernel32", "Kernel32.DLL", "kernel32.exe", "ntoskrnl.sys", "x.ocx", "a.b.dll", ".dll", "" };
+    const char *names[] = { "CreateFileW", "createfilew", "CreateFileA", "" };
+    const char *wantedModules[] = { "", "kernel32", "kernel32.exe", "ntoskrnl", "x", "a.b", "kernel3" };
+    const char *wantedNames[] = { "createfilew", "createfilea", "#115", "#1", "#0", "#1150", "115" };
+    std::uint16_t const ordinals[] = { 0, 1, 115, 1150, 65535 };
+    for (std::size_t module = 0; module < sizeof(modules) / sizeof(modules[0]); ++module)
+    for (std::size_t name = 0; name < sizeof(names) / sizeof(names[0]); ++name)
+    for (std::size_t ordinal = 0; ordinal < sizeof(ordinals) / sizeof(ordinals[0]); ++ordinal)
+    {
+        peImports::importedFunction function;
+        function.module = modules[module];
+        function.name = names[name];
+        function.ordinal = ordinals[ordinal];
+        function.delayLoaded = false;
+        std::string const key(peImports::makeImportKey(function));
+        std::string const functionPart(key.substr(key.find('!') + 1));
+        for (std::size_t wantedModule = 0; wantedModule < sizeof(wantedModules) / sizeof(wantedModules[0]); ++wantedModule)
+        for (std::size_t wantedName = 0; wantedName < sizeof(wantedNames) / sizeof(wantedNames[0]); ++wantedName)
+        {
+            std::string const moduleText(wantedModules[wantedModule]);
+            std::string const nameText(wantedNames[wantedName]);
+            bool const expected = moduleText.empty()
+                ? functionPart == nameText
+                : key == moduleText + '!' + nameText;
+            CHECK(peImports::matchesImport(function, moduleText, nameText) == expected);
+        }
+    }
+}
+
+TEST(peImportsDecodesExports)
+{
+    testImage image(importImage(false));
+    //IMAGE_EXPORT_DIRECTORY at 0x100, whose two names are listed at the very
+    //end of the section
+    std::size_t const base = 0x400;
+    image.setDirectory(peHeaders::DIRECTORY_EXPORT, 0x1100, 40);
+    put32(image.data, base + 0x100 + 20, 3);
+    put32(image.data, base + 0x100 + 24, 2);
+    put32(image.data, base + 0x100 + 32, 0x11F8);
+    put32(image.data, base + 0x1F8, 0x1150);
+    put32(image.data, base + 0x1FC, 0x1160);
+    putBytes(image.data, base + 0x150, "First", 6);
+    putBytes(image.data, base + 0x160, "Second", 7);
+
+    peImports imports;
+    CHECK(parse(image, imports));
+    CHECK(imports.getExportCount() == 3);
+    CHECK(imports.getExportNames().size() == 2 && imports.getExportNames()[1] == "Second");
+
+    //More names than the section holds
+    put32(image.data, base + 0x100 + 24, 0xFFFFFFFF);
+    CHECK(parse(image, imports));
+    CHECK(imports.getExportNames().size() == 2);
+}
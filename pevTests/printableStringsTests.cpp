@@ -0,0 +1,240 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// printableStringsTests.cpp -- Tests the printable string extractor against
+// a byte at a time reference.
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "test.h"
+#include "testImages.h"
+#include "printableStrings.h"
+
+namespace {
+
+    struct foundString
+    {
+        std::uint64_t offset;
+        bool wide;
+        std::string text;
+        bool operator<(const foundString& other) const
+        {
+            if (offset != other.offset)
+                return offset < other.offset;
+            if (wide != other.wide)
+                return wide < other.wide;
+            return text < other.text;
+        }
+        bool operator==(const foundString& other) const
+        {
+            return offset == other.offset && wide == other.wide && text == other.text;
+        }
+    };
+
+    struct collector
+    {
+        std::vector<foundString> *strings;
+        void operator()(std::uint64_t offset, bool wide, std::string const& text) const
+        {
+            foundString found = { offset, wide, text };
+            strings->push_back(found);
+        }
+    };
+
+    bool isPrintable(unsigned char byte)
+    {
+        return (byte >= 0x20 && byte <= 0x7E) || byte == '\t';
+    }
+
+    //Every ASCII run, then every UTF-16LE run of each parity, one byte (or
+    //character) at a time. Sorted, as the extractor reports in its own order.
+    std::vector<foundString> reference(const byteBuffer& data, std::size_t minimumLength)
+    {
+        std::vector<foundString> result;
+        for (std::size_t idx = 0; idx < data.size();)
+        {
+            std::size_t end = idx;
+            while (end < data.size() && isPrintable(data[end]))
+                ++end;
+            if (end - idx >= minimumLength && end != idx)
+            {
+                foundString found = { idx, false, std::string(data.begin() + idx, data.begin() + end) };
+                result.push_back(found);
+            }
+            idx = end == idx ? idx + 1 : end;
+        }
+        for (std::size_t parity = 0; parity < 2; ++parity)
+        {
+            foundString current = { 0, true, std::string() };
+            for (std::size_t idx = parity; idx < data.size(); idx += 2)
+            {
+                if (idx + 1 < data.size() && isPrintable(data[idx]) && data[idx + 1] == 0)
+                {
+                    if (current.text.empty())
+                        current.offset = idx;
+                    current.text.push_back(static_cast<char>(data[idx]));
+                    continue;
+                }
+                if (current.text.size() >= minimumLength && !current.text.empty())
+                    result.push_back(current);
+                current.text.clear();
+            }
+            if (current.text.size() >= minimumLength && !current.text.empty())
+                result.push_back(current);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    //The extractor's strings, with data fed in chunks of the given sizes in turn
+    std::vector<foundString> extract(const byteBuffer& data, std::size_t minimumLength, const std::vector<std::size_t>& chunks)
+    {
+        std::vector<foundString> result;
+        collector sink = { &result };
+        printableStrings strings(minimumLength, sink);
+        std::size_t offset = 0;
+        for (std::size_t chunk = 0; offset < data.size(); ++chunk)
+        {
+            std::size_t const length = std::min(chunks[chunk % chunks.size()], data.size() - offset);
+            strings.Update(data.empty() ? 0 : &data[offset], length);
+            offset += length;
+        }
+        strings.Final();
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    std::vector<std::size_t> wholeChunk(const byteBuffer& data)
+    {
+        return std::vector<std::size_t>(1, std::max<std::size_t>(data.size(), 1));
+    }
+
+    byteBuffer wideText(const std::string& text)
+    {
+        byteBuffer result;
+        for (std::size_t idx = 0; idx < text.size(); ++idx)
+        {
+            result.push_back(static_cast<unsigned char>(text[idx]));
+            result.push_back(0);
+        }
+        return result;
+    }
+
+}
+
+TEST(printableStringsFindsRunsAcrossBlocks)
+{
+    //Runs which fill a block exactly, or end on either side of its end,
+    //starting at the start of a block or inside one
+    std::size_t const lengths[] = { 1, 3, 4, 63, 64, 65, 127, 128, 129, 200 };
+    std::size_t const leads[] = { 0, 1, 5, 63, 64 };
+    for (std::size_t length = 0; length < sizeof(lengths) / sizeof(lengths[0]); ++length)
+    {
+        for (std::size_t lead = 0; lead < sizeof(leads) / sizeof(leads[0]); ++lead)
+        {
+            byteBuffer data(leads[lead], 0xFF);
+            for (std::size_t idx = 0; idx < lengths[length]; ++idx)
+                data.push_back(static_cast<unsigned char>('a' + idx % 26));
+            byteBuffer const trailer(70, 0x01);
+            byteBuffer ended(data);
+            ended.insert(ended.end(), trailer.begin(), trailer.end());
+            CHECK(extract(data, 4, wholeChunk(data)) == reference(data, 4));
+            CHECK(extract(ended, 4, wholeChunk(ended)) == reference(ended, 4));
+        }
+    }
+
+    //Every byte printable: one string, open until Final
+    byteBuffer all(64 * 3, 'x');
+    std::vector<foundString> const found(extract(all, 4, wholeChunk(all)));
+    CHECK(found.size() == 1 && found[0].offset == 0 && found[0].text == std::string(all.size(), 'x'));
+
+    byteBuffer const empty;
+    CHECK(extract(empty, 4, std::vector<std::size_t>(1, 1)).empty());
+}
+
+TEST(printableStringsFindsUtf16AtBothParities)
+{
+    std::size_t const lengths[] = { 3, 4, 31, 32, 33, 63, 64, 65 };
+    for (std::size_t length = 0; length < sizeof(lengths) / sizeof(lengths[0]); ++length)
+    {
+        std::string text;
+        for (std::size_t idx = 0; idx < lengths[length]; ++idx)
+            text.push_back(static_cast<char>('A' + idx % 26));
+        for (std::size_t lead = 0; lead < 4; ++lead)
+        {
+            byteBuffer data(lead + 60, 0xFF);
+            byteBuffer const wide(wideText(text));
+            data.insert(data.end(), wide.begin(), wide.end());
+            data.push_back(0xFF);
+            data.push_back(0xFF);
+            std::vector<foundString> const found(extract(data, 4, wholeChunk(data)));
+            CHECK(found == reference(data, 4));
+            bool sawWide = false;
+            for (std::size_t idx = 0; idx < found.size(); ++idx)
+                sawWide = sawWide || (found[idx].wide && found[idx].offset == lead + 60 && found[idx].text == text);
+            CHECK(sawWide == (text.size() >= 4));
+        }
+    }
+
+    //The last character's zero is the first byte of the next block, or is
+    //missing at the end of the data
+    byteBuffer data(63, 0xFF);
+    data[61] = 'a';
+    data[62] = 0;
+    data.push_back('b');
+    data.push_back(0);
+    data.push_back('c');
+    data.push_back(0);
+    data.push_back('d');
+    CHECK(extract(data, 3, wholeChunk(data)) == reference(data, 3));
+    CHECK(extract(data, 3, std::vector<std::size_t>(1, 1)) == reference(data, 3));
+}
+
+TEST(printableStringsAgreesWithAReference)
+{
+    //Mostly printable runs, zeros and UTF-16 text, with some noise, fed in
+    //odd chunk sizes which mix the block and byte paths
+    std::srand(4040);
+    for (int round = 0; round < 400; ++round)
+    {
+        byteBuffer data;
+        std::size_t const pieces = std::rand() % 12;
+        for (std::size_t piece = 0; piece < pieces; ++piece)
+        {
+            std::size_t const length = std::rand() % 140;
+            switch (std::rand() % 4)
+            {
+            case 0:
+                for (std::size_t idx = 0; idx < length; ++idx)
+                    data.push_back(static_cast<unsigned char>(0x20 + std::rand() % 0x5F));
+                break;
+            case 1:
+                for (std::size_t idx = 0; idx < length; ++idx)
+                {
+                    data.push_back(static_cast<unsigned char>(std::rand() % 8 ? 'a' + std::rand() % 26 : '\t'));
+                    data.push_back(0);
+                }
+                break;
+            case 2:
+                data.insert(data.end(), length % 5, 0);
+                break;
+            default:
+                for (std::size_t idx = 0; idx < length; ++idx)
+                    data.push_back(static_cast<unsigned char>(std::rand()));
+                break;
+            }
+        }
+        std::size_t const minimumLength = 1 + std::rand() % 8;
+        std::vector<foundString> const expected(reference(data, minimumLength));
+        CHECK(extract(data, minimumLength, wholeChunk(data)) == expected);
+        std::vector<std::size_t> chunks;
+        chunks.push_back(1 + std::rand() % 7);
+        chunks.push_back(63 + std::rand() % 3);
+        chunks.push_back(1 + std::rand() % 200);
+        CHECK(extract(data, minimumLength, chunks) == expected);
+    }
+}
@@ -0,0 +1,185 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// regexAutomatonTests.cpp -- Tests the linear time regex engine of -lreg and
+// the required literal prefilter of -preg and -lreg against std::wregex.
+
+#include <cstdlib>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include "test.h"
+#include "regexAutomaton.h"
+#include "literalPrefilter.h"
+
+namespace {
+
+    int random(int count)
+    {
+        return std::rand() % count;
+    }
+
+    std::wstring randomAlternation(int depth);
+
+    //A character, class, anchor or group, with a quantifier
+    std::wstring randomAtom(int depth)
+    {
+        std::wstring atom;
+        switch (random(depth > 1 ? 7 : 10))
+        {
+        case 0:
+        case 1:
+        case 2:
+            atom.assign(1, L"abAB.x1_\\"[random(9)]);
+            if (atom == L"." || atom == L"\\")
+                atom.insert(atom.begin(), L'\\');
+            break;
+        case 3:
+            atom = L".";
+            break;
+        case 4:
+            atom = random(2) ? L"[a-bX]" : L"[^bA]";
+            break;
+        case 5:
+            atom = random(2) ? L"\\d" : L"\\w";
+            break;
+        case 6:
+            return random(2) ? L"^" : L"$";
+        default:
+            atom = (random(2) ? L"(?:" : L"(") + randomAlternation(depth + 1) + L")";
+            switch (random(3))
+            {
+            case 0:
+                atom += L"?";
+                break;
+            case 1:
+                atom += L"{2}";
+                break;
+            }
+            return atom;
+        }
+        static const wchar_t *quantifiers[] = { L"*", L"+", L"?", L"{1,3}", L"{2}", L"*?", L"", L"" };
+        return atom + quantifiers[random(8)];
+    }
+
+    std::wstring randomAlternation(int depth)
+    {
+        std::wstring result;
+        int const branches = 1 + random(3);
+        for (int branch = 0; branch < branches; ++branch)
+        {
+            if (branch)
+                result += L'|';
+            int const atoms = random(4);
+            for (int atom = 0; atom < atoms; ++atom)
+                result += randomAtom(depth);
+        }
+        return result;
+    }
+
+    std::wstring randomText(std::size_t maxLength)
+    {
+        static const wchar_t alphabet[] = L"aAbB.\\x1_ ";
+        std::wstring result;
+        std::size_t const length = std::rand() % (maxLength + 1);
+        for (std::size_t idx = 0; idx < length; ++idx)
+            result.push_back(alphabet[random(sizeof(alphabet) / sizeof(alphabet[0]) - 1)]);
+        return result;
+    }
+
+    bool throwsRuntimeError(const wchar_t *regex)
+    {
+        try
+        {
+            regexAutomaton automaton(regex);
+        }
+        catch (std::runtime_error&)
+        {
+            return true;
+        }
+        return false;
+    }
+
+}
+
+TEST(regexAutomatonAgreesWithStdRegex)
+{
+    //Every regex std::wregex accepts from these pieces is in the subset the
+    //linear engine takes. A match the prefilter rejects would be lost by
+    //both -preg and -lreg. Names longer than the vector scan go only to
+    //regexes without groups, which std::wregex backtracks through quickly.
+    std::srand(42);
+    for (int round = 0; round < 3000; ++round)
+    {
+        std::wstring const regex(randomAlternation(0));
+        std::wregex expected;
+        try
+        {
+            expected.assign(regex, std::regex::ECMAScript | std::regex::icase);
+        }
+        catch (std::regex_error&)
+        {
+            continue;
+        }
+        regexAutomaton const automaton(regex);
+        literalPrefilter const prefilter(regex);
+        bool const grouped = regex.find(L'(') != std::wstring::npos;
+        for (int text = 0; text < 40; ++text)
+        {
+            std::wstring const subject(randomText(text < 30 || grouped ? 10 : 40));
+            bool const matched = std::regex_search(subject, expected);
+            CHECK(automaton.search(subject.c_str(), subject.size()) == matched);
+            CHECK(!matched || prefilter.mayMatch(subject.c_str(), subject.size()));
+        }
+    }
+}
+
+TEST(literalPrefilterFindsTheRequiredRun)
+{
+    literalPrefilter const dll(L"\\\\system32\\\\.*\\.dll$");
+    CHECK(dll.getLiteral() == L"\\system32\\");
+    std::wstring path(L"C:\\Windows\\SYSTEM32\\kernel32.dll");
+    CHECK(dll.mayMatch(path.c_str(), path.size()));
+    path = L"C:\\Windows\\SysWOW64\\kernel32.dll";
+    CHECK(!dll.mayMatch(path.c_str(), path.size()));
+
+    //The run at every offset of a path longer than the vector width, and cut
+    //short by the length rather than a terminator
+    literalPrefilter const run(L"(?:x|y)AbC.*");
+    CHECK(run.getLiteral() == L"abc");
+    for (std::size_t offset = 0; offset + 3 <= 40; ++offset)
+    {
+        std::wstring text(40, L'_');
+        text.replace(offset, 3, L"aBc");
+        CHECK(run.mayMatch(text.c_str(), text.size()));
+        CHECK(!run.mayMatch(text.c_str(), offset + 2));
+    }
+
+    //Alternatives and optional parts have no required run.
+    CHECK(literalPrefilter(L"abc|def").getLiteral().empty());
+    CHECK(literalPrefilter(L"(?:abc)?").getLiteral().empty());
+    CHECK(literalPrefilter(L"a*").mayMatch(L"", 0));
+}
+
+TEST(regexAutomatonRejectsBacktrackingFeatures)
+{
+    CHECK(throwsRuntimeError(L"(a)\\1"));
+    CHECK(throwsRuntimeError(L"a(?=b)"));
+    CHECK(throwsRuntimeError(L"a(?!b)"));
+    CHECK(throwsRuntimeError(L"\\bword\\b"));
+    CHECK(throwsRuntimeError(L"a*+"));
+    CHECK(throwsRuntimeError(L"(a"));
+    CHECK(throwsRuntimeError(L"a{99999}"));
+    CHECK(!throwsRuntimeError(L"^(?:[a-z]+\\\\)*\\w+\\.(?:exe|dll)$"));
+}
+
+TEST(regexAutomatonRunsInLinearTime)
+{
+    //These take exponential time to fail in a backtracking engine.
+    std::wstring const text(5000, L'a');
+    CHECK(!regexAutomaton(L"(a+)+b").search(text.c_str(), text.size()));
+    CHECK(!regexAutomaton(L"(a|aa)*c").search(text.c_str(), text.size()));
+    CHECK(regexAutomaton(L"(a+)+$").search(text.c_str(), text.size()));
+}
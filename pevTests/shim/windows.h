@@ -0,0 +1,20 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// windows.h -- The little of the Windows API which the sources under test
+// call, so they build without the Windows SDK. LCMapStringW only lowercases
+// ASCII, as the C library's tolower does in the C locale; the tests keep to
+// names on which that and Windows' folding agree.
+#pragma once
+
+#define LOCALE_INVARIANT 0x007F
+#define LCMAP_LOWERCASE 0x00000100
+
+inline int LCMapStringW(unsigned long, unsigned long, const wchar_t *source, int length, wchar_t *destination, int)
+{
+    for (int idx = 0; idx < length; ++idx)
+        destination[idx] = source[idx] >= L'A' && source[idx] <= L'Z' ? static_cast<wchar_t>(source[idx] - L'A' + L'a') : source[idx];
+    return length;
+}
@@ -0,0 +1,44 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// test.h -- A minimal unit test harness. Each TEST registers itself with
+// the runner in main.cpp; CHECK records a failure and carries on, so one run
+// reports every broken expectation.
+#pragma once
+#include <cstdio>
+#include <vector>
+
+struct testCase
+{
+    const char *name;
+    void (*run)();
+};
+
+std::vector<testCase>& testRegistry();
+extern unsigned int testFailures;
+
+struct testRegistration
+{
+    testRegistration(const char *name, void (*run)())
+    {
+        testCase registered = { name, run };
+        testRegistry().push_back(registered);
+    }
+};
+
+#define TEST(name) \
+    static void name(); \
+    static testRegistration name##Registration(#name, name); \
+    static void name()
+
+#define CHECK(expression) \
+    do \
+    { \
+        if (!(expression)) \
+        { \
+            ++testFailures; \
+            std::printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #expression); \
+        } \
+    } while (0)
@@ -0,0 +1,165 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// testImages.h -- Builds the byte buffers the parser tests decode, so each
+// test spells out exactly the structure it exercises.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "der.h"
+
+typedef std::vector<unsigned char> byteBuffer;
+
+inline void put16(byteBuffer& target, std::size_t offset, std::uint32_t value)
+{
+    if (target.size() < offset + 2)
+        target.resize(offset + 2);
+    target[offset] = static_cast<unsigned char>(value);
+    target[offset + 1] = static_cast<unsigned char>(value >> 8);
+}
+
+inline void put32(byteBuffer& target, std::size_t offset, std::uint32_t value)
+{
+    put16(target, offset, value & 0xFFFF);
+    put16(target, offset + 2, value >> 16);
+}
+
+inline void put64(byteBuffer& target, std::size_t offset, std::uint64_t value)
+{
+    put32(target, offset, static_cast<std::uint32_t>(value));
+    put32(target, offset + 4, static_cast<std::uint32_t>(value >> 32));
+}
+
+inline void putBytes(byteBuffer& target, std::size_t offset, const void *data, std::size_t length)
+{
+    if (target.size() < offset + length)
+        target.resize(offset + length);
+    if (length)
+        std::memcpy(&target[offset], data, length);
+}
+
+//An MZ stub, PE signature, file header, optional header with all 16 data
+//directories and an empty section table. SizeOfHeaders covers the section
+//table, rounded up to the file alignment of 0x200.
+class testImage
+{
+public:
+    byteBuffer data;
+    std::size_t newHeader;
+    std::size_t fileHeader;
+    std::size_t optionalHeader;
+    std::size_t directories;
+    std::size_t sectionTable;
+
+    testImage(std::size_t newHeaderOffset, bool plus, std::uint16_t sectionCount)
+        : newHeader(newHeaderOffset)
+        , fileHeader(newHeaderOffset + 4)
+        , optionalHeader(newHeaderOffset + 24)
+        , directories(newHeaderOffset + 24 + (plus ? 112 : 96))
+        , sectionTable(newHeaderOffset + 24 + (plus ? 240 : 224))
+    {
+        data.push_back('M');
+        data.push_back('Z');
+        put32(data, 0x3C, static_cast<std::uint32_t>(newHeader));
+        putBytes(data, newHeader, "PE\0\0", 4);
+        put16(data, fileHeader, plus ? 0x8664 : 0x14C);
+        put16(data, fileHeader + 2, sectionCount);
+        put16(data, fileHeader + 16, plus ? 240 : 224);
+        put16(data, fileHeader + 18, 0x0102);
+        put16(data, optionalHeader, plus ? 0x20B : 0x10B);
+        put32(data, optionalHeader + 32, 0x1000);
+        put32(data, optionalHeader + 36, 0x200);
+        std::size_t const headersEnd = sectionTable + sectionCount * 40;
+        put32(data, optionalHeader + 60, static_cast<std::uint32_t>((headersEnd + 0x1FF) & ~0x1FF));
+        put32(data, directories - 4, 16);
+        data.resize(headersEnd);
+    }
+
+    void setDirectory(std::size_t idx, std::uint32_t virtualAddress, std::uint32_t size)
+    {
+        put32(data, directories + idx * 8, virtualAddress);
+        put32(data, directories + idx * 8 + 4, size);
+    }
+
+    //Fills in a section header, and grows the image to hold its raw data.
+    void setSection(std::size_t idx, const char *name, std::uint32_t virtualAddress, std::uint32_t virtualSize,
+        std::uint32_t pointerToRawData, std::uint32_t sizeOfRawData)
+    {
+        std::size_t const entry = sectionTable + idx * 40;
+        char paddedName[8] = {};
+        for (std::size_t ch = 0; ch < sizeof(paddedName) && name[ch]; ++ch)
+            paddedName[ch] = name[ch];
+        putBytes(data, entry, paddedName, sizeof(paddedName));
+        put32(data, entry + 8, virtualSize);
+        put32(data, entry + 12, virtualAddress);
+        put32(data, entry + 16, sizeOfRawData);
+        put32(data, entry + 20, pointerToRawData);
+        put32(data, entry + 36, 0x40000040);
+        if (data.size() < static_cast<std::size_t>(pointerToRawData) + sizeOfRawData)
+            data.resize(static_cast<std::size_t>(pointerToRawData) + sizeOfRawData);
+    }
+};
+
+//DER encodes one element, choosing the short or long form of the length.
+inline byteBuffer derEncode(unsigned char tag, const byteBuffer& contents)
+{
+    byteBuffer result(1, tag);
+    std::size_t const length = contents.size();
+    if (length < 0x80)
+        result.push_back(static_cast<unsigned char>(length));
+    else
+    {
+        unsigned char lengthBytes = 0;
+        for (std::size_t remaining = length; remaining; remaining >>= 8)
+            ++lengthBytes;
+        result.push_back(static_cast<unsigned char>(0x80 | lengthBytes));
+        for (unsigned char idx = lengthBytes; idx-- > 0;)
+            result.push_back(static_cast<unsigned char>(length >> (idx * 8)));
+    }
+    result.insert(result.end(), contents.begin(), contents.end());
+    return result;
+}
+
+inline byteBuffer derEncode(unsigned char tag, const byteBuffer& first, const byteBuffer& second)
+{
+    byteBuffer contents(first);
+    contents.insert(contents.end(), second.begin(), second.end());
+    return derEncode(tag, contents);
+}
+
+inline byteBuffer derEncode(unsigned char tag, const byteBuffer& first, const byteBuffer& second, const byteBuffer& third)
+{
+    byteBuffer contents(first);
+    contents.insert(contents.end(), second.begin(), second.end());
+    return derEncode(tag, contents, third);
+}
+
+template <std::size_t size>
+byteBuffer derBytes(unsigned char tag, const unsigned char (&contents)[size])
+{
+    return derEncode(tag, byteBuffer(contents, contents + size));
+}
+
+inline byteBuffer derText(unsigned char tag, const char *text)
+{
+    return derEncode(tag, byteBuffer(text, text + std::strlen(text)));
+}
+
+//Opens a PKCS#7 ContentInfo around SignedData whose encapsulated content
+//has the given type; the signer infos follow rest (the certificates).
+template <std::size_t size>
+byteBuffer derSignedData(const unsigned char (&contentType)[size], const byteBuffer& content, const byteBuffer& rest)
+{
+    static const unsigned char oidSignedData[] = { 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x02 };
+    static const unsigned char version[] = { 1 };
+    byteBuffer encapsulated(derEncode(DER_SEQUENCE, derBytes(DER_OID, contentType), derEncode(DER_CONTEXT_0, content)));
+    byteBuffer header(derBytes(DER_INTEGER, version));
+    byteBuffer digestAlgorithms(derEncode(DER_SET, byteBuffer()));
+    header.insert(header.end(), digestAlgorithms.begin(), digestAlgorithms.end());
+    byteBuffer signedData(derEncode(DER_SEQUENCE, header, encapsulated, rest));
+    return derEncode(DER_SEQUENCE, derBytes(DER_OID, oidSignedData), derEncode(DER_CONTEXT_0, signedData));
+}
@@ -0,0 +1,217 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// versionInfoTests.cpp -- Tests for the version resource decoder.
+
+#include <string>
+#include "test.h"
+#include "testImages.h"
+#include "peHeaders.h"
+#include "versionInfo.h"
+
+namespace {
+
+    void appendUtf16(byteBuffer& target, const std::wstring& text)
+    {
+        for (std::size_t idx = 0; idx < text.size(); ++idx)
+        {
+            target.push_back(static_cast<unsigned char>(text[idx]));
+            target.push_back(static_cast<unsigned char>(text[idx] >> 8));
+        }
+        target.push_back(0);
+        target.push_back(0);
+    }
+
+    void align4(byteBuffer& target)
+    {
+        while (target.size() % 4)
+            target.push_back(0);
+    }
+
+    //One VS_VERSIONINFO node: wLength, wValueLength, wType, the key, then the
+    //value and the children, each 32 bit aligned. Nodes start aligned, so
+    //alignment within a node matches alignment within the whole block.
+    byteBuffer versionNode(const std::wstring& key, std::uint16_t valueLength, std::uint16_t type,
+        const byteBuffer& value, const std::vector<byteBuffer>& children)
+    {
+        byteBuffer node(6);
+        appendUtf16(node, key);
+        align4(node);
+        node.insert(node.end(), value.begin(), value.end());
+        for (std::vector<byteBuffer>::const_iterator it = children.begin(); it != children.end(); ++it)
+        {
+            align4(node);
+            node.insert(node.end(), it->begin(), it->end());
+        }
+        put16(node, 0, static_cast<std::uint32_t>(node.size()));
+        put16(node, 2, valueLength);
+        put16(node, 4, type);
+        return node;
+    }
+
+    byteBuffer stringNode(const std::wstring& name, const std::wstring& value)
+    {
+        byteBuffer text;
+        appendUtf16(text, value);
+        return versionNode(name, static_cast<std::uint16_t>(value.size() + 1), 1, text, std::vector<byteBuffer>());
+    }
+
+    byteBuffer companyTable(const std::wstring& key, const std::wstring& company)
+    {
+        std::vector<byteBuffer> strings;
+        strings.push_back(stringNode(L"FileDescription", L"Test image"));
+        strings.push_back(stringNode(L"CompanyName", company));
+        return versionNode(key, 0, 1, byteBuffer(), strings);
+    }
+
+    byteBuffer translationNode(std::uint16_t language, std::uint16_t codePage)
+    {
+        byteBuffer value;
+        put16(value, 0, language);
+        put16(value, 2, codePage);
+        std::vector<byteBuffer> none;
+        std::vector<byteBuffer> vars(1, versionNode(L"Translation", 4, 0, value, none));
+        return versionNode(L"VarFileInfo", 0, 1, byteBuffer(), vars);
+    }
+
+    byteBuffer versionBlock(const std::vector<byteBuffer>& tables, const byteBuffer& varFileInfo)
+    {
+        //VS_FIXEDFILEINFO; only its length matters here
+        byteBuffer fixed(52);
+        put32(fixed, 0, 0xFEEF04BD);
+        std::vector<byteBuffer> children;
+        children.push_back(versionNode(L"StringFileInfo", 0, 1, byteBuffer(), tables));
+        children.push_back(varFileInfo);
+        return versionNode(L"VS_VERSION_INFO", static_cast<std::uint16_t>(fixed.size()), 0, fixed, children);
+    }
+
+}
+
+TEST(versionInfoDecodesAStringTable)
+{
+    std::vector<byteBuffer> tables(1, companyTable(L"040904B0", L"Contoso"));
+    byteBuffer block(versionBlock(tables, translationNode(0x409, 0x4B0)));
+
+    versionInfo info;
+    CHECK(info.parseBlock(&block[0], block.size()));
+    CHECK(info.getTranslations().size() == 1);
+    CHECK(info.getTranslations()[0].language == 0x409);
+    CHECK(info.getTranslations()[0].codePage == 0x4B0);
+    CHECK(info.getStringTables().size() == 1);
+    CHECK(info.getStringTables()[0].strings.size() == 2);
+    CHECK(info.queryString(L"CompanyName") == L"Contoso");
+    CHECK(info.queryString(L"companyname") == L"Contoso");
+    CHECK(info.queryString(L"FileVersion").empty());
+}
+
+TEST(versionInfoJoinsEveryTranslation)
+{
+    std::vector<byteBuffer> tables;
+    tables.push_back(companyTable(L"040904B0", L"Contoso"));
+    tables.push_back(companyTable(L"040704E4", L"Contoso GmbH"));
+    //A table no translation names is only used for US English
+    tables.push_back(companyTable(L"040C04B0", L"Contoso SARL"));
+    byteBuffer block(versionBlock(tables, translationNode(0x407, 0x4E4)));
+
+    versionInfo info;
+    CHECK(info.parseBlock(&block[0], block.size()));
+    CHECK(info.getStringTables().size() == 3);
+    CHECK(info.queryString(L"CompanyName") == L"Contoso GmbH / Contoso");
+}
+
+TEST(versionInfoRejectsMalformedBlocks)
+{
+    std::vector<byteBuffer> tables(1, companyTable(L"040904B0", L"Contoso"));
+    byteBuffer block(versionBlock(tables, translationNode(0x409, 0x4B0)));
+    versionInfo info;
+    CHECK(!info.parseBlock(&block[0], 5));
+
+    byteBuffer wrongKey(versionNode(L"VS_VERSION_INFX", 0, 0, byteBuffer(), std::vector<byteBuffer>()));
+    CHECK(!info.parseBlock(&wrongKey[0], wrongKey.size()));
+
+    //A key with no terminator inside the node
+    byteBuffer unterminated(block);
+    put16(unterminated, 0, 8);
+    CHECK(!info.parseBlock(&unterminated[0], unterminated.size()));
+}
+
+TEST(versionInfoClampsLengthsToTheBlock)
+{
+    std::vector<byteBuffer> tables(1, companyTable(L"040904B0", L"Contoso"));
+    byteBuffer block(versionBlock(tables, translationNode(0x409, 0x4B0)));
+
+    //Nodes claim to run past the end; the copy has exactly the bytes given.
+    byteBuffer longRoot(block);
+    put16(longRoot, 0, 0xFFFF);
+    versionInfo info;
+    CHECK(info.parseBlock(&longRoot[0], longRoot.size()));
+    CHECK(info.queryString(L"CompanyName") == L"Contoso");
+
+    //The block ends in the middle of the last string's value.
+    std::size_t const cut = block.size() - 10;
+    byteBuffer truncated(block.begin(), block.begin() + cut);
+    CHECK(info.parseBlock(&truncated[0], truncated.size()));
+}
+
+namespace {
+
+    //A PE image whose .rsrc section (at RVA 0x1000, file offset 0x400) holds
+    //a type, name and language directory leading to the version block.
+    testImage versionImage(const byteBuffer& block)
+    {
+        byteBuffer resources;
+        put16(resources, 14, 1);
+        put32(resources, 16, 16);
+        put32(resources, 20, 0x80000000u | 24);
+        put16(resources, 24 + 14, 1);
+        put32(resources, 24 + 16, 1);
+        put32(resources, 24 + 20, 0x80000000u | 48);
+        put16(resources, 48 + 14, 1);
+        put32(resources, 48 + 16, 0x409);
+        put32(resources, 48 + 20, 72);
+        put32(resources, 72, 0x1000 + 88);
+        put32(resources, 76, static_cast<std::uint32_t>(block.size()));
+        putBytes(resources, 88, &block[0], block.size());
+
+        testImage image(0x80, false, 1);
+        std::uint32_t const size = static_cast<std::uint32_t>(resources.size());
+        image.setSection(0, ".rsrc", 0x1000, size, 0x400, (size + 0x1FF) & ~0x1FF);
+        image.setDirectory(peHeaders::DIRECTORY_RESOURCE, 0x1000, size);
+        putBytes(image.data, 0x400, &resources[0], resources.size());
+        return image;
+    }
+
+}
+
+TEST(versionInfoFindsTheResourceInAnImage)
+{
+    std::vector<byteBuffer> tables(1, companyTable(L"040904B0", L"Contoso"));
+    testImage image(versionImage(versionBlock(tables, translationNode(0x409, 0x4B0))));
+
+    peHeaders headers;
+    CHECK(headers.parse(&image.data[0], image.data.size()) == peHeaders::PARSE_COMPLETE);
+    versionInfo info;
+    CHECK(info.parseImage(headers, &image.data[0], image.data.size()));
+    CHECK(info.queryString(L"CompanyName") == L"Contoso");
+
+    //The data entry points past the end of the image.
+    put32(image.data, 0x400 + 72, 0x100000);
+    CHECK(!info.parseImage(headers, &image.data[0], image.data.size()));
+
+    //The language directory points at a data entry past the section.
+    put32(image.data, 0x400 + 72, 0x1000 + 88);
+    CHECK(info.parseImage(headers, &image.data[0], image.data.size()));
+    put32(image.data, 0x400 + 48 + 20, static_cast<std::uint32_t>(image.data.size()));
+    CHECK(!info.parseImage(headers, &image.data[0], image.data.size()));
+
+    //An image with resources, but none of type RT_VERSION
+    put32(image.data, 0x400 + 16, 3);
+    CHECK(!info.parseImage(headers, &image.data[0], image.data.size()));
+
+    //No resource directory at all
+    testImage bare(0x80, false, 0);
+    CHECK(headers.parse(&bare.data[0], bare.data.size()) == peHeaders::PARSE_COMPLETE);
+    CHECK(!info.parseImage(headers, &bare.data[0], bare.data.size()));
+}
@@ -0,0 +1,233 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// wildcardAutomatonTests.cpp -- Tests the compiled vFind wildcard matcher
+// against fpattern, which it replaces.
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "test.h"
+#include "wildcardAutomaton.h"
+#include "fpattern.h"
+
+namespace {
+
+    bool automatonMatches(const std::wstring& pattern, const wchar_t *name)
+    {
+        return wildcardAutomaton(std::vector<std::wstring>(1, pattern)).match(name);
+    }
+
+    std::wstring randomText(const std::wstring& alphabet, std::size_t maxLength)
+    {
+        std::wstring result;
+        std::size_t const length = std::rand() % (maxLength + 1);
+        for (std::size_t idx = 0; idx < length; ++idx)
+            result.push_back(alphabet[std::rand() % alphabet.size()]);
+        return result;
+    }
+
+    struct matchCase
+    {
+        const wchar_t *pattern;
+        const wchar_t *name;
+        bool expected;
+    };
+
+}
+
+TEST(wildcardAutomatonMatchesEdgeCases)
+{
+    static const matchCase cases[] = {
+        { L"", L"", true },
+        { L"", L"a", false },
+        { L"*", L"", true },
+        { L"*", L"anything.txt", true },
+        { L"**", L"", true },
+        { L"?", L"", false },
+        { L"?", L"a", true },
+        { L"?", L"ab", false },
+        { L"*?", L"", false },
+        { L"*?", L"abc", true },
+        { L"?*", L"a", true },
+        { L"?*?", L"a", false },
+        { L"a*b", L"ab", true },
+        { L"a*b", L"aXXb", true },
+        { L"a*b", L"aXXbc", false },
+        { L"*.txt", L"NOTES.TXT", true },
+        { L"*.txt", L"notes.txt.bak", false },
+        { L"[abc]", L"B", true },
+        { L"[abc]", L"d", false },
+        { L"[a-c]x", L"Bx", true },
+        { L"[!abc]", L"d", true },
+        { L"[!abc]", L"B", false },
+        { L"[!abc]", L"de", false },
+        { L"[!a-c]x", L"dx", true },
+        { L"[!a-c]x", L"bx", false },
+        { L"[!a-c]*", L"d", true },
+        { L"`*", L"*", true },
+        { L"`*", L"a", false },
+        { L"[`]]", L"]", true },
+        { L"\x1A.txt", L"a.txt", true },
+        { L"\x1A.txt", L"a.b.txt", false },
+        { L"!*.txt", L"a.txt", false },
+        { L"!*.txt", L"a.doc", true },
+        { L"a!b*", L"ac", true },
+        { L"a!b*", L"abc", false },
+    };
+    for (std::size_t idx = 0; idx < sizeof(cases) / sizeof(cases[0]); ++idx)
+    {
+        CHECK(fpattern_isvalid(cases[idx].pattern));
+        CHECK((fpattern_matchn(cases[idx].pattern, cases[idx].name) != 0) == cases[idx].expected);
+        CHECK(automatonMatches(cases[idx].pattern, cases[idx].name) == cases[idx].expected);
+    }
+
+    //fpattern lets a negated set match the end of the name, then reads past
+    //it. A set always needs a character here.
+    CHECK(!automatonMatches(L"[!abc]", L""));
+    CHECK(automatonMatches(L"*[!.]", L"a.b"));
+    CHECK(!automatonMatches(L"*[!.]", L"a."));
+    CHECK(!automatonMatches(L"a[!b]*", L"a"));
+}
+
+TEST(wildcardAutomatonAgreesWithFpattern)
+{
+    //Every special character, both cases of some letters and the characters
+    //which only mean something inside a set
+    std::wstring const patternAlphabet(L"aAbB.c?*\x1A[]!-`x");
+    std::wstring const nameAlphabet(L"aAbBc.xX-![]`");
+    std::srand(4321);
+    for (int round = 0; round < 20000; ++round)
+    {
+        std::wstring const pattern(randomText(patternAlphabet, 8));
+        if (!fpattern_isvalid(pattern.c_str()))
+            continue;
+        //Negated sets are compared below, where fpattern cannot read past
+        //the end of the name.
+        if (pattern.find(L"[!") != std::wstring::npos)
+            continue;
+        wildcardAutomaton const automaton(std::vector<std::wstring>(1, pattern));
+        for (int name = 0; name < 20; ++name)
+        {
+            std::wstring const text(randomText(nameAlphabet, 8));
+            CHECK(automaton.match(text.c_str()) == (fpattern_matchn(pattern.c_str(), text.c_str()) != 0));
+        }
+    }
+}
+
+TEST(wildcardAutomatonAgreesWithFpatternOnNegatedSets)
+{
+    //A negated set between a prefix and a suffix without sets or quotes.
+    //fpattern compares the set with the end of the name, and reads past it,
+    //exactly when the prefix matches the whole name; those names are left out.
+    std::wstring const plainAlphabet(L"aAbB.c?*\x1A!x");
+    std::wstring const setAlphabet(L"aAbB.c-x");
+    std::wstring const nameAlphabet(L"aAbBc.xX-!");
+    std::srand(5678);
+    for (int round = 0; round < 20000; ++round)
+    {
+        std::wstring const prefix(randomText(plainAlphabet, 4));
+        std::wstring set(randomText(setAlphabet, 3));
+        if (set.empty() || set[0] == L'-' || set[set.size() - 1] == L'-')
+            set.insert(set.begin(), L'x');
+        std::wstring const pattern(prefix + L"[!" + set + L"]" + randomText(plainAlphabet, 4));
+        if (!fpattern_isvalid(pattern.c_str()) || prefix.find(L'!') != std::wstring::npos)
+            continue;
+        wildcardAutomaton const automaton(std::vector<std::wstring>(1, pattern));
+        for (int name = 0; name < 20; ++name)
+        {
+            std::wstring const text(randomText(nameAlphabet, 8));
+            if (fpattern_matchn(prefix.c_str(), text.c_str()))
+                continue;
+            CHECK(automaton.match(text.c_str()) == (fpattern_matchn(pattern.c_str(), text.c_str()) != 0));
+        }
+    }
+}
+
+TEST(wildcardAutomatonAgreesWithFpatternOnEveryEngine)
+{
+    //Patterns whose deterministic automata grow past STATE_LIMIT run as a
+    //bit-parallel NFA; those too long for that are left to fpattern.
+    std::wstring wide(L"*a");
+    wide.append(20, L'?');
+    std::wstring tooLong(L"*a");
+    tooLong.append(80, L'?');
+    const wchar_t *patterns[] = { L"*a*b*c*d*e*f*g*h*.txt", L"*.[ch]*", L"!*.txt", L"*!*a????????????", wide.c_str(), tooLong.c_str() };
+    std::wstring const nameAlphabet(L"abcAB.");
+    std::srand(99);
+    for (std::size_t idx = 0; idx < sizeof(patterns) / sizeof(patterns[0]); ++idx)
+    {
+        wildcardAutomaton const automaton(std::vector<std::wstring>(1, patterns[idx]));
+        for (int name = 0; name < 2000; ++name)
+        {
+            std::wstring const text(randomText(nameAlphabet, 100));
+            CHECK(automaton.match(text.c_str()) == (fpattern_matchn(patterns[idx], text.c_str()) != 0));
+        }
+    }
+    CHECK(wildcardAutomaton(std::vector<std::wstring>(1, wide)).isCompiled());
+    CHECK(!wildcardAutomaton(std::vector<std::wstring>(1, tooLong)).isCompiled());
+}
+
+TEST(wildcardSetMatchesLikeEachPattern)
+{
+    //Plain names and *.ext patterns go to the hash tables, the rest to
+    //shared automata; the set matches a name if any pattern does.
+    std::wstring const nameAlphabet(L"aAbBc.x");
+    std::wstring const patternAlphabet(L"aAbB.c?*\x1A[]-`x");
+    std::srand(2468);
+    for (int round = 0; round < 2000; ++round)
+    {
+        std::vector<std::wstring> patterns;
+        std::size_t const count = 1 + std::rand() % 40;
+        while (patterns.size() < count)
+        {
+            std::wstring pattern;
+            switch (std::rand() % 3)
+            {
+            case 0:
+                pattern = randomText(nameAlphabet, 6);
+                break;
+            case 1:
+                pattern = L"*" + randomText(nameAlphabet, 4);
+                break;
+            default:
+                pattern = randomText(patternAlphabet, 8);
+                break;
+            }
+            if (fpattern_isvalid(pattern.c_str()) && pattern.find(L"[!") == std::wstring::npos)
+                patterns.push_back(pattern);
+        }
+        wildcardSet const set(patterns);
+        for (int name = 0; name < 50; ++name)
+        {
+            std::wstring const text(randomText(nameAlphabet, 8));
+            bool expected = false;
+            for (std::size_t idx = 0; idx < patterns.size() && !expected; ++idx)
+                expected = fpattern_matchn(patterns[idx].c_str(), text.c_str()) != 0;
+            CHECK(set.match(text.c_str()) == expected);
+        }
+    }
+}
+
+TEST(wildcardSetSplitsLargeAutomata)
+{
+    //Together these are far past STATE_LIMIT, so the set splits them into
+    //several automata, down to single patterns if need be.
+    std::vector<std::wstring> patterns;
+    for (wchar_t first = L'a'; first <= L'h'; ++first)
+        for (wchar_t second = L'a'; second <= L'h'; ++second)
+            patterns.push_back(std::wstring(L"*") + first + L"???" + second + L"*");
+    wildcardSet const set(patterns);
+    std::wstring const nameAlphabet(L"abcdefghABCDEFGH.");
+    std::srand(1357);
+    for (int name = 0; name < 2000; ++name)
+    {
+        std::wstring const text(randomText(nameAlphabet, 12));
+        bool expected = false;
+        for (std::size_t idx = 0; idx < patterns.size() && !expected; ++idx)
+            expected = fpattern_matchn(patterns[idx].c_str(), text.c_str()) != 0;
+        CHECK(set.match(text.c_str()) == expected);
+    }
+}
@@ -0,0 +1,135 @@
+//          Copyright Billy O'Neal 2012
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+//
+// wildcardBenchmark.cpp -- Times an OR of vFind regexes matched three ways:
+// fpattern on each pattern in turn, one wildcardAutomaton per pattern, and
+// one wildcardSet for them all. "make benchmark" runs it.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <memory>
+#include "wildcardAutomaton.h"
+#include "fpattern.h"
+
+namespace {
+
+    std::wstring randomText(const std::wstring& alphabet, std::size_t minLength, std::size_t maxLength)
+    {
+        std::wstring result;
+        std::size_t const length = minLength + std::rand() % (maxLength - minLength + 1);
+        for (std::size_t idx = 0; idx < length; ++idx)
+            result.push_back(alphabet[std::rand() % alphabet.size()]);
+        return result;
+    }
+
+    std::wstring randomExtension()
+    {
+        static const wchar_t *extensions[] = { L"exe", L"dll", L"sys", L"txt", L"log", L"dat", L"ini", L"tmp", L"cab", L"mui" };
+        return extensions[std::rand() % (sizeof(extensions) / sizeof(extensions[0]))];
+    }
+
+    //A mix like a -loadline list of names to find: mostly exact names and
+    //extensions, with some general patterns
+    std::vector<std::wstring> makePatterns(std::size_t count)
+    {
+        std::wstring const letters(L"abcdefghijklmnopqrstuvwxyz0123456789");
+        std::vector<std::wstring> patterns;
+        for (std::size_t idx = 0; idx < count; ++idx)
+        {
+            switch (idx % 4)
+            {
+            case 0:
+            case 1:
+                patterns.push_back(randomText(letters, 4, 10) + L"." + randomText(letters, 3, 3));
+                break;
+            case 2:
+                patterns.push_back(L"*." + randomText(letters, 2, 2) + L"?");
+                break;
+            default:
+                patterns.push_back(randomText(letters, 1, 1) + L"*" + randomText(letters, 1, 1) + L"?." + randomExtension());
+                break;
+            }
+        }
+        return patterns;
+    }
+
+    template <typename matcher>
+    void measure(const char *label, const std::vector<std::wstring>& names, unsigned int repeats, matcher matches)
+    {
+        std::size_t found = 0;
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+        for (unsigned int repeat = 0; repeat < repeats; ++repeat)
+            for (std::vector<std::wstring>::const_iterator it = names.begin(); it != names.end(); ++it)
+                found += matches(it->c_str()) ? 1 : 0;
+        double const elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::printf("  %-30s %12.1f ns per name (%u matches)\n", label, elapsed / (names.size() * repeats), static_cast<unsigned int>(found / repeats));
+    }
+
+    struct fpatternEach
+    {
+        const std::vector<std::wstring> *patterns;
+        bool operator()(const wchar_t *name) const
+        {
+            for (std::vector<std::wstring>::const_iterator it = patterns->begin(); it != patterns->end(); ++it)
+                if (fpattern_matchn(it->c_str(), name))
+                    return true;
+            return false;
+        }
+    };
+
+    struct automatonEach
+    {
+        const std::vector<std::shared_ptr<wildcardAutomaton> > *automata;
+        bool operator()(const wchar_t *name) const
+        {
+            for (std::vector<std::shared_ptr<wildcardAutomaton> >::const_iterator it = automata->begin(); it != automata->end(); ++it)
+                if ((*it)->match(name))
+                    return true;
+            return false;
+        }
+    };
+
+    struct combined
+    {
+        const wildcardSet *set;
+        bool operator()(const wchar_t *name) const
+        {
+            return set->match(name);
+        }
+    };
+
+}
+
+int main()
+{
+    std::srand(1);
+    std::wstring const nameLetters(L"abcdefghijklmnopqrstuvwxyz0123456789_");
+    std::vector<std::wstring> names;
+    for (int idx = 0; idx < 2000; ++idx)
+        names.push_back(randomText(nameLetters, 3, 16) + L"." + randomExtension());
+
+    std::size_t const counts[] = { 1, 10, 100, 1000 };
+    for (std::size_t count = 0; count < sizeof(counts) / sizeof(counts[0]); ++count)
+    {
+        std::vector<std::wstring> const patterns(makePatterns(counts[count]));
+        std::vector<std::shared_ptr<wildcardAutomaton> > automata;
+        for (std::vector<std::wstring>::const_iterator it = patterns.begin(); it != patterns.end(); ++it)
+            automata.push_back(std::make_shared<wildcardAutomaton>(std::vector<std::wstring>(1, *it)));
+        wildcardSet const set(patterns);
+        unsigned int const repeats = static_cast<unsigned int>(4000 / counts[count]) + 1;
+
+        std::printf("%u patterns:\n", static_cast<unsigned int>(counts[count]));
+        fpatternEach each = { &patterns };
+        measure("fpattern, one by one", names, repeats, each);
+        automatonEach compiled = { &automata };
+        measure("wildcardAutomaton, one by one", names, repeats, compiled);
+        combined all = { &set };
+        measure("wildcardSet", names, repeats, all);
+    }
+    return 0;
+}